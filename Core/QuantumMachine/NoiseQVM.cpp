@@ -52,11 +52,7 @@ std::map<string, size_t> NoiseQVM::runWithConfiguration(QProg &prog, std::vector
 
 std::map<std::string, size_t> NoiseQVM::runWithConfiguration(QProg& prog, std::vector<int>& cibts_addr, int shots, const NoiseModel&)
 {
-    std::vector<ClassicalCondition> cbits_vect;
-	auto cmem = OriginCMem::get_instance();
-	for (auto addr : cibts_addr)
-		cbits_vect.push_back(cmem->get_cbit_by_addr(addr));
-
+    auto cbits_vect = _get_cbits_by_addr(cibts_addr);
 	return runWithConfiguration(prog, cbits_vect, shots);
 }
 
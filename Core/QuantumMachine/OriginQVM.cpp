@@ -21,6 +21,9 @@ limitations under the License.
 #include "VirtualQuantumProcessor/GPUImplQPU.h"
 #include "VirtualQuantumProcessor/CPUImplQPU.h"
 #include "VirtualQuantumProcessor/CPUImplQPUSingleThread.h"
+#include "VirtualQuantumProcessor/OutOfCoreImplQPU.h"
+#include "VirtualQuantumProcessor/SparseImplQPU.h"
+#include "VirtualQuantumProcessor/AbstractFullAmplitudeEngine.h"
 #include "Core/Utilities/Tools/QPandaException.h"
 #include "Core/Utilities/Tools/Utils.h"
 #include "Core/Utilities/QProgInfo/QuantumMetadata.h"
@@ -30,6 +33,12 @@ limitations under the License.
 #include "Core/Utilities/QProgInfo/QProgProgress.h"
 #include "Core/Utilities/Tools/QStatMatrix.h"
 #include "Core/Utilities/Tools/QProgFlattening.h"
+#include "Core/Utilities/Tools/QCircuitFusion.h"
+#include "Core/Utilities/QProgInfo/QCircuitInfo.h"
+#include "Core/Utilities/Tools/QProgLightCone.h"
+#include "Core/Utilities/Tools/ShotSampler.h"
+#include "Core/Utilities/Tools/PauliGrouping.h"
+#include "Core/QuantumMachine/QProgBranchExecution.h"
 #include <set>
 #include <thread>
 #ifdef USE_OPENMP
@@ -92,6 +101,23 @@ void QVM::initState(const QStat& state, const QVec& qlist)
 		});
 		QPANDA_ASSERT(qlist.size() != qubit_set.size(), "Error: initState state qlist.");
 
+		/* the CPU backends write the state of all the qubits straight to where they keep it */
+		Qnum qubits;
+		for (auto qubit : qlist)
+		{
+			qubits.push_back(qubit->get_phy_addr());
+		}
+		if (auto qpu = dynamic_cast<CPUImplQPU<double> *>(_pGates))
+		{
+			qpu->initState(qubit_alloc_size, state, qubits);
+			return;
+		}
+		if (auto qpu = dynamic_cast<CPUImplQPU<float> *>(_pGates))
+		{
+			qpu->initState(qubit_alloc_size, state, qubits);
+			return;
+		}
+
 		QStat init_state(1ull << qubit_alloc_size, 0);
 		for (int64_t i = 0; i < state.size(); i++)
 		{
@@ -128,17 +154,8 @@ std::map<string, size_t> QVM::run_with_optimizing(QProg& prog, std::vector<Class
 
 	QProgExecution prog_exec;
 	prog_exec.execute(prog.getImplementationPtr(), nullptr, traver_param, _pGates);
-	map<size_t, size_t> result;
-
-	vector<double> random_nums(shots, 0);
-	for (size_t i = 0; i < shots; i++)
-	{
-		random_nums[i] = random_generator19937();
-	}
 
-	std::sort(random_nums.begin(), random_nums.end(), [](double& a, double b) { return a > b; });
 	prob_vec probs;
-
 	Qnum qubits_nums = traver_param.m_measure_qubits;
 	_pGates->pMeasure(qubits_nums, probs);
 	std::unordered_multimap<size_t, CBit*> qubit_cbit_map;
@@ -147,51 +164,54 @@ std::map<string, size_t> QVM::run_with_optimizing(QProg& prog, std::vector<Class
 		qubit_cbit_map.insert({ traver_param.m_measure_qubits[i], traver_param.m_measure_cc[i] });
 	}
 
-	double p_sum = 0;
-	for (size_t i = 0; i < probs.size(); i++)
+	/* shots are counted by outcome, the cbits are only written once per outcome */
+	auto outcome_counts = ShotSampler(probs).sample_counts(shots, _pGates->get_random_seed());
+	size_t measure_num = traver_param.m_measure_cc.size();
+	for (const auto& outcome : outcome_counts)
 	{
-		if (probs[i] < DBL_EPSILON && probs[i] > -DBL_EPSILON)
+		for (size_t j = 0; j < measure_num; j++)
 		{
-			continue;
-		}
-
-		p_sum += probs[i];
-		auto iter = random_nums.rbegin();
-		while (iter != random_nums.rend() && *iter < p_sum)
-		{
-			size_t measure_num = traver_param.m_measure_cc.size();
-			auto bin_str_index = integerToBinary(i, measure_num);
-			for (size_t j = 0; j < measure_num; j++)
+			auto mulit_iter = qubit_cbit_map.equal_range(qubits_nums[j]);
+			while (mulit_iter.first != mulit_iter.second)
 			{
-				auto qubit_idx = qubits_nums[j];
-				auto mulit_iter = qubit_cbit_map.equal_range(qubit_idx);
-				while (mulit_iter.first != mulit_iter.second)
-				{
-					auto cbit = mulit_iter.first->second;
-					cbit->set_val(bin_str_index[measure_num - j - 1] - 0x30);
-					_QResult->append({ cbit->getName(), cbit->getValue() });
-					++mulit_iter.first;
-				}
+				auto cbit = mulit_iter.first->second;
+				cbit->set_val((outcome.first >> j) & 1);
+				_QResult->append({ cbit->getName(), cbit->getValue() });
+				++mulit_iter.first;
 			}
+		}
 
-			random_nums.pop_back();
-			iter = random_nums.rbegin();
+		string result_bin_str = _ResultToBinaryString(cbits);
+		std::reverse(result_bin_str.begin(), result_bin_str.end());
+		result_map[result_bin_str] += outcome.second;
+	}
 
-			string result_bin_str = _ResultToBinaryString(cbits);
-			std::reverse(result_bin_str.begin(), result_bin_str.end());
-			if (result_map.find(result_bin_str) == result_map.end())
-			{
-				result_map[result_bin_str] = 1;
-			}
-			else
-			{
-				result_map[result_bin_str] += 1;
-			}
+	return result_map;
+}
+
+std::map<string, size_t> QVM::_branch_result(const std::vector<ShotBranch>& branches, std::vector<ClassicalCondition>& cbits)
+{
+	/* a cbit a branch hasn't measured reads the result it had before the shots */
+	auto start_result = _QResult->getResultMap();
+	map<string, size_t> result_map;
+	for (const auto& branch : branches)
+	{
+		auto branch_result = start_result;
+		for (const auto& item : branch.m_result)
+		{
+			branch_result[item.first] = item.second;
 		}
 
-		if (0 == random_nums.size())
+		string result_bin_str = _ResultToBinaryString(cbits, branch_result);
+		std::reverse(result_bin_str.begin(), result_bin_str.end());
+		result_map[result_bin_str] += branch.m_shots;
+	}
+
+	if (!branches.empty())
+	{
+		for (const auto& item : branches.back().m_result)
 		{
-			break;
+			_QResult->append(item);
 		}
 	}
 
@@ -521,37 +541,243 @@ void QVM::run(QProg& qprog, const NoiseModel& noise_model)
 	}
 }
 
-void CPUQVM::run(QProg& qprog, const NoiseModel& noise_model)
+void CPUQVM::set_max_fusion_qubits(size_t qubit_num)
+{
+    QPANDA_ASSERT(qubit_num > 5, "Error: max fusion qubits.");
+    m_max_fusion_qubits = qubit_num;
+}
+
+void CPUQVM::set_cache_block_qubits(size_t qubit_num)
+{
+    if (auto qpu = dynamic_cast<CPUImplQPU<double> *>(_pGates))
+    {
+        qpu->set_cache_block_qubits(qubit_num);
+        return;
+    }
+
+    auto qpu = dynamic_cast<CPUImplQPU<float> *>(_pGates);
+    QPANDA_ASSERT(nullptr == qpu, "Error: CPUImplQPU.");
+    qpu->set_cache_block_qubits(qubit_num);
+}
+
+void CPUQVM::set_state_page_mode(StatePageMode mode)
+{
+    if (auto qpu = dynamic_cast<CPUImplQPU<double> *>(_pGates))
+    {
+        qpu->set_state_page_mode(mode);
+        return;
+    }
+
+    auto qpu = dynamic_cast<CPUImplQPU<float> *>(_pGates);
+    QPANDA_ASSERT(nullptr == qpu, "Error: CPUImplQPU.");
+    qpu->set_state_page_mode(mode);
+}
+
+void CPUQVM::set_init_state_directory(const std::string& directory)
+{
+    if (auto qpu = dynamic_cast<CPUImplQPU<double> *>(_pGates))
+    {
+        qpu->set_init_state_directory(directory);
+        return;
+    }
+
+    auto qpu = dynamic_cast<CPUImplQPU<float> *>(_pGates);
+    QPANDA_ASSERT(nullptr == qpu, "Error: CPUImplQPU.");
+    qpu->set_init_state_directory(directory);
+}
+
+void CPUQVM::set_qubit_compaction(bool enable)
+{
+    m_is_qubit_compaction = enable;
+}
+
+/* the state analyses run on the CPUImplQPU of either precision */
+template <typename Func>
+static auto on_cpu_qpu(QPUImpl* qpu, Func&& func) -> decltype(func((CPUImplQPU<double> *)nullptr))
+{
+    if (auto cpu_qpu = dynamic_cast<CPUImplQPU<double> *>(qpu))
+    {
+        return func(cpu_qpu);
+    }
+
+    auto cpu_qpu = dynamic_cast<CPUImplQPU<float> *>(qpu);
+    QPANDA_ASSERT(nullptr == cpu_qpu, "Error: CPUImplQPU.");
+    return func(cpu_qpu);
+}
+
+static Qnum qubit_addrs(const QVec& qubits)
+{
+    Qnum addrs;
+    for (auto qubit : qubits)
+    {
+        addrs.push_back(qubit->get_phy_addr());
+    }
+    return addrs;
+}
+
+/* the terms of a hamiltonian on the addresses of the qubits their indices refer to */
+static QHamiltonian phy_hamiltonian(const QHamiltonian& hamiltonian, const QVec& qv)
+{
+    QHamiltonian phy_hamiltonian;
+    for (const auto& component : hamiltonian)
+    {
+        QTerm phy_term;
+        for (const auto& pauli : component.first)
+        {
+            phy_term[qv[pauli.first]->get_phy_addr()] = pauli.second;
+        }
+        phy_hamiltonian.push_back({ phy_term, component.second });
+    }
+    return phy_hamiltonian;
+}
+
+QStat CPUQVM::get_reduced_density_matrix(const QVec& qubits)
+{
+    auto addrs = qubit_addrs(qubits);
+    return on_cpu_qpu(_pGates, [&](auto qpu) { return qpu->reduced_density_matrix(addrs); });
+}
+
+prob_vec CPUQVM::get_schmidt_spectrum(const QVec& qubits)
 {
+    auto addrs = qubit_addrs(qubits);
+    return on_cpu_qpu(_pGates, [&](auto qpu) { return qpu->schmidt_spectrum(addrs); });
+}
+
+double CPUQVM::get_entanglement_entropy(const QVec& qubits, double alpha)
+{
+    auto addrs = qubit_addrs(qubits);
+    return on_cpu_qpu(_pGates, [&](auto qpu) { return qpu->entanglement_entropy(addrs, alpha); });
+}
+
+std::vector<std::vector<double>> CPUQVM::batch_expectation(const ParametricProg& builder,
+    const std::vector<std::vector<double>>& params,
+    const std::vector<QHamiltonian>& hamiltonians, const QVec& qv)
+{
+    std::vector<QHamiltonian> phy_hamiltonians;
+    for (const auto& hamiltonian : hamiltonians)
+    {
+        phy_hamiltonians.push_back(phy_hamiltonian(hamiltonian, qv));
+    }
+
+    QProgBatchExecution batch_exec(builder, getAllocateQubitNum());
+    return batch_exec.expectation(params, phy_hamiltonians);
+}
+
+std::vector<prob_vec> CPUQVM::batch_prob_list(const ParametricProg& builder,
+    const std::vector<std::vector<double>>& params, const QVec& qubits)
+{
+    QProgBatchExecution batch_exec(builder, getAllocateQubitNum());
+    return batch_exec.prob_list(params, qubit_addrs(qubits));
+}
+
+void CPUQVM::_compact_qubits(QProg& prog)
+{
+    if (!m_is_qubit_compaction)
+    {
+        return;
+    }
+
+    /* chip mapped progs use a few qubits at high addresses */
     QVec used_qv;
-    this->get_allocate_qubits(used_qv);
-    QProg prog;
-    QNodeDeepCopy deep_copy;
-    auto prog_node = qprog.getImplementationPtr();
-    prog = deep_copy.copy_node(prog_node);
-    if ((!used_qv.empty()))
+    get_all_used_qubits(prog, used_qv);
+    Qnum used_qubits;
+    for (auto qubit : used_qv)
     {
-        merge_QGate(prog);
+        used_qubits.push_back(qubit->get_phy_addr());
     }
+
+    if (auto qpu = dynamic_cast<CPUImplQPU<double> *>(_pGates))
+    {
+        qpu->set_used_qubits(used_qubits);
+    }
+    else if (auto qpu = dynamic_cast<CPUImplQPU<float> *>(_pGates))
+    {
+        qpu->set_used_qubits(used_qubits);
+    }
+}
+
+std::map<string, size_t> CPUQVM::run_with_optimizing(QProg& prog, std::vector<ClassicalCondition>& cbits,
+    int shots, TraversalConfig& traver_param)
+{
+    if (!traver_param.m_measure_qubits.empty() && prog.get_max_qubit_addr() + 1 >= kCompactionMinQubits)
+    {
+        _compact_qubits(prog);
+    }
+
+    return QVM::run_with_optimizing(prog, cbits, shots, traver_param);
+}
+
+std::map<string, size_t> CPUQVM::run_with_normal(QProg& prog, std::vector<ClassicalCondition>& cbits,
+    int shots, const NoiseModel& noise_model)
+{
+    bool is_cpu_qpu = nullptr != dynamic_cast<CPUImplQPU<double> *>(_pGates)
+        || nullptr != dynamic_cast<CPUImplQPU<float> *>(_pGates);
+    if (!is_cpu_qpu || shots <= 1 || noise_model.enabled() || noise_model.readout_error_enabled()
+        || std::abs(noise_model.rotation_error()) > DBL_EPSILON)
+    {
+        return QVM::run_with_normal(prog, cbits, shots, noise_model);
+    }
+
+    QProgBranchExecution branch_exec(prog);
+    if (!branch_exec.is_supported())
+    {
+        return QVM::run_with_normal(prog, cbits, shots, noise_model);
+    }
+
+    size_t qubit_num = prog.get_max_qubit_addr() + 1;
+    if (qubit_num >= kCompactionMinQubits)
+    {
+        _compact_qubits(prog);
+    }
+    _pGates->initState(0, 1, qubit_num);
+
+    std::vector<CBit*> all_cbits;
+    _CMem->get_allocate_cbits(all_cbits);
+
+    /* the machine keeps owning _pGates, it ends with the state of the last branch */
+    std::shared_ptr<QPUImpl> qpu(_pGates, [](QPUImpl*) {});
+    auto branches = branch_exec.execute(qpu, shots, all_cbits);
+    return _branch_result(branches, cbits);
+}
+
+void CPUQVM::run(QProg& qprog, const NoiseModel& noise_model)
+{
     try
     {
         TraversalConfig config(noise_model.rotation_error());
         config.m_can_optimize_measure = false;
 
         std::shared_ptr<AbstractQuantumProgram> qp = nullptr;
+        size_t qubit_num = qprog.get_max_qubit_addr() + 1;
         if (noise_model.enabled())
         {
             /* generate simulate prog contains virtual noise gate */
             auto noise_qprog = NoiseProgGenerator().generate_noise_prog(noise_model, qprog.getImplementationPtr());
             qp = noise_qprog.getImplementationPtr();
         }
+        else if (m_max_fusion_qubits > 0 && qubit_num >= kFusionMinQubits
+            && std::abs(noise_model.rotation_error()) <= DBL_EPSILON)
+        {
+            /* run the fused copy, every fused block is one pass over the state */
+            QNodeDeepCopy deep_copy;
+            QProg prog = deep_copy.copy_node(qprog.getImplementationPtr());
+            Fusion().aggregate_blocks(prog, m_max_fusion_qubits);
+            qp = prog.getImplementationPtr();
+        }
         else {
             qp = qprog.getImplementationPtr();
         }
         QPANDA_ASSERT(qp == nullptr, "Error: not valid quantum program");
 
+        qubit_num = std::max(qubit_num, qp->get_max_qubit_addr() + 1);
+        if (!noise_model.enabled() && qubit_num >= kCompactionMinQubits)
+        {
+            QProg sim_prog(qp);
+            _compact_qubits(sim_prog);
+        }
+
         //_pGates->initState(0, 1, _Qubit_Pool->get_max_usedqubit_addr() + 1);
-        _pGates->initState(0, 1, qp->get_max_qubit_addr() + 1);
+        _pGates->initState(0, 1, qubit_num);
 
         QProgExecution prog_exec;
         /* use QProgExecution object address(uniqe in process) as qprog process id _ExecId for recording execute progress */
@@ -636,6 +862,10 @@ bool QVM::swapQubitPhysicalAddress(Qubit* first_qubit, Qubit* second_qubit)
 void QVM::set_random_engine(RandomEngine* rng)
 {
 	random_engine = rng;
+	if (nullptr != _pGates)
+	{
+		_pGates->set_random_engine(rng);
+	}
 }
 
 QResult* QVM::getResult()
@@ -746,19 +976,24 @@ prob_tuple IdealQVM::PMeasure(QVec qubit_vector, int select_max)
 		prob_vec pmeasure_vector;
 		_pGates->pMeasure(vqubit, pmeasure_vector);
 
+		result_vec.reserve(pmeasure_vector.size());
 		for (auto i = 0; i < pmeasure_vector.size(); ++i)
 		{
 			result_vec.emplace_back(make_pair(i, pmeasure_vector[i]));
 		}
-		sort(result_vec.begin(), result_vec.end(),
-			[=](std::pair<size_t, double> a, std::pair<size_t, double> b) {return a.second > b.second; });
+
+		auto prob_greater = [](const std::pair<size_t, double>& a, const std::pair<size_t, double>& b) {
+			return a.second > b.second;
+		};
 
 		if ((select_max == -1) || (pmeasure_vector.size() <= select_max))
 		{
+			sort(result_vec.begin(), result_vec.end(), prob_greater);
 			return result_vec;
 		}
 		else
 		{
+			partial_sort(result_vec.begin(), result_vec.begin() + select_max, result_vec.end(), prob_greater);
 			result_vec.erase(result_vec.begin() + select_max, result_vec.end());
 			return result_vec;
 		}
@@ -1068,7 +1303,7 @@ QGate QVM::_generate_operation(std::vector<QGate>& fusion_gates)
 QGate QVM::_generate_operation_internal(const std::vector<QGate> &fusion_gates,
     const std::vector<int> &qubits)
 {
-    CPUImplQPU cpu;
+    CPUImplQPU<double> cpu;
     QStat state;
     cpu.initMatrixState(qubits.size() * 2, state);
     for (int i = 0; i < fusion_gates.size(); i++)
@@ -1173,7 +1408,7 @@ QGate QVM::_generate_operation_internal(const std::vector<QGate> &fusion_gates,
 QGate QVM::_generate_oracle_gate(const std::vector<QGate>& fusion_gates,
     const std::vector<int>& qubits)
 {
-    CPUImplQPU cpu;
+    CPUImplQPU<double> cpu;
     QStat state;
     cpu.initMatrixState(qubits.size() * 2, state);
     for (int i = fusion_gates.size() - 1; i >= 0; i--)
@@ -1302,13 +1537,17 @@ prob_vec IdealQVM::getProbList(QVec vQubit, int selectMax)
 
 string QVM::_ResultToBinaryString(vector<ClassicalCondition>& vCBit)
 {
-	string sTemp;
 	if (nullptr == _QResult)
 	{
 		QCERR("_QResult is null");
 		throw qvm_attributes_error("_QResult is null");
 	}
-	auto resmap = _QResult->getResultMap();
+	return _ResultToBinaryString(vCBit, _QResult->getResultMap());
+}
+
+string QVM::_ResultToBinaryString(vector<ClassicalCondition>& vCBit, map<string, bool> resmap)
+{
+	string sTemp;
 	for (auto c : vCBit)
 	{
 		auto cbit = c.getExprPtr()->getCBit();
@@ -1401,36 +1640,39 @@ prob_dict IdealQVM::getProbDict(QVec vQubit, int selectMax)
 prob_tuple IdealQVM::
 probRunTupleList(QProg& qProg, QVec vQubit, int selectMax)
 {
-	run(qProg);
+	QProg sim_prog = _light_cone_prog(qProg, vQubit);
+	run(sim_prog);
 	return getProbTupleList(vQubit, selectMax);
 }
 
 prob_vec IdealQVM::
 probRunList(QProg& qProg, QVec vQubit, int selectMax)
 {
-	run(qProg);
+	QProg sim_prog = _light_cone_prog(qProg, vQubit);
+	run(sim_prog);
 	return getProbList(vQubit, selectMax);
 }
 prob_dict IdealQVM::
 probRunDict(QProg& qProg, QVec vQubit, int selectMax)
 {
-	run(qProg);
+	QProg sim_prog = _light_cone_prog(qProg, vQubit);
+	run(sim_prog);
 	return getProbDict(vQubit, selectMax);
 }
 
 prob_tuple IdealQVM::probRunTupleList(QProg& qProg, const std::vector<int>& qubits_addr, int selectMax)
 {
-	return probRunTupleList(qProg, get_qubits_by_phyaddrs(qubits_addr), selectMax);
+	return probRunTupleList(qProg, _get_qubits_by_addr(qubits_addr), selectMax);
 }
 
 prob_vec IdealQVM::probRunList(QProg& qProg, const std::vector<int>& qubits_addr, int selectMax)
 {
-	return probRunList(qProg, get_qubits_by_phyaddrs(qubits_addr), selectMax);
+	return probRunList(qProg, _get_qubits_by_addr(qubits_addr), selectMax);
 }
 
 prob_dict IdealQVM::probRunDict(QProg& qProg, const std::vector<int>& qubits_addr, int selectMax)
 {
-	return probRunDict(qProg, get_qubits_by_phyaddrs(qubits_addr), selectMax);
+	return probRunDict(qProg, _get_qubits_by_addr(qubits_addr), selectMax);
 }
 
 
@@ -1447,14 +1689,71 @@ runWithConfiguration(QProg& qProg, vector<ClassicalCondition>& vCBit, int shots,
 map<string, size_t> QVM::
 runWithConfiguration(QProg& qProg, vector<int>& cibts_addr, int shots, const NoiseModel& noise_model)
 {
-	vector<ClassicalCondition> cbits_vect;
-	auto cmem = OriginCMem::get_instance();
-	for (auto addr : cibts_addr)
-		cbits_vect.push_back(cmem->get_cbit_by_addr(addr));
-
+	auto cbits_vect = _get_cbits_by_addr(cibts_addr);
 	return runWithConfiguration(qProg, cbits_vect, shots, noise_model);
 }
 
+QVec QVM::_get_qubits_by_addr(const std::vector<int>& qubits_addr)
+{
+	vector<Qubit*> allocated_qubits;
+	if (nullptr != _Qubit_Pool)
+	{
+		_Qubit_Pool->get_allocate_qubits(allocated_qubits);
+	}
+
+	QVec qubits;
+	for (auto addr : qubits_addr)
+	{
+		if (allocated_qubits.empty())
+		{
+			/* a machine without qubits of its own runs progs built on the process-wide pool */
+			qubits.push_back(get_qubit_by_phyaddr(addr));
+			continue;
+		}
+		auto iter = find_if(allocated_qubits.begin(), allocated_qubits.end(), [addr](Qubit* qubit) {
+			return qubit->getPhysicalQubitPtr()->getQubitAddr() == addr;
+		});
+		if (iter == allocated_qubits.end())
+		{
+			QCERR("qubit " + to_string(addr) + " is not allocated by the machine");
+			throw invalid_argument("qubit " + to_string(addr) + " is not allocated by the machine");
+		}
+		qubits.push_back(*iter);
+	}
+	return qubits;
+}
+
+std::vector<ClassicalCondition> QVM::_get_cbits_by_addr(const std::vector<int>& cbits_addr)
+{
+	vector<CBit*> allocated_cbits;
+	if (nullptr != _CMem)
+	{
+		_CMem->get_allocate_cbits(allocated_cbits);
+	}
+
+	vector<ClassicalCondition> cbits;
+	for (auto addr : cbits_addr)
+	{
+		if (allocated_cbits.empty())
+		{
+			/* measures of progs built on the process-wide CMem write into its cbits */
+			cbits.push_back(OriginCMem::get_instance()->get_cbit_by_addr(addr));
+			continue;
+		}
+		auto name = "c" + to_string(addr);
+		auto iter = find_if(allocated_cbits.begin(), allocated_cbits.end(), [&name](CBit* cbit) {
+			return cbit->getName() == name;
+		});
+		if (iter == allocated_cbits.end())
+		{
+			QCERR("cbit " + to_string(addr) + " is not allocated by the machine");
+			throw invalid_argument("cbit " + to_string(addr) + " is not allocated by the machine");
+		}
+		cbits.push_back(*iter);
+	}
+	return cbits;
+}
+
 map<string, size_t> QVM::
 runWithConfiguration(QProg& qProg, vector<ClassicalCondition>& vCBit, rapidjson::Document& param, const NoiseModel& noise_model)
 {
@@ -1485,21 +1784,47 @@ runWithConfiguration(QProg& qProg, vector<ClassicalCondition>& vCBit, rapidjson:
 	QProgCheck prog_check;
 	prog_check.execute(qProg.getImplementationPtr(), nullptr, traver_param);
 
+	/* only the measure results are read out */
+	QProg sim_prog = noise_model.enabled() ? qProg : _light_cone_prog(qProg);
 	if (traver_param.m_can_optimize_measure && shots > 1 && !noise_model.enabled() && !noise_model.readout_error_enabled())
 	{
-		return run_with_optimizing(qProg, vCBit, shots, traver_param);
+		return run_with_optimizing(sim_prog, vCBit, shots, traver_param);
 	}
 	else
 	{
-		return run_with_normal(qProg, vCBit, shots, noise_model);
+		return run_with_normal(sim_prog, vCBit, shots, noise_model);
 	}
 }
 
+void QVM::set_light_cone_pruning(bool enable)
+{
+	m_is_light_cone_pruning = enable;
+}
+
+QProg QVM::_light_cone_prog(QProg& prog, const QVec& observed_qubits)
+{
+	if (!m_is_light_cone_pruning)
+	{
+		return prog;
+	}
+
+	return light_cone_prune(prog, observed_qubits);
+}
+
 
 double QVM::get_expectation(QProg prog, const QHamiltonian& hamiltonian, const QVec& qv)
 {
 	double total_expectation = 0;
 	directlyRun(prog);
+
+	/* the processor reads the terms on the state it holds, without a circuit per term */
+	if (qErrorNone == _pGates->pauliExpectation(phy_hamiltonian(hamiltonian, qv), total_expectation))
+	{
+		initState();
+		return total_expectation;
+	}
+
+	total_expectation = 0;
 	auto qstate = getQState();
 	initState(qstate);
 
@@ -1565,49 +1890,40 @@ double QVM::get_expectation(QProg prog, const QHamiltonian& hamiltonian, const Q
 	auto qstate = getQState();
 	initState(qstate);
 
-	for (size_t i = 0; i < hamiltonian.size(); i++)
+	for (const auto& component : hamiltonian)
 	{
-		auto component = hamiltonian[i];
 		if (component.first.empty())
 		{
 			total_expectation += component.second;
-			continue;
 		}
+	}
+
+	/* qubit-wise commuting terms are estimated from the shots of one measure basis */
+	for (const auto& group : group_qubit_wise_commuting(hamiltonian))
+	{
 		QProg qprog;
-		QVec vqubit;
 		vector<ClassicalCondition> vcbit;
-
-		for (auto iter : component.first)
+		for (const auto& pauli : group.m_basis)
 		{
-			vqubit.push_back(qv[iter.first]);
-			vcbit.push_back(cAlloc(iter.first));
-			if (iter.second == 'X')
-				qprog << H(qv[iter.first]);
-			else if (iter.second == 'Y')
-				qprog << RX(qv[iter.first], PI / 2);
+			vcbit.push_back(cAlloc(pauli.first));
+			if (pauli.second == 'X')
+				qprog << H(qv[pauli.first]);
+			else if (pauli.second == 'Y')
+				qprog << RX(qv[pauli.first], PI / 2);
+		}
 
+		size_t i = 0;
+		for (const auto& pauli : group.m_basis)
+		{
+			qprog << Measure(qv[pauli.first], vcbit[i++]);
 		}
-		for (auto i = 0; i < vqubit.size(); i++)
-			qprog << Measure(vqubit[i], vcbit[i]);
 
-		double expectation = 0;
 		auto outcome = runWithConfiguration(qprog, vcbit, shots);
-		size_t label = 0;
-		for (auto iter : outcome)
+		for (auto index : group.m_terms)
 		{
-			label = 0;
-			for (auto iter1 : iter.first)
-			{
-				if (iter1 == '1')
-					label++;
-			}
-
-			if (label % 2 == 0)
-				expectation += iter.second * 1.0 / shots;
-			else
-				expectation -= iter.second * 1.0 / shots;
+			total_expectation += hamiltonian[index].second
+				* term_expectation(hamiltonian[index].first, group.m_basis, outcome);
 		}
-		total_expectation += component.second * expectation;
 	}
 	return total_expectation;
 }
@@ -1633,39 +1949,13 @@ std::map<std::string, bool> QVM::get_async_result()
 	return _QResult->getResultMap();
 }
 
-static void accumulateProbability(prob_vec& probList, prob_vec& accumulateProb)
-{
-	accumulateProb.clear();
-	accumulateProb.push_back(probList[0]);
-	for (int i = 1; i < probList.size(); ++i)
-	{
-		accumulateProb.push_back(accumulateProb[i - 1] + probList[i]);
-	}
-}
-
 map<string, size_t> IdealQVM::quickMeasure(QVec vQubit, size_t shots)
 {
 	map<string, size_t>  meas_result;
 	prob_vec probList = getProbList(vQubit, -1);
-	prob_vec accumulate_probabilites;
-	accumulateProbability(probList, accumulate_probabilites);
-	for (int i = 0; i < shots; ++i)
-	{
-		double rng = RandomNumberGenerator();
-		if (rng < accumulate_probabilites[0])
-			add_up_a_map(meas_result, dec2bin(0, vQubit.size()));
-		for (int i = 1; i < accumulate_probabilites.size(); ++i)
-		{
-			if (rng < accumulate_probabilites[i] &&
-				rng >= accumulate_probabilites[i - 1]
-				)
-			{
-				add_up_a_map(meas_result,
-					dec2bin(i, vQubit.size())
-				);
-				break;
-			}
-		}
+	for (const auto& outcome : ShotSampler(probList).sample_counts(shots, _pGates->get_random_seed()))
+	{
+		meas_result[dec2bin(outcome.first, vQubit.size())] = outcome.second;
 	}
 	return meas_result;
 }
@@ -1703,12 +1993,88 @@ QStat IdealQVM::getQState()
 }
 
 void CPUQVM::init()
+{
+	init(true);
+}
+
+void CPUQVM::init(bool is_double_precision)
 {
 	try
 	{
 		_start();
-		_pGates = new CPUImplQPU();
+		if (is_double_precision)
+		{
+			_pGates = new CPUImplQPU<double>();
+		}
+		else
+		{
+			_pGates = new CPUImplQPU<float>();
+		}
 		_ptrIsNull(_pGates, "CPUImplQPU");
+		if (random_engine)
+			_pGates->set_random_engine(random_engine);
+	}
+	catch (const std::exception& e)
+	{
+		QCERR(e.what());
+		throw init_fail(e.what());
+	}
+}
+
+void CPUQVM::init_out_of_core(const std::string& directory, size_t memory_budget, bool is_double_precision)
+{
+	try
+	{
+		_start();
+		if (is_double_precision)
+		{
+			_pGates = new OutOfCoreImplQPU<double>(directory, memory_budget);
+		}
+		else
+		{
+			_pGates = new OutOfCoreImplQPU<float>(directory, memory_budget);
+		}
+		_ptrIsNull(_pGates, "OutOfCoreImplQPU");
+	}
+	catch (const std::exception& e)
+	{
+		QCERR(e.what());
+		throw init_fail(e.what());
+	}
+}
+
+void CPUQVM::init_sparse(bool is_double_precision)
+{
+	try
+	{
+		_start();
+		if (is_double_precision)
+		{
+			_pGates = new SparseImplQPU<double>();
+		}
+		else
+		{
+			_pGates = new SparseImplQPU<float>();
+		}
+		_ptrIsNull(_pGates, "SparseImplQPU");
+
+		/* a fused block is a dense matrix for every amplitude kept */
+		m_max_fusion_qubits = 0;
+	}
+	catch (const std::exception& e)
+	{
+		QCERR(e.what());
+		throw init_fail(e.what());
+	}
+}
+
+void CPUQVM::init_distributed(bool use_shared_memory)
+{
+	try
+	{
+		_start();
+		_pGates = new DistributedFullAmplitudeEngine(use_shared_memory);
+		_ptrIsNull(_pGates, "DistributedFullAmplitudeEngine");
 	}
 	catch (const std::exception& e)
 	{
@@ -1744,7 +2110,7 @@ void CPUSingleThreadQVM::init()
 		_start();
 		_pGates = new CPUImplQPUSingleThread();
 		_ptrIsNull(_pGates, "CPUImplQPUSingleThread");
-		if (!random_engine)
+		if (random_engine)
 			_pGates->set_random_engine(random_engine);
 	}
 	catch (const std::exception& e)
@@ -38,9 +38,11 @@ static void get_couple_state_index(uint128_t num, uint64_t& under_index, uint64_
 void PartialAmplitudeQVM::init(BackendType type)
 {
     if (BackendType::CPU == type)
-        m_simulator = std::make_unique<CPUImplQPU>();
+        m_simulator = std::make_unique<CPUImplQPU<double>>();
     else if (BackendType::MPS == type)
         m_simulator = std::make_unique<MPSImplQPU>();
+    else if (BackendType::SPARSE == type)
+        m_simulator = std::make_unique<SparseImplQPU<double>>();
 #ifdef USE_CUDA
     else if (BackendType::GPU == type)
         m_simulator = std::make_unique<GPUImplQPU>();
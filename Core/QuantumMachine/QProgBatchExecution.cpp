@@ -0,0 +1,117 @@
+#include <exception>
+#include <algorithm>
+#include "Core/QuantumMachine/QProgBatchExecution.h"
+#include "Core/QuantumMachine/QProgExecution.h"
+#include "Core/VirtualQuantumProcessor/CPUImplQPU.h"
+#include "Core/Utilities/Tools/QPandaException.h"
+#ifdef USE_OPENMP
+#include <omp.h>
+#endif
+
+USING_QPANDA
+using namespace std;
+
+QProgBatchExecution::QProgBatchExecution(ParametricProg builder, size_t qubit_num)
+	: m_builder(builder), m_qubit_num(qubit_num)
+{
+	QPANDA_ASSERT(nullptr == m_builder, "Error: no parametric prog.");
+	QPANDA_ASSERT(qubit_num >= 64, "Error: too many qubits for a state vector.");
+}
+
+size_t QProgBatchExecution::worker_num(size_t point_num) const
+{
+	size_t thread_num = 1;
+#ifdef USE_OPENMP
+	thread_num = omp_get_max_threads();
+#endif
+	size_t state_bytes = sizeof(qcomplex_t) << m_qubit_num;
+	size_t memory_workers = std::max<size_t>(1, m_memory_limit / state_bytes);
+	return std::max<size_t>(1, std::min({ thread_num, point_num, memory_workers }));
+}
+
+void QProgBatchExecution::run(const std::vector<std::vector<double>>& params, const PointHandler& handler)
+{
+	/* the builder may allocate nodes through global factories, so it stays on this thread */
+	vector<QProg> progs;
+	progs.reserve(params.size());
+	for (const auto& point : params)
+	{
+		progs.push_back(m_builder(point));
+	}
+
+	const size_t workers = worker_num(progs.size());
+	size_t threads_per_worker = 1;
+#ifdef USE_OPENMP
+	threads_per_worker = std::max<size_t>(1, omp_get_max_threads() / workers);
+
+	/* the gate loops of a worker are nested in the region of the workers */
+	const int max_active_levels = omp_get_max_active_levels();
+	if (workers > 1 && threads_per_worker > 1)
+	{
+		omp_set_max_active_levels(std::max(max_active_levels, 2));
+	}
+#endif
+
+	exception_ptr error;
+	const int64_t point_num = progs.size();
+#pragma omp parallel num_threads(workers) if (workers > 1)
+	{
+		CPUImplQPU<double> qpu;
+		QPUImpl* qpu_ptr = &qpu;
+		qpu_ptr->set_parallel_threads_size(threads_per_worker);
+
+#pragma omp for schedule(dynamic)
+		for (int64_t i = 0; i < point_num; i++)
+		{
+			try
+			{
+				qpu_ptr->initState(0, 1, m_qubit_num);
+				QProgExecution prog_exec;
+				TraversalConfig config;
+				Traversal::traversalByType(dynamic_pointer_cast<QNode>(progs[i].getImplementationPtr()),
+					nullptr, prog_exec, config, qpu_ptr);
+				handler(i, qpu_ptr);
+			}
+			catch (...)
+			{
+#pragma omp critical
+				if (nullptr == error)
+				{
+					error = current_exception();
+				}
+			}
+		}
+	}
+
+#ifdef USE_OPENMP
+	omp_set_max_active_levels(max_active_levels);
+#endif
+
+	if (nullptr != error)
+	{
+		rethrow_exception(error);
+	}
+}
+
+std::vector<std::vector<double>> QProgBatchExecution::expectation(const std::vector<std::vector<double>>& params,
+	const std::vector<QHamiltonian>& hamiltonians)
+{
+	vector<vector<double>> expectations(params.size(), vector<double>(hamiltonians.size(), 0));
+	run(params, [&](size_t point, QPUImpl* qpu) {
+		for (size_t i = 0; i < hamiltonians.size(); i++)
+		{
+			qpu->pauliExpectation(hamiltonians[i], expectations[point][i]);
+		}
+	});
+	return expectations;
+}
+
+std::vector<prob_vec> QProgBatchExecution::prob_list(const std::vector<std::vector<double>>& params, const Qnum& qubits)
+{
+	vector<prob_vec> probs(params.size());
+	run(params, [&](size_t point, QPUImpl* qpu) {
+		Qnum measure_qubits = qubits;
+		qpu->pMeasure(measure_qubits, probs[point]);
+	});
+	return probs;
+}
@@ -0,0 +1,219 @@
+#include <random>
+#include "Core/QuantumMachine/QProgBranchExecution.h"
+#include "Core/QuantumMachine/QProgExecution.h"
+#include "Core/QuantumCircuit/QuantumMeasure.h"
+#include "Core/QuantumCircuit/QReset.h"
+#include "Core/QuantumCircuit/ClassicalProgram.h"
+#include "Core/Utilities/Tools/QPandaException.h"
+#include "Core/Utilities/Tools/RandomEngine/RandomEngine.h"
+
+USING_QPANDA
+using namespace std;
+
+namespace
+{
+/* a branch is a state, the instruction it stops at and the cbit values it has read */
+struct PendingBranch
+{
+	shared_ptr<QPUImpl> m_qpu;
+	size_t m_pc;
+	size_t m_shots;
+	vector<cbit_size_t> m_cbit_values;
+	map<string, bool> m_result;
+};
+}
+
+QProgBranchExecution::QProgBranchExecution(QProg prog)
+	: m_prog(prog)
+{
+	_compile(dynamic_pointer_cast<QNode>(prog.getImplementationPtr()));
+}
+
+size_t QProgBranchExecution::_append(OpType type, shared_ptr<QNode> node, size_t qubit, CBit* cbit)
+{
+	m_instructions.push_back({ type, node, qubit, cbit, 0 });
+	return m_instructions.size() - 1;
+}
+
+void QProgBranchExecution::_compile(shared_ptr<QNode> node)
+{
+	switch (node->getNodeType())
+	{
+	case PROG_NODE:
+	{
+		auto prog_node = dynamic_pointer_cast<AbstractQuantumProgram>(node);
+		for (auto iter = prog_node->getFirstNodeIter(); iter != prog_node->getEndNodeIter(); ++iter)
+		{
+			_compile(*iter);
+		}
+		break;
+	}
+	case GATE_NODE:
+	case CIRCUIT_NODE:
+		_append(OpType::QUANTUM, node);
+		break;
+	case MEASURE_GATE:
+	{
+		auto measure_node = dynamic_pointer_cast<AbstractQuantumMeasure>(node);
+		_append(OpType::MEASURE, node, measure_node->getQuBit()->get_phy_addr(), measure_node->getCBit());
+		break;
+	}
+	case RESET_NODE:
+	{
+		auto reset_node = dynamic_pointer_cast<AbstractQuantumReset>(node);
+		_append(OpType::RESET, node, reset_node->getQuBit()->get_phy_addr());
+		break;
+	}
+	case CLASS_COND_NODE:
+		_append(OpType::CLASSICAL, node);
+		break;
+	case QIF_START_NODE:
+	{
+		/* if !cond goto else; true branch; goto end; else: false branch; end: */
+		auto control_flow = dynamic_pointer_cast<AbstractControlFlowNode>(node);
+		auto branch = _append(OpType::JUMP_IF_FALSE, node);
+		_compile(control_flow->getTrueBranch());
+		auto jump = _append(OpType::JUMP);
+		m_instructions[branch].m_target = m_instructions.size();
+		if (nullptr != control_flow->getFalseBranch())
+		{
+			_compile(control_flow->getFalseBranch());
+		}
+		m_instructions[jump].m_target = m_instructions.size();
+		break;
+	}
+	case WHILE_START_NODE:
+	{
+		/* start: if !cond goto end; body; goto start; end: */
+		auto control_flow = dynamic_pointer_cast<AbstractControlFlowNode>(node);
+		auto branch = _append(OpType::JUMP_IF_FALSE, node);
+		_compile(control_flow->getTrueBranch());
+		m_instructions[_append(OpType::JUMP)].m_target = branch;
+		m_instructions[branch].m_target = m_instructions.size();
+		break;
+	}
+	default:
+		m_is_supported = false;
+		break;
+	}
+}
+
+std::vector<ShotBranch> QProgBranchExecution::execute(std::shared_ptr<QPUImpl> qpu, size_t shots,
+	const std::vector<CBit*>& cbits, NodeRunner runner)
+{
+	QPANDA_ASSERT(!m_is_supported, "Error: the prog can't run on shared shots.");
+	if (0 == shots)
+	{
+		return {};
+	}
+
+	if (nullptr == runner)
+	{
+		runner = [](shared_ptr<QNode> node, const shared_ptr<QPUImpl>& node_qpu) {
+			QProgExecution prog_exec;
+			TraversalConfig config;
+			config.m_can_optimize_measure = false;
+			auto qpu_ptr = node_qpu.get();
+			Traversal::traversalByType(node, nullptr, prog_exec, config, qpu_ptr);
+		};
+	}
+
+	Philox4x32 rng(qpu->get_random_seed());
+
+	vector<cbit_size_t> cbit_values(cbits.size());
+	for (size_t i = 0; i < cbits.size(); ++i)
+	{
+		cbit_values[i] = cbits[i]->getValue();
+	}
+
+	/* depth first, so only the branches pending on the current path hold a state */
+	vector<ShotBranch> finished;
+	vector<PendingBranch> pending;
+	pending.push_back({ qpu, 0, shots, cbit_values, {} });
+	while (!pending.empty())
+	{
+		auto branch = std::move(pending.back());
+		pending.pop_back();
+		for (size_t i = 0; i < cbits.size(); ++i)
+		{
+			cbits[i]->set_val(branch.m_cbit_values[i]);
+		}
+
+		while (branch.m_pc < m_instructions.size())
+		{
+			const auto& instruction = m_instructions[branch.m_pc++];
+			switch (instruction.m_type)
+			{
+			case OpType::QUANTUM:
+				runner(instruction.m_node, branch.m_qpu);
+				continue;
+			case OpType::CLASSICAL:
+				dynamic_pointer_cast<AbstractClassicalProg>(instruction.m_node)->get_val();
+				continue;
+			case OpType::JUMP:
+				branch.m_pc = instruction.m_target;
+				continue;
+			case OpType::JUMP_IF_FALSE:
+				if (!dynamic_pointer_cast<AbstractControlFlowNode>(instruction.m_node)->getCExpr().get_val())
+				{
+					branch.m_pc = instruction.m_target;
+				}
+				continue;
+			default:
+				break;
+			}
+
+			/* a measure or a reset splits the shots between the outcomes of the qubit */
+			Qnum qubits = { instruction.m_qubit };
+			prob_vec probs;
+			branch.m_qpu->pMeasure(qubits, probs);
+			double prob_1 = std::min(std::max(probs[1], 0.), 1.);
+			auto shots_1 = std::binomial_distribution<size_t>(branch.m_shots, prob_1)(rng);
+			auto shots_0 = branch.m_shots - shots_1;
+
+			if (shots_0 > 0 && shots_1 > 0)
+			{
+				shared_ptr<QPUImpl> other_qpu(branch.m_qpu->clone());
+				QPANDA_ASSERT(nullptr == other_qpu, "Error: the quantum processor can't be copied.");
+				PendingBranch other{ other_qpu, branch.m_pc, shots_1, {}, branch.m_result };
+				if (OpType::MEASURE == instruction.m_type)
+				{
+					instruction.m_cbit->set_val(1);
+					other.m_result[instruction.m_cbit->getName()] = true;
+				}
+				for (auto cbit : cbits)
+				{
+					other.m_cbit_values.push_back(cbit->getValue());
+				}
+
+				QPANDA_ASSERT(qErrorNone != other_qpu->qubitCollapse(instruction.m_qubit, true, prob_1),
+					"Error: the quantum processor can't collapse a qubit.");
+				if (OpType::RESET == instruction.m_type)
+				{
+					QStat matrix_x = { 0, 1, 1, 0 };
+					other_qpu->unitarySingleQubitGate(instruction.m_qubit, matrix_x, false, PAULI_X_GATE);
+				}
+				pending.push_back(std::move(other));
+			}
+
+			bool outcome = 0 == shots_0;
+			branch.m_shots = outcome ? shots_1 : shots_0;
+			QPANDA_ASSERT(qErrorNone != branch.m_qpu->qubitCollapse(instruction.m_qubit, outcome, outcome ? prob_1 : 1 - prob_1),
+				"Error: the quantum processor can't collapse a qubit.");
+			if (OpType::MEASURE == instruction.m_type)
+			{
+				instruction.m_cbit->set_val(outcome);
+				branch.m_result[instruction.m_cbit->getName()] = outcome;
+			}
+			else if (outcome)
+			{
+				QStat matrix_x = { 0, 1, 1, 0 };
+				branch.m_qpu->unitarySingleQubitGate(instruction.m_qubit, matrix_x, false, PAULI_X_GATE);
+			}
+		}
+
+		finished.push_back({ std::move(branch.m_result), branch.m_shots });
+	}
+
+	return finished;
+}
@@ -96,8 +96,15 @@ void QProgExecution::execute(std::shared_ptr<AbstractQGateNode> cur_node,
     }
     
     /* update qprog exec progress, use QProgExecution address as process id */
-    uint64_t exec_id = (uint64_t)this;
-    QProgProgress::getInstance().update_processed_gate_num(exec_id);
+    if (!m_is_progress_checked)
+    {
+        m_processed_gates = QProgProgress::getInstance().get_processed_gate_counter((uint64_t)this);
+        m_is_progress_checked = true;
+    }
+    if (nullptr != m_processed_gates)
+    {
+        ++*m_processed_gates;
+    }
 }
 
 
@@ -4,6 +4,7 @@ USING_QPANDA
 
 size_t QProgProgress::get_processed_gate_num(uint64_t exec_id)
 {
+    ReadLock rl(m_sm);
     if (m_prog_exec_gates.count(exec_id))
     {
         return m_prog_exec_gates.at(exec_id);
@@ -16,6 +17,7 @@ size_t QProgProgress::get_processed_gate_num(uint64_t exec_id)
 
 size_t QProgProgress::update_processed_gate_num(uint64_t exec_id, size_t count)
 {
+    ReadLock rl(m_sm);
     if (m_prog_exec_gates.count(exec_id))
     {
         m_prog_exec_gates.at(exec_id) += count;
@@ -29,6 +31,7 @@ size_t QProgProgress::update_processed_gate_num(uint64_t exec_id, size_t count)
 
 void QProgProgress::prog_start(uint64_t exec_id)
 {
+    WriteLock wl(m_sm);
     if (m_prog_exec_gates.count(exec_id))
     {
         m_prog_exec_gates.at(exec_id) = 0;
@@ -41,8 +44,16 @@ void QProgProgress::prog_start(uint64_t exec_id)
 
 void QProgProgress::prog_end(uint64_t exec_id)
 {
+    WriteLock wl(m_sm);
     if (m_prog_exec_gates.count(exec_id))
     {
         m_prog_exec_gates.erase(exec_id);
     }
 }
+
+std::atomic<size_t>* QProgProgress::get_processed_gate_counter(uint64_t exec_id)
+{
+    ReadLock rl(m_sm);
+    auto iter = m_prog_exec_gates.find(exec_id);
+    return iter == m_prog_exec_gates.end() ? nullptr : &iter->second;
+}
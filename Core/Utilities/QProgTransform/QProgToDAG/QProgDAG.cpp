@@ -22,7 +22,7 @@ void QProgDAG::add_vertex(std::shared_ptr<QProgDAGNode> n, DAGNodeType type) {
 	for_each(tmp_qv.begin(), tmp_qv.end(), [&](Qubit* qubit) {
 		if (qubit_vertices_map.find(qubit->get_phy_addr()) != qubit_vertices_map.end()) {
 			const auto _last_node = qubit_vertices_map.at(qubit->get_phy_addr()).back();
-			const auto _layer = get_vertex(_last_node).m_layer + 1;
+			const auto _layer = m_vertex_vec[_last_node].m_layer + 1;
 			if ((_layer) > cur_layer) {
 				cur_layer = _layer;
 			}
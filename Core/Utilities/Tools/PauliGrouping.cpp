@@ -0,0 +1,84 @@
+#include <cmath>
+#include <numeric>
+#include <algorithm>
+#include "Core/Utilities/Tools/PauliGrouping.h"
+#include "Core/Utilities/Tools/QPandaException.h"
+
+USING_QPANDA
+using namespace std;
+
+std::vector<PauliMeasureGroup> QPanda::group_qubit_wise_commuting(const QHamiltonian& hamiltonian)
+{
+	/* the heavy terms pick the bases first */
+	vector<size_t> order(hamiltonian.size());
+	std::iota(order.begin(), order.end(), 0);
+	std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+		return std::abs(hamiltonian[a].second) > std::abs(hamiltonian[b].second);
+	});
+
+	vector<PauliMeasureGroup> groups;
+	for (auto index : order)
+	{
+		const auto& term = hamiltonian[index].first;
+		if (term.empty())
+		{
+			continue;
+		}
+
+		auto is_compatible = [&](const PauliMeasureGroup& group) {
+			for (const auto& pauli : term)
+			{
+				auto iter = group.m_basis.find(pauli.first);
+				if (iter != group.m_basis.end() && iter->second != pauli.second)
+				{
+					return false;
+				}
+			}
+			return true;
+		};
+
+		auto group = std::find_if(groups.begin(), groups.end(), is_compatible);
+		if (group == groups.end())
+		{
+			groups.push_back({});
+			group = groups.end() - 1;
+		}
+		group->m_basis.insert(term.begin(), term.end());
+		group->m_terms.push_back(index);
+	}
+
+	return groups;
+}
+
+double QPanda::term_expectation(const QTerm& term, const QTerm& basis,
+	const std::map<std::string, size_t>& counts)
+{
+	/* position of the bit of every term qubit in the bit strings */
+	vector<size_t> positions;
+	size_t position = 0;
+	for (const auto& pauli : basis)
+	{
+		if (term.find(pauli.first) != term.end())
+		{
+			positions.push_back(position);
+		}
+		++position;
+	}
+	QPANDA_ASSERT(positions.size() != term.size(), "Error: the term is not measured in the basis.");
+
+	double sum = 0;
+	size_t shots = 0;
+	for (const auto& item : counts)
+	{
+		QPANDA_ASSERT(item.first.size() < basis.size(), "Error: bit string shorter than the basis.");
+		size_t ones = 0;
+		for (auto bit : positions)
+		{
+			ones += '1' == item.first[item.first.size() - 1 - bit];
+		}
+		sum += (ones % 2 ? -1. : 1.) * item.second;
+		shots += item.second;
+	}
+
+	return shots ? sum / shots : 0;
+}
@@ -12,6 +12,10 @@
 #include <set>
 USING_QPANDA
 
+/* gates fused into one block are searched in the next kFusionLookahead gates */
+static const size_t kFusionLookahead = 256;
+static const size_t kMaxFusionQubits = 5;
+
 double Fusion::distance_cost(const std::vector<QGate>& ops,
     const int from,
     const int until) const
@@ -19,10 +23,21 @@ double Fusion::distance_cost(const std::vector<QGate>& ops,
     std::vector<int> fusion_qubits;
     for (int i = from; i <= until; ++i)
         add_optimize_qubits(fusion_qubits, ops[i]);
-    auto configured_cost = distances_[fusion_qubits.size() - 1];
+    return fusion_cost(fusion_qubits.size());
+}
+
+void Fusion::set_fusion_cost(size_t qubit_num, double cost)
+{
+    QPANDA_ASSERT(qubit_num < 1 || qubit_num > 64 || cost <= 0, "Error: fusion cost.");
+    distances_[qubit_num - 1] = cost;
+}
+
+double Fusion::fusion_cost(size_t qubit_num) const
+{
+    auto configured_cost = distances_[qubit_num - 1];
     if (configured_cost > 0)
         return configured_cost;
-    switch (fusion_qubits.size()) {
+    switch (qubit_num) {
     case 1:
         /*bull*/
     case 2:
@@ -32,7 +47,7 @@ double Fusion::distance_cost(const std::vector<QGate>& ops,
     case 4:
         return 3;
     default:
-        return pow(distance_factor, (double)std::max(fusion_qubits.size() - 2, size_t(1)));
+        return pow(distance_factor, (double)std::max(qubit_num - 2, size_t(1)));
     }
 }
 
@@ -99,7 +114,7 @@ bool Fusion::aggreate(std::vector<QGate>& gate_v, QuantumMachine* qvm)
 QGate Fusion::_generate_oracle_gate(const std::vector<QGate>& fusion_gates,
     const std::vector<int>& qubits, QuantumMachine* qvm)
 {
-    CPUImplQPU cpu;
+    CPUImplQPU<double> cpu;
     QStat state;
     cpu.initMatrixState(qubits.size() * 2, state);
     for (int i = fusion_gates.size() - 1; i >= 0; i--)
@@ -166,7 +181,7 @@ QGate Fusion::_generate_oracle_gate(const std::vector<QGate>& fusion_gates,
 QGate Fusion::_generate_operation_internal(const std::vector<QGate> &fusion_gates,
 	const std::vector<int> &qubits, QuantumMachine *qvm)
 {
-	CPUImplQPU cpu;
+	CPUImplQPU<double> cpu;
 	QStat state;
 	cpu.initMatrixState(qubits.size() * 2, state);
 	for (int i = 0; i < fusion_gates.size(); i++)
@@ -555,4 +570,221 @@ QGate Fusion::_generate_operation(std::vector<QGate>& fusion_gates, QuantumMachi
         fusioned_op.remap(gate_qv);
         return fusioned_op;
     }
-}
\ No newline at end of file
+}
+
+void Fusion::aggregate_blocks(QProg& prog, size_t max_fusion_qubits)
+{
+    QPANDA_ASSERT(max_fusion_qubits < 1 || max_fusion_qubits > kMaxFusionQubits,
+        "Error: max fusion qubits.");
+    if (prog.is_empty()) {
+        return;
+    }
+
+    flatten(prog, true);
+
+    /* only consecutive gates are fused, other nodes split the gate runs */
+    QProg fused_prog;
+    std::vector<QGate> gate_run;
+    for (auto itr = prog.getFirstNodeIter(); itr != prog.getEndNodeIter(); ++itr)
+    {
+        auto node = *itr;
+        if (node->getNodeType() == NodeType::GATE_NODE)
+        {
+            gate_run.push_back(QGate(std::dynamic_pointer_cast<AbstractQGateNode>(node)));
+            continue;
+        }
+
+        _aggregate_gate_run(gate_run, max_fusion_qubits, fused_prog);
+        gate_run.clear();
+        fused_prog.pushBackNode(node);
+    }
+    _aggregate_gate_run(gate_run, max_fusion_qubits, fused_prog);
+
+    prog = fused_prog;
+}
+
+void Fusion::_aggregate_gate_run(std::vector<QGate>& gates, size_t max_fusion_qubits, QProg& prog)
+{
+    std::vector<std::vector<size_t>> gate_qubits(gates.size());
+    std::vector<bool> fusible(gates.size());
+    for (size_t i = 0; i < gates.size(); ++i)
+    {
+        QVec qv;
+        gates[i].getQuBitVector(qv);
+        gates[i].getControlVector(qv);
+        for (auto qubit : qv) {
+            gate_qubits[i].push_back(qubit->get_phy_addr());
+        }
+        std::sort(gate_qubits[i].begin(), gate_qubits[i].end());
+        gate_qubits[i].erase(std::unique(gate_qubits[i].begin(), gate_qubits[i].end()), gate_qubits[i].end());
+
+        auto gate_type = gates[i].getQGate()->getGateType();
+        fusible[i] = gate_type != GateType::BARRIER_GATE && gate_qubits[i].size() <= max_fusion_qubits;
+    }
+
+    std::vector<bool> done(gates.size(), false);
+    for (size_t i = 0; i < gates.size(); ++i)
+    {
+        if (done[i]) {
+            continue;
+        }
+
+        std::vector<size_t> best_block = { i };
+        std::vector<size_t> best_qubits = gate_qubits[i];
+        if (fusible[i])
+        {
+            /* passes over the state saved per pass spent, the narrowest block wins a tie */
+            double best_rate = 1.0 / fusion_cost(best_qubits.size());
+            for (size_t width = gate_qubits[i].size(); width <= max_fusion_qubits; ++width)
+            {
+                std::vector<size_t> block_qubits;
+                auto block = _collect_block(gate_qubits, fusible, done, i, width, block_qubits);
+                double rate = block.size() / fusion_cost(block_qubits.size());
+                if (rate > best_rate * (1 + 1e-9))
+                {
+                    best_rate = rate;
+                    best_block.swap(block);
+                    best_qubits.swap(block_qubits);
+                }
+            }
+        }
+
+        for (auto idx : best_block) {
+            done[idx] = true;
+        }
+
+        if (best_block.size() == 1)
+        {
+            prog << gates[i];
+            continue;
+        }
+
+        std::vector<QGate> block_gates;
+        for (auto idx : best_block) {
+            block_gates.push_back(gates[idx]);
+        }
+        prog << _generate_block_gate(block_gates, best_qubits);
+    }
+}
+
+std::vector<size_t> Fusion::_collect_block(const std::vector<std::vector<size_t>>& gate_qubits,
+    const std::vector<bool>& fusible, const std::vector<bool>& done,
+    size_t first, size_t width, std::vector<size_t>& block_qubits) const
+{
+    /*
+      a later gate joins the block when none of its qubits is used by a skipped gate
+      in between, so it commutes with all of them and can move forward to the block
+    */
+    std::vector<size_t> block = { first };
+    block_qubits = gate_qubits[first];
+    std::set<size_t> blocked_qubits;
+    size_t scanned = 0;
+    for (size_t j = first + 1; j < gate_qubits.size() && scanned < kFusionLookahead; ++j)
+    {
+        if (done[j]) {
+            continue;
+        }
+        ++scanned;
+
+        auto& qubits = gate_qubits[j];
+        bool is_blocked = std::any_of(qubits.begin(), qubits.end(),
+            [&](size_t q) { return blocked_qubits.count(q) > 0; });
+        if (!is_blocked && fusible[j])
+        {
+            std::vector<size_t> merged;
+            std::set_union(block_qubits.begin(), block_qubits.end(),
+                qubits.begin(), qubits.end(), std::back_inserter(merged));
+            if (merged.size() <= width)
+            {
+                block.push_back(j);
+                block_qubits.swap(merged);
+                continue;
+            }
+        }
+
+        blocked_qubits.insert(qubits.begin(), qubits.end());
+        bool is_closed = block_qubits.size() == width && std::all_of(block_qubits.begin(), block_qubits.end(),
+            [&](size_t q) { return blocked_qubits.count(q) > 0; });
+        if (is_closed) {
+            break;
+        }
+    }
+
+    return block;
+}
+
+QGate Fusion::_generate_block_gate(const std::vector<QGate>& gates, const std::vector<size_t>& block_qubits)
+{
+    /* bit i of the block matrix index is block_qubits[i], the same as the oracle gate */
+    size_t qubit_num = block_qubits.size();
+    std::vector<OriginPhysicalQubit> physical_qubits(qubit_num);
+    std::vector<std::shared_ptr<OriginQubit>> local_qubits;
+    std::map<size_t, Qubit*> local_map;
+    for (size_t i = 0; i < qubit_num; ++i)
+    {
+        physical_qubits[i].setQubitAddr(i);
+        local_qubits.push_back(std::make_shared<OriginQubit>(&physical_qubits[i]));
+        local_map[block_qubits[i]] = local_qubits.back().get();
+    }
+
+    /* column k of the block matrix is the state evolved from the basis state |k> */
+    size_t dim = 1ull << qubit_num;
+    QStat matrix(dim * dim);
+    CPUImplQPU<double> cpu;
+    QPUImpl* qpu = &cpu;
+    for (size_t col = 0; col < dim; ++col)
+    {
+        QStat basis(dim, 0);
+        basis[col] = 1;
+        cpu.loadState(qubit_num, basis);
+
+        for (auto gate : gates)
+        {
+            QVec targets, controls;
+            gate.getQuBitVector(targets);
+            gate.getControlVector(controls);
+            for (auto& qubit : targets) {
+                qubit = local_map[qubit->get_phy_addr()];
+            }
+            for (auto& qubit : controls) {
+                qubit = local_map[qubit->get_phy_addr()];
+            }
+
+            auto qgate = gate.getQGate();
+            auto parse_gate = QGateParseMap::getFunction(qgate->getOperationNum());
+            QPANDA_ASSERT(nullptr == parse_gate, "Error: gate operation num.");
+            parse_gate(qgate, targets, qpu, gate.isDagger(), controls, (GateType)qgate->getGateType());
+        }
+
+        auto column = cpu.getQState();
+        for (size_t row = 0; row < dim; ++row) {
+            matrix[row * dim + col] = column[row];
+        }
+    }
+
+    std::map<size_t, Qubit*> qubit_map;
+    for (auto gate : gates)
+    {
+        QVec qv;
+        gate.getQuBitVector(qv);
+        gate.getControlVector(qv);
+        for (auto qubit : qv) {
+            qubit_map[qubit->get_phy_addr()] = qubit;
+        }
+    }
+
+    QVec gate_qv;
+    for (auto addr : block_qubits) {
+        gate_qv.push_back(qubit_map[addr]);
+    }
+
+    switch (qubit_num)
+    {
+    case 1:
+        return U4(gate_qv[0], matrix);
+    case 2:
+        return QDouble(gate_qv[0], gate_qv[1], matrix);
+    default:
+        return QOracle(gate_qv, matrix);
+    }
+}
@@ -0,0 +1,156 @@
+#include <set>
+#include <algorithm>
+#include "Core/Utilities/Tools/QProgLightCone.h"
+#include "Core/QuantumCircuit/QNodeDeepCopy.h"
+#include "Core/Utilities/QProgTransform/QProgToDAG/QProgToDAG.h"
+
+USING_QPANDA
+using namespace std;
+
+namespace
+{
+/* the DAG of a prog is only its gates, measures and resets */
+class CheckLightConeProg : public TraverseByNodeIter
+{
+public:
+	void execute(std::shared_ptr<AbstractClassicalProg> cur_node, std::shared_ptr<QNode> parent_node, QCircuitParam &cir_param, NodeIter& cur_node_iter) override {
+		m_is_supported = false;
+	}
+
+	void execute(std::shared_ptr<AbstractControlFlowNode> cur_node, std::shared_ptr<QNode> parent_node, QCircuitParam &cir_param, NodeIter& cur_node_iter) override {
+		m_is_supported = false;
+	}
+
+	bool m_is_supported{ true };
+};
+}
+
+QProg QPanda::light_cone_prune(QProg prog, const QVec& observed_qubits)
+{
+	CheckLightConeProg check;
+	check.traverse_qprog(prog);
+	if (!check.m_is_supported)
+	{
+		return prog;
+	}
+
+	QProgDAG prog_dag;
+	QProgToDAG().traversal(prog, prog_dag);
+	const auto& vertices = prog_dag.get_vertex_c();
+	const auto& qubit_vertices_map = prog_dag.get_qubit_vertices_map();
+
+	/* barriers are not simulated, the light cone passes them qubit by qubit */
+	auto is_barrier = [&](uint32_t vertex_id) {
+		return DAGNodeType(GateType::BARRIER_GATE) == vertices[vertex_id].m_type;
+	};
+
+	std::vector<bool> is_observed(vertices.size(), false);
+	auto observe = [&](uint32_t vertex_id, uint32_t qubit) {
+		while (is_barrier(vertex_id))
+		{
+			const auto& pre_edges = vertices[vertex_id].m_pre_edges;
+			auto iter = std::find_if(pre_edges.begin(), pre_edges.end(),
+				[&](const QProgDAGEdge& edge) { return edge.m_qubit == qubit; });
+			if (pre_edges.end() == iter)
+			{
+				return;
+			}
+			vertex_id = iter->m_from;
+		}
+		is_observed[vertex_id] = true;
+	};
+
+	for (const auto& vertex : vertices)
+	{
+		if (DAGNodeType::MEASURE == vertex.m_type)
+		{
+			is_observed[vertex.m_id] = true;
+		}
+	}
+
+	for (auto qubit : observed_qubits)
+	{
+		const auto qubit_addr = qubit->get_phy_addr();
+		auto iter = qubit_vertices_map.find(qubit_addr);
+		if (qubit_vertices_map.end() != iter)
+		{
+			observe(iter->second.back(), qubit_addr);
+		}
+	}
+
+	/* vertices are numbered in the order of the prog, so one backward sweep
+	   over them collects the light cone of every measure and observed qubit */
+	size_t observed_num = 0;
+	for (auto i = vertices.size(); i-- > 0;)
+	{
+		if (!is_observed[i])
+		{
+			continue;
+		}
+
+		++observed_num;
+		for (const auto& edge : vertices[i].m_pre_edges)
+		{
+			observe(edge.m_from, edge.m_qubit);
+		}
+	}
+
+	if (observed_num == vertices.size())
+	{
+		return prog;
+	}
+
+	QProg pruned_prog;
+	std::set<size_t> used_qubits;
+	for (const auto& vertex : vertices)
+	{
+		if (!is_observed[vertex.m_id])
+		{
+			continue;
+		}
+
+		const auto& dag_node = *(vertex.m_node);
+		for (auto qubit : dag_node.m_qubits_vec + dag_node.m_control_vec)
+		{
+			used_qubits.insert(qubit->get_phy_addr());
+		}
+
+		auto node = *(dag_node.m_itr);
+		if (DAGNodeType::MEASURE == vertex.m_type)
+		{
+			auto measure_node = std::dynamic_pointer_cast<AbstractQuantumMeasure>(node);
+			pruned_prog << Measure(measure_node->getQuBit(), measure_node->getCBit());
+		}
+		else if (DAGNodeType::RESET == vertex.m_type)
+		{
+			auto reset_node = std::dynamic_pointer_cast<AbstractQuantumReset>(node);
+			pruned_prog << Reset(reset_node->getQuBit());
+		}
+		else
+		{
+			/* the dagger and controls of the enclosing circuits are folded into the vertex */
+			auto gate = QGate(std::dynamic_pointer_cast<AbstractQGateNode>(node));
+			QGate new_gate = deepCopy(gate);
+			new_gate.clear_control();
+			new_gate.setControl(dag_node.m_control_vec);
+			new_gate.setDagger(dag_node.m_dagger);
+			pruned_prog << new_gate;
+		}
+	}
+
+	QVec idle_qubits;
+	for (auto qubit : observed_qubits)
+	{
+		if (used_qubits.end() == used_qubits.find(qubit->get_phy_addr()))
+		{
+			idle_qubits.push_back(qubit);
+		}
+	}
+
+	if (!idle_qubits.empty())
+	{
+		pruned_prog << BARRIER(idle_qubits);
+	}
+
+	return pruned_prog;
+}
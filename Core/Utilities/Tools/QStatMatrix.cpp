@@ -1,4 +1,6 @@
 #include <cmath>
+#include <cfloat>
+#include <algorithm>
 #include <string.h>
 #include "ThirdParty/EigenUnsupported/Eigen/KroneckerProduct"
 #include "Core/Utilities/Tools/QStatMatrix.h"
@@ -524,4 +526,52 @@ bool QPanda::is_unitary_matrix_by_eigen(const QStat& circuit_matrix, const doubl
 bool QPanda::is_unitary_matrix_by_eigen(const EigenMatrixXc& circuit_matrix, const double precision /*= MAX_COMPARE_PRECISION*/)
 {
 	return circuit_matrix.isUnitary(precision);
-}
\ No newline at end of file
+}
+prob_vec QPanda::density_matrix_spectrum(const QStat& density_matrix)
+{
+	auto order = (size_t)std::sqrt(density_matrix.size());
+	QPANDA_ASSERT(order * order != density_matrix.size(), "Error: density matrix size.");
+
+	EigenMatrixXc rho = EigenMatrixXc::Map(&density_matrix[0], order, order);
+	Eigen::SelfAdjointEigenSolver<EigenMatrixXc> solver(rho, Eigen::EigenvaluesOnly);
+	QPANDA_ASSERT(Eigen::Success != solver.info(), "Error: density matrix spectrum.");
+
+	/* eigenvalues under the rounding noise of the solver are treated as zero */
+	const double cutoff = order * DBL_EPSILON * std::max(solver.eigenvalues().cwiseAbs().maxCoeff(), 1.);
+	prob_vec spectrum(order);
+	for (size_t i = 0; i < order; ++i)
+	{
+		auto value = solver.eigenvalues()[order - 1 - i];
+		spectrum[i] = value > cutoff ? value : 0.;
+	}
+
+	return spectrum;
+}
+
+double QPanda::spectrum_entropy(const prob_vec& spectrum, double alpha /*= 1*/)
+{
+	QPANDA_ASSERT(alpha < 0, "Error: order of the Renyi entropy.");
+
+	if (std::abs(alpha - 1) <= DBL_EPSILON)
+	{
+		double entropy = 0;
+		for (auto p : spectrum)
+		{
+			if (p > 0)
+			{
+				entropy -= p * std::log2(p);
+			}
+		}
+		return entropy;
+	}
+
+	double sum = 0;
+	for (auto p : spectrum)
+	{
+		if (p > 0)
+		{
+			sum += std::pow(p, alpha);
+		}
+	}
+	return std::log2(sum) / (1 - alpha);
+}
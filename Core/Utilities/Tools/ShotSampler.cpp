@@ -0,0 +1,124 @@
+#include <cfloat>
+#include <random>
+#include <algorithm>
+#include <unordered_map>
+#include "Core/Utilities/Tools/ShotSampler.h"
+#include "Core/Utilities/Tools/QPandaException.h"
+#include "Core/Utilities/Tools/RandomEngine/RandomEngine.h"
+
+USING_QPANDA
+using namespace std;
+
+/* shots drawn by one generator stream */
+static const size_t kShotsPerStream = 1ull << 14;
+
+ShotSampler::ShotSampler(const prob_vec& probs)
+	: m_threshold(probs.size(), 0), m_alias(probs.size())
+{
+	QPANDA_ASSERT(probs.empty(), "Error: empty distribution.");
+
+	double sum = 0;
+	for (auto p : probs)
+	{
+		QPANDA_ASSERT(p < -DBL_EPSILON, "Error: negative probability.");
+		sum += std::max(p, 0.);
+	}
+	QPANDA_ASSERT(sum <= 0, "Error: distribution without probability.");
+
+	/* Vose's method: pair each light column with a heavy outcome */
+	const size_t size = probs.size();
+	std::vector<size_t> light, heavy;
+	for (size_t i = 0; i < size; ++i)
+	{
+		m_threshold[i] = std::max(probs[i], 0.) * size / sum;
+		m_alias[i] = i;
+		(m_threshold[i] < 1 ? light : heavy).push_back(i);
+	}
+
+	while (!light.empty() && !heavy.empty())
+	{
+		auto small = light.back();
+		auto large = heavy.back();
+		light.pop_back();
+
+		m_alias[small] = large;
+		m_threshold[large] -= 1 - m_threshold[small];
+		if (m_threshold[large] < 1)
+		{
+			heavy.pop_back();
+			light.push_back(large);
+		}
+	}
+
+	/* what is left is 1 up to rounding */
+	for (auto i : heavy)
+	{
+		m_threshold[i] = 1;
+	}
+	for (auto i : light)
+	{
+		m_threshold[i] = 1;
+	}
+}
+
+size_t ShotSampler::sample(double random) const
+{
+	double column = random * m_alias.size();
+	auto index = std::min((size_t)column, m_alias.size() - 1);
+	return column - index < m_threshold[index] ? index : m_alias[index];
+}
+
+std::map<size_t, size_t> ShotSampler::sample_counts(size_t shots, uint64_t seed) const
+{
+	const size_t size = m_alias.size();
+	const int64_t streams = (shots + kShotsPerStream - 1) / kShotsPerStream;
+	const bool is_dense = size <= kShotsPerStream;
+
+	std::map<size_t, size_t> counts;
+#pragma omp parallel for if (streams > 1)
+	for (int64_t stream = 0; stream < streams; ++stream)
+	{
+		Philox4x32 rng(seed, stream);
+		std::uniform_int_distribution<size_t> column(0, size - 1);
+		std::uniform_real_distribution<double> coin(0, 1);
+
+		auto stream_shots = std::min(kShotsPerStream, shots - stream * kShotsPerStream);
+		std::vector<size_t> dense_counts(is_dense ? size : 0, 0);
+		std::unordered_map<size_t, size_t> sparse_counts;
+		for (size_t i = 0; i < stream_shots; ++i)
+		{
+			auto index = column(rng);
+			auto outcome = coin(rng) < m_threshold[index] ? index : m_alias[index];
+			if (is_dense)
+			{
+				++dense_counts[outcome];
+			}
+			else
+			{
+				++sparse_counts[outcome];
+			}
+		}
+
+#pragma omp critical
+		{
+			for (size_t i = 0; i < dense_counts.size(); ++i)
+			{
+				if (dense_counts[i])
+				{
+					counts[i] += dense_counts[i];
+				}
+			}
+			for (const auto& item : sparse_counts)
+			{
+				counts[item.first] += item.second;
+			}
+		}
+	}
+
+	return counts;
+}
+
+std::map<size_t, size_t> ShotSampler::sample_counts(size_t shots) const
+{
+	return sample_counts(shots, random_seed64());
+}
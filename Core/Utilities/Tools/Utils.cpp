@@ -1,11 +1,16 @@
 #include "Core/Utilities/Tools/Utils.h"
 #include <time.h>
+#include <thread>
+#include <functional>
+#include <cstdlib>
 
 #include "Core/QuantumCircuit/QuantumMeasure.h"
 #include "ControlFlow.h"
 
 #if defined(WIN32) || defined(_WIN32)
 #define localtime_r(_Time, _Tm) localtime_s(_Tm, _Time)
+#else
+#include <unistd.h>
 #endif
 
 using namespace std;
@@ -28,17 +33,23 @@ double QPanda::RandomNumberGenerator()
     *  define constant number in 16807 generator.
     */
     int  ia = 16807, im = 2147483647, iq = 127773, ir = 2836;
-    time_t rawtime;
-    struct tm  timeinfo;
-    time(&rawtime);
-    localtime_r(&rawtime, &timeinfo);
-    static int irandseed = timeinfo.tm_year + 70 *
-        (timeinfo.tm_mon + 1 + 12 *
-        (timeinfo.tm_mday + 31 *
-            (timeinfo.tm_hour + 23 *
-            (timeinfo.tm_min + 59 * timeinfo.tm_sec))));
-
-    static int irandnewseed = 0;
+
+    /* the state is per thread, seeded once from the clock and the thread */
+    thread_local int irandseed = [im]() {
+        time_t rawtime;
+        struct tm  timeinfo;
+        time(&rawtime);
+        localtime_r(&rawtime, &timeinfo);
+        int seed = timeinfo.tm_year + 70 *
+            (timeinfo.tm_mon + 1 + 12 *
+            (timeinfo.tm_mday + 31 *
+                (timeinfo.tm_hour + 23 *
+                (timeinfo.tm_min + 59 * timeinfo.tm_sec))));
+        auto thread_hash = std::hash<std::thread::id>()(std::this_thread::get_id());
+        return (int)(((size_t)seed ^ thread_hash) % (im - 1)) + 1;
+    }();
+
+    int irandnewseed = 0;
     if (ia * (irandseed % iq) - ir * (irandseed / iq) >= 0)
     {
         irandnewseed = ia * (irandseed % iq) - ir * (irandseed / iq);
@@ -244,3 +255,44 @@ QCircuit QPanda::parityCheckCircuit(std::vector<Qubit*> qubit_vec)
 	}
 	return circuit;
 }
+
+std::shared_ptr<FILE> QPanda::create_unnamed_file(const std::string& directory, const std::string& prefix)
+{
+	std::string dir = directory;
+	if (dir.empty())
+	{
+		const char* tmp_dir = std::getenv("TMPDIR");
+		dir = (nullptr != tmp_dir && *tmp_dir) ? tmp_dir : "/tmp";
+	}
+
+#if defined(WIN32) || defined(_WIN32)
+	char* name = _tempnam(dir.c_str(), prefix.c_str());
+	if (nullptr == name)
+	{
+		return nullptr;
+	}
+	/* D deletes the file when it is closed */
+	FILE* fp = fopen(name, "w+bD");
+	free(name);
+#else
+	std::string path = dir + "/" + prefix + "XXXXXX";
+	std::vector<char> name(path.begin(), path.end());
+	name.push_back('\0');
+	int fd = mkstemp(name.data());
+	if (fd < 0)
+	{
+		return nullptr;
+	}
+	unlink(name.data());
+	FILE* fp = fdopen(fd, "w+b");
+	if (nullptr == fp)
+	{
+		close(fd);
+	}
+#endif
+	if (nullptr == fp)
+	{
+		return nullptr;
+	}
+	return std::shared_ptr<FILE>(fp, [](FILE* fp) { fclose(fp); });
+}
@@ -1,5 +1,18 @@
 #include "Core/VirtualQuantumProcessor/AbstractFullAmplitudeEngine.h"
+#include "Core/VirtualQuantumProcessor/MPIFullAmplitudeEngine.h"
+#include "Core/VirtualQuantumProcessor/CPUImplQPU.h"
 USING_QPANDA
+
+DistributedFullAmplitudeEngine::DistributedFullAmplitudeEngine(bool use_shared_memory)
+{
+    _PQGates = new MPIFullAmplitudeEngine(use_shared_memory);
+}
+
+DistributedFullAmplitudeEngine::~DistributedFullAmplitudeEngine()
+{
+    delete _PQGates;
+}
+
 QError DistributedFullAmplitudeEngine::initState(size_t head_rank, size_t rank_size, size_t qubit_num)
 {
     if (nullptr == _PQGates)
@@ -20,6 +33,26 @@ QError DistributedFullAmplitudeEngine::initState(size_t head_rank, size_t rank_s
     }
 }
 
+QError DistributedFullAmplitudeEngine::initState(size_t qubit_num, const QStat &state)
+{
+    if (nullptr == _PQGates)
+    {
+        QCERR("_PQGates is null");
+        throw qvm_attributes_error("_PQGates is null");
+    }
+
+    try
+    {
+        _PQGates->initState(qubit_num, state);
+        return QError::qErrorNone;
+    }
+    catch (const std::exception&e)
+    {
+        QCERR(e.what());
+        throw qalloc_fail(e.what());
+    }
+}
+
 QStat DistributedFullAmplitudeEngine::getQState()
 {
     if (nullptr == _PQGates)
@@ -37,8 +70,7 @@ bool DistributedFullAmplitudeEngine::qubitMeasure(size_t qn)
         QCERR("_PQGates is null");
         throw result_get_fail("_PQGates is null");
     }
-    _PQGates->measureQubitOperation(qn);
-    return QError::qErrorNone;
+    return _PQGates->measureQubitOperation(qn);
 }
 
 QError DistributedFullAmplitudeEngine::Reset(size_t qn)
@@ -67,52 +99,97 @@ QError DistributedFullAmplitudeEngine::pMeasure(Qnum& qnum, prob_vec &mResult)
 }
 
 
-QError DistributedFullAmplitudeEngine::unitarySingleQubitGate(size_t qn, QStat& matrix,
-    bool isConjugate,GateType)
+QError DistributedFullAmplitudeEngine::_apply_gate(Qnum qubits, Qnum controls, const QStat& matrix,
+    bool isConjugate, GateType type, bool is_controlled)
 {
     if (nullptr == _PQGates)
     {
         QCERR("_PQGates is null");
         throw result_get_fail("_PQGates is null");
     }
-    _PQGates->singleQubitOperation(qn, matrix, isConjugate);
+
+    QStat gate_matrix;
+    gate_target_operator(type, is_controlled, matrix, isConjugate, qubits, controls, gate_matrix);
+    if (qubits.empty())
+    {
+        return QError::qErrorNone;
+    }
+
+    if (1 == qubits.size())
+    {
+        if (controls.empty())
+        {
+            _PQGates->singleQubitOperation(qubits[0], gate_matrix, false);
+        }
+        else
+        {
+            _PQGates->controlsingleQubitOperation(qubits[0], controls, gate_matrix, false);
+        }
+    }
+    else if (2 == qubits.size())
+    {
+        if (controls.empty())
+        {
+            _PQGates->doubleQubitOperation(qubits[0], qubits[1], gate_matrix, false);
+        }
+        else
+        {
+            _PQGates->controldoubleQubitOperation(qubits[0], qubits[1], controls, gate_matrix, false);
+        }
+    }
+    else
+    {
+        _PQGates->controlOracleOperation(qubits, controls, gate_matrix, false);
+    }
     return QError::qErrorNone;
 }
 
+QError DistributedFullAmplitudeEngine::unitarySingleQubitGate(size_t qn, QStat& matrix,
+    bool isConjugate, GateType type)
+{
+    return _apply_gate({ qn }, {}, matrix, isConjugate, type, false);
+}
+
 QError DistributedFullAmplitudeEngine::controlunitarySingleQubitGate(size_t qn, Qnum& qnum,
-    QStat& matrix, bool isConjugate,GateType)
+    QStat& matrix, bool isConjugate, GateType type)
 {
-    if (nullptr == _PQGates)
-    {
-        QCERR("_PQGates is null");
-        throw result_get_fail("_PQGates is null");
-    }
-    _PQGates->controlsingleQubitOperation(qn, qnum, matrix, isConjugate);
-    return QError::qErrorNone;
+    return _apply_gate({ qn }, qnum, matrix, isConjugate, type, true);
 }
 
 QError DistributedFullAmplitudeEngine::unitaryDoubleQubitGate(size_t qn_0, size_t qn_1,
-    QStat& matrix, bool isConjugate,GateType)
+    QStat& matrix, bool isConjugate, GateType type)
 {
-    if (nullptr == _PQGates)
-    {
-        QCERR("_PQGates is null");
-        throw result_get_fail("_PQGates is null");
-    }
-    _PQGates->doubleQubitOperation(qn_0, qn_1, matrix, isConjugate);
-    return QError::qErrorNone;
+    return _apply_gate({ qn_0, qn_1 }, {}, matrix, isConjugate, type, false);
 }
 
 QError DistributedFullAmplitudeEngine::controlunitaryDoubleQubitGate(size_t qn_0,
-    size_t qn_1, Qnum& qnum, QStat& matrix, bool isConjugate,GateType)
+    size_t qn_1, Qnum& qnum, QStat& matrix, bool isConjugate, GateType type)
+{
+    return _apply_gate({ qn_0, qn_1 }, qnum, matrix, isConjugate, type, true);
+}
+
+QError DistributedFullAmplitudeEngine::OracleGate(Qnum& qubits, QStat &matrix, bool isConjugate)
+{
+    return controlOracleGate(qubits, {}, matrix, isConjugate);
+}
+
+QError DistributedFullAmplitudeEngine::controlOracleGate(Qnum& qubits, const Qnum& controls,
+    QStat &matrix, bool isConjugate)
 {
     if (nullptr == _PQGates)
     {
         QCERR("_PQGates is null");
         throw result_get_fail("_PQGates is null");
     }
-    _PQGates->controldoubleQubitOperation(qn_0, qn_1, qnum, matrix, isConjugate);
+    _PQGates->controlOracleOperation(qubits, controls, matrix, isConjugate);
+    return QError::qErrorNone;
+}
 
+QError DistributedFullAmplitudeEngine::debug(std::shared_ptr<QPanda::AbstractQDebugNode> debugger)
+{
+    /* the debugger keeps a reference, so it gets a copy of the state */
+    m_debug_state = getQState();
+    debugger->save_qstate(m_debug_state);
     return QError::qErrorNone;
 }
 
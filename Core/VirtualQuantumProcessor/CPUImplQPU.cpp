@@ -17,7 +17,11 @@ limitations under the License.
 #include "CPUImplQPU.h"
 #include "QPandaNamespace.h"
 #include "Core/Utilities/Tools/Utils.h"
+#include "Core/VirtualQuantumProcessor/MarginalProbability.h"
+#include "Core/VirtualQuantumProcessor/SIMDGates.h"
+#include "Core/Utilities/Tools/QStatMatrix.h"
 #include <algorithm>
+#include <array>
 #include <thread>
 #include <map>
 #include <iostream>
@@ -40,103 +44,136 @@ using qvector_t = Eigen::Matrix<qcomplex_t, 1, Eigen::Dynamic, Eigen::RowMajor>;
 
 const double kStateEpSilon = 1.0e-010;
 
-CPUImplQPU::CPUImplQPU()
+/* cache blocks of 256 KB stay in the L2 cache of one core */
+const size_t kCacheBlockBytes = 1ull << 18;
+/* gates a cache block pass must hold to beat the plain passes over the state */
+const size_t kMinBlockGates = 2;
+const size_t kMaxPendingGates = 1024;
+/* diagonal gates batched into one pass */
+const size_t kMinDiagonalGates = 3;
+const size_t kMaxDiagonalQubits = 10;
+/* register index of the addresses a compacted prog does not use */
+const size_t kUnusedQubit = SIZE_MAX;
+/* gates a parallel region must hold to beat one region per gate */
+const size_t kMinSequenceGates = 2;
+const size_t kMaxSequenceQubits = 6;
+
+template <typename data_t>
+static size_t default_cache_block_qubits()
+{
+    size_t qubit_num = 0;
+    while ((sizeof(std::complex<data_t>) << (qubit_num + 1)) <= kCacheBlockBytes)
+    {
+        qubit_num++;
+    }
+    return qubit_num;
+}
+
+template <typename data_t>
+CPUImplQPU<data_t>::CPUImplQPU()
+    : m_qubit_num(0), m_cache_block_qubits(default_cache_block_qubits<data_t>())
 {
 }
 
-CPUImplQPU::~CPUImplQPU()
+template <typename data_t>
+CPUImplQPU<data_t>::~CPUImplQPU()
 {
 }
-CPUImplQPU::CPUImplQPU(size_t qubit_num)
+template <typename data_t>
+CPUImplQPU<data_t>::CPUImplQPU(size_t qubit_num)
+    : m_qubit_num(0), m_cache_block_qubits(default_cache_block_qubits<data_t>())
 {
 }
 
+static bool target_operator(GateType type, bool is_controlled, const QStat& m,
+    bool is_dagger, Qnum& qubits, Qnum& controls, QStat& matrix);
+
 static bool probcompare(pair<size_t, double> a, pair<size_t, double> b)
 {
     return a.second > b.second;
 }
 
-QError CPUImplQPU::pMeasure(Qnum& qnum, prob_tuple &probs, int select_max)
+template <typename data_t>
+QError CPUImplQPU<data_t>::pMeasure(Qnum& qnum, prob_tuple &probs, int select_max)
 {
-    pMeasure(qnum, probs);
+    prob_vec probs_vec;
+    pMeasure(qnum, probs_vec);
+
+    probs.clear();
+    probs.reserve(probs_vec.size());
+    for (size_t i = 0; i < probs_vec.size(); i++)
+    {
+        probs.emplace_back(i, probs_vec[i]);
+    }
+
     if (select_max == -1 || probs.size() <= select_max)
     {
         stable_sort(probs.begin(), probs.end(), probcompare);
-        return qErrorNone;
     }
     else
     {
-        stable_sort(probs.begin(), probs.end(), probcompare);
+        /* ties keep the index order, as the stable sort does */
+        partial_sort(probs.begin(), probs.begin() + select_max, probs.end(),
+            [](const pair<size_t, double>& a, const pair<size_t, double>& b) {
+            return a.second > b.second || (a.second == b.second && a.first < b.first);
+        });
         probs.erase(probs.begin() + select_max, probs.end());
     }
     return qErrorNone;
 }
 
 
-QError CPUImplQPU::pMeasure(Qnum& qnum, prob_vec &probs)
+template <typename data_t>
+QError CPUImplQPU<data_t>::pMeasure(Qnum& qnum, prob_vec &probs)
 {
-    probs.resize(1ll << qnum.size());
-    size_t size = 1ll << m_qubit_num;
-    bool ordered = true;
-
-    for (size_t i = 1; i < qnum.size(); i++)
+    _flush_gates();
+    MarginalProbability<data_t> marginal(m_state.data(), m_qubit_num,
+        _omp_thread_num(1ll << m_qubit_num));
+    if (m_qubit_map.empty())
     {
-        if (qnum[i] < qnum[i - 1])
-        {
-            ordered = false;
-            break;
-        }
+        marginal.calculate(qnum, probs);
+        return qErrorNone;
     }
 
-    if (ordered)
+    /* qubits the program did not use stay |0> */
+    Qnum used_qubits;
+    Qnum used_bits;
+    for (size_t j = 0; j < qnum.size(); j++)
     {
-#pragma omp parallel for num_threads(_omp_thread_num(size))
-        for (int64_t i = 0; i < size; i++)
+        QPANDA_ASSERT(qnum[j] >= m_qubit_map.size(), "Error: pmeasure qubit out of range.");
+        if (_is_used_qubit(qnum[j]))
         {
-            size_t pmeasure_idx = 0;
-            for (size_t idx_q = 0; idx_q < qnum.size(); idx_q++)
-            {
-                size_t state_idx = i >> qnum[idx_q];
-                if (state_idx > 0)
-                {
-                    if (1ull & state_idx)
-                    {
-                        pmeasure_idx |= 1ull << idx_q;
-                    }
-                }
-                else
-                {
-                    break;
-                }
-            }
-
-#pragma omp critical
-            {
-                probs[pmeasure_idx] += std::norm(m_state[i]);
-            }
-
+            used_qubits.push_back(m_qubit_map[qnum[j]]);
+            used_bits.push_back(j);
         }
     }
-    else
+
+    prob_vec used_probs;
+    marginal.calculate(used_qubits, used_probs);
+    probs.assign(1ull << qnum.size(), 0);
+    for (size_t i = 0; i < used_probs.size(); i++)
     {
-        for (int64_t i = 0; i < size; i++)
+        size_t index = 0;
+        for (size_t k = 0; k < used_bits.size(); k++)
         {
-            int64_t idx = 0;
-            for (int64_t j = 0; j < qnum.size(); j++)
-            {
-                idx += (((i >> (qnum[j])) % 2) << j);
-            }
-            probs[idx] += std::norm(m_state[i]);
+            index |= ((i >> k) & 1ull) << used_bits[k];
         }
+        probs[index] = used_probs[i];
     }
-
     return qErrorNone;
 }
 
-bool CPUImplQPU::qubitMeasure(size_t qn)
+template <typename data_t>
+bool CPUImplQPU<data_t>::qubitMeasure(size_t qn)
 {
+    _flush_gates();
+    if (!_is_used_qubit(qn))
+    {
+        return false;
+    }
+
+    qn = _register_qubit(qn);
     int64_t size = 1ll << (m_qubit_num - 1);
-    int64_t offset = 1ll << qn;
     double dprob = 0;
 
     if (size > m_threshold)
@@ -159,81 +196,77 @@ bool CPUImplQPU::qubitMeasure(size_t qn)
 
 
     bool measure_out = false;
-    double fi = random_generator19937();
+    double fi = get_random_double();
     if (fi > dprob)
     {
         measure_out = true;
     }
 
-    if (!measure_out)
+    _qubit_collapse(qn, measure_out, measure_out ? 1 - dprob : dprob);
+    return measure_out;
+}
+
+template <typename data_t>
+QError CPUImplQPU<data_t>::qubitCollapse(size_t qn, bool outcome, double prob)
+{
+    _flush_gates();
+    if (!_is_used_qubit(qn))
     {
-        dprob = 1 / sqrt(dprob);
-        if (size > m_threshold)
-        {
-#pragma omp parallel for
-            for (int64_t i = 0; i < size; i++)
-            {
-                int64_t real00_idx = _insert(i, qn);
-                m_state[real00_idx] *= dprob;
-                m_state[real00_idx | offset] = 0;
-            }
-        }
-        else
-        {
-            for (int64_t i = 0; i < size; i++)
-            {
-                int64_t real00_idx = _insert(i, qn);
-                m_state[real00_idx] *= dprob;
-                m_state[real00_idx | offset] = 0;
-            }
-        }
+        /* an unused qubit stays |0> */
+        QPANDA_ASSERT(outcome, "Error: collapse onto an outcome of probability 0.");
+        return qErrorNone;
     }
-    else
+
+    _qubit_collapse(_register_qubit(qn), outcome, prob);
+    return qErrorNone;
+}
+
+template <typename data_t>
+void CPUImplQPU<data_t>::_qubit_collapse(size_t qn, bool outcome, double prob)
+{
+    int64_t size = 1ll << (m_qubit_num - 1);
+    int64_t offset = 1ll << qn;
+    int64_t keep_offset = outcome ? offset : 0;
+    int64_t drop_offset = offset - keep_offset;
+    data_t scale = 1 / sqrt(prob);
+
+#pragma omp parallel for num_threads(_omp_thread_num(size))
+    for (int64_t i = 0; i < size; i++)
     {
-        dprob = 1 / sqrt(1 - dprob);
-        if (size > m_threshold)
-        {
-#pragma omp parallel for
-            for (int64_t i = 0; i < size; i++)
-            {
-                int64_t real00_idx = _insert(i, qn);
-                m_state[real00_idx] = 0;
-                m_state[real00_idx | offset] *= dprob;
-            }
-        }
-        else
-        {
-            for (int64_t i = 0; i < size; i++)
-            {
-                int64_t real00_idx = _insert(i, qn);
-                m_state[real00_idx] = 0;
-                m_state[real00_idx | offset] *= dprob;
-            }
-        }
+        int64_t real00_idx = _insert(i, qn);
+        m_state[real00_idx | keep_offset] *= scale;
+        m_state[real00_idx | drop_offset] = 0;
     }
-    return measure_out;
 }
 
-QError CPUImplQPU::initState(size_t head_rank, size_t rank_size, size_t qubit_num)
+template <typename data_t>
+QPUImpl* CPUImplQPU<data_t>::clone()
+{
+    _flush_gates();
+    return new CPUImplQPU<data_t>(*this);
+}
+
+template <typename data_t>
+QError CPUImplQPU<data_t>::initState(size_t head_rank, size_t rank_size, size_t qubit_num)
 {
+    m_pending_gates.clear();
+    m_qubit_map.clear();
+    Qnum used_qubits;
+    used_qubits.swap(m_used_qubits);
     if (m_is_init_state)
     {
-        m_state.resize(m_init_state.size());
-        if (m_init_state.size() > m_threshold)
-        {
-        #pragma omp parallel for
-            for (int64_t i = 0; i < m_init_state.size(); i++)
-            {
-                m_state[i] = m_init_state[i];
-            }
-        }
-        else
+        _load_init_state();
+    }
+    else if (!used_qubits.empty() && used_qubits.size() < qubit_num
+        && used_qubits.back() < qubit_num)
+    {
+        initState(used_qubits.size());
+        m_qubit_map.assign(qubit_num, kUnusedQubit);
+        for (size_t i = 0; i < used_qubits.size(); i++)
         {
-            for (int64_t i = 0; i < m_init_state.size(); i++)
-            {
-                m_state[i] = m_init_state[i];
-            }
+            m_qubit_map[used_qubits[i]] = i;
         }
+        m_register_qubits.swap(used_qubits);
     }
     else
     {
@@ -243,48 +276,99 @@ QError CPUImplQPU::initState(size_t head_rank, size_t rank_size, size_t qubit_nu
     return QError::qErrorNone;
 }
 
-QError CPUImplQPU::initState(size_t qubit_num, const QStat &state)
+template <typename data_t>
+QError CPUImplQPU<data_t>::initState(size_t qubit_num, const QStat &state)
 {
+    m_pending_gates.clear();
+    m_qubit_map.clear();
     if (0 == state.size())
     {
         m_qubit_num = qubit_num;
-        m_state.assign(1ull << m_qubit_num, 0);
+        int64_t size = 1ll << m_qubit_num;
+        _alloc_state(m_state, size);
+#pragma omp parallel for num_threads(_omp_thread_num(size))
+        for (int64_t i = 0; i < size; i++)
+        {
+            m_state[i] = 0;
+        }
         m_state[0] = { 1, 0 };
         m_is_init_state = false;
+        m_init_state_file.reset();
+        cstate_t().swap(m_init_state);
     }
     else
     {
         m_qubit_num = qubit_num;
-        m_init_state.resize(1ull << m_qubit_num, 0);
         QPANDA_ASSERT(1ll << m_qubit_num != state.size(), "Error: initState size.");
-        m_is_init_state = true;
+        _keep_init_state(state.size(), [&](size_t i) { return state[i]; });
+    }
 
-        if (state.size() > m_threshold)
-        {
-#pragma omp parallel for
-            for (int64_t i = 0; i < state.size(); i++)
-            {
-                m_init_state[i] = state[i];
-            }
-        }
-        else
+    return qErrorNone;
+}
+
+template <typename data_t>
+QError CPUImplQPU<data_t>::initState(size_t qubit_num, const QStat& state, const Qnum& qubits)
+{
+    QPANDA_ASSERT(qubits.size() > qubit_num || (1ull << qubits.size()) != state.size(),
+        "Error: initState state and qubits size.");
+    m_pending_gates.clear();
+    m_qubit_map.clear();
+    m_qubit_num = qubit_num;
+
+    size_t mask = 0;
+    for (auto qubit : qubits)
+    {
+        mask |= 1ull << qubit;
+    }
+    _keep_init_state(1ull << qubit_num, [&](size_t i) {
+        size_t index = 0;
+        for (size_t j = 0; j < qubits.size(); j++)
         {
-            for (int64_t i = 0; i < state.size(); i++)
-            {
-                m_init_state[i] = state[i];
-            }
+            index |= ((i >> qubits[j]) & 1ull) << j;
         }
-    }
+        return (i & ~mask) ? qcomplex_t(0) : state[index];
+    });
 
     return qErrorNone;
 }
 
-QError CPUImplQPU::initMatrixState(size_t qubit_num, const QStat &state)
+template <typename data_t>
+QError CPUImplQPU<data_t>::loadState(size_t qubit_num, const QStat& state)
+{
+    QPANDA_ASSERT(1ull << qubit_num != state.size(), "Error: loadState size.");
+    m_pending_gates.clear();
+    m_qubit_map.clear();
+    m_used_qubits.clear();
+    m_qubit_num = qubit_num;
+    m_is_init_state = false;
+    m_init_state_file.reset();
+    cstate_t().swap(m_init_state);
+
+    int64_t size = state.size();
+    _alloc_state(m_state, size);
+#pragma omp parallel for num_threads(_omp_thread_num(size))
+    for (int64_t i = 0; i < size; i++)
+    {
+        m_state[i] = state[i];
+    }
+    return qErrorNone;
+}
+
+template <typename data_t>
+QError CPUImplQPU<data_t>::initMatrixState(size_t qubit_num, const QStat &state)
 {
+	m_pending_gates.clear();
+	m_qubit_map.clear();
 	if (0 == state.size())
 	{
 		m_qubit_num = qubit_num;
-		m_state.assign(1ull << m_qubit_num, 0);
+		int64_t size = 1ll << m_qubit_num;
+		_alloc_state(m_state, size);
+#pragma omp parallel for num_threads(_omp_thread_num(size))
+		for (int64_t i = 0; i < size; i++)
+		{
+			m_state[i] = 0;
+		}
 		int row = sqrt(m_state.size());
 		for (int k = 0; k < row; k++)
 		{
@@ -295,10 +379,15 @@ QError CPUImplQPU::initMatrixState(size_t qubit_num, const QStat &state)
 }
 
 
-QError CPUImplQPU::_X(size_t qn)
+template <typename data_t>
+QError CPUImplQPU<data_t>::_X(size_t qn)
 {
     int64_t size = 1ll << (m_qubit_num - 1);
     int64_t offset = 1ll << qn;
+    if (simd_pauli_x(m_state.data(), m_qubit_num, qn, _omp_thread_num(size)))
+    {
+        return qErrorNone;
+    }
 
     if (size > m_threshold)
     {
@@ -320,7 +409,8 @@ QError CPUImplQPU::_X(size_t qn)
     return qErrorNone;
 }
 
-QError CPUImplQPU::_Y(size_t qn)
+template <typename data_t>
+QError CPUImplQPU<data_t>::_Y(size_t qn)
 {
     int64_t size = 1ll << (m_qubit_num - 1);
     int64_t offset = 1ll << qn;
@@ -332,10 +422,10 @@ QError CPUImplQPU::_Y(size_t qn)
         {
             int64_t real00_idx = _insert(i, qn);
             int64_t real01_idx = real00_idx | offset;
-            auto alpha = m_state[real00_idx];
-            auto beta = m_state[real01_idx];
-            m_state[real00_idx] = { beta.imag(), -beta.real() };
-            m_state[real01_idx] = { -alpha.imag(), alpha.real() };
+            qcomplex_t alpha = m_state[real00_idx];
+            qcomplex_t beta = m_state[real01_idx];
+            m_state[real00_idx] = std::complex<data_t>(beta.imag(), -beta.real());
+            m_state[real01_idx] = std::complex<data_t>(-alpha.imag(), alpha.real());
         }
     }
     else
@@ -344,17 +434,18 @@ QError CPUImplQPU::_Y(size_t qn)
         {
             int64_t real00_idx = _insert(i, qn);
             int64_t real01_idx = real00_idx | offset;
-            auto alpha = m_state[real00_idx];
-            auto beta = m_state[real01_idx];
-            m_state[real00_idx] = { beta.imag(), -beta.real() };
-            m_state[real01_idx] = { -alpha.imag(), alpha.real() };
+            qcomplex_t alpha = m_state[real00_idx];
+            qcomplex_t beta = m_state[real01_idx];
+            m_state[real00_idx] = std::complex<data_t>(beta.imag(), -beta.real());
+            m_state[real01_idx] = std::complex<data_t>(-alpha.imag(), alpha.real());
         }
     }
 
     return qErrorNone;
 }
 
-QError CPUImplQPU::_Z(size_t qn)
+template <typename data_t>
+QError CPUImplQPU<data_t>::_Z(size_t qn)
 {
     int64_t size = 1ll << (m_qubit_num - 1);
     int64_t offset = 1ll << qn;
@@ -380,7 +471,8 @@ QError CPUImplQPU::_Z(size_t qn)
     return qErrorNone;
 }
 
-QError CPUImplQPU::_S(size_t qn, bool is_dagger)
+template <typename data_t>
+QError CPUImplQPU<data_t>::_S(size_t qn, bool is_dagger)
 {
     int64_t size = 1ll << (m_qubit_num - 1);
     int64_t offset = 1ll << qn;
@@ -423,7 +515,8 @@ QError CPUImplQPU::_S(size_t qn, bool is_dagger)
 }
 
 
-QError CPUImplQPU::_RZ(size_t qn, QStat &matrix, bool is_dagger)
+template <typename data_t>
+QError CPUImplQPU<data_t>::_RZ(size_t qn, QStat &matrix, bool is_dagger)
 {
     int64_t size = 1ll << (m_qubit_num - 1);
     int64_t offset = 1ll << qn;
@@ -457,10 +550,15 @@ QError CPUImplQPU::_RZ(size_t qn, QStat &matrix, bool is_dagger)
     return qErrorNone;
 }
 
-QError CPUImplQPU::_H(size_t qn, QStat &matrix)
+template <typename data_t>
+QError CPUImplQPU<data_t>::_H(size_t qn, QStat &matrix)
 {
     int64_t size = 1ll << (m_qubit_num - 1);
     int64_t offset = 1ll << qn;
+    if (simd_hadamard(m_state.data(), m_qubit_num, qn, _omp_thread_num(size)))
+    {
+        return qErrorNone;
+    }
 
     if (size > m_threshold)
     {
@@ -470,8 +568,8 @@ QError CPUImplQPU::_H(size_t qn, QStat &matrix)
             int64_t real00_idx = _insert(i, qn);
             int64_t real01_idx = real00_idx | offset;
 
-            auto alpha = m_state[real00_idx];
-            auto beta = m_state[real01_idx];
+            qcomplex_t alpha = m_state[real00_idx];
+            qcomplex_t beta = m_state[real01_idx];
             m_state[real00_idx] = (alpha + beta) * SQ2;
             m_state[real01_idx] = (alpha - beta) * SQ2;
         }
@@ -483,8 +581,8 @@ QError CPUImplQPU::_H(size_t qn, QStat &matrix)
             int64_t real00_idx = _insert(i, qn);
             int64_t real01_idx = real00_idx | offset;
 
-            auto alpha = m_state[real00_idx];
-            auto beta = m_state[real01_idx];
+            qcomplex_t alpha = m_state[real00_idx];
+            qcomplex_t beta = m_state[real01_idx];
             m_state[real00_idx] = (alpha + beta) * SQ2;
             m_state[real01_idx] = (alpha - beta) * SQ2;
         }
@@ -492,11 +590,16 @@ QError CPUImplQPU::_H(size_t qn, QStat &matrix)
     return qErrorNone;
 }
 
-QError CPUImplQPU::_CNOT(size_t qn_0, size_t qn_1)
+template <typename data_t>
+QError CPUImplQPU<data_t>::_CNOT(size_t qn_0, size_t qn_1)
 {
     int64_t size = 1ll << (m_qubit_num - 2);
     int64_t offset0 = 1ll << qn_0;
     int64_t offset1 = 1ll << qn_1;
+    if (simd_cnot(m_state.data(), m_qubit_num, qn_0, qn_1, _omp_thread_num(size)))
+    {
+        return qErrorNone;
+    }
 
     if (size > m_threshold)
     {
@@ -518,24 +621,20 @@ QError CPUImplQPU::_CNOT(size_t qn_0, size_t qn_1)
     return qErrorNone;
 }
 
-QError CPUImplQPU::_CZ(size_t qn_0, size_t qn_1, Qnum &controls)
+template <typename data_t>
+QError CPUImplQPU<data_t>::_CZ(size_t qn_0, size_t qn_1, Qnum &controls)
 {
-    int64_t size = 1ll << (m_qubit_num - 2);
+    ControlSubspace subspace(controls, { qn_0, qn_1 });
+    int64_t size = subspace.size(m_qubit_num);
     int64_t offset0 = 1ll << qn_0;
     int64_t offset1 = 1ll << qn_1;
-    int64_t mask = 0;
-    for_each(controls.begin(), controls.end() - 2, [&](size_t &q) {
-        mask |= 1ll << q;
-    });
 
     if (size > m_threshold)
     {
 #pragma omp parallel for
         for (int64_t i = 0; i < size; i++)
         {
-            int64_t real00_idx = _insert(i, qn_1, qn_0);
-            if (mask != (mask & real00_idx))
-                continue;
+            int64_t real00_idx = subspace(i);
             m_state[real00_idx | offset0 | offset1] = -m_state[real00_idx | offset0 | offset1];
         }
     }
@@ -543,16 +642,15 @@ QError CPUImplQPU::_CZ(size_t qn_0, size_t qn_1, Qnum &controls)
     {
         for (int64_t i = 0; i < size; i++)
         {
-            int64_t real00_idx = _insert(i, qn_1, qn_0);
-            if (mask != (mask & real00_idx))
-                continue;
+            int64_t real00_idx = subspace(i);
             m_state[real00_idx | offset0 | offset1] = -m_state[real00_idx | offset0 | offset1];
         }
     }
     return qErrorNone;
 }
 
-QError CPUImplQPU::_CR(size_t qn_0, size_t qn_1, QStat &matrix, bool is_dagger)
+template <typename data_t>
+QError CPUImplQPU<data_t>::_CR(size_t qn_0, size_t qn_1, QStat &matrix, bool is_dagger)
 {
     int64_t size = 1ll << (m_qubit_num - 2);
     int64_t offset0 = 1ll << qn_0;
@@ -582,7 +680,8 @@ QError CPUImplQPU::_CR(size_t qn_0, size_t qn_1, QStat &matrix, bool is_dagger)
     return qErrorNone;
 }
 
-QError CPUImplQPU::_CP(size_t qn_0, size_t qn_1, QStat &matrix, bool is_dagger)
+template <typename data_t>
+QError CPUImplQPU<data_t>::_CP(size_t qn_0, size_t qn_1, QStat &matrix, bool is_dagger)
 {
 	int64_t size = 1ll << (m_qubit_num - 2);
 	int64_t offset0 = 1ll << qn_0;
@@ -612,7 +711,8 @@ QError CPUImplQPU::_CP(size_t qn_0, size_t qn_1, QStat &matrix, bool is_dagger)
 	return qErrorNone;
 }
 
-QError CPUImplQPU::_SWAP(size_t qn_0, size_t qn_1)
+template <typename data_t>
+QError CPUImplQPU<data_t>::_SWAP(size_t qn_0, size_t qn_1)
 {
     int64_t size = 1ll << (m_qubit_num - 2);
     int64_t offset0 = 1ll << qn_0;
@@ -638,7 +738,8 @@ QError CPUImplQPU::_SWAP(size_t qn_0, size_t qn_1)
     return qErrorNone;
 }
 
-QError CPUImplQPU::_iSWAP(size_t qn_0, size_t qn_1, QStat &matrix, bool is_dagger)
+template <typename data_t>
+QError CPUImplQPU<data_t>::_iSWAP(size_t qn_0, size_t qn_1, QStat &matrix, bool is_dagger)
 {
     int64_t size = 1ll << (m_qubit_num - 2);
     int64_t offset0 = 1ll << qn_0;
@@ -656,8 +757,8 @@ QError CPUImplQPU::_iSWAP(size_t qn_0, size_t qn_1, QStat &matrix, bool is_dagge
         for (int64_t i = 0; i < size; i++)
         {
             int64_t real00_idx = _insert(i, qn_1, qn_0);
-            auto phi01 = m_state[real00_idx | offset1];
-            auto phi10 = m_state[real00_idx | offset0];
+            qcomplex_t phi01 = m_state[real00_idx | offset1];
+            qcomplex_t phi10 = m_state[real00_idx | offset0];
             m_state[real00_idx | offset1] = matrix[6] * phi10;
             m_state[real00_idx | offset0] = matrix[9] * phi01;
         }
@@ -667,8 +768,8 @@ QError CPUImplQPU::_iSWAP(size_t qn_0, size_t qn_1, QStat &matrix, bool is_dagge
         for (int64_t i = 0; i < size; i++)
         {
             int64_t real00_idx = _insert(i, qn_1, qn_0);
-            auto phi01 = m_state[real00_idx | offset1];
-            auto phi10 = m_state[real00_idx | offset0];
+            qcomplex_t phi01 = m_state[real00_idx | offset1];
+            qcomplex_t phi10 = m_state[real00_idx | offset0];
             m_state[real00_idx | offset1] = matrix[6] * phi10;
             m_state[real00_idx | offset0] = matrix[9] * phi01;
         }
@@ -676,7 +777,8 @@ QError CPUImplQPU::_iSWAP(size_t qn_0, size_t qn_1, QStat &matrix, bool is_dagge
     return qErrorNone;
 }
 
-QError CPUImplQPU::_iSWAP_theta(size_t qn_0, size_t qn_1, QStat &matrix, bool is_dagger)
+template <typename data_t>
+QError CPUImplQPU<data_t>::_iSWAP_theta(size_t qn_0, size_t qn_1, QStat &matrix, bool is_dagger)
 {
     int64_t size = 1ll << (m_qubit_num - 2);
     int64_t offset0 = 1ll << qn_0;
@@ -694,8 +796,8 @@ QError CPUImplQPU::_iSWAP_theta(size_t qn_0, size_t qn_1, QStat &matrix, bool is
         for (int64_t i = 0; i < size; i++)
         {
             int64_t real00_idx = _insert(i, qn_1, qn_0);
-            auto phi01 = m_state[real00_idx | offset1];
-            auto phi10 = m_state[real00_idx | offset0];
+            qcomplex_t phi01 = m_state[real00_idx | offset1];
+            qcomplex_t phi10 = m_state[real00_idx | offset0];
             m_state[real00_idx | offset1] = matrix[5] * phi01 + matrix[6] * phi10;
             m_state[real00_idx | offset0] = matrix[9] * phi01 + matrix[10] * phi10;
         }
@@ -705,8 +807,8 @@ QError CPUImplQPU::_iSWAP_theta(size_t qn_0, size_t qn_1, QStat &matrix, bool is
         for (int64_t i = 0; i < size; i++)
         {
             int64_t real00_idx = _insert(i, qn_1, qn_0);
-            auto phi01 = m_state[real00_idx | offset1];
-            auto phi10 = m_state[real00_idx | offset0];
+            qcomplex_t phi01 = m_state[real00_idx | offset1];
+            qcomplex_t phi10 = m_state[real00_idx | offset0];
             m_state[real00_idx | offset1] = matrix[5] * phi01 + matrix[6] * phi10;
             m_state[real00_idx | offset0] = matrix[9] * phi01 + matrix[10] * phi10;
         }
@@ -714,7 +816,8 @@ QError CPUImplQPU::_iSWAP_theta(size_t qn_0, size_t qn_1, QStat &matrix, bool is
     return qErrorNone;
 }
 
-QError CPUImplQPU::_CU(size_t qn_0, size_t qn_1, QStat &matrix, bool is_dagger)
+template <typename data_t>
+QError CPUImplQPU<data_t>::_CU(size_t qn_0, size_t qn_1, QStat &matrix, bool is_dagger)
 {
     int64_t size = 1ll << (m_qubit_num - 2);
     int64_t offset0 = 1ll << qn_0;
@@ -730,14 +833,21 @@ QError CPUImplQPU::_CU(size_t qn_0, size_t qn_1, QStat &matrix, bool is_dagger)
         matrix[15] = { matrix[15].real(), -matrix[15].imag() };
     }
 
+    qcomplex_t control_matrix[4] = { matrix[10], matrix[11], matrix[14], matrix[15] };
+    if (simd_control_single_qubit_unitary(m_state.data(), m_qubit_num, qn_0, qn_1,
+        control_matrix, _omp_thread_num(size)))
+    {
+        return qErrorNone;
+    }
+
     if (size > m_threshold)
     {
 #pragma omp parallel for
         for (int64_t i = 0; i < size; i++)
         {
             int64_t real00_idx = _insert(i, qn_1, qn_0);
-            auto phi10 = m_state[real00_idx | offset0];
-            auto phi11 = m_state[real00_idx | offset0 | offset1];
+            qcomplex_t phi10 = m_state[real00_idx | offset0];
+            qcomplex_t phi11 = m_state[real00_idx | offset0 | offset1];
             m_state[real00_idx | offset0] = matrix[10] * phi10 + matrix[11] * phi11;
             m_state[real00_idx | offset0 | offset1] = matrix[14] * phi10 + matrix[15] * phi11;
         }
@@ -747,8 +857,8 @@ QError CPUImplQPU::_CU(size_t qn_0, size_t qn_1, QStat &matrix, bool is_dagger)
         for (int64_t i = 0; i < size; i++)
         {
             int64_t real00_idx = _insert(i, qn_1, qn_0);
-            auto phi10 = m_state[real00_idx | offset0];
-            auto phi11 = m_state[real00_idx | offset0 | offset1];
+            qcomplex_t phi10 = m_state[real00_idx | offset0];
+            qcomplex_t phi11 = m_state[real00_idx | offset0 | offset1];
             m_state[real00_idx | offset0] = matrix[10] * phi10 + matrix[11] * phi11;
             m_state[real00_idx | offset0 | offset1] = matrix[14] * phi10 + matrix[15] * phi11;
         }
@@ -756,7 +866,8 @@ QError CPUImplQPU::_CU(size_t qn_0, size_t qn_1, QStat &matrix, bool is_dagger)
     return qErrorNone;
 }
 
-QError CPUImplQPU::_U1(size_t qn, QStat &matrix, bool is_dagger)
+template <typename data_t>
+QError CPUImplQPU<data_t>::_U1(size_t qn, QStat &matrix, bool is_dagger)
 {
     int64_t size = 1ll << (m_qubit_num - 1);
     int64_t offset = 1ll << qn;
@@ -787,7 +898,8 @@ QError CPUImplQPU::_U1(size_t qn, QStat &matrix, bool is_dagger)
     return qErrorNone;
 }
 
-QError CPUImplQPU::_P(size_t qn, QStat &matrix, bool is_dagger)
+template <typename data_t>
+QError CPUImplQPU<data_t>::_P(size_t qn, QStat &matrix, bool is_dagger)
 {
 	int64_t size = 1ll << (m_qubit_num - 1);
 	int64_t offset = 1ll << qn;
@@ -818,23 +930,19 @@ QError CPUImplQPU::_P(size_t qn, QStat &matrix, bool is_dagger)
 	return qErrorNone;
 }
 
-QError CPUImplQPU::_X(size_t qn, Qnum &controls)
+template <typename data_t>
+QError CPUImplQPU<data_t>::_X(size_t qn, Qnum &controls)
 {
-    int64_t size = 1ll << (m_qubit_num - 1);
+    ControlSubspace subspace(controls, { qn });
+    int64_t size = subspace.size(m_qubit_num);
     int64_t offset = 1ll << qn;
-    int64_t mask = 0;
-    for_each(controls.begin(), controls.end() - 1, [&](size_t &q) {
-        mask |= 1ll << q;
-    });
 
     if (size > m_threshold)
     {
 #pragma omp parallel for
         for (int64_t i = 0; i < size; i++)
         {
-            int64_t real00_idx = _insert(i, qn);
-            if (mask != (mask & real00_idx))
-                continue;
+            int64_t real00_idx = subspace(i);
             int64_t real01_idx = real00_idx | offset;
             std::swap(m_state[real00_idx], m_state[real01_idx]);
         }
@@ -843,9 +951,7 @@ QError CPUImplQPU::_X(size_t qn, Qnum &controls)
     {
         for (int64_t i = 0; i < size; i++)
         {
-            int64_t real00_idx = _insert(i, qn);
-            if (mask != (mask & real00_idx))
-                continue;
+            int64_t real00_idx = subspace(i);
             int64_t real01_idx = real00_idx | offset;
             std::swap(m_state[real00_idx], m_state[real01_idx]);
         }
@@ -854,65 +960,55 @@ QError CPUImplQPU::_X(size_t qn, Qnum &controls)
     return qErrorNone;
 }
 
-QError CPUImplQPU::_Y(size_t qn, Qnum &controls)
+template <typename data_t>
+QError CPUImplQPU<data_t>::_Y(size_t qn, Qnum &controls)
 {
-    int64_t size = 1ll << (m_qubit_num - 1);
+    ControlSubspace subspace(controls, { qn });
+    int64_t size = subspace.size(m_qubit_num);
     int64_t offset = 1ll << qn;
-    int64_t mask = 0;
-    for_each(controls.begin(), controls.end() - 1, [&](size_t &q) {
-        mask |= 1ll << q;
-    });
 
     if (size > m_threshold)
     {
 #pragma omp parallel for
         for (int64_t i = 0; i < size; i++)
         {
-            int64_t real00_idx = _insert(i, qn);
-            if (mask != (mask & real00_idx))
-                continue;
+            int64_t real00_idx = subspace(i);
             int64_t real01_idx = real00_idx | offset;
-            auto alpha = m_state[real00_idx];
-            auto beta = m_state[real01_idx];
-            m_state[real00_idx] = { beta.imag(), -beta.real() };
-            m_state[real01_idx] = { -alpha.imag(), alpha.real() };
+            qcomplex_t alpha = m_state[real00_idx];
+            qcomplex_t beta = m_state[real01_idx];
+            m_state[real00_idx] = std::complex<data_t>(beta.imag(), -beta.real());
+            m_state[real01_idx] = std::complex<data_t>(-alpha.imag(), alpha.real());
         }
     }
     else
     {
         for (int64_t i = 0; i < size; i++)
         {
-            int64_t real00_idx = _insert(i, qn);
-            if (mask != (mask & real00_idx))
-                continue;
+            int64_t real00_idx = subspace(i);
             int64_t real01_idx = real00_idx | offset;
-            auto alpha = m_state[real00_idx];
-            auto beta = m_state[real01_idx];
-            m_state[real00_idx] = { beta.imag(), -beta.real() };
-            m_state[real01_idx] = { -alpha.imag(), alpha.real() };
+            qcomplex_t alpha = m_state[real00_idx];
+            qcomplex_t beta = m_state[real01_idx];
+            m_state[real00_idx] = std::complex<data_t>(beta.imag(), -beta.real());
+            m_state[real01_idx] = std::complex<data_t>(-alpha.imag(), alpha.real());
         }
     }
 
     return qErrorNone;
 }
 
-QError CPUImplQPU::_Z(size_t qn, Qnum &controls)
+template <typename data_t>
+QError CPUImplQPU<data_t>::_Z(size_t qn, Qnum &controls)
 {
-    int64_t size = 1ll << (m_qubit_num - 1);
+    ControlSubspace subspace(controls, { qn });
+    int64_t size = subspace.size(m_qubit_num);
     int64_t offset = 1ll << qn;
-    int64_t mask = 0;
-    for_each(controls.begin(), controls.end() - 1, [&](size_t &q) {
-        mask |= 1ll << q;
-    });
 
     if (size > m_threshold)
     {
 #pragma omp parallel for
         for (int64_t i = 0; i < size; i++)
         {
-            int64_t real00_idx = _insert(i, qn);
-            if (mask != (mask & real00_idx))
-                continue;
+            int64_t real00_idx = subspace(i);
             int64_t real01_idx = real00_idx | offset;
             m_state[real01_idx] = -m_state[real01_idx];
         }
@@ -921,9 +1017,7 @@ QError CPUImplQPU::_Z(size_t qn, Qnum &controls)
     {
         for (int64_t i = 0; i < size; i++)
         {
-            int64_t real00_idx = _insert(i, qn);
-            if (mask != (mask & real00_idx))
-                continue;
+            int64_t real00_idx = subspace(i);
             int64_t real01_idx = real00_idx | offset;
             m_state[real01_idx] = -m_state[real01_idx];
         }
@@ -932,23 +1026,19 @@ QError CPUImplQPU::_Z(size_t qn, Qnum &controls)
     return qErrorNone;
 }
 
-QError CPUImplQPU::_S(size_t qn, bool is_dagger, Qnum &controls)
+template <typename data_t>
+QError CPUImplQPU<data_t>::_S(size_t qn, bool is_dagger, Qnum &controls)
 {
-    int64_t size = 1ll << (m_qubit_num - 1);
+    ControlSubspace subspace(controls, { qn });
+    int64_t size = subspace.size(m_qubit_num);
     int64_t offset = 1ll << qn;
-    int64_t mask = 0;
-    for_each(controls.begin(), controls.end() - 1, [&](size_t &q) {
-        mask |= 1ll << q;
-    });
 
     if (size > m_threshold)
     {
 #pragma omp parallel for
         for (int64_t i = 0; i < size; i++)
         {
-            int64_t real00_idx = _insert(i, qn);
-            if (mask != (mask & real00_idx))
-                continue;
+            int64_t real00_idx = subspace(i);
             int64_t real01_idx = real00_idx | offset;
             if (is_dagger)
             {
@@ -964,9 +1054,7 @@ QError CPUImplQPU::_S(size_t qn, bool is_dagger, Qnum &controls)
     {
         for (int64_t i = 0; i < size; i++)
         {
-            int64_t real00_idx = _insert(i, qn);
-            if (mask != (mask & real00_idx))
-                continue;
+            int64_t real00_idx = subspace(i);
             int64_t real01_idx = real00_idx | offset;
             if (is_dagger)
             {
@@ -983,14 +1071,12 @@ QError CPUImplQPU::_S(size_t qn, bool is_dagger, Qnum &controls)
 }
 
 
-QError CPUImplQPU::_RZ(size_t qn, QStat &matrix, bool is_dagger, Qnum &controls)
+template <typename data_t>
+QError CPUImplQPU<data_t>::_RZ(size_t qn, QStat &matrix, bool is_dagger, Qnum &controls)
 {
-    int64_t size = 1ll << (m_qubit_num - 1);
+    ControlSubspace subspace(controls, { qn });
+    int64_t size = subspace.size(m_qubit_num);
     int64_t offset = 1ll << qn;
-    int64_t mask = 0;
-    for_each(controls.begin(), controls.end() - 1, [&](size_t &q) {
-        mask |= 1ll << q;
-    });
 
     if (is_dagger)
     {
@@ -1003,9 +1089,7 @@ QError CPUImplQPU::_RZ(size_t qn, QStat &matrix, bool is_dagger, Qnum &controls)
 #pragma omp parallel for
         for (int64_t i = 0; i < size; i++)
         {
-            int64_t real00_idx = _insert(i, qn);
-            if (mask != (mask & real00_idx))
-                continue;
+            int64_t real00_idx = subspace(i);
             int64_t real01_idx = real00_idx | offset;
             m_state[real00_idx] *= matrix[0];
             m_state[real01_idx] *= matrix[3];
@@ -1015,9 +1099,7 @@ QError CPUImplQPU::_RZ(size_t qn, QStat &matrix, bool is_dagger, Qnum &controls)
     {
         for (int64_t i = 0; i < size; i++)
         {
-            int64_t real00_idx = _insert(i, qn);
-            if (mask != (mask & real00_idx))
-                continue;
+            int64_t real00_idx = subspace(i);
             int64_t real01_idx = real00_idx | offset;
             m_state[real00_idx] *= matrix[0];
             m_state[real01_idx] *= matrix[3];
@@ -1026,27 +1108,23 @@ QError CPUImplQPU::_RZ(size_t qn, QStat &matrix, bool is_dagger, Qnum &controls)
     return qErrorNone;
 }
 
-QError CPUImplQPU::_H(size_t qn, QStat &matrix, Qnum &controls)
+template <typename data_t>
+QError CPUImplQPU<data_t>::_H(size_t qn, QStat &matrix, Qnum &controls)
 {
-    int64_t size = 1ll << (m_qubit_num - 1);
+    ControlSubspace subspace(controls, { qn });
+    int64_t size = subspace.size(m_qubit_num);
     int64_t offset = 1ll << qn;
-    int64_t mask = 0;
-    for_each(controls.begin(), controls.end() - 1, [&](size_t &q) {
-        mask |= 1ll << q;
-    });
 
     if (size > m_threshold)
     {
 #pragma omp parallel for
         for (int64_t i = 0; i < size; i++)
         {
-            int64_t real00_idx = _insert(i, qn);
-            if (mask != (mask & real00_idx))
-                continue;
+            int64_t real00_idx = subspace(i);
             int64_t real01_idx = real00_idx | offset;
 
-            auto alpha = m_state[real00_idx];
-            auto beta = m_state[real01_idx];
+            qcomplex_t alpha = m_state[real00_idx];
+            qcomplex_t beta = m_state[real01_idx];
             m_state[real00_idx] = (alpha + beta) * SQ2;
             m_state[real01_idx] = (alpha - beta) * SQ2;
         }
@@ -1055,13 +1133,11 @@ QError CPUImplQPU::_H(size_t qn, QStat &matrix, Qnum &controls)
     {
         for (int64_t i = 0; i < size; i++)
         {
-            int64_t real00_idx = _insert(i, qn);
-            if (mask != (mask & real00_idx))
-                continue;
+            int64_t real00_idx = subspace(i);
             int64_t real01_idx = real00_idx | offset;
 
-            auto alpha = m_state[real00_idx];
-            auto beta = m_state[real01_idx];
+            qcomplex_t alpha = m_state[real00_idx];
+            qcomplex_t beta = m_state[real01_idx];
             m_state[real00_idx] = (alpha + beta) * SQ2;
             m_state[real01_idx] = (alpha - beta) * SQ2;
         }
@@ -1069,24 +1145,20 @@ QError CPUImplQPU::_H(size_t qn, QStat &matrix, Qnum &controls)
     return qErrorNone;
 }
 
-QError CPUImplQPU::_CNOT(size_t qn_0, size_t qn_1, Qnum &controls)
+template <typename data_t>
+QError CPUImplQPU<data_t>::_CNOT(size_t qn_0, size_t qn_1, Qnum &controls)
 {
-    int64_t size = 1ll << (m_qubit_num - 2);
+    ControlSubspace subspace(controls, { qn_0, qn_1 });
+    int64_t size = subspace.size(m_qubit_num);
     int64_t offset0 = 1ll << qn_0;
     int64_t offset1 = 1ll << qn_1;
-    int64_t mask = 0;
-    for_each(controls.begin(), controls.end() - 2, [&](size_t &q) {
-        mask |= 1ll << q;
-    });
 
     if (size > m_threshold)
     {
 #pragma omp parallel for
         for (int64_t i = 0; i < size; i++)
         {
-            int64_t real00_idx = _insert(i, qn_1, qn_0);
-            if (mask != (mask & real00_idx))
-                continue;
+            int64_t real00_idx = subspace(i);
             std::swap(m_state[real00_idx | offset0], m_state[real00_idx | offset0 | offset1]);
         }
     }
@@ -1094,16 +1166,15 @@ QError CPUImplQPU::_CNOT(size_t qn_0, size_t qn_1, Qnum &controls)
     {
         for (int64_t i = 0; i < size; i++)
         {
-            int64_t real00_idx = _insert(i, qn_1, qn_0);
-            if (mask != (mask & real00_idx))
-                continue;
+            int64_t real00_idx = subspace(i);
             std::swap(m_state[real00_idx | offset0], m_state[real00_idx | offset0 | offset1]);
         }
     }
     return qErrorNone;
 }
 
-QError CPUImplQPU::_CZ(size_t qn_0, size_t qn_1)
+template <typename data_t>
+QError CPUImplQPU<data_t>::_CZ(size_t qn_0, size_t qn_1)
 {
     int64_t size = 1ll << (m_qubit_num - 2);
     int64_t offset0 = 1ll << qn_0;
@@ -1129,15 +1200,13 @@ QError CPUImplQPU::_CZ(size_t qn_0, size_t qn_1)
     return qErrorNone;
 }
 
-QError CPUImplQPU::_CR(size_t qn_0, size_t qn_1, QStat &matrix, bool is_dagger, Qnum &controls)
+template <typename data_t>
+QError CPUImplQPU<data_t>::_CR(size_t qn_0, size_t qn_1, QStat &matrix, bool is_dagger, Qnum &controls)
 {
-    int64_t size = 1ll << (m_qubit_num - 2);
+    ControlSubspace subspace(controls, { qn_0, qn_1 });
+    int64_t size = subspace.size(m_qubit_num);
     int64_t offset0 = 1ll << qn_0;
     int64_t offset1 = 1ll << qn_1;
-    int64_t mask = 0;
-    for_each(controls.begin(), controls.end() - 2, [&](size_t &q) {
-        mask |= 1ll << q;
-    });
 
     if (is_dagger)
     {
@@ -1149,9 +1218,7 @@ QError CPUImplQPU::_CR(size_t qn_0, size_t qn_1, QStat &matrix, bool is_dagger,
 #pragma omp parallel for
         for (int64_t i = 0; i < size; i++)
         {
-            int64_t real00_idx = _insert(i, qn_1, qn_0);
-            if (mask != (mask & real00_idx))
-                continue;
+            int64_t real00_idx = subspace(i);
             m_state[real00_idx | offset0 | offset1] *= matrix[15];
         }
     }
@@ -1159,24 +1226,20 @@ QError CPUImplQPU::_CR(size_t qn_0, size_t qn_1, QStat &matrix, bool is_dagger,
     {
         for (int64_t i = 0; i < size; i++)
         {
-            int64_t real00_idx = _insert(i, qn_1, qn_0);
-            if (mask != (mask & real00_idx))
-                continue;
+            int64_t real00_idx = subspace(i);
             m_state[real00_idx | offset0 | offset1] *= matrix[15];
         }
     }
     return qErrorNone;
 }
 
-QError CPUImplQPU::_CP(size_t qn_0, size_t qn_1, QStat &matrix, bool is_dagger, Qnum &controls)
+template <typename data_t>
+QError CPUImplQPU<data_t>::_CP(size_t qn_0, size_t qn_1, QStat &matrix, bool is_dagger, Qnum &controls)
 {
-	int64_t size = 1ll << (m_qubit_num - 2);
+	ControlSubspace subspace(controls, { qn_0, qn_1 });
+	int64_t size = subspace.size(m_qubit_num);
 	int64_t offset0 = 1ll << qn_0;
 	int64_t offset1 = 1ll << qn_1;
-	int64_t mask = 0;
-	for_each(controls.begin(), controls.end() - 2, [&](size_t &q) {
-		mask |= 1ll << q;
-	});
 
 	if (is_dagger)
 	{
@@ -1188,9 +1251,7 @@ QError CPUImplQPU::_CP(size_t qn_0, size_t qn_1, QStat &matrix, bool is_dagger,
 #pragma omp parallel for
 		for (int64_t i = 0; i < size; i++)
 		{
-			int64_t real00_idx = _insert(i, qn_1, qn_0);
-			if (mask != (mask & real00_idx))
-				continue;
+			int64_t real00_idx = subspace(i);
 			m_state[real00_idx | offset0 | offset1] *= matrix[15];
 		}
 	}
@@ -1198,33 +1259,27 @@ QError CPUImplQPU::_CP(size_t qn_0, size_t qn_1, QStat &matrix, bool is_dagger,
 	{
 		for (int64_t i = 0; i < size; i++)
 		{
-			int64_t real00_idx = _insert(i, qn_1, qn_0);
-			if (mask != (mask & real00_idx))
-				continue;
+			int64_t real00_idx = subspace(i);
 			m_state[real00_idx | offset0 | offset1] *= matrix[15];
 		}
 	}
 	return qErrorNone;
 }
 
-QError CPUImplQPU::_SWAP(size_t qn_0, size_t qn_1, Qnum &controls)
+template <typename data_t>
+QError CPUImplQPU<data_t>::_SWAP(size_t qn_0, size_t qn_1, Qnum &controls)
 {
-    int64_t size = 1ll << (m_qubit_num - 2);
+    ControlSubspace subspace(controls, { qn_0, qn_1 });
+    int64_t size = subspace.size(m_qubit_num);
     int64_t offset0 = 1ll << qn_0;
     int64_t offset1 = 1ll << qn_1;
-    int64_t mask = 0;
-    for_each(controls.begin(), controls.end() - 2, [&](size_t &q) {
-        mask |= 1ll << q;
-    });
 
     if (size > m_threshold)
     {
 #pragma omp parallel for
         for (int64_t i = 0; i < size; i++)
         {
-            int64_t real00_idx = _insert(i, qn_1, qn_0);
-            if (mask != (mask & real00_idx))
-                continue;
+            int64_t real00_idx = subspace(i);
             std::swap(m_state[real00_idx | offset1], m_state[real00_idx | offset0]);
         }
     }
@@ -1232,24 +1287,20 @@ QError CPUImplQPU::_SWAP(size_t qn_0, size_t qn_1, Qnum &controls)
     {
         for (int64_t i = 0; i < size; i++)
         {
-            int64_t real00_idx = _insert(i, qn_1, qn_0);
-            if (mask != (mask & real00_idx))
-                continue;
+            int64_t real00_idx = subspace(i);
             std::swap(m_state[real00_idx | offset1], m_state[real00_idx | offset0]);
         }
     }
     return qErrorNone;
 }
 
-QError CPUImplQPU::_iSWAP(size_t qn_0, size_t qn_1, QStat &matrix, bool is_dagger, Qnum &controls)
+template <typename data_t>
+QError CPUImplQPU<data_t>::_iSWAP(size_t qn_0, size_t qn_1, QStat &matrix, bool is_dagger, Qnum &controls)
 {
-    int64_t size = 1ll << (m_qubit_num - 2);
+    ControlSubspace subspace(controls, { qn_0, qn_1 });
+    int64_t size = subspace.size(m_qubit_num);
     int64_t offset0 = 1ll << qn_0;
     int64_t offset1 = 1ll << qn_1;
-    int64_t mask = 0;
-    for_each(controls.begin(), controls.end() - 2, [&](size_t &q) {
-        mask |= 1ll << q;
-    });
 
     if (is_dagger)
     {
@@ -1262,11 +1313,9 @@ QError CPUImplQPU::_iSWAP(size_t qn_0, size_t qn_1, QStat &matrix, bool is_dagge
 #pragma omp parallel for
         for (int64_t i = 0; i < size; i++)
         {
-            int64_t real00_idx = _insert(i, qn_1, qn_0);
-            if (mask != (mask & real00_idx))
-                continue;
-            auto phi01 = m_state[real00_idx | offset1];
-            auto phi10 = m_state[real00_idx | offset0];
+            int64_t real00_idx = subspace(i);
+            qcomplex_t phi01 = m_state[real00_idx | offset1];
+            qcomplex_t phi10 = m_state[real00_idx | offset0];
             m_state[real00_idx | offset1] = matrix[6] * phi10;
             m_state[real00_idx | offset0] = matrix[9] * phi01;
         }
@@ -1275,11 +1324,9 @@ QError CPUImplQPU::_iSWAP(size_t qn_0, size_t qn_1, QStat &matrix, bool is_dagge
     {
         for (int64_t i = 0; i < size; i++)
         {
-            int64_t real00_idx = _insert(i, qn_1, qn_0);
-            if (mask != (mask & real00_idx))
-                continue;
-            auto phi01 = m_state[real00_idx | offset1];
-            auto phi10 = m_state[real00_idx | offset0];
+            int64_t real00_idx = subspace(i);
+            qcomplex_t phi01 = m_state[real00_idx | offset1];
+            qcomplex_t phi10 = m_state[real00_idx | offset0];
             m_state[real00_idx | offset1] = matrix[6] * phi10;
             m_state[real00_idx | offset0] = matrix[9] * phi01;
         }
@@ -1287,15 +1334,13 @@ QError CPUImplQPU::_iSWAP(size_t qn_0, size_t qn_1, QStat &matrix, bool is_dagge
     return qErrorNone;
 }
 
-QError CPUImplQPU::_iSWAP_theta(size_t qn_0, size_t qn_1, QStat &matrix, bool is_dagger, Qnum &controls)
+template <typename data_t>
+QError CPUImplQPU<data_t>::_iSWAP_theta(size_t qn_0, size_t qn_1, QStat &matrix, bool is_dagger, Qnum &controls)
 {
-    int64_t size = 1ll << (m_qubit_num - 2);
+    ControlSubspace subspace(controls, { qn_0, qn_1 });
+    int64_t size = subspace.size(m_qubit_num);
     int64_t offset0 = 1ll << qn_0;
     int64_t offset1 = 1ll << qn_1;
-    int64_t mask = 0;
-    for_each(controls.begin(), controls.end() - 2, [&](size_t &q) {
-        mask |= 1ll << q;
-    });
 
     if (is_dagger)
     {
@@ -1308,11 +1353,9 @@ QError CPUImplQPU::_iSWAP_theta(size_t qn_0, size_t qn_1, QStat &matrix, bool is
 #pragma omp parallel for
         for (int64_t i = 0; i < size; i++)
         {
-            int64_t real00_idx = _insert(i, qn_1, qn_0);
-            if (mask != (mask & real00_idx))
-                continue;
-            auto phi01 = m_state[real00_idx | offset1];
-            auto phi10 = m_state[real00_idx | offset0];
+            int64_t real00_idx = subspace(i);
+            qcomplex_t phi01 = m_state[real00_idx | offset1];
+            qcomplex_t phi10 = m_state[real00_idx | offset0];
             m_state[real00_idx | offset1] = matrix[5] * phi01 + matrix[6] * phi10;
             m_state[real00_idx | offset0] = matrix[9] * phi01 + matrix[10] * phi10;
         }
@@ -1321,11 +1364,9 @@ QError CPUImplQPU::_iSWAP_theta(size_t qn_0, size_t qn_1, QStat &matrix, bool is
     {
         for (int64_t i = 0; i < size; i++)
         {
-            int64_t real00_idx = _insert(i, qn_1, qn_0);
-            if (mask != (mask & real00_idx))
-                continue;
-            auto phi01 = m_state[real00_idx | offset1];
-            auto phi10 = m_state[real00_idx | offset0];
+            int64_t real00_idx = subspace(i);
+            qcomplex_t phi01 = m_state[real00_idx | offset1];
+            qcomplex_t phi10 = m_state[real00_idx | offset0];
             m_state[real00_idx | offset1] = matrix[5] * phi01 + matrix[6] * phi10;
             m_state[real00_idx | offset0] = matrix[9] * phi01 + matrix[10] * phi10;
         }
@@ -1333,15 +1374,13 @@ QError CPUImplQPU::_iSWAP_theta(size_t qn_0, size_t qn_1, QStat &matrix, bool is
     return qErrorNone;
 }
 
-QError CPUImplQPU::_CU(size_t qn_0, size_t qn_1, QStat &matrix, bool is_dagger, Qnum &controls)
+template <typename data_t>
+QError CPUImplQPU<data_t>::_CU(size_t qn_0, size_t qn_1, QStat &matrix, bool is_dagger, Qnum &controls)
 {
-    int64_t size = 1ll << (m_qubit_num - 2);
+    ControlSubspace subspace(controls, { qn_0, qn_1 });
+    int64_t size = subspace.size(m_qubit_num);
     int64_t offset0 = 1ll << qn_0;
     int64_t offset1 = 1ll << qn_1;
-    int64_t mask = 0;
-    for_each(controls.begin(), controls.end() - 2, [&](size_t &q) {
-        mask |= 1ll << q;
-    });
 
 	qcomplex_t temp;
     if (is_dagger)
@@ -1358,11 +1397,9 @@ QError CPUImplQPU::_CU(size_t qn_0, size_t qn_1, QStat &matrix, bool is_dagger,
 #pragma omp parallel for
         for (int64_t i = 0; i < size; i++)
         {
-            int64_t real00_idx = _insert(i, qn_1, qn_0);
-            if (mask != (mask & real00_idx))
-                continue;
-            auto phi10 = m_state[real00_idx | offset0];
-            auto phi11 = m_state[real00_idx | offset0 | offset1];
+            int64_t real00_idx = subspace(i);
+            qcomplex_t phi10 = m_state[real00_idx | offset0];
+            qcomplex_t phi11 = m_state[real00_idx | offset0 | offset1];
             m_state[real00_idx | offset0] = matrix[10] * phi10 + matrix[11] * phi11;
             m_state[real00_idx | offset0 | offset1] = matrix[14] * phi10 + matrix[15] * phi11;
         }
@@ -1371,11 +1408,9 @@ QError CPUImplQPU::_CU(size_t qn_0, size_t qn_1, QStat &matrix, bool is_dagger,
     {
         for (int64_t i = 0; i < size; i++)
         {
-            int64_t real00_idx = _insert(i, qn_1, qn_0);
-            if (mask != (mask & real00_idx))
-                continue;
-            auto phi10 = m_state[real00_idx | offset0];
-            auto phi11 = m_state[real00_idx | offset0 | offset1];
+            int64_t real00_idx = subspace(i);
+            qcomplex_t phi10 = m_state[real00_idx | offset0];
+            qcomplex_t phi11 = m_state[real00_idx | offset0 | offset1];
             m_state[real00_idx | offset0] = matrix[10] * phi10 + matrix[11] * phi11;
             m_state[real00_idx | offset0 | offset1] = matrix[14] * phi10 + matrix[15] * phi11;
         }
@@ -1383,7 +1418,8 @@ QError CPUImplQPU::_CU(size_t qn_0, size_t qn_1, QStat &matrix, bool is_dagger,
     return qErrorNone;
 }
 
-void CPUImplQPU::_verify_state(const QStat &state)
+template <typename data_t>
+void CPUImplQPU<data_t>::_verify_state(const QStat &state)
 {
     double prob = 0;
 #pragma omp parallel for reduction(+:prob)
@@ -1395,14 +1431,12 @@ void CPUImplQPU::_verify_state(const QStat &state)
     QPANDA_ASSERT(std::abs(1 - prob) > kStateEpSilon, "Error: initState state.");
 }
 
-QError CPUImplQPU::_U1(size_t qn, QStat &matrix, bool is_dagger, Qnum &controls)
+template <typename data_t>
+QError CPUImplQPU<data_t>::_U1(size_t qn, QStat &matrix, bool is_dagger, Qnum &controls)
 {
-    int64_t size = 1ll << (m_qubit_num - 1);
+    ControlSubspace subspace(controls, { qn });
+    int64_t size = subspace.size(m_qubit_num);
     int64_t offset = 1ll << qn;
-    int64_t mask = 0;
-    for_each(controls.begin(), controls.end() - 1, [&](size_t &q) {
-        mask |= 1ll << q;
-    });
 
     if (is_dagger)
     {
@@ -1414,9 +1448,7 @@ QError CPUImplQPU::_U1(size_t qn, QStat &matrix, bool is_dagger, Qnum &controls)
 #pragma omp parallel for
         for (int64_t i = 0; i < size; i++)
         {
-            int64_t real00_idx = _insert(i, qn);
-            if (mask != (mask & real00_idx))
-                continue;
+            int64_t real00_idx = subspace(i);
             int64_t real01_idx = real00_idx | offset;
             m_state[real01_idx] *= matrix[3];
         }
@@ -1425,9 +1457,7 @@ QError CPUImplQPU::_U1(size_t qn, QStat &matrix, bool is_dagger, Qnum &controls)
     {
         for (int64_t i = 0; i < size; i++)
         {
-            int64_t real00_idx = _insert(i, qn);
-            if (mask != (mask & real00_idx))
-                continue;
+            int64_t real00_idx = subspace(i);
             int64_t real01_idx = real00_idx | offset;
             m_state[real01_idx] *= matrix[3];
         }
@@ -1435,14 +1465,12 @@ QError CPUImplQPU::_U1(size_t qn, QStat &matrix, bool is_dagger, Qnum &controls)
     return qErrorNone;
 }
 
-QError CPUImplQPU::_P(size_t qn, QStat &matrix, bool is_dagger, Qnum &controls)
+template <typename data_t>
+QError CPUImplQPU<data_t>::_P(size_t qn, QStat &matrix, bool is_dagger, Qnum &controls)
 {
-	int64_t size = 1ll << (m_qubit_num - 1);
+	ControlSubspace subspace(controls, { qn });
+	int64_t size = subspace.size(m_qubit_num);
 	int64_t offset = 1ll << qn;
-	int64_t mask = 0;
-	for_each(controls.begin(), controls.end() - 1, [&](size_t &q) {
-		mask |= 1ll << q;
-	});
 
 	if (is_dagger)
 	{
@@ -1454,9 +1482,7 @@ QError CPUImplQPU::_P(size_t qn, QStat &matrix, bool is_dagger, Qnum &controls)
 #pragma omp parallel for
 		for (int64_t i = 0; i < size; i++)
 		{
-			int64_t real00_idx = _insert(i, qn);
-			if (mask != (mask & real00_idx))
-				continue;
+			int64_t real00_idx = subspace(i);
 			int64_t real01_idx = real00_idx | offset;
 			m_state[real01_idx] *= matrix[3];
 		}
@@ -1465,9 +1491,7 @@ QError CPUImplQPU::_P(size_t qn, QStat &matrix, bool is_dagger, Qnum &controls)
 	{
 		for (int64_t i = 0; i < size; i++)
 		{
-			int64_t real00_idx = _insert(i, qn);
-			if (mask != (mask & real00_idx))
-				continue;
+			int64_t real00_idx = subspace(i);
 			int64_t real01_idx = real00_idx | offset;
 			m_state[real01_idx] *= matrix[3];
 		}
@@ -1475,7 +1499,8 @@ QError CPUImplQPU::_P(size_t qn, QStat &matrix, bool is_dagger, Qnum &controls)
 	return qErrorNone;
 }
 
-QError CPUImplQPU::_single_qubit_normal_unitary(size_t qn, QStat &matrix, bool is_dagger)
+template <typename data_t>
+QError CPUImplQPU<data_t>::_single_qubit_normal_unitary(size_t qn, QStat &matrix, bool is_dagger)
 {
     if (is_dagger)
     {
@@ -1509,6 +1534,10 @@ QError CPUImplQPU::_single_qubit_normal_unitary(size_t qn, QStat &matrix, bool i
     */
     int64_t size = 1ll << (m_qubit_num - 1);
     int64_t offset = 1ll << qn;
+    if (simd_single_qubit_unitary(m_state.data(), m_qubit_num, qn, matrix.data(), _omp_thread_num(size)))
+    {
+        return qErrorNone;
+    }
 
     if (size > m_threshold)
     {
@@ -1518,8 +1547,8 @@ QError CPUImplQPU::_single_qubit_normal_unitary(size_t qn, QStat &matrix, bool i
             int64_t real00_idx = _insert(i, qn);
             int64_t real01_idx = real00_idx | offset;
 
-            auto alpha = m_state[real00_idx];
-            auto beta = m_state[real01_idx];
+            qcomplex_t alpha = m_state[real00_idx];
+            qcomplex_t beta = m_state[real01_idx];
             m_state[real00_idx] = matrix[0] * alpha + matrix[1] * beta;
             m_state[real01_idx] = matrix[2] * alpha + matrix[3] * beta;
         }
@@ -1531,8 +1560,8 @@ QError CPUImplQPU::_single_qubit_normal_unitary(size_t qn, QStat &matrix, bool i
             int64_t real00_idx = _insert(i, qn);
             int64_t real01_idx = real00_idx | offset;
 
-            auto alpha = m_state[real00_idx];
-            auto beta = m_state[real01_idx];
+            qcomplex_t alpha = m_state[real00_idx];
+            qcomplex_t beta = m_state[real01_idx];
             m_state[real00_idx] = matrix[0] * alpha + matrix[1] * beta;
             m_state[real01_idx] = matrix[2] * alpha + matrix[3] * beta;
         }
@@ -1540,7 +1569,8 @@ QError CPUImplQPU::_single_qubit_normal_unitary(size_t qn, QStat &matrix, bool i
     return qErrorNone;
 }
 
-QError CPUImplQPU::_single_qubit_normal_unitary(size_t qn, Qnum &controls,
+template <typename data_t>
+QError CPUImplQPU<data_t>::_single_qubit_normal_unitary(size_t qn, Qnum &controls,
     QStat &matrix, bool is_dagger)
 {
     if (is_dagger)
@@ -1555,12 +1585,9 @@ QError CPUImplQPU::_single_qubit_normal_unitary(size_t qn, Qnum &controls,
         }//dagger
     }
 
-    int64_t mask = 0;
-    for_each(controls.begin(), controls.end() - 1, [&](size_t &q) {
-        mask |= 1ll << q;
-    });
 
-    int64_t size = 1ll << (m_qubit_num - 1);
+    ControlSubspace subspace(controls, { qn });
+    int64_t size = subspace.size(m_qubit_num);
     int64_t offset = 1ll << qn;
 
     if (size > m_threshold)
@@ -1568,11 +1595,9 @@ QError CPUImplQPU::_single_qubit_normal_unitary(size_t qn, Qnum &controls,
 #pragma omp parallel for
         for (int64_t i = 0; i < size; i++)
         {
-            int64_t real00_idx = _insert(i, qn);
-            if (mask != (mask & real00_idx))
-                continue;
-            auto alpha = m_state[real00_idx];
-            auto beta = m_state[real00_idx | offset];
+            int64_t real00_idx = subspace(i);
+            qcomplex_t alpha = m_state[real00_idx];
+            qcomplex_t beta = m_state[real00_idx | offset];
             m_state[real00_idx] = matrix[0] * alpha + matrix[1] * beta;
             m_state[real00_idx | offset] = matrix[2] * alpha + matrix[3] * beta;
         }
@@ -1581,11 +1606,9 @@ QError CPUImplQPU::_single_qubit_normal_unitary(size_t qn, Qnum &controls,
     {
         for (int64_t i = 0; i < size; i++)
         {
-            int64_t real00_idx = _insert(i, qn);
-            if (mask != (mask & real00_idx))
-                continue;
-            auto alpha = m_state[real00_idx];
-            auto beta = m_state[real00_idx | offset];
+            int64_t real00_idx = subspace(i);
+            qcomplex_t alpha = m_state[real00_idx];
+            qcomplex_t beta = m_state[real00_idx | offset];
             m_state[real00_idx] = matrix[0] * alpha + matrix[1] * beta;
             m_state[real00_idx | offset] = matrix[2] * alpha + matrix[3] * beta;
         }
@@ -1594,15 +1617,12 @@ QError CPUImplQPU::_single_qubit_normal_unitary(size_t qn, Qnum &controls,
     return qErrorNone;
 }
 
-QError CPUImplQPU::_double_qubit_normal_unitary(size_t qn_0, size_t qn_1, QStat &matrix, bool is_dagger)
+template <typename data_t>
+QError CPUImplQPU<data_t>::_double_qubit_normal_unitary(size_t qn_0, size_t qn_1, QStat &matrix, bool is_dagger)
 {
     int64_t size = 1ll << (m_qubit_num - 2);
     int64_t offset0 = 1ll << qn_0;
     int64_t offset1 = 1ll << qn_1;
-	if (qn_0 > qn_1)
-	{
-		std::swap(qn_0, qn_1);
-	}
     if (is_dagger)
     {
         qcomplex_t temp;
@@ -1621,16 +1641,21 @@ QError CPUImplQPU::_double_qubit_normal_unitary(size_t qn_0, size_t qn_1, QStat
         }//dagger
     }
 
+    if (simd_double_qubit_unitary(m_state.data(), m_qubit_num, qn_0, qn_1, matrix.data(), _omp_thread_num(size)))
+    {
+        return qErrorNone;
+    }
+
     if (size > m_threshold)
     {
 #pragma omp parallel for
         for (int64_t i = 0; i < size; i++)
         {
             int64_t real00_idx = _insert(i, qn_0, qn_1);
-            auto phi00 = m_state[real00_idx];
-            auto phi01 = m_state[real00_idx | offset0];
-            auto phi10 = m_state[real00_idx | offset1];
-            auto phi11 = m_state[real00_idx | offset0 | offset1];
+            qcomplex_t phi00 = m_state[real00_idx];
+            qcomplex_t phi01 = m_state[real00_idx | offset0];
+            qcomplex_t phi10 = m_state[real00_idx | offset1];
+            qcomplex_t phi11 = m_state[real00_idx | offset0 | offset1];
 
             m_state[real00_idx] = matrix[0] * phi00 + matrix[1] * phi01
                 + matrix[2] * phi10 + matrix[3] * phi11;
@@ -1647,10 +1672,10 @@ QError CPUImplQPU::_double_qubit_normal_unitary(size_t qn_0, size_t qn_1, QStat
         for (int64_t i = 0; i < size; i++)
         {
             int64_t real00_idx = _insert(i, qn_0, qn_1);
-            auto phi00 = m_state[real00_idx];
-            auto phi01 = m_state[real00_idx | offset0];
-            auto phi10 = m_state[real00_idx | offset1];
-            auto phi11 = m_state[real00_idx | offset0 | offset1];
+            qcomplex_t phi00 = m_state[real00_idx];
+            qcomplex_t phi01 = m_state[real00_idx | offset0];
+            qcomplex_t phi10 = m_state[real00_idx | offset1];
+            qcomplex_t phi11 = m_state[real00_idx | offset0 | offset1];
 
             m_state[real00_idx] = matrix[0] * phi00 + matrix[1] * phi01
                 + matrix[2] * phi10 + matrix[3] * phi11;
@@ -1666,7 +1691,8 @@ QError CPUImplQPU::_double_qubit_normal_unitary(size_t qn_0, size_t qn_1, QStat
     return qErrorNone;
 }
 
-QError CPUImplQPU::_double_qubit_normal_unitary(size_t qn_0, size_t qn_1, Qnum &controls,
+template <typename data_t>
+QError CPUImplQPU<data_t>::_double_qubit_normal_unitary(size_t qn_0, size_t qn_1, Qnum &controls,
     QStat &matrix, bool is_dagger)
 {
     if (is_dagger)
@@ -1687,31 +1713,26 @@ QError CPUImplQPU::_double_qubit_normal_unitary(size_t qn_0, size_t qn_1, Qnum &
         }//dagger
     }
 
-    int64_t size = 1ll << (m_qubit_num - 2);
+    ControlSubspace subspace(controls, { qn_0, qn_1 });
+    int64_t size = subspace.size(m_qubit_num);
     int64_t offset0 = 1ll << qn_0;
     int64_t offset1 = 1ll << qn_1;
 	if (qn_0 > qn_1)
 	{
 		std::swap(qn_0, qn_1);
 	}
-    int64_t mask = 0;
-    for_each(controls.begin(), controls.end() - 2, [&](size_t &q) {
-        mask |= 1ll << q;
-    });
 
     if (size > m_threshold)
     {
 #pragma omp parallel for
         for (int64_t i = 0; i < size; i++)
         {
-            int64_t real00_idx = _insert(i, qn_0, qn_1);
-            if (mask != (mask & real00_idx))
-                continue;
+            int64_t real00_idx = subspace(i);
 
-            auto phi00 = m_state[real00_idx];
-            auto phi01 = m_state[real00_idx | offset0];
-            auto phi10 = m_state[real00_idx | offset1];
-            auto phi11 = m_state[real00_idx | offset0 + offset1];
+            qcomplex_t phi00 = m_state[real00_idx];
+            qcomplex_t phi01 = m_state[real00_idx | offset0];
+            qcomplex_t phi10 = m_state[real00_idx | offset1];
+            qcomplex_t phi11 = m_state[real00_idx | offset0 + offset1];
 
             m_state[real00_idx] = matrix[0] * phi00 + matrix[1] * phi01
                 + matrix[2] * phi10 + matrix[3] * phi11;
@@ -1727,14 +1748,12 @@ QError CPUImplQPU::_double_qubit_normal_unitary(size_t qn_0, size_t qn_1, Qnum &
     {
         for (int64_t i = 0; i < size; i++)
         {
-            int64_t real00_idx = _insert(i, qn_0, qn_1);
-            if (mask != (mask & real00_idx))
-                continue;
+            int64_t real00_idx = subspace(i);
 
-            auto phi00 = m_state[real00_idx];
-            auto phi01 = m_state[real00_idx | offset0];
-            auto phi10 = m_state[real00_idx | offset1];
-            auto phi11 = m_state[real00_idx | offset0 + offset1];
+            qcomplex_t phi00 = m_state[real00_idx];
+            qcomplex_t phi01 = m_state[real00_idx | offset0];
+            qcomplex_t phi10 = m_state[real00_idx | offset1];
+            qcomplex_t phi11 = m_state[real00_idx | offset0 + offset1];
 
             m_state[real00_idx] = matrix[0] * phi00 + matrix[1] * phi01
                 + matrix[2] * phi10 + matrix[3] * phi11;
@@ -1750,12 +1769,19 @@ QError CPUImplQPU::_double_qubit_normal_unitary(size_t qn_0, size_t qn_1, Qnum &
     return qErrorNone;
 }
 
-QError  CPUImplQPU::
+template <typename data_t>
+QError  CPUImplQPU<data_t>::
 unitarySingleQubitGate(size_t qn,
     QStat& matrix,
     bool is_dagger,
     GateType type)
 {
+    qn = _register_qubit(qn);
+    if (_can_defer_gate())
+    {
+        return _defer_gate({ GateCallType::SINGLE, false, { qn }, {}, matrix, is_dagger, type });
+    }
+
     switch (type)
     {
     case GateType::I_GATE:
@@ -1808,13 +1834,21 @@ unitarySingleQubitGate(size_t qn,
     return qErrorNone;
 }
 
-QError  CPUImplQPU::
+template <typename data_t>
+QError  CPUImplQPU<data_t>::
 controlunitarySingleQubitGate(size_t qn,
-    Qnum& controls,
+    Qnum& control_qubits,
     QStat & matrix,
     bool is_dagger,
     GateType type)
 {
+    qn = _register_qubit(qn);
+    Qnum controls = _register_qubits(control_qubits);
+    if (_can_defer_gate())
+    {
+        return _defer_gate({ GateCallType::SINGLE, true, { qn }, controls, matrix, is_dagger, type });
+    }
+
     switch (type)
     {
     case GateType::I_GATE:
@@ -1866,13 +1900,21 @@ controlunitarySingleQubitGate(size_t qn,
     return qErrorNone;
 }
 
-QError CPUImplQPU::
+template <typename data_t>
+QError CPUImplQPU<data_t>::
 unitaryDoubleQubitGate(size_t qn_0,
     size_t qn_1,
     QStat& matrix,
     bool is_dagger,
     GateType type)
 {
+    qn_0 = _register_qubit(qn_0);
+    qn_1 = _register_qubit(qn_1);
+    if (_can_defer_gate())
+    {
+        return _defer_gate({ GateCallType::DOUBLE, false, { qn_0, qn_1 }, {}, matrix, is_dagger, type });
+    }
+
     switch (type)
     {
     case GateType::CNOT_GATE:
@@ -1915,14 +1957,23 @@ unitaryDoubleQubitGate(size_t qn_0,
     return qErrorNone;
 }
 
-QError  CPUImplQPU::
+template <typename data_t>
+QError  CPUImplQPU<data_t>::
 controlunitaryDoubleQubitGate(size_t qn_0,
     size_t qn_1,
-    Qnum& controls,
+    Qnum& control_qubits,
     QStat& matrix,
     bool is_dagger,
     GateType type)
 {
+    qn_0 = _register_qubit(qn_0);
+    qn_1 = _register_qubit(qn_1);
+    Qnum controls = _register_qubits(control_qubits);
+    if (_can_defer_gate())
+    {
+        return _defer_gate({ GateCallType::DOUBLE, true, { qn_0, qn_1 }, controls, matrix, is_dagger, type });
+    }
+
     switch (type)
     {
     case GateType::CNOT_GATE:
@@ -1962,183 +2013,218 @@ controlunitaryDoubleQubitGate(size_t qn_0,
 }
 
 
-QError CPUImplQPU::Reset(size_t qn)
+template <typename data_t>
+QError CPUImplQPU<data_t>::Reset(size_t qn)
 {
     bool measure_out = qubitMeasure(qn);
     if (measure_out)
     {
-        _X(qn);
+        _X(_register_qubit(qn));
     }
     return qErrorNone;
 }
 
-QStat CPUImplQPU::getQState()
+template <typename data_t>
+QStat CPUImplQPU<data_t>::_register_state()
 {
-    return m_state;
+    _flush_gates();
+    return QStat(m_state.begin(), m_state.end());
 }
 
-QError CPUImplQPU::DiagonalGate(Qnum & vQubit, QStat & matrix, bool isConjugate, double error_rate)
+template <typename data_t>
+QStat CPUImplQPU<data_t>::getQState()
+{
+    if (m_qubit_map.empty())
+    {
+        return _register_state();
+    }
+
+    _flush_gates();
+
+    /* the amplitudes of the register, with the unused qubits put back as |0> */
+    QStat state(1ull << m_qubit_map.size(), 0);
+    int64_t size = m_state.size();
+#pragma omp parallel for num_threads(_omp_thread_num(size))
+    for (int64_t i = 0; i < size; i++)
+    {
+        int64_t index = 0;
+        for (size_t j = 0; j < m_register_qubits.size(); j++)
+        {
+            index |= ((i >> j) & 1ll) << m_register_qubits[j];
+        }
+        state[index] = m_state[i];
+    }
+    return state;
+}
+
+template <typename data_t>
+QError CPUImplQPU<data_t>::DiagonalGate(Qnum & vQubit, QStat & matrix, bool isConjugate, double error_rate)
 {
     return qErrorNone;
 }
 
-QError CPUImplQPU::controlDiagonalGate(Qnum & vQubit, QStat & matrix, Qnum & vControlBit, bool isConjugate, double error_rate)
+template <typename data_t>
+QError CPUImplQPU<data_t>::controlDiagonalGate(Qnum & vQubit, QStat & matrix, Qnum & vControlBit, bool isConjugate, double error_rate)
 {
     return qErrorNone;
 }
 
-QError CPUImplQPU::OracleGate(Qnum &qubits, QStat &matrix, bool is_dagger)
+template <typename data_t>
+QError CPUImplQPU<data_t>::OracleGate(Qnum &oracle_qubits, QStat &matrix, bool is_dagger)
 {
-	if (qubits.size() == 3)
-	{
-		_three_qubit_gate(qubits, matrix, is_dagger);
-		return qErrorNone;
-	}
-	else if (qubits.size() == 4)
+	Qnum qubits = _register_qubits(oracle_qubits);
+	if (_can_defer_gate())
 	{
-		_four_qubit_gate(qubits, matrix, is_dagger);
-		return qErrorNone;
+		return _defer_gate({ GateCallType::ORACLE, false, qubits, {}, matrix, is_dagger, GateType::ORACLE_GATE });
 	}
-	else if (qubits.size() == 5)
+
+	return _oracle_gate(qubits, matrix, is_dagger, {});
+}
+
+template <typename data_t>
+QError CPUImplQPU<data_t>::controlOracleGate(Qnum &oracle_qubits, const Qnum &control_qubits,
+                                     QStat &matrix, bool is_dagger)
+{
+	Qnum qubits = _register_qubits(oracle_qubits);
+	Qnum controls = _register_qubits(control_qubits);
+	if (_can_defer_gate())
 	{
-		_five_qubit_gate(qubits, matrix, is_dagger);
-		return qErrorNone;
+		return _defer_gate({ GateCallType::ORACLE, true, qubits, controls, matrix, is_dagger, GateType::ORACLE_GATE });
 	}
 
-    auto dim = 1ll << qubits.size();
-    qmatrix_t mat_eigen = qmatrix_t::Map(&matrix[0], dim, dim);
+	return _oracle_gate(qubits, matrix, is_dagger, controls);
+}
+
+template <typename data_t>
+QError CPUImplQPU<data_t>::_oracle_gate(const Qnum &qubits, const QStat &matrix,
+                                        bool is_dagger, const Qnum &controls)
+{
+    int64_t dim = 1ll << qubits.size();
+    QPANDA_ASSERT(matrix.size() != dim * dim, "Error: oracle matrix size.");
 
+    switch (qubits.size())
+    {
+    case 1:
+        return _k_qubit_gate<1>(qubits, matrix, is_dagger, controls);
+    case 2:
+        return _k_qubit_gate<2>(qubits, matrix, is_dagger, controls);
+    case 3:
+        return _k_qubit_gate<3>(qubits, matrix, is_dagger, controls);
+    case 4:
+        return _k_qubit_gate<4>(qubits, matrix, is_dagger, controls);
+    case 5:
+        return _k_qubit_gate<5>(qubits, matrix, is_dagger, controls);
+    case 6:
+        return _k_qubit_gate<6>(qubits, matrix, is_dagger, controls);
+    default:
+        break;
+    }
+
+    qmatrix_t mat_eigen = qmatrix_t::Map(&matrix[0], dim, dim);
     if (is_dagger)
     {
         mat_eigen.adjointInPlace();
     }
 
-    int64_t size = 1ll << (m_qubit_num - qubits.size());
-    qvector_t state_bak(dim);
-    std::vector<int64_t> realxx_idxes(dim);
-
-    //std::reverse(qubits.begin(), qubits.end());
-#pragma omp parallel for num_threads(_omp_thread_num(size)) firstprivate(state_bak, realxx_idxes)
-    for (int64_t i = 0; i < size; i++)
+    /* bit j of the matrix index is qubits[j] */
+    std::vector<int64_t> offsets(dim, 0);
+    for (int64_t i_dim = 0; i_dim < dim; i_dim++)
     {
-        int64_t real00_idx = _insert(i, qubits);
-        for (size_t i_dim = 0; i_dim < dim; i_dim++)
+        for (size_t j = 0; j < qubits.size(); j++)
         {
-            size_t realxx_idx = real00_idx;
-            size_t tmp = i_dim;
-            for (size_t qubit_idx = 0; qubit_idx < qubits.size(); qubit_idx++)
+            if ((i_dim >> j) & 1ll)
             {
-                tmp = i_dim >> qubit_idx;
-                if (tmp > 0)
-                {
-                    if (1ull & tmp)
-                    {
-                        realxx_idx += 1ll << qubits[qubit_idx];
-                    }
-
-                }
-                else
-                {
-                    break;
-                }
+                offsets[i_dim] |= 1ll << qubits[j];
             }
-            realxx_idxes[i_dim] = realxx_idx;
         }
+    }
 
-        for (size_t i_dim = 0; i_dim < dim; i_dim++)
+    ControlSubspace subspace(controls, qubits);
+    int64_t size = subspace.size(m_qubit_num);
+    qvector_t state_bak(dim);
+#pragma omp parallel for num_threads(_omp_thread_num(size)) firstprivate(state_bak)
+    for (int64_t i = 0; i < size; i++)
+    {
+        int64_t real00_idx = subspace(i);
+        for (int64_t i_dim = 0; i_dim < dim; i_dim++)
         {
-            state_bak(i_dim) = m_state[realxx_idxes[i_dim]];
+            state_bak(i_dim) = m_state[real00_idx | offsets[i_dim]];
         }
 
-        for (size_t i_dim = 0; i_dim < dim; i_dim++)
+        for (int64_t i_dim = 0; i_dim < dim; i_dim++)
         {
-            m_state[realxx_idxes[i_dim]] = mat_eigen.row(i_dim).cwiseProduct(state_bak).sum();
+            m_state[real00_idx | offsets[i_dim]] = mat_eigen.row(i_dim).cwiseProduct(state_bak).sum();
         }
     }
     return qErrorNone;
 }
 
-QError CPUImplQPU::controlOracleGate(Qnum &qubits, const Qnum &controls,
-                                     QStat &matrix, bool is_dagger)
+/*
+  k qubit matrix kernel, the matrix and the amplitude offsets are built once,
+  the amplitude loop works on fixed size arrays only
+*/
+template <typename data_t>
+template <size_t K>
+QError CPUImplQPU<data_t>::_k_qubit_gate(const Qnum &qubits, const QStat &matrix,
+                                         bool is_dagger, const Qnum &controls)
 {
-	if (qubits.size() == 3)
-	{
-		_three_qubit_gate(qubits, matrix, is_dagger, controls);
-		return qErrorNone;
-	}
-	else if (qubits.size() == 4)
-	{
-		_four_qubit_gate(qubits, matrix, is_dagger, controls);
-		return qErrorNone;
-	}
-	else if (qubits.size() == 5)
-	{
-		_five_qubit_gate(qubits, matrix, is_dagger, controls);
-		return qErrorNone;
-	}
-    auto dim = 1ll << qubits.size();
-    qmatrix_t mat_eigen = qmatrix_t::Map(&matrix[0], dim, dim);
-
-    if (is_dagger)
+    const size_t dim = 1ull << K;
+    std::vector<qcomplex_t> mat(dim * dim);
+    for (size_t row = 0; row < dim; row++)
     {
-        mat_eigen.adjointInPlace();
+        for (size_t col = 0; col < dim; col++)
+        {
+            mat[row * dim + col] = is_dagger ? std::conj(matrix[col * dim + row]) : matrix[row * dim + col];
+        }
     }
 
-    int64_t mask = 0;
-    for_each(controls.begin(), controls.end() - qubits.size(), [&](size_t q) {
-        mask |= 1ll << q;
-    });
-
-    int64_t size = 1ll << (m_qubit_num - qubits.size());
-    qvector_t state_bak(dim);
-    std::vector<int64_t> realxx_idxes(dim);
-
-    //std::reverse(qubits.begin(), qubits.end());
-#pragma omp parallel for num_threads(_omp_thread_num(size)) firstprivate(state_bak, realxx_idxes)
-    for (int64_t i = 0; i < size; i++)
+    /* bit j of the matrix index is qubits[j] */
+    std::array<int64_t, dim> offsets;
+    for (size_t i_dim = 0; i_dim < dim; i_dim++)
     {
-        int64_t real00_idx = _insert(i, qubits);
-        if (mask != (mask & real00_idx))
-            continue;
-
-        for (size_t i_dim = 0; i_dim < dim; i_dim++)
+        offsets[i_dim] = 0;
+        for (size_t j = 0; j < K; j++)
         {
-            size_t realxx_idx = real00_idx;
-            size_t tmp = i_dim;
-            for (size_t qubit_idx = 0; qubit_idx < qubits.size(); qubit_idx++)
+            if ((i_dim >> j) & 1ull)
             {
-                tmp = i_dim >> qubit_idx;
-                if (tmp > 0)
-                {
-                    if (1ull & tmp)
-                    {
-                        realxx_idx += 1ll << qubits[qubit_idx];
-                    }
-
-                }
-                else
-                {
-                    break;
-                }
+                offsets[i_dim] |= 1ll << qubits[j];
             }
-            realxx_idxes[i_dim] = realxx_idx;
         }
+    }
 
+    const qcomplex_t *mat_data = mat.data();
+    ControlSubspace subspace(controls, qubits);
+    int64_t size = subspace.size(m_qubit_num);
+#pragma omp parallel for num_threads(_omp_thread_num(size))
+    for (int64_t i = 0; i < size; i++)
+    {
+        int64_t real00_idx = subspace(i);
+        std::array<qcomplex_t, dim> phi;
         for (size_t i_dim = 0; i_dim < dim; i_dim++)
         {
-            state_bak(i_dim) = m_state[realxx_idxes[i_dim]];
+            phi[i_dim] = m_state[real00_idx | offsets[i_dim]];
         }
 
-        for (size_t i_dim = 0; i_dim < dim; i_dim++)
+        for (size_t row = 0; row < dim; row++)
         {
-            m_state[realxx_idxes[i_dim]] = mat_eigen.row(i_dim).cwiseProduct(state_bak).sum();
+            qcomplex_t sum = 0;
+            const qcomplex_t *mat_row = mat_data + row * dim;
+            for (size_t col = 0; col < dim; col++)
+            {
+                sum += mat_row[col] * phi[col];
+            }
+            m_state[real00_idx | offsets[row]] = sum;
         }
     }
+
     return qErrorNone;
 }
 
-QError CPUImplQPU::process_noise(Qnum &qnum, QStat &matrix)
+template <typename data_t>
+QError CPUImplQPU<data_t>::process_noise(Qnum &noise_qubits, QStat &matrix)
 {
+    _flush_gates();
+    Qnum qnum = _register_qubits(noise_qubits);
     if (1 == qnum.size())
     {
         return _single_qubit_normal_unitary(qnum.front(), matrix, false);
@@ -2153,17 +2239,24 @@ QError CPUImplQPU::process_noise(Qnum &qnum, QStat &matrix)
     }
 }
 
-QError CPUImplQPU::debug(std::shared_ptr<QPanda::AbstractQDebugNode> debugger)
+template <typename data_t>
+QError CPUImplQPU<data_t>::debug(std::shared_ptr<QPanda::AbstractQDebugNode> debugger)
 {
-    debugger->save_qstate(m_state);
+    _flush_gates();
+    /* the debugger keeps a reference, so it gets a copy of the state */
+    m_debug_state = getQState();
+    debugger->save_qstate(m_debug_state);
     return QError::qErrorNone;
 }
-void CPUImplQPU::set_parallel_threads_size(size_t size)
+
+template <typename data_t>
+void CPUImplQPU<data_t>::set_parallel_threads_size(size_t size)
 {
     m_max_threads_size = size;
 }
 
-int CPUImplQPU::_omp_thread_num(size_t size)
+template <typename data_t>
+int CPUImplQPU<data_t>::_omp_thread_num(size_t size)
 {
     if (size > m_threshold)
     {
@@ -2186,318 +2279,1423 @@ int CPUImplQPU::_omp_thread_num(size_t size)
     }
 }
 
-QError CPUImplQPUWithOracle::controlOracularGate(std::vector<size_t> bits, std::vector<size_t> controlbits, bool is_dagger, std::string name)
+template <typename data_t>
+void CPUImplQPU<data_t>::set_cache_block_qubits(size_t qubit_num)
 {
-    if (name == "oracle_test") {
-
-    }
-    else {
-        throw runtime_error("Not Implemented.");
-    }
-    return qErrorNone;
+    QPANDA_ASSERT(qubit_num > 30, "Error: cache block qubits.");
+    _flush_gates();
+    m_cache_block_qubits = qubit_num;
 }
 
-QError  CPUImplQPU::single_qubit_gate_fusion(size_t qn, QStat& matrix)
+template <typename data_t>
+void CPUImplQPU<data_t>::set_state_page_mode(StatePageMode mode)
 {
-	int64_t size = 1ll << (m_qubit_num - 1);
-	int64_t offset = 1ll << qn;
-	if (size > m_threshold)
-	{
-#pragma omp parallel for
-		for (int64_t i = 0; i < size; i++)
-		{
-			int64_t real00_idx = i;
-			int64_t real01_idx = i + 1;
-
-			auto alpha = m_state[real00_idx];
-			auto beta = m_state[real01_idx];
-			m_state[real00_idx] = matrix[0] * alpha + matrix[2] * beta;
-			m_state[real01_idx] = matrix[1] * alpha + matrix[3] * beta;
-		}
-	}
-	else
-	{
-		for (int64_t i = 0; i < size; i++)
-		{
-			int64_t real00_idx = _insert(i, qn);
-			int64_t real01_idx = real00_idx | offset;
-
-			auto alpha = m_state[real00_idx];
-			auto beta = m_state[real01_idx];
-			m_state[real00_idx] = matrix[0] * alpha + matrix[2] * beta;
-			m_state[real01_idx] = matrix[1] * alpha + matrix[3] * beta;
-		}
-	}
-	return qErrorNone;
+    m_page_mode = mode;
 }
 
+template <typename data_t>
+void CPUImplQPU<data_t>::set_used_qubits(const Qnum& qubits)
+{
+    m_used_qubits = qubits;
+    std::sort(m_used_qubits.begin(), m_used_qubits.end());
+    m_used_qubits.erase(std::unique(m_used_qubits.begin(), m_used_qubits.end()), m_used_qubits.end());
+}
 
-QError CPUImplQPU::double_qubit_gate_fusion(size_t qn_0, size_t qn_1, QStat &matrix)
+template <typename data_t>
+QStat CPUImplQPU<data_t>::reduced_density_matrix(const Qnum& qubits)
 {
-    int64_t size = 1ll << (m_qubit_num - 2);
-    
-    int64_t offset0 = 1ll << qn_0;
-    int64_t offset1 = 1ll << qn_1;
-    if (qn_0 > qn_1)
+    Qnum sorted_qubits = qubits;
+    std::sort(sorted_qubits.begin(), sorted_qubits.end());
+    QPANDA_ASSERT(std::adjacent_find(sorted_qubits.begin(), sorted_qubits.end()) != sorted_qubits.end(),
+        "Error: repeated qubits.");
+    QPANDA_ASSERT(!sorted_qubits.empty()
+        && sorted_qubits.back() >= (m_qubit_map.empty() ? m_qubit_num : m_qubit_map.size()),
+        "Error: qubit out of the state.");
+
+    Qnum register_qubits;
+    Qnum positions;
+    for (size_t j = 0; j < qubits.size(); j++)
     {
-        std::swap(qn_0, qn_1);
+        if (_is_used_qubit(qubits[j]))
+        {
+            register_qubits.push_back(_register_qubit(qubits[j]));
+            positions.push_back(j);
+        }
     }
 
-    for (int64_t i = 0; i < size; i++)
+    QStat gram = _gram_matrix(register_qubits);
+    if (register_qubits.size() == qubits.size())
     {
-        int64_t real00_idx = _insert(i, qn_0, qn_1);
-        auto phi00 = m_state[real00_idx];
-        auto phi01 = m_state[real00_idx | offset0];
-        auto phi10 = m_state[real00_idx | offset1];
-        auto phi11 = m_state[real00_idx | offset0 + offset1];
+        return gram;
+    }
 
-        m_state[real00_idx] = matrix[0] * phi00 + matrix[4] * phi01
-            + matrix[8] * phi10 + matrix[12] * phi11;
-        m_state[real00_idx | offset0] = matrix[1] * phi00 + matrix[5] * phi01
-            + matrix[9] * phi10 + matrix[13] * phi11;
-        m_state[real00_idx | offset1] = matrix[2] * phi00 + matrix[6] * phi01
-            + matrix[10] * phi10 + matrix[14] * phi11;
-        m_state[real00_idx | offset0 | offset1] = matrix[3] * phi00 + matrix[7] * phi01
-            + matrix[11] * phi10 + matrix[15] * phi11;
+    /* qubits the prog did not use are |0>, only their 0 rows and columns are not zero */
+    int64_t gram_dim = 1ll << register_qubits.size();
+    int64_t dim = 1ll << qubits.size();
+    std::vector<int64_t> indices(gram_dim, 0);
+    for (int64_t i = 0; i < gram_dim; i++)
+    {
+        for (size_t j = 0; j < positions.size(); j++)
+        {
+            indices[i] |= ((i >> j) & 1ll) << positions[j];
+        }
     }
-    return qErrorNone;
+
+    QStat rho(dim * dim, 0);
+    for (int64_t row = 0; row < gram_dim; row++)
+    {
+        for (int64_t col = 0; col < gram_dim; col++)
+        {
+            rho[indices[row] * dim + indices[col]] = gram[row * gram_dim + col];
+        }
+    }
+    return rho;
 }
 
-QError CPUImplQPU::three_qubit_gate_fusion(size_t qn_0, size_t qn_1, QStat &matrix)
+template <typename data_t>
+prob_vec CPUImplQPU<data_t>::schmidt_spectrum(const Qnum& qubits)
 {
-    int64_t size = 1ll << (m_qubit_num - 2);
-    if (qn_0 > qn_1)
+    std::vector<bool> is_on_side(m_qubit_num, false);
+    for (auto qubit : qubits)
     {
-        std::swap(qn_0, qn_1);
+        if (_is_used_qubit(qubit))
+        {
+            QPANDA_ASSERT(_register_qubit(qubit) >= m_qubit_num, "Error: qubit out of the state.");
+            is_on_side[_register_qubit(qubit)] = true;
+        }
     }
-    int64_t offset0 = 1ll << qn_0;
-    int64_t offset1 = 1ll << qn_1;
 
-    for (int64_t i = 0; i < size; i++)
+    /* both sides have the same non-zero spectrum, the smaller one has the smaller Gram matrix */
+    Qnum side;
+    Qnum other_side;
+    for (size_t qubit = 0; qubit < m_qubit_num; qubit++)
     {
-        int64_t real00_idx = _insert(i, qn_0, qn_1);
-        auto phi00 = m_state[real00_idx];
-        auto phi01 = m_state[real00_idx | offset0];
-        auto phi10 = m_state[real00_idx | offset1];
-        auto phi11 = m_state[real00_idx | offset0 + offset1];
-
-        m_state[real00_idx] = matrix[0] * phi00 + matrix[4] * phi01
-            + matrix[8] * phi10 + matrix[12] * phi11;
-        m_state[real00_idx | offset0] = matrix[1] * phi00 + matrix[5] * phi01
-            + matrix[9] * phi10 + matrix[13] * phi11;
-        m_state[real00_idx | offset1] = matrix[2] * phi00 + matrix[6] * phi01
-            + matrix[10] * phi10 + matrix[14] * phi11;
-        m_state[real00_idx | offset0 | offset1] = matrix[3] * phi00 + matrix[7] * phi01
-            + matrix[11] * phi10 + matrix[15] * phi11;
+        (is_on_side[qubit] ? side : other_side).push_back(qubit);
     }
 
-
-    return qErrorNone;
+    return density_matrix_spectrum(_gram_matrix(side.size() <= other_side.size() ? side : other_side));
 }
 
+template <typename data_t>
+double CPUImplQPU<data_t>::entanglement_entropy(const Qnum& qubits, double alpha)
+{
+    return spectrum_entropy(schmidt_spectrum(qubits), alpha);
+}
 
-QError CPUImplQPU::_three_qubit_gate(Qnum& qubits, QStat& matrix, bool is_dagger, const Qnum& controls)
+template <typename data_t>
+QError CPUImplQPU<data_t>::pauliExpectation(const QHamiltonian& hamiltonian, double& expectation)
 {
-    int64_t size = 1ll << (m_qubit_num - 3);
-    int64_t offset0 = 1ll << qubits[0];
-    int64_t offset1 = 1ll << qubits[1];
-    int64_t offset2 = 1ll << qubits[2];
-    int64_t mask = 0;
-    std::sort(qubits.begin(), qubits.end());
-    auto dim = 1ll << qubits.size();
-    qmatrix_t mat_eigen = qmatrix_t::Map(&matrix[0], dim, dim);
-    if (is_dagger)
-    {
-        mat_eigen.adjointInPlace();
-    }
+    _flush_gates();
 
-    qvector_t state_bak(dim);
-    state_bak.setZero();
-    std::vector<int64_t> realxx_idxes(dim);
-    if (controls.size() > 3)
+    /*
+      P|i> = c (-1)^|i & z_mask| |i ^ x_mask>, where a Y is a flip and a sign
+      with c = i, so <psi|P|psi> = c sum_i conj(psi[i ^ x_mask]) psi[i] (-1)^|i & z_mask|
+    */
+    struct PauliTerm
     {
-        for_each(controls.begin(), controls.end() - 3, [&](size_t q) {
-            mask |= 1ll << q;
-        });
-    }
+        int64_t z_mask;
+        qcomplex_t coef;
+    };
+    std::map<int64_t, std::vector<PauliTerm>> families;
 
-#pragma omp parallel for num_threads(_omp_thread_num(size)) firstprivate(realxx_idxes, state_bak)
-    for (int64_t i = 0; i < size; i++)
+    expectation = 0;
+    size_t qubit_num = m_qubit_map.empty() ? m_qubit_num : m_qubit_map.size();
+    for (const auto& item : hamiltonian)
     {
-        int64_t real00_idx = _insert(i, qubits[0], qubits[1], qubits[2]);
-        if (mask != (mask & real00_idx)) {
-            continue;
-        }
+        int64_t x_mask = 0;
+        int64_t z_mask = 0;
+        qcomplex_t coef = item.second;
+        for (const auto& pauli : item.first)
+        {
+            QPANDA_ASSERT(pauli.first >= qubit_num, "Error: qubit out of the state.");
+            if (!_is_used_qubit(pauli.first))
+            {
+                /* qubits the prog did not use are |0>, a flip there ends on an empty amplitude */
+                if ('X' == pauli.second || 'Y' == pauli.second)
+                {
+                    coef = 0;
+                }
+                continue;
+            }
 
-        realxx_idxes[0] = real00_idx;
-        realxx_idxes[1] = real00_idx | offset0;
-        realxx_idxes[2] = real00_idx | offset1;
-        realxx_idxes[3] = real00_idx | offset0 | offset1;
+            int64_t bit = 1ll << _register_qubit(pauli.first);
+            switch (pauli.second)
+            {
+            case 'X':
+                x_mask |= bit;
+                break;
+            case 'Y':
+                x_mask |= bit;
+                z_mask |= bit;
+                coef *= qcomplex_t(0, 1);
+                break;
+            case 'Z':
+                z_mask |= bit;
+                break;
+            default:
+                QCERR_AND_THROW(std::invalid_argument, "Error: pauli operator " << pauli.second);
+            }
+        }
 
-        realxx_idxes[4] = real00_idx | offset2;
-        realxx_idxes[5] = real00_idx | offset2 | offset0;
-        realxx_idxes[6] = real00_idx | offset2 | offset1;
-        realxx_idxes[7] = real00_idx | offset2 | offset1 | offset0;
+        if (0 == x_mask && 0 == z_mask)
+        {
+            expectation += coef.real();
+        }
+        else if (std::abs(coef) > 0)
+        {
+            families[x_mask].push_back({ z_mask, coef });
+        }
+    }
 
-        for (size_t i_dim = 0; i_dim < dim; i_dim++)
+    int64_t size = 1ll << m_qubit_num;
+    for (const auto& family : families)
+    {
+        int64_t x_mask = family.first;
+        const auto& terms = family.second;
+        std::vector<qcomplex_t> sums(terms.size(), 0);
+#pragma omp parallel num_threads(_omp_thread_num(size * terms.size()))
         {
-            state_bak(i_dim) = m_state[realxx_idxes[i_dim]];
+            std::vector<qcomplex_t> local_sums(terms.size(), 0);
+#pragma omp for
+            for (int64_t i = 0; i < size; i++)
+            {
+                qcomplex_t product = 0 == x_mask ? qcomplex_t(std::norm(m_state[i]), 0)
+                    : qcomplex_t(std::conj(m_state[i ^ x_mask]) * m_state[i]);
+                for (size_t k = 0; k < terms.size(); k++)
+                {
+                    if (std::bitset<64>(i & terms[k].z_mask).count() & 1)
+                    {
+                        local_sums[k] -= product;
+                    }
+                    else
+                    {
+                        local_sums[k] += product;
+                    }
+                }
+            }
+#pragma omp critical
+            for (size_t k = 0; k < terms.size(); k++)
+            {
+                sums[k] += local_sums[k];
+            }
         }
 
-        for (size_t i_dim = 0; i_dim < dim; i_dim++)
+        for (size_t k = 0; k < terms.size(); k++)
         {
-            m_state[realxx_idxes[i_dim]] = mat_eigen.row(i_dim).cwiseProduct(state_bak).sum();
+            expectation += (terms[k].coef * sums[k]).real();
         }
     }
+
     return qErrorNone;
 }
 
-QError CPUImplQPU::_four_qubit_gate(Qnum &qubits, QStat& matrix, bool is_dagger, const Qnum& controls)
+template <typename data_t>
+QStat CPUImplQPU<data_t>::_gram_matrix(const Qnum& qubits)
 {
+    using block_t = Eigen::Matrix<qcomplex_t, Eigen::Dynamic, Eigen::Dynamic>;
 
-	int64_t size = 1ll << (m_qubit_num - 4);
-	int64_t offset0 = 1ll << qubits[0];
-	int64_t offset1 = 1ll << qubits[1];
-	int64_t offset2 = 1ll << qubits[2];
-	int64_t offset3 = 1ll << qubits[3];
-	int64_t mask = 0;
-	std::sort(qubits.begin(), qubits.end());
-	auto dim = 1ll << qubits.size();
-	qmatrix_t mat_eigen = qmatrix_t::Map(&matrix[0], dim, dim);
-	if (is_dagger)
-	{
-		mat_eigen.adjointInPlace();
-	}
+    _flush_gates();
+    int64_t dim = 1ll << qubits.size();
+    std::vector<int64_t> offsets(dim, 0);
+    for (int64_t i_dim = 0; i_dim < dim; i_dim++)
+    {
+        for (size_t j = 0; j < qubits.size(); j++)
+        {
+            offsets[i_dim] |= ((i_dim >> j) & 1ll) << qubits[j];
+        }
+    }
 
-    qvector_t state_bak(dim);
-    state_bak.setZero();
-	std::vector<int64_t> realxx_idxes(dim);
-	if (controls.size() > 4)
-	{
-		for_each(controls.begin(), controls.end() - 4, [&](size_t q) {
-			mask |= 1ll << q;
-		});
-	}
-#pragma omp parallel for num_threads(_omp_thread_num(size)) firstprivate(state_bak, realxx_idxes)
-	for (int64_t i = 0; i < size; i++)
-	{
-		int64_t real00_idx = _insert(i, qubits[0], qubits[1], qubits[2], qubits[3]);
-		if (mask != (mask & real00_idx)) {
-			continue;
-		}
+    /*
+      column i of a block holds the amplitudes of the qubits where the other
+      qubits are the i-th index of the subspace, the block adds its product
+      with its adjoint, blocks of 2^14 amplitudes stay in the L2 cache
+    */
+    ControlSubspace subspace({}, qubits);
+    int64_t size = subspace.size(m_qubit_num);
+    int64_t block_size = std::max<int64_t>(1, std::min<int64_t>(size, (1ll << 14) / dim));
+    int64_t block_num = (size + block_size - 1) / block_size;
+
+    block_t gram = block_t::Zero(dim, dim);
+#pragma omp parallel num_threads(_omp_thread_num(size * dim))
+    {
+        block_t local_gram = block_t::Zero(dim, dim);
+        block_t block(dim, block_size);
+#pragma omp for
+        for (int64_t i_block = 0; i_block < block_num; i_block++)
+        {
+            int64_t begin = i_block * block_size;
+            int64_t end = std::min(begin + block_size, size);
+            for (int64_t i = begin; i < end; i++)
+            {
+                int64_t base = subspace(i);
+                for (int64_t i_dim = 0; i_dim < dim; i_dim++)
+                {
+                    block(i_dim, i - begin) = m_state[base | offsets[i_dim]];
+                }
+            }
 
-		realxx_idxes[0] = real00_idx;
-		realxx_idxes[1] = real00_idx | offset0;
-		realxx_idxes[2] = real00_idx | offset1;
-		realxx_idxes[3] = real00_idx | offset0 | offset1;
-		realxx_idxes[4] = real00_idx | offset2;
-		realxx_idxes[5] = real00_idx | offset2 | offset0;
-		realxx_idxes[6] = real00_idx | offset2 | offset1;
-		realxx_idxes[7] = real00_idx | offset2 | offset1 | offset0;
-		realxx_idxes[8] = real00_idx | offset3;
-		realxx_idxes[9] = real00_idx | offset3 | offset0;
-		realxx_idxes[10] = real00_idx | offset3 | offset1;
-		realxx_idxes[11] = real00_idx | offset3 | offset1 | offset0;
-		realxx_idxes[12] = real00_idx | offset3 | offset2;
-		realxx_idxes[13] = real00_idx | offset3 | offset2 | offset0;
-		realxx_idxes[14] = real00_idx | offset3 | offset2 | offset1;
-		realxx_idxes[15] = real00_idx | offset3 | offset2 | offset1 | offset0;
-
-		for (size_t i_dim = 0; i_dim < dim; i_dim++)
-		{
-			state_bak(i_dim) = m_state[realxx_idxes[i_dim]];
-		}
+            auto columns = block.leftCols(end - begin);
+            local_gram.noalias() += columns * columns.adjoint();
+        }
+#pragma omp critical
+        gram += local_gram;
+    }
 
-		for (size_t i_dim = 0; i_dim < dim; i_dim++)
-		{
-			m_state[realxx_idxes[i_dim]] = mat_eigen.row(i_dim).cwiseProduct(state_bak).sum();
-		}
-	}
+    QStat matrix(dim * dim);
+    for (int64_t row = 0; row < dim; row++)
+    {
+        for (int64_t col = 0; col < dim; col++)
+        {
+            matrix[row * dim + col] = gram(row, col);
+        }
+    }
+    return matrix;
+}
+
+/* queued gates already hold register qubits when they are flushed */
+template <typename data_t>
+size_t CPUImplQPU<data_t>::_register_qubit(size_t qn) const
+{
+    if (m_qubit_map.empty() || m_is_flushing)
+    {
+        return qn;
+    }
+
+    QPANDA_ASSERT(!_is_used_qubit(qn), "Error: qubit is not used by the prog.");
+    return m_qubit_map[qn];
+}
+
+template <typename data_t>
+Qnum CPUImplQPU<data_t>::_register_qubits(const Qnum& qubits) const
+{
+    Qnum register_qubits(qubits.size());
+    std::transform(qubits.begin(), qubits.end(), register_qubits.begin(),
+        [this](size_t qubit) { return _register_qubit(qubit); });
+    return register_qubits;
+}
+
+template <typename data_t>
+bool CPUImplQPU<data_t>::_is_used_qubit(size_t qn) const
+{
+    return m_qubit_map.empty()
+        || (qn < m_qubit_map.size() && kUnusedQubit != m_qubit_map[qn]);
+}
+
+template <typename data_t>
+bool CPUImplQPU<data_t>::_alloc_state(cstate_t& state, size_t size)
+{
+    if (state.size() == size && state.get_allocator().mode() == m_page_mode)
+    {
+        return false;
+    }
+
+    /* release the old pages first, the new ones are first touched by the caller */
+    cstate_t(StateAllocator<std::complex<data_t>>(m_page_mode)).swap(state);
+    state.resize(size);
+    return true;
+}
+
+template <typename data_t>
+template <typename Func>
+void CPUImplQPU<data_t>::_keep_init_state(size_t size, const Func& amplitude)
+{
+    m_is_init_state = true;
+    m_init_state_file.reset();
+    cstate_t().swap(m_init_state);
+    if (m_init_state_spill_qubits > 0 && m_qubit_num >= m_init_state_spill_qubits
+        && _spill_init_state(size, amplitude))
+    {
+        return;
+    }
+
+    _alloc_state(m_init_state, size);
+#pragma omp parallel for num_threads(_omp_thread_num(size))
+    for (int64_t i = 0; i < (int64_t)size; i++)
+    {
+        m_init_state[i] = amplitude(i);
+    }
+}
+
+template <typename data_t>
+template <typename Func>
+bool CPUImplQPU<data_t>::_spill_init_state(size_t size, const Func& amplitude)
+{
+    auto file = create_unnamed_file(m_init_state_directory, "qpanda_init_state_");
+    if (!file)
+    {
+        return false;
+    }
+
+    /* written in chunks converted to the state precision */
+    const size_t chunk_size = 1ull << 16;
+    std::vector<std::complex<data_t>> chunk(std::min(chunk_size, size));
+    for (size_t begin = 0; begin < size; begin += chunk.size())
+    {
+        size_t count = std::min(chunk.size(), size - begin);
+#pragma omp parallel for num_threads(_omp_thread_num(count))
+        for (int64_t j = 0; j < (int64_t)count; j++)
+        {
+            chunk[j] = amplitude(begin + j);
+        }
+        if (fwrite(chunk.data(), sizeof(std::complex<data_t>), count, file.get()) != count)
+        {
+            return false;
+        }
+    }
+
+    if (fflush(file.get()) != 0)
+    {
+        return false;
+    }
+
+    m_init_state_file = file;
+    return true;
+}
+
+template <typename data_t>
+void CPUImplQPU<data_t>::_load_init_state()
+{
+    if (!m_init_state_file)
+    {
+        int64_t size = m_init_state.size();
+        _alloc_state(m_state, size);
+#pragma omp parallel for num_threads(_omp_thread_num(size))
+        for (int64_t i = 0; i < size; i++)
+        {
+            m_state[i] = m_init_state[i];
+        }
+        return;
+    }
+
+    int64_t size = 1ll << m_qubit_num;
+    if (_alloc_state(m_state, size))
+    {
+        /* fresh pages are placed by the gate loop schedule before the file is read into them */
+#pragma omp parallel for num_threads(_omp_thread_num(size))
+        for (int64_t i = 0; i < size; i++)
+        {
+            m_state[i] = 0;
+        }
+    }
+
+    FILE* fp = m_init_state_file.get();
+    QPANDA_ASSERT(fseek(fp, 0, SEEK_SET) != 0
+        || fread(m_state.data(), sizeof(std::complex<data_t>), size, fp) != static_cast<size_t>(size),
+        "Error: initState file.");
+}
+
+template <typename data_t>
+QError CPUImplQPU<data_t>::_defer_gate(GateCall&& call)
+{
+    m_pending_gates.emplace_back(std::move(call));
+    if (m_pending_gates.size() >= kMaxPendingGates)
+    {
+        _flush_gates();
+    }
+    return qErrorNone;
+}
+
+template <typename data_t>
+std::bitset<64> CPUImplQPU<data_t>::_gate_qubits(const GateCall& call)
+{
+    std::bitset<64> used;
+    for (auto qubit : call.qubits)
+    {
+        used.set(qubit);
+    }
+    for (auto qubit : call.controls)
+    {
+        used.set(qubit);
+    }
+    return used;
+}
+
+template <typename data_t>
+void CPUImplQPU<data_t>::_apply_gate(CPUImplQPU<data_t>& qpu, const GateCall& call, const Qnum& relabel)
+{
+    /* the kernels dagger the matrix and sort the qubits in place */
+    QStat matrix = call.matrix;
+    Qnum qubits(call.qubits.size());
+    Qnum controls(call.controls.size());
+    std::transform(call.qubits.begin(), call.qubits.end(), qubits.begin(),
+        [&](size_t qubit) { return relabel[qubit]; });
+    std::transform(call.controls.begin(), call.controls.end(), controls.begin(),
+        [&](size_t qubit) { return relabel[qubit]; });
+
+    switch (call.call_type)
+    {
+    case GateCallType::SINGLE:
+        if (call.is_controlled)
+        {
+            qpu.controlunitarySingleQubitGate(qubits[0], controls, matrix, call.is_dagger, call.gate_type);
+        }
+        else
+        {
+            qpu.unitarySingleQubitGate(qubits[0], matrix, call.is_dagger, call.gate_type);
+        }
+        break;
+    case GateCallType::DOUBLE:
+        if (call.is_controlled)
+        {
+            qpu.controlunitaryDoubleQubitGate(qubits[0], qubits[1], controls, matrix, call.is_dagger, call.gate_type);
+        }
+        else
+        {
+            qpu.unitaryDoubleQubitGate(qubits[0], qubits[1], matrix, call.is_dagger, call.gate_type);
+        }
+        break;
+    case GateCallType::ORACLE:
+        if (call.is_controlled)
+        {
+            qpu.controlOracleGate(qubits, controls, matrix, call.is_dagger);
+        }
+        else
+        {
+            qpu.OracleGate(qubits, matrix, call.is_dagger);
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+/*
+  the diagonal of a queued gate over its targets and controls,
+  false if the gate is not diagonal
+*/
+template <typename data_t>
+bool CPUImplQPU<data_t>::_diagonal_term(const GateCall& call, DiagonalTerm& term)
+{
+    const auto& m = call.matrix;
+    auto is_zero = [&](size_t i) { return qcomplex_t(0) == m[i]; };
+
+    QStat diagonal;
+    Qnum targets;
+    switch (call.call_type)
+    {
+    case GateCallType::SINGLE:
+        if (m.size() != 4)
+        {
+            return false;
+        }
+        targets = call.qubits;
+        switch (call.gate_type)
+        {
+        case GateType::I_GATE:
+        case GateType::BARRIER_GATE:
+        case GateType::ECHO_GATE:
+            term.qubits.clear();
+            term.diagonal = { 1 };
+            return true;
+        case GateType::PAULI_Z_GATE:
+            diagonal = { 1, -1 };
+            break;
+        case GateType::S_GATE:
+            diagonal = { 1, qcomplex_t(0, 1) };
+            break;
+        case GateType::T_GATE:
+        case GateType::U1_GATE:
+        case GateType::P_GATE:
+            diagonal = { 1, m[3] };
+            break;
+        case GateType::RZ_GATE:
+        case GateType::Z_HALF_PI:
+            diagonal = { m[0], m[3] };
+            break;
+        case GateType::PAULI_X_GATE:
+        case GateType::PAULI_Y_GATE:
+        case GateType::HADAMARD_GATE:
+            return false;
+        default:
+            if (!is_zero(1) || !is_zero(2))
+            {
+                return false;
+            }
+            diagonal = { m[0], m[3] };
+            break;
+        }
+        break;
+    case GateCallType::DOUBLE:
+        if (m.size() != 16)
+        {
+            return false;
+        }
+        targets = call.qubits;
+        switch (call.gate_type)
+        {
+        case GateType::CZ_GATE:
+            diagonal = { 1, 1, 1, -1 };
+            break;
+        case GateType::CPHASE_GATE:
+        case GateType::CP_GATE:
+            diagonal = { 1, 1, 1, m[15] };
+            break;
+        case GateType::CU_GATE:
+            /* qn_0 is the control and the high bit of the matrix index */
+            if (!is_zero(11) || !is_zero(14))
+            {
+                return false;
+            }
+            targets = { call.qubits[1], call.qubits[0] };
+            diagonal = { 1, 1, m[10], m[15] };
+            break;
+        case GateType::RXX_GATE:
+        case GateType::RYY_GATE:
+        case GateType::RZZ_GATE:
+        case GateType::RZX_GATE:
+            /* controlled ones are left to controlunitaryDoubleQubitGate, which rejects them */
+            if (call.is_controlled)
+            {
+                return false;
+            }
+            /* falls through */
+        case GateType::P00_GATE:
+        case GateType::P11_GATE:
+        case GateType::TWO_QUBIT_GATE:
+            for (size_t i = 0; i < 16; i++)
+            {
+                if (i % 5 != 0 && !is_zero(i))
+                {
+                    return false;
+                }
+            }
+            diagonal = { m[0], m[5], m[10], m[15] };
+            break;
+        default:
+            return false;
+        }
+        break;
+    case GateCallType::ORACLE:
+    {
+        targets = call.qubits;
+        size_t dim = 1ull << targets.size();
+        if (targets.size() > kMaxDiagonalQubits || m.size() != dim * dim)
+        {
+            return false;
+        }
+        for (size_t row = 0; row < dim; row++)
+        {
+            for (size_t col = 0; col < dim; col++)
+            {
+                if (row != col && !is_zero(row * dim + col))
+                {
+                    return false;
+                }
+            }
+            diagonal.push_back(m[row * dim + row]);
+        }
+        break;
+    }
+    default:
+        return false;
+    }
+
+    if (call.is_dagger)
+    {
+        for (auto& value : diagonal)
+        {
+            value = std::conj(value);
+        }
+    }
+
+    /* controls become extra bits of the diagonal, that is 1 unless they are all set */
+    term.qubits = targets;
+    for (auto qubit : call.controls)
+    {
+        if (std::find(targets.begin(), targets.end(), qubit) == targets.end())
+        {
+            term.qubits.push_back(qubit);
+        }
+    }
+    if (term.qubits.size() > kMaxDiagonalQubits)
+    {
+        return false;
+    }
+
+    /* the control bits are the high bits of the index, all of them set is the tail */
+    term.diagonal.assign(1ull << term.qubits.size(), 1);
+    std::copy(diagonal.begin(), diagonal.end(), term.diagonal.end() - diagonal.size());
+    return true;
+}
+
+/*
+  apply a run of diagonal gates in one pass over the state, the state is
+  swept in blocks of 2^low_num amplitudes:
+  the gates on low qubits only are one phase table built once,
+  the gates on high qubits only are one phase per block,
+  the gates on one low qubit give two phases per block and qubit, expanded
+  into the block table with 2^low_num products,
+  any other gate multiplies its phases into the block table
+*/
+template <typename data_t>
+void CPUImplQPU<data_t>::_apply_diagonal_terms(const std::vector<DiagonalTerm>& terms)
+{
+    size_t low_num = std::min(std::max<size_t>(m_cache_block_qubits, 2) - 1, m_qubit_num);
+    int64_t block_size = 1ll << low_num;
+    int64_t block_num = 1ll << (m_qubit_num - low_num);
+
+    /* index of the diagonal of a term from the low or the high bits of the state index */
+    auto term_index = [&](const DiagonalTerm& term, int64_t bits, bool is_high) {
+        int64_t index = 0;
+        for (size_t j = 0; j < term.qubits.size(); j++)
+        {
+            size_t qubit = term.qubits[j];
+            if (is_high && qubit >= low_num)
+            {
+                index |= ((bits >> (qubit - low_num)) & 1ll) << j;
+            }
+            else if (!is_high && qubit < low_num)
+            {
+                index |= ((bits >> qubit) & 1ll) << j;
+            }
+        }
+        return index;
+    };
+
+    std::vector<const DiagonalTerm*> high_terms, single_low_terms, cross_terms;
+    std::vector<size_t> single_low_bit;
+    std::vector<qcomplex_t> low_table(block_size, 1);
+    for (auto& term : terms)
+    {
+        size_t low_count = std::count_if(term.qubits.begin(), term.qubits.end(),
+            [&](size_t qubit) { return qubit < low_num; });
+        if (term.qubits.empty())
+        {
+            continue;
+        }
+        else if (low_count == term.qubits.size())
+        {
+            for (int64_t l = 0; l < block_size; l++)
+            {
+                low_table[l] *= term.diagonal[term_index(term, l, false)];
+            }
+        }
+        else if (0 == low_count)
+        {
+            high_terms.push_back(&term);
+        }
+        else if (1 == low_count)
+        {
+            single_low_terms.push_back(&term);
+            for (size_t j = 0; j < term.qubits.size(); j++)
+            {
+                if (term.qubits[j] < low_num)
+                {
+                    single_low_bit.push_back(j);
+                }
+            }
+        }
+        else
+        {
+            cross_terms.push_back(&term);
+        }
+    }
+
+#pragma omp parallel num_threads(_omp_thread_num(1ll << m_qubit_num))
+    {
+        std::vector<qcomplex_t> block_table(block_size);
+        std::vector<qcomplex_t> phase0(low_num), phase1(low_num);
+#pragma omp for
+        for (int64_t block = 0; block < block_num; block++)
+        {
+            qcomplex_t scale = 1;
+            for (auto term : high_terms)
+            {
+                scale *= term->diagonal[term_index(*term, block, true)];
+            }
+
+            std::fill(phase0.begin(), phase0.end(), qcomplex_t(1));
+            std::fill(phase1.begin(), phase1.end(), qcomplex_t(1));
+            for (size_t k = 0; k < single_low_terms.size(); k++)
+            {
+                auto term = single_low_terms[k];
+                size_t j = single_low_bit[k];
+                int64_t high_index = term_index(*term, block, true);
+                phase0[term->qubits[j]] *= term->diagonal[high_index];
+                phase1[term->qubits[j]] *= term->diagonal[high_index | (1ll << j)];
+            }
+
+            /* tensor product of the per qubit phases */
+            block_table[0] = scale;
+            for (size_t qubit = 0; qubit < low_num; qubit++)
+            {
+                int64_t half = 1ll << qubit;
+                for (int64_t l = 0; l < half; l++)
+                {
+                    block_table[l | half] = block_table[l] * phase1[qubit];
+                    block_table[l] *= phase0[qubit];
+                }
+            }
+
+            for (auto term : cross_terms)
+            {
+                int64_t high_index = term_index(*term, block, true);
+                for (int64_t l = 0; l < block_size; l++)
+                {
+                    block_table[l] *= term->diagonal[high_index | term_index(*term, l, false)];
+                }
+            }
+
+            int64_t offset = block * block_size;
+            for (int64_t l = 0; l < block_size; l++)
+            {
+                m_state[offset + l] = qcomplex_t(m_state[offset + l]) * low_table[l] * block_table[l];
+            }
+        }
+    }
+}
+
+/*
+  split the queue into runs of diagonal gates, applied in one pass,
+  and runs acting on at most m_cache_block_qubits qubits,
+  a run long enough to pay for its passes is applied block by block,
+  any other gate is applied on the whole state
+*/
+template <typename data_t>
+void CPUImplQPU<data_t>::_flush_gates()
+{
+    if (m_pending_gates.empty())
+    {
+        return;
+    }
+
+    m_is_flushing = true;
+    try
+    {
+        Qnum identity(m_qubit_num);
+        for (size_t i = 0; i < m_qubit_num; i++)
+        {
+            identity[i] = i;
+        }
+
+        /*
+          fewer cache blocks than threads leave threads idle, the gates
+          then run in one parallel region instead
+        */
+        int64_t thread_num = _omp_thread_num(1ll << m_qubit_num);
+        bool is_block_parallel = (1ll << (m_qubit_num - m_cache_block_qubits)) >= thread_num;
+
+        /* gates [sequence, begin) wait for one parallel region */
+        size_t sequence = 0;
+        size_t begin = 0;
+        while (begin < m_pending_gates.size())
+        {
+            std::vector<DiagonalTerm> terms;
+            DiagonalTerm term;
+            while (begin + terms.size() < m_pending_gates.size()
+                && _diagonal_term(m_pending_gates[begin + terms.size()], term))
+            {
+                terms.push_back(std::move(term));
+            }
+
+            if (terms.size() >= kMinDiagonalGates)
+            {
+                _run_gate_sequence(sequence, begin, identity);
+                _apply_diagonal_terms(terms);
+                begin += terms.size();
+                sequence = begin;
+                continue;
+            }
+
+            if (!is_block_parallel)
+            {
+                begin++;
+                continue;
+            }
+
+            std::bitset<64> used;
+            size_t end = begin;
+            for (; end < m_pending_gates.size(); end++)
+            {
+                auto next = used | _gate_qubits(m_pending_gates[end]);
+                if (next.count() > m_cache_block_qubits)
+                {
+                    break;
+                }
+                used = next;
+            }
+
+            /* runs on high qubits also pay the two passes swapping them down */
+            size_t min_gates = (used >> m_cache_block_qubits).any() ? kMinBlockGates + 2 : kMinBlockGates;
+            if (end - begin >= min_gates)
+            {
+                _run_gate_sequence(sequence, begin, identity);
+                _run_gate_block(begin, end, used);
+                begin = end;
+                sequence = begin;
+            }
+            else
+            {
+                begin++;
+            }
+        }
+        _run_gate_sequence(sequence, begin, identity);
+    }
+    catch (...)
+    {
+        m_pending_gates.clear();
+        m_is_flushing = false;
+        throw;
+    }
+
+    m_pending_gates.clear();
+    m_is_flushing = false;
+}
+
+/*
+  run the queued gates [begin, end) in one parallel region. Every gate loop
+  is split into the same parts of the state, which the static schedule hands
+  to the same threads, so a thread only waits for the others around gates
+  with a fixed qubit among the high qubits selecting the parts.
+*/
+template <typename data_t>
+void CPUImplQPU<data_t>::_run_gate_sequence(size_t begin, size_t end, const Qnum& identity)
+{
+    int64_t thread_num = _omp_thread_num(1ll << m_qubit_num);
+    int64_t part_num = 1;
+    size_t part_qubits = 0;
+    while (part_num < thread_num)
+    {
+        part_num <<= 1;
+        part_qubits++;
+    }
+
+    if (end - begin < kMinSequenceGates || thread_num <= 1 || part_qubits >= m_qubit_num)
+    {
+        for (size_t i = begin; i < end; i++)
+        {
+            _apply_gate(*this, m_pending_gates[i], identity);
+        }
+        return;
+    }
+
+    std::vector<SequenceGate> gates;
+    auto run_gates = [&]()
+    {
+#pragma omp parallel num_threads(thread_num)
+        {
+            for (size_t i = 0; i < gates.size(); i++)
+            {
+                switch (gates[i].qubits.size())
+                {
+                case 1: _sequence_kernel<1>(gates[i], part_num); break;
+                case 2: _sequence_kernel<2>(gates[i], part_num); break;
+                case 3: _sequence_kernel<3>(gates[i], part_num); break;
+                case 4: _sequence_kernel<4>(gates[i], part_num); break;
+                case 5: _sequence_kernel<5>(gates[i], part_num); break;
+                case 6: _sequence_kernel<6>(gates[i], part_num); break;
+                default: break;
+                }
 
-	return qErrorNone;
+                if (i + 1 < gates.size() && !(gates[i].is_local && gates[i + 1].is_local))
+                {
+#pragma omp barrier
+                }
+            }
+        }
+        gates.clear();
+    };
+
+    for (size_t i = begin; i < end; i++)
+    {
+        Qnum qubits;
+        Qnum controls;
+        QStat matrix;
+        if (!_sequence_gate(m_pending_gates[i], qubits, controls, matrix))
+        {
+            run_gates();
+            _apply_gate(*this, m_pending_gates[i], identity);
+            continue;
+        }
+
+        if (qubits.empty())
+        {
+            continue;
+        }
+
+        size_t max_qubit = *std::max_element(qubits.begin(), qubits.end());
+        for (auto qubit : controls)
+        {
+            max_qubit = std::max(max_qubit, qubit);
+        }
+        bool is_local = max_qubit < m_qubit_num - part_qubits;
+        ControlSubspace subspace(controls, qubits);
+        gates.push_back({ std::move(qubits), std::move(matrix), std::move(subspace), is_local });
+    }
+    run_gates();
+}
+
+/*
+  the matrix a queued gate applies, with the dagger taken, on qubits
+  where controls are all 1. false if the gate needs its own kernel
+*/
+template <typename data_t>
+bool CPUImplQPU<data_t>::_sequence_gate(const GateCall& call, Qnum& qubits, Qnum& controls, QStat& matrix)
+{
+    qubits = call.qubits;
+    controls = call.controls;
+    if (!target_operator(call.gate_type, call.is_controlled, call.matrix,
+        call.is_dagger, qubits, controls, matrix))
+    {
+        return false;
+    }
+
+    size_t dim = 1ull << qubits.size();
+    return qubits.size() <= kMaxSequenceQubits && matrix.size() == dim * dim;
 }
 
+/* the loop of a gate in a gate sequence, called by every thread of the region */
+template <typename data_t>
+template <size_t K>
+void CPUImplQPU<data_t>::_sequence_kernel(const SequenceGate& gate, int64_t part_num)
+{
+    const size_t dim = 1ull << K;
+    std::array<int64_t, dim> offsets;
+    for (size_t i_dim = 0; i_dim < dim; i_dim++)
+    {
+        offsets[i_dim] = 0;
+        for (size_t j = 0; j < K; j++)
+        {
+            if ((i_dim >> j) & 1ull)
+            {
+                offsets[i_dim] |= 1ll << gate.qubits[j];
+            }
+        }
+    }
+
+    const qcomplex_t *mat_data = gate.matrix.data();
+    int64_t size = gate.subspace.size(m_qubit_num);
+#pragma omp for schedule(static) nowait
+    for (int64_t part = 0; part < part_num; part++)
+    {
+        int64_t part_end = (part + 1) * size / part_num;
+        for (int64_t i = part * size / part_num; i < part_end; i++)
+        {
+            int64_t real00_idx = gate.subspace(i);
+            std::array<qcomplex_t, dim> phi;
+            for (size_t i_dim = 0; i_dim < dim; i_dim++)
+            {
+                phi[i_dim] = m_state[real00_idx | offsets[i_dim]];
+            }
+
+            for (size_t row = 0; row < dim; row++)
+            {
+                qcomplex_t sum = 0;
+                const qcomplex_t *mat_row = mat_data + row * dim;
+                for (size_t col = 0; col < dim; col++)
+                {
+                    sum += mat_row[col] * phi[col];
+                }
+                m_state[real00_idx | offsets[row]] = sum;
+            }
+        }
+    }
+}
 
-QError CPUImplQPU::_five_qubit_gate(Qnum &qubits, QStat& matrix, bool is_dagger, const Qnum& controls)
+/* swap qubits_0[k] with qubits_1[k] for every k, in one pass over the state */
+template <typename data_t>
+void CPUImplQPU<data_t>::_swap_qubits(const Qnum& qubits_0, const Qnum& qubits_1)
 {
+    int64_t size = 1ll << m_qubit_num;
+#pragma omp parallel for num_threads(_omp_thread_num(size))
+    for (int64_t i = 0; i < size; i++)
+    {
+        int64_t j = i;
+        for (size_t k = 0; k < qubits_0.size(); k++)
+        {
+            if (((i >> qubits_0[k]) ^ (i >> qubits_1[k])) & 1ll)
+            {
+                j ^= (1ll << qubits_0[k]) | (1ll << qubits_1[k]);
+            }
+        }
 
-	int64_t size = 1ll << (m_qubit_num - 5);
-	int64_t offset0 = 1ll << qubits[0];
-	int64_t offset1 = 1ll << qubits[1];
-	int64_t offset2 = 1ll << qubits[2];
-	int64_t offset3 = 1ll << qubits[3];
-	int64_t offset4 = 1ll << qubits[4];
-	int64_t mask = 0;
-	std::sort(qubits.begin(), qubits.end());
-	auto dim = 1ll << qubits.size();
-	qmatrix_t mat_eigen = qmatrix_t::Map(&matrix[0], dim, dim);
-	if (is_dagger)
-	{
-		mat_eigen.adjointInPlace();
-	}
+        if (i < j)
+        {
+            std::swap(m_state[i], m_state[j]);
+        }
+    }
+}
 
-    qvector_t state_bak(dim);
-    state_bak.setZero();
-	std::vector<int64_t> realxx_idxes(dim);
-	if (controls.size() > 5)
+template <typename data_t>
+void CPUImplQPU<data_t>::_run_gate_block(size_t begin, size_t end, const std::bitset<64>& used)
+{
+    /* move the high qubits of the run onto low qubits it does not use */
+    Qnum high_qubits, free_qubits;
+    for (size_t i = 0; i < m_qubit_num; i++)
+    {
+        if (i < m_cache_block_qubits && !used.test(i))
+        {
+            free_qubits.push_back(i);
+        }
+        else if (i >= m_cache_block_qubits && used.test(i))
+        {
+            high_qubits.push_back(i);
+        }
+    }
+    free_qubits.resize(high_qubits.size());
+
+    Qnum relabel(m_qubit_num);
+    for (size_t i = 0; i < m_qubit_num; i++)
+    {
+        relabel[i] = i;
+    }
+    for (size_t k = 0; k < high_qubits.size(); k++)
+    {
+        relabel[high_qubits[k]] = free_qubits[k];
+        relabel[free_qubits[k]] = high_qubits[k];
+    }
+
+    if (!high_qubits.empty())
+    {
+        _swap_qubits(high_qubits, free_qubits);
+    }
+
+    int64_t block_size = 1ll << m_cache_block_qubits;
+    int64_t block_num = 1ll << (m_qubit_num - m_cache_block_qubits);
+    auto run_block = [&](CPUImplQPU<data_t>& block_qpu, int64_t block)
+    {
+        auto iter = m_state.begin() + block * block_size;
+        std::copy(iter, iter + block_size, block_qpu.m_state.begin());
+        for (size_t i = begin; i < end; i++)
+        {
+            _apply_gate(block_qpu, m_pending_gates[i], relabel);
+        }
+        std::copy(block_qpu.m_state.begin(), block_qpu.m_state.end(), iter);
+    };
+    auto init_block_qpu = [&](CPUImplQPU<data_t>& block_qpu)
+    {
+        block_qpu.m_qubit_num = m_cache_block_qubits;
+        block_qpu.m_state.resize(block_size);
+        block_qpu.m_cache_block_qubits = 0;
+        block_qpu.m_max_threads_size = 1;
+        block_qpu.m_threshold = INT64_MAX;
+    };
+
+    /* the first block runs alone, so that a bad gate throws outside the parallel region */
+    {
+        CPUImplQPU<data_t> block_qpu;
+        init_block_qpu(block_qpu);
+        run_block(block_qpu, 0);
+    }
+
+#pragma omp parallel num_threads(_omp_thread_num(1ll << m_qubit_num))
+    {
+        CPUImplQPU<data_t> block_qpu;
+        init_block_qpu(block_qpu);
+#pragma omp for
+        for (int64_t block = 1; block < block_num; block++)
+        {
+            run_block(block_qpu, block);
+        }
+    }
+
+    if (!high_qubits.empty())
+    {
+        _swap_qubits(high_qubits, free_qubits);
+    }
+}
+
+QError CPUImplQPUWithOracle::controlOracularGate(std::vector<size_t> bits, std::vector<size_t> controlbits, bool is_dagger, std::string name)
+{
+    if (name == "oracle_test") {
+
+    }
+    else {
+        throw runtime_error("Not Implemented.");
+    }
+    return qErrorNone;
+}
+
+template <typename data_t>
+QError  CPUImplQPU<data_t>::single_qubit_gate_fusion(size_t qn, QStat& matrix)
+{
+	_flush_gates();
+	int64_t size = 1ll << (m_qubit_num - 1);
+	int64_t offset = 1ll << qn;
+	if (size > m_threshold)
 	{
-		for_each(controls.begin(), controls.end() - 5, [&](size_t q) {
-			mask |= 1ll << q;
-		});
+#pragma omp parallel for
+		for (int64_t i = 0; i < size; i++)
+		{
+			int64_t real00_idx = i;
+			int64_t real01_idx = i + 1;
+
+			qcomplex_t alpha = m_state[real00_idx];
+			qcomplex_t beta = m_state[real01_idx];
+			m_state[real00_idx] = matrix[0] * alpha + matrix[2] * beta;
+			m_state[real01_idx] = matrix[1] * alpha + matrix[3] * beta;
+		}
 	}
-#pragma omp parallel for num_threads(_omp_thread_num(size)) firstprivate(state_bak, realxx_idxes)
-	for (int64_t i = 0; i < size; i++)
+	else
 	{
-		int64_t real00_idx = _insert(i, qubits[0], qubits[1], qubits[2], qubits[3], qubits[4]);
-		if (mask != (mask & real00_idx)) {
-			continue;
-		}
-
-		realxx_idxes[0] = real00_idx;
-		realxx_idxes[1] = real00_idx | offset0;
-		realxx_idxes[2] = real00_idx | offset1;
-		realxx_idxes[3] = real00_idx | offset0 | offset1;
-		realxx_idxes[4] = real00_idx | offset2;
-		realxx_idxes[5] = real00_idx | offset2 | offset0;
-		realxx_idxes[6] = real00_idx | offset2 | offset1;
-		realxx_idxes[7] = real00_idx | offset2 | offset1 | offset0;
-		realxx_idxes[8] = real00_idx | offset3;
-		realxx_idxes[9] = real00_idx | offset3 | offset0;
-		realxx_idxes[10] = real00_idx | offset3 | offset1;
-		realxx_idxes[11] = real00_idx | offset3 | offset1 | offset0;
-		realxx_idxes[12] = real00_idx | offset3 | offset2;
-		realxx_idxes[13] = real00_idx | offset3 | offset2 | offset0;
-		realxx_idxes[14] = real00_idx | offset3 | offset2 | offset1;
-		realxx_idxes[15] = real00_idx | offset3 | offset2 | offset1 | offset0;
-		realxx_idxes[16] = real00_idx | offset4;
-		realxx_idxes[17] = real00_idx | offset4 | offset0;
-		realxx_idxes[18] = real00_idx | offset4 | offset1;
-		realxx_idxes[19] = real00_idx | offset4 | offset1 | offset0;
-		realxx_idxes[20] = real00_idx | offset4 | offset2;
-		realxx_idxes[21] = real00_idx | offset4 | offset2 | offset0;
-		realxx_idxes[22] = real00_idx | offset4 | offset2 | offset1;
-		realxx_idxes[23] = real00_idx | offset4 | offset2 | offset1 | offset0;
-		realxx_idxes[24] = real00_idx | offset4 | offset3;
-		realxx_idxes[25] = real00_idx | offset4 | offset3 | offset0;
-		realxx_idxes[26] = real00_idx | offset4 | offset3 | offset1;
-		realxx_idxes[27] = real00_idx | offset4 | offset3 | offset1 | offset0;
-		realxx_idxes[28] = real00_idx | offset4 | offset3 | offset2;
-		realxx_idxes[29] = real00_idx | offset4 | offset3 | offset2 | offset0;
-		realxx_idxes[30] = real00_idx | offset4 | offset3 | offset2 | offset1;
-		realxx_idxes[31] = real00_idx | offset4 | offset3 | offset2 | offset1 | offset0;
-
-
-		for (size_t i_dim = 0; i_dim < dim; i_dim++)
+		for (int64_t i = 0; i < size; i++)
 		{
-			state_bak(i_dim) = m_state[realxx_idxes[i_dim]];
-		}
+			int64_t real00_idx = _insert(i, qn);
+			int64_t real01_idx = real00_idx | offset;
 
-		for (size_t i_dim = 0; i_dim < dim; i_dim++)
-		{
-			m_state[realxx_idxes[i_dim]] = mat_eigen.row(i_dim).cwiseProduct(state_bak).sum();
+			qcomplex_t alpha = m_state[real00_idx];
+			qcomplex_t beta = m_state[real01_idx];
+			m_state[real00_idx] = matrix[0] * alpha + matrix[2] * beta;
+			m_state[real01_idx] = matrix[1] * alpha + matrix[3] * beta;
 		}
 	}
-
 	return qErrorNone;
 }
 
+
+template <typename data_t>
+QError CPUImplQPU<data_t>::double_qubit_gate_fusion(size_t qn_0, size_t qn_1, QStat &matrix)
+{
+	_flush_gates();
+    int64_t size = 1ll << (m_qubit_num - 2);
+    
+    int64_t offset0 = 1ll << qn_0;
+    int64_t offset1 = 1ll << qn_1;
+    if (qn_0 > qn_1)
+    {
+        std::swap(qn_0, qn_1);
+    }
+
+    for (int64_t i = 0; i < size; i++)
+    {
+        int64_t real00_idx = _insert(i, qn_0, qn_1);
+        qcomplex_t phi00 = m_state[real00_idx];
+        qcomplex_t phi01 = m_state[real00_idx | offset0];
+        qcomplex_t phi10 = m_state[real00_idx | offset1];
+        qcomplex_t phi11 = m_state[real00_idx | offset0 + offset1];
+
+        m_state[real00_idx] = matrix[0] * phi00 + matrix[4] * phi01
+            + matrix[8] * phi10 + matrix[12] * phi11;
+        m_state[real00_idx | offset0] = matrix[1] * phi00 + matrix[5] * phi01
+            + matrix[9] * phi10 + matrix[13] * phi11;
+        m_state[real00_idx | offset1] = matrix[2] * phi00 + matrix[6] * phi01
+            + matrix[10] * phi10 + matrix[14] * phi11;
+        m_state[real00_idx | offset0 | offset1] = matrix[3] * phi00 + matrix[7] * phi01
+            + matrix[11] * phi10 + matrix[15] * phi11;
+    }
+    return qErrorNone;
+}
+
+template <typename data_t>
+QError CPUImplQPU<data_t>::three_qubit_gate_fusion(size_t qn_0, size_t qn_1, QStat &matrix)
+{
+	_flush_gates();
+    int64_t size = 1ll << (m_qubit_num - 2);
+    if (qn_0 > qn_1)
+    {
+        std::swap(qn_0, qn_1);
+    }
+    int64_t offset0 = 1ll << qn_0;
+    int64_t offset1 = 1ll << qn_1;
+
+    for (int64_t i = 0; i < size; i++)
+    {
+        int64_t real00_idx = _insert(i, qn_0, qn_1);
+        qcomplex_t phi00 = m_state[real00_idx];
+        qcomplex_t phi01 = m_state[real00_idx | offset0];
+        qcomplex_t phi10 = m_state[real00_idx | offset1];
+        qcomplex_t phi11 = m_state[real00_idx | offset0 + offset1];
+
+        m_state[real00_idx] = matrix[0] * phi00 + matrix[4] * phi01
+            + matrix[8] * phi10 + matrix[12] * phi11;
+        m_state[real00_idx | offset0] = matrix[1] * phi00 + matrix[5] * phi01
+            + matrix[9] * phi10 + matrix[13] * phi11;
+        m_state[real00_idx | offset1] = matrix[2] * phi00 + matrix[6] * phi01
+            + matrix[10] * phi10 + matrix[14] * phi11;
+        m_state[real00_idx | offset0 | offset1] = matrix[3] * phi00 + matrix[7] * phi01
+            + matrix[11] * phi10 + matrix[15] * phi11;
+    }
+
+
+    return qErrorNone;
+}
+
+
+/*
+  the table behind gate_target_operator and the gate sequences,
+  false for gates and matrices it has no target matrix for
+*/
+static bool target_operator(GateType type, bool is_controlled, const QStat& m,
+    bool is_dagger, Qnum& qubits, Qnum& controls, QStat& matrix)
+{
+    auto control_high_qubit = [&]()
+    {
+        controls.push_back(qubits[0]);
+        qubits.erase(qubits.begin());
+    };
+
+    auto has_size = [&](size_t size) { return m.size() == size; };
+
+    if (GateType::ORACLE_GATE == type)
+    {
+        matrix = m;
+    }
+    else if (1 == qubits.size())
+    {
+        switch (type)
+        {
+        case GateType::I_GATE:
+        case GateType::BARRIER_GATE:
+        case GateType::ECHO_GATE:
+            qubits.clear();
+            return true;
+        case GateType::PAULI_X_GATE:
+            matrix = { 0, 1, 1, 0 };
+            break;
+        case GateType::PAULI_Y_GATE:
+            matrix = { 0, qcomplex_t(0, -1), qcomplex_t(0, 1), 0 };
+            break;
+        case GateType::PAULI_Z_GATE:
+            matrix = { 1, 0, 0, -1 };
+            break;
+        case GateType::S_GATE:
+            matrix = { 1, 0, 0, qcomplex_t(0, 1) };
+            break;
+        case GateType::HADAMARD_GATE:
+            matrix = { SQ2, SQ2, SQ2, -SQ2 };
+            break;
+        case GateType::T_GATE:
+        case GateType::U1_GATE:
+        case GateType::P_GATE:
+            if (!has_size(4))
+            {
+                return false;
+            }
+            matrix = { 1, 0, 0, m[3] };
+            break;
+        case GateType::RZ_GATE:
+        case GateType::Z_HALF_PI:
+            if (!has_size(4))
+            {
+                return false;
+            }
+            matrix = { m[0], 0, 0, m[3] };
+            break;
+        case GateType::P0_GATE:
+        case GateType::P1_GATE:
+        case GateType::X_HALF_PI:
+        case GateType::Y_HALF_PI:
+        case GateType::RX_GATE:
+        case GateType::RY_GATE:
+        case GateType::U2_GATE:
+        case GateType::U3_GATE:
+        case GateType::U4_GATE:
+        case GateType::RPHI_GATE:
+            matrix = m;
+            break;
+        default:
+            return false;
+        }
+    }
+    else
+    {
+        switch (type)
+        {
+        case GateType::CNOT_GATE:
+            control_high_qubit();
+            matrix = { 0, 1, 1, 0 };
+            break;
+        case GateType::CZ_GATE:
+            control_high_qubit();
+            matrix = { 1, 0, 0, -1 };
+            break;
+        case GateType::CPHASE_GATE:
+        case GateType::CP_GATE:
+            if (!has_size(16))
+            {
+                return false;
+            }
+            control_high_qubit();
+            matrix = { 1, 0, 0, m[15] };
+            break;
+        case GateType::CU_GATE:
+            if (!has_size(16))
+            {
+                return false;
+            }
+            control_high_qubit();
+            matrix = { m[10], m[11], m[14], m[15] };
+            break;
+        case GateType::SWAP_GATE:
+            matrix = { 1, 0, 0, 0, 0, 0, 1, 0, 0, 1, 0, 0, 0, 0, 0, 1 };
+            break;
+        case GateType::ISWAP_GATE:
+            /* the iSWAP kernels take qn_1 as the lower qubit and their own dagger */
+            if (!has_size(16))
+            {
+                return false;
+            }
+            std::swap(qubits[0], qubits[1]);
+            matrix = { 1, 0, 0, 0, 0, 0, m[6], 0, 0, m[9], 0, 0, 0, 0, 0, 1 };
+            if (is_dagger)
+            {
+                matrix[6] = { 0, 1 };
+                matrix[9] = { 0, 1 };
+            }
+            return true;
+        case GateType::ISWAP_THETA_GATE:
+        case GateType::SQISWAP_GATE:
+            if (!has_size(16))
+            {
+                return false;
+            }
+            std::swap(qubits[0], qubits[1]);
+            matrix = { 1, 0, 0, 0, 0, m[5], m[6], 0, 0, m[9], m[10], 0, 0, 0, 0, 1 };
+            if (is_dagger)
+            {
+                matrix[6] = std::conj(matrix[6]);
+                matrix[9] = std::conj(matrix[9]);
+            }
+            return true;
+        case GateType::RXX_GATE:
+        case GateType::RYY_GATE:
+        case GateType::RZZ_GATE:
+        case GateType::RZX_GATE:
+            if (is_controlled)
+            {
+                return false;
+            }
+            matrix = m;
+            break;
+        case GateType::P00_GATE:
+        case GateType::P11_GATE:
+        case GateType::TWO_QUBIT_GATE:
+            matrix = m;
+            break;
+        default:
+            return false;
+        }
+    }
+
+    size_t dim = 1ull << qubits.size();
+    if (matrix.size() != dim * dim)
+    {
+        return false;
+    }
+
+    if (is_dagger)
+    {
+        for (size_t row = 0; row < dim; row++)
+        {
+            for (size_t col = row; col < dim; col++)
+            {
+                auto value = std::conj(matrix[row * dim + col]);
+                matrix[row * dim + col] = std::conj(matrix[col * dim + row]);
+                matrix[col * dim + row] = value;
+            }
+        }
+    }
+    return true;
+}
+
+void QPanda::gate_target_operator(GateType type, bool is_controlled, const QStat& m,
+    bool is_dagger, Qnum& qubits, Qnum& controls, QStat& matrix)
+{
+    if (!target_operator(type, is_controlled, m, is_dagger, qubits, controls, matrix))
+    {
+        QCERR_AND_THROW(std::runtime_error, "Error: gate type: " << type << ", matrix size: " << m.size());
+    }
+}
+
+template class QPanda::CPUImplQPU<double>;
+template class QPanda::CPUImplQPU<float>;
@@ -16,6 +16,7 @@ limitations under the License.
 #include "CPUImplQPUSingleThread.h"
 #include "QPandaNamespace.h"
 #include "Core/Utilities/Tools/Utils.h"
+#include "Core/VirtualQuantumProcessor/MarginalProbability.h"
 #include <algorithm>
 #include <thread>
 #include <map>
@@ -152,16 +153,8 @@ QError CPUImplQPUSingleThread::pMeasure(Qnum& qnum, prob_vec &mResult)
         qvtemp.push_back(find(group0.qVec.begin(), group0.qVec.end(), *iter) - group0.qVec.begin());
     }
 
-    for (size_t i = 0; i < group0.qstate.size(); i++)
-    {
-        size_t idx = 0;
-        for (size_t j = 0; j < qvtemp.size(); j++)
-        {
-            idx += (((i >> (qvtemp[j])) % 2) << j);
-        }
-        mResult[idx] += group0.qstate[i].real()*group0.qstate[i].real()
-            + group0.qstate[i].imag()*group0.qstate[i].imag();
-    }
+    MarginalProbability<qstate_type> marginal(group0.qstate.data(), group0.qVec.size());
+    marginal.calculate(qvtemp, mResult);
 
     return qErrorNone;
 }
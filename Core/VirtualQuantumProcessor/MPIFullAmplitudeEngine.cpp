@@ -0,0 +1,742 @@
+/*
+Copyright (c) 2017-2020 Origin Quantum Computing. All Right Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "Core/VirtualQuantumProcessor/MPIFullAmplitudeEngine.h"
+#include "Core/VirtualQuantumProcessor/CPUImplQPU.h"
+#include "Core/Utilities/Tools/QPandaException.h"
+#include "Core/Utilities/Tools/Utils.h"
+#include <cstdlib>
+#include <algorithm>
+#ifdef USE_OPENMP
+#include <omp.h>
+#endif
+
+USING_QPANDA
+using namespace std;
+
+/* amplitudes exchanged with a rank at a time */
+const int64_t kExchangeAmplitudes = 1ll << 18;
+/* MPI counts are int, the collectives on whole local states count blocks of amplitudes */
+const int64_t kMessageBlockAmplitudes = 1ll << 20;
+/* doubles reduced by one collective call */
+const int64_t kMaxReduceDoubles = 1ll << 28;
+
+static void dagger_matrix(QStat& matrix)
+{
+    size_t dim = 1;
+    while (dim * dim < matrix.size())
+    {
+        dim <<= 1;
+    }
+
+    for (size_t row = 0; row < dim; row++)
+    {
+        for (size_t col = row; col < dim; col++)
+        {
+            auto value = std::conj(matrix[row * dim + col]);
+            matrix[row * dim + col] = std::conj(matrix[col * dim + row]);
+            matrix[col * dim + row] = value;
+        }
+    }
+}
+
+#ifdef USE_MPI
+static void finalize_mpi()
+{
+    int is_finalized = 0;
+    MPI_Finalized(&is_finalized);
+    if (!is_finalized)
+    {
+        MPI_Finalize();
+    }
+}
+
+static bool is_mpi_finalized()
+{
+    int is_finalized = 0;
+    MPI_Finalized(&is_finalized);
+    return is_finalized;
+}
+#endif
+
+MPIFullAmplitudeEngine::MPIFullAmplitudeEngine(bool use_shared_memory)
+    : m_use_shared_memory(use_shared_memory)
+{
+#ifdef USE_MPI
+    int is_initialized = 0;
+    MPI_Initialized(&is_initialized);
+    if (!is_initialized)
+    {
+        MPI_Init(nullptr, nullptr);
+        std::atexit(finalize_mpi);
+    }
+
+    MPI_Comm_dup(MPI_COMM_WORLD, &m_comm);
+    MPI_Comm_rank(m_comm, &m_rank);
+    MPI_Comm_size(m_comm, &m_rank_size);
+#endif
+    QPANDA_ASSERT(0 != (m_rank_size & (m_rank_size - 1)), "Error: the rank size is not a power of 2.");
+    while ((1 << m_rank_qubits) < m_rank_size)
+    {
+        m_rank_qubits++;
+    }
+}
+
+MPIFullAmplitudeEngine::~MPIFullAmplitudeEngine()
+{
+    _free_state();
+#ifdef USE_MPI
+    if (MPI_COMM_NULL != m_comm && !is_mpi_finalized())
+    {
+        MPI_Comm_free(&m_comm);
+    }
+#endif
+}
+
+void MPIFullAmplitudeEngine::_allocate_state(size_t qubit_num)
+{
+    QPANDA_ASSERT(qubit_num <= m_rank_qubits, "Error: the qubits are not more than the rank qubits.");
+    if (nullptr != m_state && qubit_num == m_qubit_num)
+    {
+        return;
+    }
+
+    _free_state();
+    m_qubit_num = qubit_num;
+    m_local_qubits = qubit_num - m_rank_qubits;
+    m_local_size = 1ll << m_local_qubits;
+
+#ifdef USE_MPI
+    if (m_use_shared_memory && m_rank_size > 1)
+    {
+        MPI_Comm node_comm;
+        int node_size = 0;
+        MPI_Comm_split_type(m_comm, MPI_COMM_TYPE_SHARED, m_rank, MPI_INFO_NULL, &node_comm);
+        MPI_Comm_size(node_comm, &node_size);
+        MPI_Comm_free(&node_comm);
+
+        /* every rank on this node, the other ranks read the state in place */
+        if (node_size == m_rank_size)
+        {
+            void* base = nullptr;
+            MPI_Win_allocate_shared(m_local_size * sizeof(qcomplex_t), sizeof(qcomplex_t),
+                MPI_INFO_NULL, m_comm, &base, &m_window);
+            MPI_Win_lock_all(MPI_MODE_NOCHECK, m_window);
+
+            m_rank_states.resize(m_rank_size);
+            for (int rank = 0; rank < m_rank_size; rank++)
+            {
+                MPI_Aint size = 0;
+                int disp_unit = 0;
+                void* rank_base = nullptr;
+                MPI_Win_shared_query(m_window, rank, &size, &disp_unit, &rank_base);
+                m_rank_states[rank] = static_cast<qcomplex_t*>(rank_base);
+            }
+
+            m_state = static_cast<qcomplex_t*>(base);
+            m_is_shared_memory = true;
+            return;
+        }
+    }
+#endif
+
+    m_local_state.resize(m_local_size);
+    m_state = m_local_state.data();
+}
+
+void MPIFullAmplitudeEngine::_free_state()
+{
+#ifdef USE_MPI
+    if (MPI_WIN_NULL != m_window && !is_mpi_finalized())
+    {
+        MPI_Win_unlock_all(m_window);
+        MPI_Win_free(&m_window);
+    }
+    m_window = MPI_WIN_NULL;
+    m_rank_states.clear();
+#endif
+    QStat().swap(m_local_state);
+    m_state = nullptr;
+    m_is_shared_memory = false;
+}
+
+void MPIFullAmplitudeEngine::initState(int head_rank, int rank_size, int qubit_num)
+{
+    _allocate_state(qubit_num);
+    if (m_is_init_state)
+    {
+        std::copy(m_init_state.begin(), m_init_state.end(), m_state);
+    }
+    else
+    {
+        std::fill(m_state, m_state + m_local_size, qcomplex_t(0));
+        if (0 == m_rank)
+        {
+            m_state[0] = 1;
+        }
+    }
+}
+
+void MPIFullAmplitudeEngine::initState(size_t qubit_num, const QStat &state)
+{
+    if (0 == state.size())
+    {
+        m_is_init_state = false;
+        QStat().swap(m_init_state);
+        initState(0, 1, (int)qubit_num);
+        return;
+    }
+
+    QPANDA_ASSERT(1ull << qubit_num != state.size(), "Error: initState size.");
+    QPANDA_ASSERT(qubit_num <= m_rank_qubits, "Error: the qubits are not more than the rank qubits.");
+    size_t local_size = 1ull << (qubit_num - m_rank_qubits);
+    auto begin = state.begin() + m_rank * local_size;
+    m_init_state.assign(begin, begin + local_size);
+    m_is_init_state = true;
+}
+
+QStat MPIFullAmplitudeEngine::getQState(bool is_all_state)
+{
+    if (!is_all_state || 1 == m_rank_size)
+    {
+        return QStat(m_state, m_state + m_local_size);
+    }
+
+    QStat state(1ull << m_qubit_num);
+#ifdef USE_MPI
+    /* the local sizes are powers of 2, so a block divides them */
+    int64_t block = std::min(m_local_size, kMessageBlockAmplitudes);
+    MPI_Datatype block_type;
+    MPI_Type_contiguous((int)(2 * block), MPI_DOUBLE, &block_type);
+    MPI_Type_commit(&block_type);
+    int count = (int)(m_local_size / block);
+    MPI_Allgather(m_state, count, block_type, state.data(), count, block_type, m_comm);
+    MPI_Type_free(&block_type);
+#endif
+    return state;
+}
+
+void MPIFullAmplitudeEngine::singleQubitOperation(const int &iQn, QStat U, bool isConjugate)
+{
+    if (isConjugate)
+    {
+        dagger_matrix(U);
+    }
+    _apply_gate({ (size_t)iQn }, {}, U);
+}
+
+void MPIFullAmplitudeEngine::controlsingleQubitOperation(const int &iQn, Qnum& qnum, QStat U, bool isConjugate)
+{
+    if (isConjugate)
+    {
+        dagger_matrix(U);
+    }
+    _apply_gate({ (size_t)iQn }, qnum, U);
+}
+
+void MPIFullAmplitudeEngine::doubleQubitOperation(const int &iQn1, const int &iQn2, QStat U, bool isConjugate)
+{
+    size_t global_num = ((size_t)iQn1 >= m_local_qubits) + ((size_t)iQn2 >= m_local_qubits);
+    if (0 == global_num)
+    {
+        distributeOneRank_doubleQubitOperation(iQn1, iQn2, U, isConjugate);
+    }
+    else if (1 == global_num)
+    {
+        distributeTwoRank_doubleQubitOperation(iQn1, iQn2, U, isConjugate);
+    }
+    else
+    {
+        distributeFourRank_doubleQubitOperation(iQn1, iQn2, U, isConjugate);
+    }
+}
+
+void MPIFullAmplitudeEngine::controldoubleQubitOperation(const int &iQn1, const int &iQn2,
+    Qnum& qnum, QStat U, bool isConjugate)
+{
+    if (isConjugate)
+    {
+        dagger_matrix(U);
+    }
+    _apply_gate({ (size_t)iQn1, (size_t)iQn2 }, qnum, U);
+}
+
+void MPIFullAmplitudeEngine::controlOracleOperation(const Qnum& qubits, const Qnum& controls,
+    QStat U, bool isConjugate)
+{
+    if (isConjugate)
+    {
+        dagger_matrix(U);
+    }
+    _apply_gate(qubits, controls, U);
+}
+
+/* both qubits on this rank */
+void MPIFullAmplitudeEngine::distributeOneRank_doubleQubitOperation(const int &iQn1, const int &iQn2,
+    QStat U, bool isConjugate)
+{
+    if (isConjugate)
+    {
+        dagger_matrix(U);
+    }
+    _local_gate({ (size_t)iQn1, (size_t)iQn2 }, {}, U);
+}
+
+/* one qubit selects the rank, the pairs of ranks differing in it exchange amplitudes */
+void MPIFullAmplitudeEngine::distributeTwoRank_doubleQubitOperation(const int &iQn1, const int &iQn2,
+    QStat U, bool isConjugate)
+{
+    if (isConjugate)
+    {
+        dagger_matrix(U);
+    }
+    _global_gate({ (size_t)iQn1, (size_t)iQn2 }, {}, U, true);
+}
+
+/* both qubits select the rank, the groups of four ranks exchange amplitudes */
+void MPIFullAmplitudeEngine::distributeFourRank_doubleQubitOperation(const int &iQn1, const int &iQn2,
+    QStat U, bool isConjugate)
+{
+    if (isConjugate)
+    {
+        dagger_matrix(U);
+    }
+    _global_gate({ (size_t)iQn1, (size_t)iQn2 }, {}, U, true);
+}
+
+void MPIFullAmplitudeEngine::_apply_gate(const Qnum& qubits, const Qnum& controls, const QStat& U)
+{
+    if (qubits.empty())
+    {
+        return;
+    }
+
+    /* the controls that select the rank keep or skip the whole gate */
+    Qnum local_controls;
+    bool is_selected = true;
+    for (auto qubit : controls)
+    {
+        if (std::find(qubits.begin(), qubits.end(), qubit) != qubits.end())
+        {
+            continue;
+        }
+
+        if (qubit < m_local_qubits)
+        {
+            local_controls.push_back(qubit);
+        }
+        else if (0 == ((m_rank >> (qubit - m_local_qubits)) & 1))
+        {
+            is_selected = false;
+        }
+    }
+
+    bool is_global = std::any_of(qubits.begin(), qubits.end(),
+        [&](size_t qubit) { return qubit >= m_local_qubits; });
+    if (is_global)
+    {
+        _global_gate(qubits, local_controls, U, is_selected);
+    }
+    else if (is_selected)
+    {
+        _local_gate(qubits, local_controls, U);
+    }
+}
+
+void MPIFullAmplitudeEngine::_local_gate(const Qnum& qubits, const Qnum& controls, const QStat& U)
+{
+    size_t dim = 1ull << qubits.size();
+    QPANDA_ASSERT(U.size() != dim * dim, "Error: gate matrix size.");
+    std::vector<int64_t> offsets(dim, 0);
+    for (size_t i_dim = 0; i_dim < dim; i_dim++)
+    {
+        for (size_t j = 0; j < qubits.size(); j++)
+        {
+            if ((i_dim >> j) & 1ull)
+            {
+                offsets[i_dim] |= 1ll << qubits[j];
+            }
+        }
+    }
+
+    ControlSubspace subspace(controls, qubits);
+    int64_t size = subspace.size(m_local_qubits);
+#pragma omp parallel num_threads(_omp_thread_num(size))
+    {
+        QStat phi(dim);
+#pragma omp for
+        for (int64_t i = 0; i < size; i++)
+        {
+            int64_t real00_idx = subspace(i);
+            for (size_t i_dim = 0; i_dim < dim; i_dim++)
+            {
+                phi[i_dim] = m_state[real00_idx | offsets[i_dim]];
+            }
+
+            for (size_t row = 0; row < dim; row++)
+            {
+                qcomplex_t sum = 0;
+                const qcomplex_t *mat_row = U.data() + row * dim;
+                for (size_t col = 0; col < dim; col++)
+                {
+                    sum += mat_row[col] * phi[col];
+                }
+                m_state[real00_idx | offsets[row]] = sum;
+            }
+        }
+    }
+}
+
+void MPIFullAmplitudeEngine::_global_gate(const Qnum& qubits, const Qnum& controls,
+    const QStat& U, bool is_selected)
+{
+    size_t dim = 1ull << qubits.size();
+    QPANDA_ASSERT(U.size() != dim * dim, "Error: gate matrix size.");
+
+    /* bit j of the matrix index is a rank bit or a bit of the local index */
+    Qnum local_targets;
+    Qnum rank_targets;
+    std::vector<size_t> group_of(dim, 0);
+    std::vector<size_t> local_of(dim, 0);
+    for (auto qubit : qubits)
+    {
+        if (qubit < m_local_qubits)
+        {
+            local_targets.push_back(qubit);
+        }
+        else
+        {
+            rank_targets.push_back(qubit - m_local_qubits);
+        }
+    }
+
+    for (size_t i_dim = 0; i_dim < dim; i_dim++)
+    {
+        size_t local_bit = 0;
+        size_t rank_bit = 0;
+        for (size_t j = 0; j < qubits.size(); j++)
+        {
+            size_t bit = (i_dim >> j) & 1ull;
+            if (qubits[j] < m_local_qubits)
+            {
+                local_of[i_dim] |= bit << local_bit++;
+            }
+            else
+            {
+                group_of[i_dim] |= bit << rank_bit++;
+            }
+        }
+    }
+
+    size_t local_dim = 1ull << local_targets.size();
+    size_t group_size = 1ull << rank_targets.size();
+    std::vector<int64_t> local_offsets(local_dim, 0);
+    for (size_t i_dim = 0; i_dim < local_dim; i_dim++)
+    {
+        for (size_t j = 0; j < local_targets.size(); j++)
+        {
+            if ((i_dim >> j) & 1ull)
+            {
+                local_offsets[i_dim] |= 1ll << local_targets[j];
+            }
+        }
+    }
+
+    /* this rank is member group_id of the ranks differing in the rank targets */
+    size_t group_id = 0;
+    int rank_mask = 0;
+    for (size_t j = 0; j < rank_targets.size(); j++)
+    {
+        group_id |= (size_t)((m_rank >> rank_targets[j]) & 1) << j;
+        rank_mask |= 1 << rank_targets[j];
+    }
+
+    std::vector<int> group_ranks(group_size, m_rank & ~rank_mask);
+    for (size_t member = 0; member < group_size; member++)
+    {
+        for (size_t j = 0; j < rank_targets.size(); j++)
+        {
+            group_ranks[member] |= (int)((member >> j) & 1ull) << rank_targets[j];
+        }
+    }
+
+    ControlSubspace subspace(controls, local_targets);
+    int64_t size = subspace.size(m_local_qubits);
+    int64_t chunk = std::max<int64_t>(1, kExchangeAmplitudes / local_dim);
+    std::vector<QStat> buffers(group_size);
+    std::vector<int64_t> indices;
+
+    /* the other ranks are done with the gates before */
+    _synchronize();
+    for (int64_t begin = 0; begin < size; begin += chunk)
+    {
+        int64_t end = std::min(size, begin + chunk);
+        if (is_selected)
+        {
+            indices.resize((end - begin) * local_dim);
+            for (int64_t i = begin; i < end; i++)
+            {
+                int64_t real00_idx = subspace(i);
+                for (size_t i_dim = 0; i_dim < local_dim; i_dim++)
+                {
+                    indices[(i - begin) * local_dim + i_dim] = real00_idx | local_offsets[i_dim];
+                }
+            }
+
+            /* every step pairs up the members of the group */
+            for (size_t step = 1; step < group_size; step++)
+            {
+                size_t member = group_id ^ step;
+                _fetch(group_ranks[member], indices, buffers[member]);
+            }
+        }
+
+        /* the amplitudes of this chunk are read before they are written */
+        _synchronize();
+        if (!is_selected)
+        {
+            continue;
+        }
+
+        int64_t chunk_size = end - begin;
+#pragma omp parallel num_threads(_omp_thread_num(chunk_size))
+        {
+            QStat phi(dim);
+#pragma omp for
+            for (int64_t i = 0; i < chunk_size; i++)
+            {
+                const int64_t *chunk_indices = indices.data() + i * local_dim;
+                for (size_t i_dim = 0; i_dim < dim; i_dim++)
+                {
+                    size_t local = local_of[i_dim];
+                    phi[i_dim] = group_of[i_dim] == group_id ? m_state[chunk_indices[local]]
+                        : buffers[group_of[i_dim]][i * local_dim + local];
+                }
+
+                for (size_t row = 0; row < dim; row++)
+                {
+                    if (group_of[row] != group_id)
+                    {
+                        continue;
+                    }
+
+                    qcomplex_t sum = 0;
+                    const qcomplex_t *mat_row = U.data() + row * dim;
+                    for (size_t col = 0; col < dim; col++)
+                    {
+                        sum += mat_row[col] * phi[col];
+                    }
+                    m_state[chunk_indices[local_of[row]]] = sum;
+                }
+            }
+        }
+    }
+}
+
+void MPIFullAmplitudeEngine::_fetch(int rank, const std::vector<int64_t>& indices, QStat& buffer)
+{
+    buffer.resize(indices.size());
+#ifdef USE_MPI
+    if (m_is_shared_memory)
+    {
+        const qcomplex_t* rank_state = m_rank_states[rank];
+        for (size_t i = 0; i < indices.size(); i++)
+        {
+            buffer[i] = rank_state[indices[i]];
+        }
+        return;
+    }
+
+    m_send_buffer.resize(indices.size());
+    for (size_t i = 0; i < indices.size(); i++)
+    {
+        m_send_buffer[i] = m_state[indices[i]];
+    }
+
+    int count = (int)(2 * indices.size());
+    MPI_Sendrecv(m_send_buffer.data(), count, MPI_DOUBLE, rank, 0,
+        buffer.data(), count, MPI_DOUBLE, rank, 0, m_comm, MPI_STATUS_IGNORE);
+#endif
+}
+
+void MPIFullAmplitudeEngine::_synchronize()
+{
+#ifdef USE_MPI
+    if (m_is_shared_memory)
+    {
+        MPI_Win_sync(m_window);
+        MPI_Barrier(m_comm);
+        MPI_Win_sync(m_window);
+    }
+#endif
+}
+
+double MPIFullAmplitudeEngine::_reduce_sum(double value)
+{
+#ifdef USE_MPI
+    MPI_Allreduce(MPI_IN_PLACE, &value, 1, MPI_DOUBLE, MPI_SUM, m_comm);
+#endif
+    return value;
+}
+
+/* the qubit is on every rank, all of them sum up the probability */
+qstate_type MPIFullAmplitudeEngine::distributeAllRank_measureQubitOperation(const int &qn)
+{
+    ControlSubspace subspace({}, { (size_t)qn });
+    int64_t size = subspace.size(m_local_qubits);
+    double dprob = 0;
+#pragma omp parallel for num_threads(_omp_thread_num(size)) reduction(+:dprob)
+    for (int64_t i = 0; i < size; i++)
+    {
+        dprob += std::norm(m_state[subspace(i)]);
+    }
+    return _reduce_sum(dprob);
+}
+
+/* the qubit selects the rank, the half of the ranks where it is 0 sum up the probability */
+qstate_type MPIFullAmplitudeEngine::distributeHalfRank_measureQubitOperation(const int &qn)
+{
+    double dprob = 0;
+    if (0 == ((m_rank >> (qn - m_local_qubits)) & 1))
+    {
+#pragma omp parallel for num_threads(_omp_thread_num(m_local_size)) reduction(+:dprob)
+        for (int64_t i = 0; i < m_local_size; i++)
+        {
+            dprob += std::norm(m_state[i]);
+        }
+    }
+    return _reduce_sum(dprob);
+}
+
+void MPIFullAmplitudeEngine::distributeAllRank_handleMeasureState(const int &qn, int &result, const qstate_type &prob)
+{
+    double scale = 1 / sqrt(result ? 1 - prob : prob);
+    int64_t offset = 1ll << qn;
+    int64_t kept = result ? offset : 0;
+    ControlSubspace subspace({}, { (size_t)qn });
+    int64_t size = subspace.size(m_local_qubits);
+#pragma omp parallel for num_threads(_omp_thread_num(size))
+    for (int64_t i = 0; i < size; i++)
+    {
+        int64_t real00_idx = subspace(i);
+        m_state[real00_idx | kept] *= scale;
+        m_state[(real00_idx | offset) ^ kept] = 0;
+    }
+}
+
+void MPIFullAmplitudeEngine::distributeHalfRank_handleMeasureState(const int &qn, int &result, const qstate_type &prob)
+{
+    bool is_kept = ((m_rank >> (qn - m_local_qubits)) & 1) == result;
+    double scale = is_kept ? 1 / sqrt(result ? 1 - prob : prob) : 0;
+#pragma omp parallel for num_threads(_omp_thread_num(m_local_size))
+    for (int64_t i = 0; i < m_local_size; i++)
+    {
+        m_state[i] *= scale;
+    }
+}
+
+int MPIFullAmplitudeEngine::measureQubitOperation(const int &qn)
+{
+    bool is_local = (size_t)qn < m_local_qubits;
+    qstate_type prob = is_local ? distributeAllRank_measureQubitOperation(qn)
+        : distributeHalfRank_measureQubitOperation(qn);
+
+    /* rank 0 draws the result for all of them */
+    double random = random_generator19937();
+#ifdef USE_MPI
+    MPI_Bcast(&random, 1, MPI_DOUBLE, 0, m_comm);
+#endif
+    int result = random > prob;
+    if (is_local)
+    {
+        distributeAllRank_handleMeasureState(qn, result, prob);
+    }
+    else
+    {
+        distributeHalfRank_handleMeasureState(qn, result, prob);
+    }
+    return result;
+}
+
+void MPIFullAmplitudeEngine::PMeasureQubitOperation(Qnum& qnum, prob_vec &mResult)
+{
+    mResult.assign(1ull << qnum.size(), 0);
+
+    /* the rank bits are the same for all the amplitudes of this rank */
+    size_t base = 0;
+    Qnum local_qubits;
+    Qnum local_bits;
+    for (size_t j = 0; j < qnum.size(); j++)
+    {
+        if (qnum[j] < m_local_qubits)
+        {
+            local_qubits.push_back(qnum[j]);
+            local_bits.push_back(j);
+        }
+        else
+        {
+            base |= (size_t)((m_rank >> (qnum[j] - m_local_qubits)) & 1) << j;
+        }
+    }
+
+#pragma omp parallel num_threads(_omp_thread_num(m_local_size))
+    {
+        prob_vec local_probs(mResult.size(), 0);
+#pragma omp for
+        for (int64_t i = 0; i < m_local_size; i++)
+        {
+            size_t index = base;
+            for (size_t k = 0; k < local_qubits.size(); k++)
+            {
+                index |= ((i >> local_qubits[k]) & 1ll) << local_bits[k];
+            }
+            local_probs[index] += std::norm(m_state[i]);
+        }
+#pragma omp critical
+        for (size_t k = 0; k < mResult.size(); k++)
+        {
+            mResult[k] += local_probs[k];
+        }
+    }
+
+#ifdef USE_MPI
+    for (size_t begin = 0; begin < mResult.size(); begin += kMaxReduceDoubles)
+    {
+        int count = (int)std::min<size_t>(kMaxReduceDoubles, mResult.size() - begin);
+        MPI_Allreduce(MPI_IN_PLACE, mResult.data() + begin, count, MPI_DOUBLE, MPI_SUM, m_comm);
+    }
+#endif
+}
+
+void MPIFullAmplitudeEngine::reset_qubit_operation(const int &qn)
+{
+    if (measureQubitOperation(qn))
+    {
+        _apply_gate({ (size_t)qn }, {}, { 0, 1, 1, 0 });
+    }
+}
+
+int MPIFullAmplitudeEngine::_omp_thread_num(size_t size) const
+{
+    if (size > m_threshold)
+    {
+#ifdef USE_OPENMP
+        return omp_get_max_threads();
+#else
+        return 1;
+#endif
+    }
+    return 1;
+}
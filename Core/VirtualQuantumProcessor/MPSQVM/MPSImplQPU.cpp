@@ -804,6 +804,22 @@ void MPSImplQPU::swap_qubits_location(size_t index_A, size_t index_B)
 		m_qubits_location[m_qubits_order[i]] = i;
 }
 
+QError MPSImplQPU::qubitCollapse(size_t qn, bool outcome, double prob)
+{
+	if (!is_ordered(m_qubits_location))
+		move_all_qubits_to_sorted_ordering();
+
+	apply_collapse(qn, outcome, prob);
+	return qErrorNone;
+}
+
+QPUImpl* MPSImplQPU::clone()
+{
+	auto qpu = new MPSImplQPU();
+	qpu->initState(*this);
+	return qpu;
+}
+
 bool MPSImplQPU::measure_one_collapsing(size_t qubit)
 {
 	if (!is_ordered(m_qubits_location))
@@ -863,30 +879,19 @@ bool MPSImplQPU::apply_measure(size_t qubit)
 
 	// step 3 - randomly choose a measurement value for qubit 0
 
-	double rnd = random_generator19937(0.0, 1.0);
-	bool measurement;
-	cmatrix_t measurement_matrix(2, 2);
-
-	cmatrix_t zero_measure(2, 2);
-	zero_measure << qcomplex_t(1, 0), qcomplex_t(0, 0), qcomplex_t(0, 0), qcomplex_t(0, 0);
+	double rnd = get_random_double();
+	bool measurement = rnd >= prob0;
+	apply_collapse(qubit, measurement, measurement ? prob1 : prob0);
 
-	cmatrix_t one_measure(2, 2);
-	one_measure << qcomplex_t(0, 0), qcomplex_t(0, 0), qcomplex_t(0, 0), qcomplex_t(1, 0);
+	return measurement;
+}
 
-	if (rnd < prob0)
-	{
-		measurement = 0;
-		measurement_matrix = zero_measure;
-		measurement_matrix = measurement_matrix * (1 / sqrt(prob0));
-	}
-	else
-	{
-		measurement = 1;
-		measurement_matrix = one_measure;
-		measurement_matrix = measurement_matrix * (1 / sqrt(prob1));
-	}
+void MPSImplQPU::apply_collapse(size_t qubit, bool outcome, double prob)
+{
+	cmatrix_t measurement_matrix = cmatrix_t::Zero(2, 2);
+	measurement_matrix(outcome, outcome) = 1 / sqrt(prob);
 
-	auto qindex = get_qubit_index(qubits_to_update[0]);
+	auto qindex = get_qubit_index(qubit);
 
 	m_qubits_tensor[qindex].apply_matrix(measurement_matrix);
 
@@ -910,8 +915,6 @@ bool MPSImplQPU::apply_measure(size_t qubit)
 
 		execute_two_qubit_gate(i - 1, i, id_mat);
 	}
-
-	return measurement;
 }
 
 void MPSImplQPU::move_all_qubits_to_sorted_ordering()
@@ -1081,7 +1084,7 @@ cmatrix_t MPSImplQPU::density_matrix(const Qnum &qubits)
 
     Qnum new_qubits;
     Qnum sorted_indices;
-    centralize_and_sort_qubits(qubits, sorted_indices, new_qubits);
+    temp.centralize_and_sort_qubits(internal_qubits, sorted_indices, new_qubits);
 
     MPS_Tensor mps_vec = temp.convert_qstate_to_mps_form(new_qubits.front(), new_qubits.back());
 
@@ -1106,6 +1109,63 @@ cmatrix_t MPSImplQPU::density_matrix(const Qnum &qubits)
 }
 
 
+prob_vec MPSImplQPU::schmidt_spectrum(const Qnum &qubits)
+{
+    std::vector<bool> is_on_side(m_qubits_num, false);
+    for (auto qubit : qubits)
+    {
+        QPANDA_ASSERT(qubit >= m_qubits_num, "Error: qubit out of the state.");
+        is_on_side[get_qubit_index(qubit)] = true;
+    }
+
+    size_t side_num = std::count(is_on_side.begin(), is_on_side.end(), true);
+    if (0 == side_num || m_qubits_num == side_num)
+    {
+        return { 1 };
+    }
+
+    /* the lambdas of a bond are the Schmidt coefficients across it */
+    bool is_left_end = std::all_of(is_on_side.begin(), is_on_side.begin() + side_num,
+        [](bool on_side) { return on_side; });
+    bool is_right_end = std::none_of(is_on_side.begin(), is_on_side.end() - side_num,
+        [](bool on_side) { return on_side; });
+    if (is_left_end || is_right_end)
+    {
+        const auto &lambda = m_lambdas[is_left_end ? side_num - 1 : m_qubits_num - side_num - 1];
+        prob_vec spectrum(lambda.size());
+        double sum = 0;
+        for (size_t i = 0; i < spectrum.size(); i++)
+        {
+            spectrum[i] = lambda[i] * lambda[i];
+            sum += spectrum[i];
+        }
+
+        for (auto &value : spectrum)
+        {
+            value /= sum;
+        }
+        std::sort(spectrum.begin(), spectrum.end(), std::greater<double>());
+        return spectrum;
+    }
+
+    Qnum other_side;
+    for (size_t qubit = 0; qubit < m_qubits_num; qubit++)
+    {
+        if (!is_on_side[get_qubit_index(qubit)])
+        {
+            other_side.push_back(qubit);
+        }
+    }
+
+    auto rho = density_matrix(side_num <= other_side.size() ? qubits : other_side);
+    return density_matrix_spectrum(QStat(rho.data(), rho.data() + rho.size()));
+}
+
+double MPSImplQPU::entanglement_entropy(const Qnum &qubits, double alpha)
+{
+    return spectrum_entropy(schmidt_spectrum(qubits), alpha);
+}
+
 double MPSImplQPU::single_expectation_value(const Qnum &qubits, const cmatrix_t &matrix)
 {
 
@@ -202,6 +202,12 @@ std::map<std::string, size_t> MPSQVM::run_configuration_without_noise(QProg &pro
     // at least one Measure operation is not at the end of the quantum program
     if (traver_param.m_can_optimize_measure != true)
     {
+        QProgBranchExecution branch_exec(prog);
+        if (shots > 1 && branch_exec.is_supported())
+        {
+            return run_with_branching(branch_exec, cbits, shots);
+        }
+
         for (int i = 0; i < shots; i++)
         {
             run_cannot_optimize_measure(prog);
@@ -247,6 +253,40 @@ std::map<std::string, size_t> MPSQVM::run_configuration_without_noise(QProg &pro
 }
 
 
+std::map<std::string, size_t> MPSQVM::run_with_branching(QProgBranchExecution &branch_exec,
+    std::vector<ClassicalCondition> &cbits, int shots)
+{
+    m_qubit_num = getAllocateQubitNum();
+    m_simulator->initState(0, 1, m_qubit_num);
+
+    std::vector<CBit*> all_cbits;
+    _CMem->get_allocate_cbits(all_cbits);
+
+    /* the gates of a branch run on the simulator of the branch */
+    auto trunk_simulator = m_simulator;
+    auto runner = [this](std::shared_ptr<QNode> node, const std::shared_ptr<QPUImpl> &qpu)
+    {
+        m_simulator = std::dynamic_pointer_cast<MPSImplQPU>(qpu);
+        QCircuitConfig config;
+        config._can_optimize_measure = false;
+        Traversal::traversalByType(node, nullptr, *this, config);
+    };
+
+    std::vector<ShotBranch> branches;
+    try
+    {
+        branches = branch_exec.execute(trunk_simulator, shots, all_cbits, runner);
+    }
+    catch (...)
+    {
+        m_simulator = trunk_simulator;
+        throw;
+    }
+
+    m_simulator = trunk_simulator;
+    return _branch_result(branches, cbits);
+}
+
 std::map<std::string, size_t> MPSQVM::run_configuration_with_noise(QProg &prog, std::vector<ClassicalCondition> &cbits, int shots)
 {
     map<string, size_t> result_map;
@@ -316,6 +356,27 @@ std::map<std::string, size_t> MPSQVM::quickMeasure(QVec vQubit, size_t shots)
 }
 
 
+prob_vec MPSQVM::get_schmidt_spectrum(QVec qubits)
+{
+    if (m_simulator == nullptr)
+    {
+        QCERR("m_simulator error, need run the prog");
+        throw run_fail("m_simulator error, need run the prog");
+    }
+
+    Qnum vqubit;
+    for (auto aiter = qubits.begin(); aiter != qubits.end(); ++aiter)
+    {
+        vqubit.push_back((*aiter)->getPhysicalQubitPtr()->getQubitAddr());
+    }
+    return m_simulator->schmidt_spectrum(vqubit);
+}
+
+double MPSQVM::get_entanglement_entropy(QVec qubits, double alpha)
+{
+    return spectrum_entropy(get_schmidt_spectrum(qubits), alpha);
+}
+
 prob_vec MPSQVM::PMeasure_no_index(QVec qubits)
 {
     return getProbList(qubits, -1);
@@ -0,0 +1,747 @@
+/*
+Copyright (c) 2017-2020 Origin Quantum Computing. All Right Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "QPandaConfig.h"
+#include "Core/VirtualQuantumProcessor/OutOfCoreImplQPU.h"
+#include "Core/Utilities/Tools/QPandaException.h"
+#include "Core/Utilities/Tools/Utils.h"
+#include <array>
+#include <cstdlib>
+#include <algorithm>
+#ifdef USE_OPENMP
+#include <omp.h>
+#endif
+#if defined(__linux__) || defined(__APPLE__)
+#define QPANDA_MMAP_CHUNKS
+#include <unistd.h>
+#include <sys/mman.h>
+#endif
+
+USING_QPANDA
+using namespace std;
+
+/* chunks hold at least the qubits of the widest gate kernel */
+const size_t kMinChunkQubits = 6;
+
+template <typename data_t>
+OutOfCoreImplQPU<data_t>::OutOfCoreImplQPU(const std::string& directory, size_t memory_budget)
+    : m_directory(directory), m_memory_budget(memory_budget)
+{
+    if (m_directory.empty())
+    {
+        const char* tmp_dir = std::getenv("TMPDIR");
+        m_directory = (nullptr != tmp_dir && *tmp_dir) ? tmp_dir : "/tmp";
+    }
+}
+
+template <typename data_t>
+OutOfCoreImplQPU<data_t>::~OutOfCoreImplQPU()
+{
+}
+
+template <typename data_t>
+QError OutOfCoreImplQPU<data_t>::initState(size_t head_rank, size_t rank_size, size_t qubit_num)
+{
+    if (m_is_init_state)
+    {
+        _load_init_state();
+    }
+    else
+    {
+        initState(qubit_num);
+    }
+
+    return qErrorNone;
+}
+
+template <typename data_t>
+QError OutOfCoreImplQPU<data_t>::initState(size_t qubit_num, const QStat &state)
+{
+    m_pending_gates.clear();
+    if (0 == state.size())
+    {
+        _create_chunks(qubit_num);
+        auto chunk = _map_chunk(0);
+        chunk[0] = { 1, 0 };
+        _unmap_chunk(0, chunk);
+        m_is_init_state = false;
+        m_init_state_file.reset();
+        return qErrorNone;
+    }
+
+    QPANDA_ASSERT(1ull << qubit_num != state.size(), "Error: initState size.");
+    auto file = create_unnamed_file(m_directory, "qpanda_state_");
+    QPANDA_ASSERT(!file, "Error: create initial state file in " + m_directory);
+
+    std::vector<amplitude_t> block(std::min<size_t>(1ull << 16, state.size()));
+    for (size_t begin = 0; begin < state.size(); begin += block.size())
+    {
+        size_t count = std::min(block.size(), state.size() - begin);
+        std::copy(state.begin() + begin, state.begin() + begin + count, block.begin());
+        QPANDA_ASSERT(fwrite(block.data(), sizeof(amplitude_t), count, file.get()) != count,
+            "Error: write initial state file.");
+    }
+    QPANDA_ASSERT(fflush(file.get()) != 0, "Error: write initial state file.");
+
+    m_qubit_num = qubit_num;
+    m_init_state_file = file;
+    m_is_init_state = true;
+    return qErrorNone;
+}
+
+template <typename data_t>
+void OutOfCoreImplQPU<data_t>::_load_init_state()
+{
+    _create_chunks(m_qubit_num);
+    size_t chunk_size = 1ull << m_chunk_qubits;
+    FILE* fp = m_init_state_file.get();
+    QPANDA_ASSERT(fseek(fp, 0, SEEK_SET) != 0, "Error: read initial state file.");
+    for (size_t i = 0; i < m_chunk_files.size(); i++)
+    {
+        auto chunk = _map_chunk(i);
+        bool is_read = fread(chunk, sizeof(amplitude_t), chunk_size, fp) == chunk_size;
+        _unmap_chunk(i, chunk);
+        QPANDA_ASSERT(!is_read, "Error: read initial state file.");
+    }
+}
+
+template <typename data_t>
+void OutOfCoreImplQPU<data_t>::_create_chunks(size_t qubit_num)
+{
+    m_pending_gates.clear();
+
+    /* the largest chunk two of which fit the budget */
+    size_t chunk_qubits = 0;
+    while ((sizeof(amplitude_t) << (chunk_qubits + 2)) <= m_memory_budget)
+    {
+        chunk_qubits++;
+    }
+    chunk_qubits = std::max(chunk_qubits, kMinChunkQubits);
+    chunk_qubits = std::min(chunk_qubits, qubit_num);
+    size_t chunk_num = 1ull << (qubit_num - chunk_qubits);
+
+    if (chunk_qubits != m_chunk_qubits || chunk_num != m_chunk_files.size())
+    {
+        m_chunk_files.clear();
+        m_chunk_qubits = chunk_qubits;
+        for (size_t i = 0; i < chunk_num; i++)
+        {
+            auto file = create_unnamed_file(m_directory, "qpanda_chunk_");
+            QPANDA_ASSERT(!file, "Error: create chunk file in " + m_directory);
+            m_chunk_files.push_back(file);
+        }
+    }
+
+    for (size_t i = 0; i < chunk_num; i++)
+    {
+        _clear_chunk(i);
+    }
+
+    m_qubit_num = qubit_num;
+    m_qubit_map.resize(qubit_num);
+    m_chunk_qubit_owner.resize(qubit_num);
+    for (size_t i = 0; i < qubit_num; i++)
+    {
+        m_qubit_map[i] = i;
+        m_chunk_qubit_owner[i] = i;
+    }
+    m_last_use.assign(qubit_num, 0);
+    m_use_count = 0;
+}
+
+template <typename data_t>
+void OutOfCoreImplQPU<data_t>::_clear_chunk(size_t chunk)
+{
+    size_t bytes = sizeof(amplitude_t) << m_chunk_qubits;
+#ifdef QPANDA_MMAP_CHUNKS
+    /* a truncated file reads as zeros without taking any block */
+    int fd = fileno(m_chunk_files[chunk].get());
+    QPANDA_ASSERT(ftruncate(fd, 0) != 0 || ftruncate(fd, bytes) != 0, "Error: clear chunk file.");
+#else
+    FILE* fp = m_chunk_files[chunk].get();
+    std::vector<amplitude_t> zeros(std::min<size_t>(1ull << 16, 1ull << m_chunk_qubits));
+    QPANDA_ASSERT(fseek(fp, 0, SEEK_SET) != 0, "Error: clear chunk file.");
+    for (size_t begin = 0; begin < (1ull << m_chunk_qubits); begin += zeros.size())
+    {
+        QPANDA_ASSERT(fwrite(zeros.data(), sizeof(amplitude_t), zeros.size(), fp) != zeros.size(),
+            "Error: clear chunk file.");
+    }
+#endif
+}
+
+template <typename data_t>
+typename OutOfCoreImplQPU<data_t>::amplitude_t* OutOfCoreImplQPU<data_t>::_map_chunk(size_t chunk)
+{
+    size_t size = 1ull << m_chunk_qubits;
+#ifdef QPANDA_MMAP_CHUNKS
+    void* data = mmap(nullptr, size * sizeof(amplitude_t), PROT_READ | PROT_WRITE,
+        MAP_SHARED, fileno(m_chunk_files[chunk].get()), 0);
+    QPANDA_ASSERT(MAP_FAILED == data, "Error: map chunk file.");
+    return static_cast<amplitude_t*>(data);
+#else
+    auto data = new amplitude_t[size];
+    FILE* fp = m_chunk_files[chunk].get();
+    QPANDA_ASSERT(fseek(fp, 0, SEEK_SET) != 0 || fread(data, sizeof(amplitude_t), size, fp) != size,
+        "Error: read chunk file.");
+    return data;
+#endif
+}
+
+template <typename data_t>
+void OutOfCoreImplQPU<data_t>::_unmap_chunk(size_t chunk, amplitude_t* data)
+{
+    size_t size = 1ull << m_chunk_qubits;
+#ifdef QPANDA_MMAP_CHUNKS
+    munmap(data, size * sizeof(amplitude_t));
+#else
+    FILE* fp = m_chunk_files[chunk].get();
+    bool is_written = fseek(fp, 0, SEEK_SET) == 0 && fwrite(data, sizeof(amplitude_t), size, fp) == size;
+    delete[] data;
+    QPANDA_ASSERT(!is_written, "Error: write chunk file.");
+#endif
+}
+
+template <typename data_t>
+void OutOfCoreImplQPU<data_t>::_apply_gate(const Qnum& qubits, const Qnum& controls, QStat matrix)
+{
+    if (qubits.empty())
+    {
+        return;
+    }
+
+    QPANDA_ASSERT(qubits.size() > m_chunk_qubits, "Error: gate qubits exceed the chunk qubits.");
+    for (auto qubit : qubits)
+    {
+        m_last_use[qubit] = ++m_use_count;
+        if (m_qubit_map[qubit] >= m_chunk_qubits)
+        {
+            _swap_qubits(_victim_qubit(qubits), m_qubit_map[qubit]);
+        }
+    }
+
+    Qnum targets;
+    for (auto qubit : qubits)
+    {
+        targets.push_back(m_qubit_map[qubit]);
+    }
+
+    Qnum chunk_controls;
+    int64_t chunk_mask = 0;
+    for (auto qubit : controls)
+    {
+        if (std::find(qubits.begin(), qubits.end(), qubit) != qubits.end())
+        {
+            continue;
+        }
+
+        if (m_qubit_map[qubit] < m_chunk_qubits)
+        {
+            chunk_controls.push_back(m_qubit_map[qubit]);
+        }
+        else
+        {
+            chunk_mask |= 1ll << (m_qubit_map[qubit] - m_chunk_qubits);
+        }
+    }
+
+    ControlSubspace subspace(chunk_controls, targets);
+    m_pending_gates.push_back({ std::move(targets), std::move(matrix), std::move(subspace), chunk_mask });
+}
+
+template <typename data_t>
+size_t OutOfCoreImplQPU<data_t>::_victim_qubit(const Qnum& qubits) const
+{
+    size_t victim = m_chunk_qubits;
+    for (size_t i = 0; i < m_chunk_qubits; i++)
+    {
+        size_t owner = m_chunk_qubit_owner[i];
+        if (std::find(qubits.begin(), qubits.end(), owner) != qubits.end())
+        {
+            continue;
+        }
+
+        if (victim == m_chunk_qubits || m_last_use[owner] < m_last_use[m_chunk_qubit_owner[victim]])
+        {
+            victim = i;
+        }
+    }
+    return victim;
+}
+
+/* swap a qubit inside the chunks with one above them, one pass over pairs of chunks */
+template <typename data_t>
+void OutOfCoreImplQPU<data_t>::_swap_qubits(size_t low_qubit, size_t high_qubit)
+{
+    _flush_gates();
+    size_t high_bit = 1ull << (high_qubit - m_chunk_qubits);
+    int64_t low_offset = 1ll << low_qubit;
+    ControlSubspace subspace({ low_qubit }, {});
+    int64_t size = subspace.size(m_chunk_qubits);
+    for (size_t i = 0; i < m_chunk_files.size(); i++)
+    {
+        if (i & high_bit)
+        {
+            continue;
+        }
+
+        /* |h=0, l=1> of the first chunk with |h=1, l=0> of the second */
+        auto chunk_0 = _map_chunk(i);
+        auto chunk_1 = _map_chunk(i | high_bit);
+#pragma omp parallel for num_threads(_omp_thread_num(size))
+        for (int64_t j = 0; j < size; j++)
+        {
+            int64_t index = subspace(j);
+            std::swap(chunk_0[index], chunk_1[index ^ low_offset]);
+        }
+        _unmap_chunk(i | high_bit, chunk_1);
+        _unmap_chunk(i, chunk_0);
+    }
+
+    std::swap(m_chunk_qubit_owner[low_qubit], m_chunk_qubit_owner[high_qubit]);
+    m_qubit_map[m_chunk_qubit_owner[low_qubit]] = low_qubit;
+    m_qubit_map[m_chunk_qubit_owner[high_qubit]] = high_qubit;
+}
+
+/* every queued gate is applied to a chunk while it is mapped */
+template <typename data_t>
+void OutOfCoreImplQPU<data_t>::_flush_gates()
+{
+    if (m_pending_gates.empty())
+    {
+        return;
+    }
+
+    for (size_t i = 0; i < m_chunk_files.size(); i++)
+    {
+        auto is_visited = [&](const ChunkGate& gate) {
+            return (int64_t(i) & gate.chunk_mask) == gate.chunk_mask;
+        };
+        if (std::none_of(m_pending_gates.begin(), m_pending_gates.end(), is_visited))
+        {
+            continue;
+        }
+
+        auto chunk = _map_chunk(i);
+        for (const auto& gate : m_pending_gates)
+        {
+            if (is_visited(gate))
+            {
+                _chunk_gate(chunk, gate);
+            }
+        }
+        _unmap_chunk(i, chunk);
+    }
+    m_pending_gates.clear();
+}
+
+template <typename data_t>
+void OutOfCoreImplQPU<data_t>::_chunk_gate(amplitude_t* chunk, const ChunkGate& gate)
+{
+    switch (gate.qubits.size())
+    {
+    case 1:
+        return _chunk_kernel<1>(chunk, gate);
+    case 2:
+        return _chunk_kernel<2>(chunk, gate);
+    case 3:
+        return _chunk_kernel<3>(chunk, gate);
+    case 4:
+        return _chunk_kernel<4>(chunk, gate);
+    case 5:
+        return _chunk_kernel<5>(chunk, gate);
+    case 6:
+        return _chunk_kernel<6>(chunk, gate);
+    default:
+        break;
+    }
+
+    /* wider oracles, with the amplitudes of an index on the heap */
+    size_t dim = 1ull << gate.qubits.size();
+    std::vector<int64_t> offsets(dim, 0);
+    for (size_t i_dim = 0; i_dim < dim; i_dim++)
+    {
+        for (size_t j = 0; j < gate.qubits.size(); j++)
+        {
+            if ((i_dim >> j) & 1ull)
+            {
+                offsets[i_dim] |= 1ll << gate.qubits[j];
+            }
+        }
+    }
+
+    int64_t size = gate.subspace.size(m_chunk_qubits);
+#pragma omp parallel num_threads(_omp_thread_num(size))
+    {
+        std::vector<qcomplex_t> phi(dim);
+#pragma omp for
+        for (int64_t i = 0; i < size; i++)
+        {
+            int64_t real00_idx = gate.subspace(i);
+            for (size_t i_dim = 0; i_dim < dim; i_dim++)
+            {
+                phi[i_dim] = chunk[real00_idx | offsets[i_dim]];
+            }
+
+            for (size_t row = 0; row < dim; row++)
+            {
+                qcomplex_t sum = 0;
+                const qcomplex_t *mat_row = gate.matrix.data() + row * dim;
+                for (size_t col = 0; col < dim; col++)
+                {
+                    sum += mat_row[col] * phi[col];
+                }
+                chunk[real00_idx | offsets[row]] = sum;
+            }
+        }
+    }
+}
+
+template <typename data_t>
+template <size_t K>
+void OutOfCoreImplQPU<data_t>::_chunk_kernel(amplitude_t* chunk, const ChunkGate& gate)
+{
+    const size_t dim = 1ull << K;
+    std::array<int64_t, dim> offsets;
+    for (size_t i_dim = 0; i_dim < dim; i_dim++)
+    {
+        offsets[i_dim] = 0;
+        for (size_t j = 0; j < K; j++)
+        {
+            if ((i_dim >> j) & 1ull)
+            {
+                offsets[i_dim] |= 1ll << gate.qubits[j];
+            }
+        }
+    }
+
+    const qcomplex_t *mat_data = gate.matrix.data();
+    int64_t size = gate.subspace.size(m_chunk_qubits);
+#pragma omp parallel for num_threads(_omp_thread_num(size))
+    for (int64_t i = 0; i < size; i++)
+    {
+        int64_t real00_idx = gate.subspace(i);
+        std::array<qcomplex_t, dim> phi;
+        for (size_t i_dim = 0; i_dim < dim; i_dim++)
+        {
+            phi[i_dim] = chunk[real00_idx | offsets[i_dim]];
+        }
+
+        for (size_t row = 0; row < dim; row++)
+        {
+            qcomplex_t sum = 0;
+            const qcomplex_t *mat_row = mat_data + row * dim;
+            for (size_t col = 0; col < dim; col++)
+            {
+                sum += mat_row[col] * phi[col];
+            }
+            chunk[real00_idx | offsets[row]] = sum;
+        }
+    }
+}
+
+template <typename data_t>
+QError OutOfCoreImplQPU<data_t>::unitarySingleQubitGate(size_t qn, QStat& matrix,
+    bool is_dagger, GateType type)
+{
+    Qnum qubits = { qn };
+    Qnum controls;
+    QStat gate_matrix;
+    gate_target_operator(type, false, matrix, is_dagger, qubits, controls, gate_matrix);
+    _apply_gate(qubits, controls, std::move(gate_matrix));
+    return qErrorNone;
+}
+
+template <typename data_t>
+QError OutOfCoreImplQPU<data_t>::controlunitarySingleQubitGate(size_t qn, Qnum& control_qubits,
+    QStat& matrix, bool is_dagger, GateType type)
+{
+    Qnum qubits = { qn };
+    Qnum controls = control_qubits;
+    QStat gate_matrix;
+    gate_target_operator(type, true, matrix, is_dagger, qubits, controls, gate_matrix);
+    _apply_gate(qubits, controls, std::move(gate_matrix));
+    return qErrorNone;
+}
+
+template <typename data_t>
+QError OutOfCoreImplQPU<data_t>::unitaryDoubleQubitGate(size_t qn_0, size_t qn_1,
+    QStat& matrix, bool is_dagger, GateType type)
+{
+    Qnum qubits = { qn_0, qn_1 };
+    Qnum controls;
+    QStat gate_matrix;
+    gate_target_operator(type, false, matrix, is_dagger, qubits, controls, gate_matrix);
+    _apply_gate(qubits, controls, std::move(gate_matrix));
+    return qErrorNone;
+}
+
+template <typename data_t>
+QError OutOfCoreImplQPU<data_t>::controlunitaryDoubleQubitGate(size_t qn_0, size_t qn_1,
+    Qnum& control_qubits, QStat& matrix, bool is_dagger, GateType type)
+{
+    Qnum qubits = { qn_0, qn_1 };
+    Qnum controls = control_qubits;
+    QStat gate_matrix;
+    gate_target_operator(type, true, matrix, is_dagger, qubits, controls, gate_matrix);
+    _apply_gate(qubits, controls, std::move(gate_matrix));
+    return qErrorNone;
+}
+
+template <typename data_t>
+QError OutOfCoreImplQPU<data_t>::OracleGate(Qnum& qubits, QStat &matrix, bool is_dagger)
+{
+    return controlOracleGate(qubits, {}, matrix, is_dagger);
+}
+
+template <typename data_t>
+QError OutOfCoreImplQPU<data_t>::controlOracleGate(Qnum& qubits, const Qnum& controls,
+    QStat &matrix, bool is_dagger)
+{
+    size_t dim = 1ull << qubits.size();
+    QPANDA_ASSERT(matrix.size() != dim * dim, "Error: oracle matrix size.");
+    QStat gate_matrix = matrix;
+    if (is_dagger)
+    {
+        for (size_t row = 0; row < dim; row++)
+        {
+            for (size_t col = 0; col < dim; col++)
+            {
+                gate_matrix[row * dim + col] = std::conj(matrix[col * dim + row]);
+            }
+        }
+    }
+
+    _apply_gate(qubits, controls, std::move(gate_matrix));
+    return qErrorNone;
+}
+
+template <typename data_t>
+QError OutOfCoreImplQPU<data_t>::process_noise(Qnum& qnum, QStat& matrix)
+{
+    if (qnum.size() > 2)
+    {
+        QCERR_AND_THROW(std::invalid_argument, "Qnum for noise above 2");
+    }
+
+    _apply_gate(qnum, {}, matrix);
+    return qErrorNone;
+}
+
+template <typename data_t>
+double OutOfCoreImplQPU<data_t>::_zero_probability(size_t qubit)
+{
+    int64_t size = 1ll << m_chunk_qubits;
+    double probability = 0;
+    for (size_t i = 0; i < m_chunk_files.size(); i++)
+    {
+        if (qubit >= m_chunk_qubits && ((i >> (qubit - m_chunk_qubits)) & 1ull))
+        {
+            continue;
+        }
+
+        auto chunk = _map_chunk(i);
+        double chunk_probability = 0;
+        if (qubit >= m_chunk_qubits)
+        {
+#pragma omp parallel for num_threads(_omp_thread_num(size)) reduction(+:chunk_probability)
+            for (int64_t j = 0; j < size; j++)
+            {
+                chunk_probability += std::norm(chunk[j]);
+            }
+        }
+        else
+        {
+            ControlSubspace subspace({}, { qubit });
+            int64_t half_size = subspace.size(m_chunk_qubits);
+#pragma omp parallel for num_threads(_omp_thread_num(half_size)) reduction(+:chunk_probability)
+            for (int64_t j = 0; j < half_size; j++)
+            {
+                chunk_probability += std::norm(chunk[subspace(j)]);
+            }
+        }
+        _unmap_chunk(i, chunk);
+        probability += chunk_probability;
+    }
+    return probability;
+}
+
+template <typename data_t>
+bool OutOfCoreImplQPU<data_t>::qubitMeasure(size_t qn)
+{
+    _flush_gates();
+    size_t qubit = m_qubit_map[qn];
+    double dprob = _zero_probability(qubit);
+    bool measure_out = get_random_double() > dprob;
+    double scale = 1 / sqrt(measure_out ? 1 - dprob : dprob);
+
+    int64_t size = 1ll << m_chunk_qubits;
+    for (size_t i = 0; i < m_chunk_files.size(); i++)
+    {
+        if (qubit >= m_chunk_qubits && ((i >> (qubit - m_chunk_qubits)) & 1ull) != measure_out)
+        {
+            _clear_chunk(i);
+            continue;
+        }
+
+        auto chunk = _map_chunk(i);
+        if (qubit >= m_chunk_qubits)
+        {
+#pragma omp parallel for num_threads(_omp_thread_num(size))
+            for (int64_t j = 0; j < size; j++)
+            {
+                chunk[j] *= scale;
+            }
+        }
+        else
+        {
+            int64_t offset = 1ll << qubit;
+            int64_t kept = measure_out ? offset : 0;
+            ControlSubspace subspace({}, { qubit });
+            int64_t half_size = subspace.size(m_chunk_qubits);
+#pragma omp parallel for num_threads(_omp_thread_num(half_size))
+            for (int64_t j = 0; j < half_size; j++)
+            {
+                int64_t real00_idx = subspace(j);
+                chunk[real00_idx | kept] *= scale;
+                chunk[(real00_idx | offset) ^ kept] = 0;
+            }
+        }
+        _unmap_chunk(i, chunk);
+    }
+    return measure_out;
+}
+
+template <typename data_t>
+QError OutOfCoreImplQPU<data_t>::pMeasure(Qnum& qnum, prob_vec &probs)
+{
+    _flush_gates();
+    probs.assign(1ull << qnum.size(), 0);
+
+    Qnum chunk_qubits;
+    Qnum chunk_bits;
+    for (size_t j = 0; j < qnum.size(); j++)
+    {
+        if (m_qubit_map[qnum[j]] < m_chunk_qubits)
+        {
+            chunk_qubits.push_back(m_qubit_map[qnum[j]]);
+            chunk_bits.push_back(j);
+        }
+    }
+
+    int64_t size = 1ll << m_chunk_qubits;
+    for (size_t i = 0; i < m_chunk_files.size(); i++)
+    {
+        /* the bits of the qubits above the chunk are the same in the whole chunk */
+        size_t base = 0;
+        for (size_t j = 0; j < qnum.size(); j++)
+        {
+            size_t qubit = m_qubit_map[qnum[j]];
+            if (qubit >= m_chunk_qubits)
+            {
+                base |= ((i >> (qubit - m_chunk_qubits)) & 1ull) << j;
+            }
+        }
+
+        auto chunk = _map_chunk(i);
+#pragma omp parallel num_threads(_omp_thread_num(size))
+        {
+            prob_vec local_probs(probs.size(), 0);
+#pragma omp for
+            for (int64_t j = 0; j < size; j++)
+            {
+                size_t index = base;
+                for (size_t k = 0; k < chunk_qubits.size(); k++)
+                {
+                    index |= ((j >> chunk_qubits[k]) & 1ll) << chunk_bits[k];
+                }
+                local_probs[index] += std::norm(chunk[j]);
+            }
+#pragma omp critical
+            for (size_t k = 0; k < probs.size(); k++)
+            {
+                probs[k] += local_probs[k];
+            }
+        }
+        _unmap_chunk(i, chunk);
+    }
+    return qErrorNone;
+}
+
+template <typename data_t>
+QStat OutOfCoreImplQPU<data_t>::getQState()
+{
+    _flush_gates();
+    QStat state(1ull << m_qubit_num);
+    int64_t size = 1ll << m_chunk_qubits;
+    for (size_t i = 0; i < m_chunk_files.size(); i++)
+    {
+        auto chunk = _map_chunk(i);
+#pragma omp parallel for num_threads(_omp_thread_num(size))
+        for (int64_t j = 0; j < size; j++)
+        {
+            int64_t chunk_index = (int64_t(i) << m_chunk_qubits) | j;
+            int64_t index = 0;
+            for (size_t k = 0; k < m_qubit_num; k++)
+            {
+                index |= ((chunk_index >> m_qubit_map[k]) & 1ll) << k;
+            }
+            state[index] = chunk[j];
+        }
+        _unmap_chunk(i, chunk);
+    }
+    return state;
+}
+
+template <typename data_t>
+QError OutOfCoreImplQPU<data_t>::Reset(size_t qn)
+{
+    if (qubitMeasure(qn))
+    {
+        _apply_gate({ qn }, {}, { 0, 1, 1, 0 });
+    }
+    return qErrorNone;
+}
+
+template <typename data_t>
+QError OutOfCoreImplQPU<data_t>::debug(std::shared_ptr<QPanda::AbstractQDebugNode> debugger)
+{
+    /* the debugger keeps a reference, so it gets a copy of the state */
+    m_debug_state = getQState();
+    debugger->save_qstate(m_debug_state);
+    return QError::qErrorNone;
+}
+
+template <typename data_t>
+void OutOfCoreImplQPU<data_t>::set_parallel_threads_size(size_t size)
+{
+    m_max_threads_size = size;
+}
+
+template <typename data_t>
+int OutOfCoreImplQPU<data_t>::_omp_thread_num(size_t size) const
+{
+    if (size > m_threshold)
+    {
+#ifdef USE_OPENMP
+        return m_max_threads_size > 0 ? m_max_threads_size : omp_get_max_threads();
+#else
+        return 1;
+#endif
+    }
+    return 1;
+}
+
+template class QPanda::OutOfCoreImplQPU<double>;
+template class QPanda::OutOfCoreImplQPU<float>;
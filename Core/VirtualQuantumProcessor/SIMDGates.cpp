@@ -0,0 +1,562 @@
+/*
+Copyright (c) 2017-2020 Origin Quantum Computing. All Right Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "QPandaConfig.h"
+#include "Core/VirtualQuantumProcessor/SIMDGates.h"
+#include "Core/QuantumCircuit/QGlobalVariable.h"
+#include <atomic>
+#include <algorithm>
+#ifdef USE_OPENMP
+#include <omp.h>
+#endif
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#if defined(__GNUC__) || defined(__clang__)
+#define QPANDA_SIMD_X86
+#define QPANDA_TARGET_AVX2 __attribute__((target("avx2")))
+#define QPANDA_TARGET_AVX512 __attribute__((target("avx512f")))
+#include <immintrin.h>
+#elif defined(_MSC_VER)
+#define QPANDA_SIMD_X86
+#define QPANDA_TARGET_AVX2
+#define QPANDA_TARGET_AVX512
+#include <immintrin.h>
+#include <intrin.h>
+#endif
+#endif
+
+USING_QPANDA
+using namespace std;
+
+static SIMDLevel _detect_simd_level()
+{
+#if defined(QPANDA_SIMD_X86) && (defined(__GNUC__) || defined(__clang__))
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f"))
+    {
+        return SIMDLevel::AVX512;
+    }
+    if (__builtin_cpu_supports("avx2"))
+    {
+        return SIMDLevel::AVX2;
+    }
+#elif defined(QPANDA_SIMD_X86) && defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 1);
+    bool os_xsave = (info[2] & (1 << 27)) != 0;
+    bool cpu_avx = (info[2] & (1 << 28)) != 0;
+    if (!os_xsave || !cpu_avx)
+    {
+        return SIMDLevel::SCALAR;
+    }
+
+    auto xcr0 = _xgetbv(0);
+    __cpuidex(info, 7, 0);
+    if ((info[1] & (1 << 16)) && (xcr0 & 0xe6) == 0xe6)
+    {
+        return SIMDLevel::AVX512;
+    }
+    if ((info[1] & (1 << 5)) && (xcr0 & 0x6) == 0x6)
+    {
+        return SIMDLevel::AVX2;
+    }
+#endif
+    return SIMDLevel::SCALAR;
+}
+
+static std::atomic<int>& _simd_level()
+{
+    static std::atomic<int> level((int)detected_simd_level());
+    return level;
+}
+
+SIMDLevel QPanda::detected_simd_level()
+{
+    static const SIMDLevel level = _detect_simd_level();
+    return level;
+}
+
+SIMDLevel QPanda::get_simd_level()
+{
+    return (SIMDLevel)_simd_level().load(std::memory_order_relaxed);
+}
+
+void QPanda::set_simd_level(SIMDLevel level)
+{
+    if ((int)level > (int)detected_simd_level())
+    {
+        level = detected_simd_level();
+    }
+    _simd_level().store((int)level, std::memory_order_relaxed);
+}
+
+static inline int64_t _insert_zero(int64_t value, size_t qn)
+{
+    int64_t mask = (1ll << qn) - 1;
+    return ((value & ~mask) << 1) | (value & mask);
+}
+
+/* insert zeros at bit low and bit high, low < high */
+static inline int64_t _insert_zero(int64_t value, size_t low, size_t high)
+{
+    return _insert_zero(_insert_zero(value, low), high);
+}
+
+#ifdef QPANDA_SIMD_X86
+
+/*
+  complex numbers are stored as [re, im] pairs, a 256 bits register holds
+  2 amplitudes and a 512 bits register holds 4 amplitudes.
+  m * v is computed as [mr*vr - mi*vi, mr*vi + mi*vr] with separate multiply
+  and add, which is the rounding of std::complex<double> multiplication.
+*/
+struct Complex256
+{
+    __m256d re;
+    __m256d im;
+};
+
+QPANDA_TARGET_AVX2
+static inline Complex256 _broadcast256(const qcomplex_t& value)
+{
+    return { _mm256_set1_pd(value.real()), _mm256_set1_pd(value.imag()) };
+}
+
+/* lane 0 holds value_0, lane 1 holds value_1 */
+QPANDA_TARGET_AVX2
+static inline Complex256 _broadcast256(const qcomplex_t& value_0, const qcomplex_t& value_1)
+{
+    return { _mm256_setr_pd(value_0.real(), value_0.real(), value_1.real(), value_1.real()),
+        _mm256_setr_pd(value_0.imag(), value_0.imag(), value_1.imag(), value_1.imag()) };
+}
+
+QPANDA_TARGET_AVX2
+static inline __m256d _cmul256(const Complex256& m, __m256d v)
+{
+    __m256d t1 = _mm256_mul_pd(m.re, v);
+    __m256d t2 = _mm256_mul_pd(m.im, _mm256_permute_pd(v, 0x5));
+    return _mm256_addsub_pd(t1, t2);
+}
+
+QPANDA_TARGET_AVX2
+static inline __m256d _load256(const qcomplex_t* ptr)
+{
+    return _mm256_loadu_pd(reinterpret_cast<const double*>(ptr));
+}
+
+QPANDA_TARGET_AVX2
+static inline void _store256(qcomplex_t* ptr, __m256d value)
+{
+    _mm256_storeu_pd(reinterpret_cast<double*>(ptr), value);
+}
+
+struct Complex512
+{
+    __m512d re;
+    __m512d im;
+};
+
+QPANDA_TARGET_AVX512
+static inline Complex512 _broadcast512(const qcomplex_t& value)
+{
+    return { _mm512_set1_pd(value.real()), _mm512_set1_pd(value.imag()) };
+}
+
+QPANDA_TARGET_AVX512
+static inline __m512d _cmul512(const Complex512& m, __m512d v)
+{
+    __m512d t1 = _mm512_mul_pd(m.re, v);
+    __m512d t2 = _mm512_mul_pd(m.im, _mm512_permute_pd(v, 0x55));
+    /* even lanes t1 - t2, odd lanes t1 + t2 */
+    return _mm512_mask_sub_pd(_mm512_add_pd(t1, t2), 0x55, t1, t2);
+}
+
+QPANDA_TARGET_AVX512
+static inline __m512d _load512(const qcomplex_t* ptr)
+{
+    return _mm512_loadu_pd(reinterpret_cast<const double*>(ptr));
+}
+
+QPANDA_TARGET_AVX512
+static inline void _store512(qcomplex_t* ptr, __m512d value)
+{
+    _mm512_storeu_pd(reinterpret_cast<double*>(ptr), value);
+}
+
+/* qn >= 1: amplitude pairs at idx and idx + 1 share the same role */
+QPANDA_TARGET_AVX2
+static void _single_qubit_avx2(qcomplex_t* state, size_t qubit_num, size_t qn,
+    const qcomplex_t* matrix, int threads)
+{
+    int64_t size = 1ll << (qubit_num - 1);
+    int64_t offset = 1ll << qn;
+    auto m0 = _broadcast256(matrix[0]);
+    auto m1 = _broadcast256(matrix[1]);
+    auto m2 = _broadcast256(matrix[2]);
+    auto m3 = _broadcast256(matrix[3]);
+
+#pragma omp parallel for num_threads(threads) if(threads > 1)
+    for (int64_t i = 0; i < size; i += 2)
+    {
+        int64_t real00_idx = _insert_zero(i, qn);
+        auto alpha = _load256(state + real00_idx);
+        auto beta = _load256(state + (real00_idx | offset));
+        _store256(state + real00_idx, _mm256_add_pd(_cmul256(m0, alpha), _cmul256(m1, beta)));
+        _store256(state + (real00_idx | offset), _mm256_add_pd(_cmul256(m2, alpha), _cmul256(m3, beta)));
+    }
+}
+
+/* qn == 0: one register holds [alpha, beta] */
+QPANDA_TARGET_AVX2
+static void _single_qubit_q0_avx2(qcomplex_t* state, size_t qubit_num,
+    const qcomplex_t* matrix, int threads)
+{
+    int64_t size = 1ll << qubit_num;
+    auto col0 = _broadcast256(matrix[0], matrix[2]);
+    auto col1 = _broadcast256(matrix[1], matrix[3]);
+
+#pragma omp parallel for num_threads(threads) if(threads > 1)
+    for (int64_t i = 0; i < size; i += 2)
+    {
+        auto value = _load256(state + i);
+        auto alpha = _mm256_permute2f128_pd(value, value, 0x00);
+        auto beta = _mm256_permute2f128_pd(value, value, 0x11);
+        _store256(state + i, _mm256_add_pd(_cmul256(col0, alpha), _cmul256(col1, beta)));
+    }
+}
+
+QPANDA_TARGET_AVX512
+static void _single_qubit_avx512(qcomplex_t* state, size_t qubit_num, size_t qn,
+    const qcomplex_t* matrix, int threads)
+{
+    int64_t size = 1ll << (qubit_num - 1);
+    int64_t offset = 1ll << qn;
+    auto m0 = _broadcast512(matrix[0]);
+    auto m1 = _broadcast512(matrix[1]);
+    auto m2 = _broadcast512(matrix[2]);
+    auto m3 = _broadcast512(matrix[3]);
+
+#pragma omp parallel for num_threads(threads) if(threads > 1)
+    for (int64_t i = 0; i < size; i += 4)
+    {
+        int64_t real00_idx = _insert_zero(i, qn);
+        auto alpha = _load512(state + real00_idx);
+        auto beta = _load512(state + (real00_idx | offset));
+        _store512(state + real00_idx, _mm512_add_pd(_cmul512(m0, alpha), _cmul512(m1, beta)));
+        _store512(state + (real00_idx | offset), _mm512_add_pd(_cmul512(m2, alpha), _cmul512(m3, beta)));
+    }
+}
+
+QPANDA_TARGET_AVX2
+static void _control_single_qubit_avx2(qcomplex_t* state, size_t qubit_num,
+    size_t control, size_t target, const qcomplex_t* matrix, int threads)
+{
+    int64_t size = 1ll << (qubit_num - 2);
+    int64_t offset0 = 1ll << control;
+    int64_t offset1 = 1ll << target;
+    size_t low = std::min(control, target);
+    size_t high = std::max(control, target);
+    auto m0 = _broadcast256(matrix[0]);
+    auto m1 = _broadcast256(matrix[1]);
+    auto m2 = _broadcast256(matrix[2]);
+    auto m3 = _broadcast256(matrix[3]);
+
+#pragma omp parallel for num_threads(threads) if(threads > 1)
+    for (int64_t i = 0; i < size; i += 2)
+    {
+        int64_t real10_idx = _insert_zero(i, low, high) | offset0;
+        auto phi10 = _load256(state + real10_idx);
+        auto phi11 = _load256(state + (real10_idx | offset1));
+        _store256(state + real10_idx, _mm256_add_pd(_cmul256(m0, phi10), _cmul256(m1, phi11)));
+        _store256(state + (real10_idx | offset1), _mm256_add_pd(_cmul256(m2, phi10), _cmul256(m3, phi11)));
+    }
+}
+
+QPANDA_TARGET_AVX512
+static void _control_single_qubit_avx512(qcomplex_t* state, size_t qubit_num,
+    size_t control, size_t target, const qcomplex_t* matrix, int threads)
+{
+    int64_t size = 1ll << (qubit_num - 2);
+    int64_t offset0 = 1ll << control;
+    int64_t offset1 = 1ll << target;
+    size_t low = std::min(control, target);
+    size_t high = std::max(control, target);
+    auto m0 = _broadcast512(matrix[0]);
+    auto m1 = _broadcast512(matrix[1]);
+    auto m2 = _broadcast512(matrix[2]);
+    auto m3 = _broadcast512(matrix[3]);
+
+#pragma omp parallel for num_threads(threads) if(threads > 1)
+    for (int64_t i = 0; i < size; i += 4)
+    {
+        int64_t real10_idx = _insert_zero(i, low, high) | offset0;
+        auto phi10 = _load512(state + real10_idx);
+        auto phi11 = _load512(state + (real10_idx | offset1));
+        _store512(state + real10_idx, _mm512_add_pd(_cmul512(m0, phi10), _cmul512(m1, phi11)));
+        _store512(state + (real10_idx | offset1), _mm512_add_pd(_cmul512(m2, phi10), _cmul512(m3, phi11)));
+    }
+}
+
+QPANDA_TARGET_AVX2
+static void _double_qubit_avx2(qcomplex_t* state, size_t qubit_num,
+    size_t qn_0, size_t qn_1, const qcomplex_t* matrix, int threads)
+{
+    int64_t size = 1ll << (qubit_num - 2);
+    int64_t offset0 = 1ll << qn_0;
+    int64_t offset1 = 1ll << qn_1;
+    size_t low = std::min(qn_0, qn_1);
+    size_t high = std::max(qn_0, qn_1);
+    Complex256 m[16];
+    for (int k = 0; k < 16; k++)
+    {
+        m[k] = _broadcast256(matrix[k]);
+    }
+
+#pragma omp parallel for num_threads(threads) if(threads > 1)
+    for (int64_t i = 0; i < size; i += 2)
+    {
+        int64_t real00_idx = _insert_zero(i, low, high);
+        qcomplex_t* ptr[4] = { state + real00_idx, state + (real00_idx | offset0),
+            state + (real00_idx | offset1), state + (real00_idx | offset0 | offset1) };
+        __m256d phi[4] = { _load256(ptr[0]), _load256(ptr[1]), _load256(ptr[2]), _load256(ptr[3]) };
+
+        for (int row = 0; row < 4; row++)
+        {
+            auto value = _cmul256(m[4 * row], phi[0]);
+            value = _mm256_add_pd(value, _cmul256(m[4 * row + 1], phi[1]));
+            value = _mm256_add_pd(value, _cmul256(m[4 * row + 2], phi[2]));
+            value = _mm256_add_pd(value, _cmul256(m[4 * row + 3], phi[3]));
+            _store256(ptr[row], value);
+        }
+    }
+}
+
+QPANDA_TARGET_AVX512
+static void _double_qubit_avx512(qcomplex_t* state, size_t qubit_num,
+    size_t qn_0, size_t qn_1, const qcomplex_t* matrix, int threads)
+{
+    int64_t size = 1ll << (qubit_num - 2);
+    int64_t offset0 = 1ll << qn_0;
+    int64_t offset1 = 1ll << qn_1;
+    size_t low = std::min(qn_0, qn_1);
+    size_t high = std::max(qn_0, qn_1);
+    Complex512 m[16];
+    for (int k = 0; k < 16; k++)
+    {
+        m[k] = _broadcast512(matrix[k]);
+    }
+
+#pragma omp parallel for num_threads(threads) if(threads > 1)
+    for (int64_t i = 0; i < size; i += 4)
+    {
+        int64_t real00_idx = _insert_zero(i, low, high);
+        qcomplex_t* ptr[4] = { state + real00_idx, state + (real00_idx | offset0),
+            state + (real00_idx | offset1), state + (real00_idx | offset0 | offset1) };
+        __m512d phi[4] = { _load512(ptr[0]), _load512(ptr[1]), _load512(ptr[2]), _load512(ptr[3]) };
+
+        for (int row = 0; row < 4; row++)
+        {
+            auto value = _cmul512(m[4 * row], phi[0]);
+            value = _mm512_add_pd(value, _cmul512(m[4 * row + 1], phi[1]));
+            value = _mm512_add_pd(value, _cmul512(m[4 * row + 2], phi[2]));
+            value = _mm512_add_pd(value, _cmul512(m[4 * row + 3], phi[3]));
+            _store512(ptr[row], value);
+        }
+    }
+}
+
+QPANDA_TARGET_AVX2
+static void _pauli_x_avx2(qcomplex_t* state, size_t qubit_num, size_t qn, int threads)
+{
+    if (0 == qn)
+    {
+        int64_t size = 1ll << qubit_num;
+#pragma omp parallel for num_threads(threads) if(threads > 1)
+        for (int64_t i = 0; i < size; i += 2)
+        {
+            auto value = _load256(state + i);
+            _store256(state + i, _mm256_permute2f128_pd(value, value, 0x01));
+        }
+        return;
+    }
+
+    int64_t size = 1ll << (qubit_num - 1);
+    int64_t offset = 1ll << qn;
+#pragma omp parallel for num_threads(threads) if(threads > 1)
+    for (int64_t i = 0; i < size; i += 2)
+    {
+        int64_t real00_idx = _insert_zero(i, qn);
+        auto alpha = _load256(state + real00_idx);
+        auto beta = _load256(state + (real00_idx | offset));
+        _store256(state + real00_idx, beta);
+        _store256(state + (real00_idx | offset), alpha);
+    }
+}
+
+QPANDA_TARGET_AVX2
+static void _hadamard_avx2(qcomplex_t* state, size_t qubit_num, size_t qn, int threads)
+{
+    auto sq2 = _mm256_set1_pd(SQ2);
+    if (0 == qn)
+    {
+        int64_t size = 1ll << qubit_num;
+#pragma omp parallel for num_threads(threads) if(threads > 1)
+        for (int64_t i = 0; i < size; i += 2)
+        {
+            auto value = _load256(state + i);
+            auto alpha = _mm256_permute2f128_pd(value, value, 0x00);
+            auto beta = _mm256_permute2f128_pd(value, value, 0x11);
+            auto result = _mm256_blend_pd(_mm256_add_pd(alpha, beta), _mm256_sub_pd(alpha, beta), 0xc);
+            _store256(state + i, _mm256_mul_pd(result, sq2));
+        }
+        return;
+    }
+
+    int64_t size = 1ll << (qubit_num - 1);
+    int64_t offset = 1ll << qn;
+#pragma omp parallel for num_threads(threads) if(threads > 1)
+    for (int64_t i = 0; i < size; i += 2)
+    {
+        int64_t real00_idx = _insert_zero(i, qn);
+        auto alpha = _load256(state + real00_idx);
+        auto beta = _load256(state + (real00_idx | offset));
+        _store256(state + real00_idx, _mm256_mul_pd(_mm256_add_pd(alpha, beta), sq2));
+        _store256(state + (real00_idx | offset), _mm256_mul_pd(_mm256_sub_pd(alpha, beta), sq2));
+    }
+}
+
+QPANDA_TARGET_AVX2
+static void _cnot_avx2(qcomplex_t* state, size_t qubit_num, size_t control, size_t target, int threads)
+{
+    int64_t size = 1ll << (qubit_num - 2);
+    int64_t offset0 = 1ll << control;
+    int64_t offset1 = 1ll << target;
+    size_t low = std::min(control, target);
+    size_t high = std::max(control, target);
+
+#pragma omp parallel for num_threads(threads) if(threads > 1)
+    for (int64_t i = 0; i < size; i += 2)
+    {
+        int64_t real10_idx = _insert_zero(i, low, high) | offset0;
+        auto phi10 = _load256(state + real10_idx);
+        auto phi11 = _load256(state + (real10_idx | offset1));
+        _store256(state + real10_idx, phi11);
+        _store256(state + (real10_idx | offset1), phi10);
+    }
+}
+
+#endif // QPANDA_SIMD_X86
+
+bool QPanda::simd_single_qubit_unitary(qcomplex_t* state, size_t qubit_num,
+    size_t qn, const qcomplex_t* matrix, int threads)
+{
+#ifdef QPANDA_SIMD_X86
+    auto level = get_simd_level();
+    if (level == SIMDLevel::AVX512 && qn >= 2)
+    {
+        _single_qubit_avx512(state, qubit_num, qn, matrix, threads);
+        return true;
+    }
+    if (level >= SIMDLevel::AVX2)
+    {
+        if (0 == qn)
+        {
+            _single_qubit_q0_avx2(state, qubit_num, matrix, threads);
+        }
+        else
+        {
+            _single_qubit_avx2(state, qubit_num, qn, matrix, threads);
+        }
+        return true;
+    }
+#endif
+    return false;
+}
+
+bool QPanda::simd_control_single_qubit_unitary(qcomplex_t* state, size_t qubit_num,
+    size_t control, size_t target, const qcomplex_t* matrix, int threads)
+{
+#ifdef QPANDA_SIMD_X86
+    auto level = get_simd_level();
+    size_t low = std::min(control, target);
+    if (level == SIMDLevel::AVX512 && low >= 2)
+    {
+        _control_single_qubit_avx512(state, qubit_num, control, target, matrix, threads);
+        return true;
+    }
+    if (level >= SIMDLevel::AVX2 && low >= 1)
+    {
+        _control_single_qubit_avx2(state, qubit_num, control, target, matrix, threads);
+        return true;
+    }
+#endif
+    return false;
+}
+
+bool QPanda::simd_double_qubit_unitary(qcomplex_t* state, size_t qubit_num,
+    size_t qn_0, size_t qn_1, const qcomplex_t* matrix, int threads)
+{
+#ifdef QPANDA_SIMD_X86
+    auto level = get_simd_level();
+    size_t low = std::min(qn_0, qn_1);
+    if (level == SIMDLevel::AVX512 && low >= 2)
+    {
+        _double_qubit_avx512(state, qubit_num, qn_0, qn_1, matrix, threads);
+        return true;
+    }
+    if (level >= SIMDLevel::AVX2 && low >= 1)
+    {
+        _double_qubit_avx2(state, qubit_num, qn_0, qn_1, matrix, threads);
+        return true;
+    }
+#endif
+    return false;
+}
+
+bool QPanda::simd_pauli_x(qcomplex_t* state, size_t qubit_num, size_t qn, int threads)
+{
+#ifdef QPANDA_SIMD_X86
+    if (get_simd_level() >= SIMDLevel::AVX2)
+    {
+        _pauli_x_avx2(state, qubit_num, qn, threads);
+        return true;
+    }
+#endif
+    return false;
+}
+
+bool QPanda::simd_hadamard(qcomplex_t* state, size_t qubit_num, size_t qn, int threads)
+{
+#ifdef QPANDA_SIMD_X86
+    if (get_simd_level() >= SIMDLevel::AVX2)
+    {
+        _hadamard_avx2(state, qubit_num, qn, threads);
+        return true;
+    }
+#endif
+    return false;
+}
+
+bool QPanda::simd_cnot(qcomplex_t* state, size_t qubit_num, size_t control, size_t target, int threads)
+{
+#ifdef QPANDA_SIMD_X86
+    if (get_simd_level() >= SIMDLevel::AVX2 && std::min(control, target) >= 1)
+    {
+        _cnot_avx2(state, qubit_num, control, target, threads);
+        return true;
+    }
+#endif
+    return false;
+}
@@ -0,0 +1,481 @@
+/*
+Copyright (c) 2017-2020 Origin Quantum Computing. All Right Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "QPandaConfig.h"
+#include "Core/VirtualQuantumProcessor/SparseImplQPU.h"
+#include "Core/VirtualQuantumProcessor/CPUImplQPU.h"
+#include "Core/Utilities/Tools/QPandaException.h"
+#include <limits>
+#include <algorithm>
+
+USING_QPANDA
+using namespace std;
+
+/* amplitudes below the rounding error of a normalized state are dropped */
+template <typename data_t>
+static inline bool is_zero_amplitude(const std::complex<data_t>& amplitude)
+{
+    const double epsilon = std::numeric_limits<data_t>::epsilon();
+    return std::norm(amplitude) <= epsilon * epsilon;
+}
+
+template <typename data_t>
+SparseImplQPU<data_t>::SparseImplQPU(double dense_fill_ratio)
+    : m_dense_fill_ratio(dense_fill_ratio)
+{
+}
+
+template <typename data_t>
+SparseImplQPU<data_t>::~SparseImplQPU()
+{
+}
+
+template <typename data_t>
+size_t SparseImplQPU<data_t>::get_amplitude_num() const
+{
+    return m_dense ? 1ull << m_qubit_num : m_state.size();
+}
+
+template <typename data_t>
+QError SparseImplQPU<data_t>::initState(size_t head_rank, size_t rank_size, size_t qubit_num)
+{
+    m_dense.reset();
+    if (m_is_init_state)
+    {
+        m_state = m_init_state;
+    }
+    else
+    {
+        m_qubit_num = qubit_num;
+        m_state.clear();
+        m_state.emplace(0, 1);
+    }
+
+    _check_fill();
+    return qErrorNone;
+}
+
+template <typename data_t>
+QError SparseImplQPU<data_t>::initState(size_t qubit_num, const QStat &state)
+{
+    m_init_state.clear();
+    if (0 == state.size())
+    {
+        m_is_init_state = false;
+        return initState(0, 1, qubit_num);
+    }
+
+    QPANDA_ASSERT(1ull << qubit_num != state.size(), "Error: initState size.");
+    for (size_t i = 0; i < state.size(); i++)
+    {
+        amplitude_t amplitude(state[i]);
+        if (!is_zero_amplitude(amplitude))
+        {
+            m_init_state.emplace(i, amplitude);
+        }
+    }
+
+    m_qubit_num = qubit_num;
+    m_is_init_state = true;
+    return qErrorNone;
+}
+
+template <typename data_t>
+void SparseImplQPU<data_t>::_check_fill()
+{
+    if (!m_dense && m_qubit_num < 64
+        && m_state.size() > m_dense_fill_ratio * double(1ull << m_qubit_num))
+    {
+        _to_dense();
+    }
+}
+
+template <typename data_t>
+void SparseImplQPU<data_t>::_to_dense()
+{
+    auto state = getQState();
+    amplitude_map().swap(m_state);
+
+    auto dense = new CPUImplQPU<data_t>();
+    m_dense.reset(dense);
+    if (m_max_threads_size > 0)
+    {
+        m_dense->set_parallel_threads_size(m_max_threads_size);
+    }
+    dense->loadState(m_qubit_num, state);
+}
+
+template <typename data_t>
+void SparseImplQPU<data_t>::_apply_diagonal(const Qnum& qubits, size_t control_mask, const QStat& matrix)
+{
+    size_t dim = 1ull << qubits.size();
+    for (auto iter = m_state.begin(); iter != m_state.end();)
+    {
+        if ((iter->first & control_mask) != control_mask)
+        {
+            ++iter;
+            continue;
+        }
+
+        size_t row = 0;
+        for (size_t j = 0; j < qubits.size(); j++)
+        {
+            row |= ((iter->first >> qubits[j]) & 1ull) << j;
+        }
+
+        iter->second = amplitude_t(matrix[row * dim + row] * qcomplex_t(iter->second));
+        iter = is_zero_amplitude(iter->second) ? m_state.erase(iter) : std::next(iter);
+    }
+}
+
+template <typename data_t>
+void SparseImplQPU<data_t>::_apply_gate(const Qnum& qubits, const Qnum& controls, const QStat& matrix)
+{
+    if (qubits.empty())
+    {
+        return;
+    }
+
+    size_t dim = 1ull << qubits.size();
+    QPANDA_ASSERT(matrix.size() != dim * dim, "Error: gate matrix size.");
+
+    size_t control_mask = 0;
+    for (auto qubit : controls)
+    {
+        if (std::find(qubits.begin(), qubits.end(), qubit) == qubits.end())
+        {
+            control_mask |= 1ull << qubit;
+        }
+    }
+
+    bool is_diagonal = true;
+    for (size_t i = 0; i < matrix.size() && is_diagonal; i++)
+    {
+        is_diagonal = (i / dim == i % dim) || (0. == matrix[i]);
+    }
+
+    if (is_diagonal)
+    {
+        _apply_diagonal(qubits, control_mask, matrix);
+        return;
+    }
+
+    std::vector<size_t> offsets(dim, 0);
+    for (size_t i_dim = 0; i_dim < dim; i_dim++)
+    {
+        for (size_t j = 0; j < qubits.size(); j++)
+        {
+            if ((i_dim >> j) & 1ull)
+            {
+                offsets[i_dim] |= 1ull << qubits[j];
+            }
+        }
+    }
+
+    size_t target_mask = offsets[dim - 1];
+    amplitude_map state;
+    state.reserve(m_state.size());
+    std::vector<qcomplex_t> phi(dim);
+    for (const auto& amplitude : m_state)
+    {
+        size_t index = amplitude.first;
+        if ((index & control_mask) != control_mask)
+        {
+            state.insert(amplitude);
+            continue;
+        }
+
+        /* the amplitudes sharing the other bits are mixed once, at the first one kept */
+        size_t base = index & ~target_mask;
+        size_t row = 0;
+        for (size_t j = 0; j < qubits.size(); j++)
+        {
+            row |= ((index >> qubits[j]) & 1ull) << j;
+        }
+
+        bool is_first = true;
+        for (size_t i_dim = 0; i_dim < row && is_first; i_dim++)
+        {
+            is_first = m_state.end() == m_state.find(base | offsets[i_dim]);
+        }
+
+        if (!is_first)
+        {
+            continue;
+        }
+
+        for (size_t i_dim = 0; i_dim < dim; i_dim++)
+        {
+            auto iter = m_state.find(base | offsets[i_dim]);
+            phi[i_dim] = m_state.end() == iter ? 0 : qcomplex_t(iter->second);
+        }
+
+        for (size_t i_row = 0; i_row < dim; i_row++)
+        {
+            qcomplex_t sum = 0;
+            const qcomplex_t *mat_row = matrix.data() + i_row * dim;
+            for (size_t col = 0; col < dim; col++)
+            {
+                sum += mat_row[col] * phi[col];
+            }
+
+            amplitude_t result(sum);
+            if (!is_zero_amplitude(result))
+            {
+                state.emplace(base | offsets[i_row], result);
+            }
+        }
+    }
+
+    m_state.swap(state);
+}
+
+template <typename data_t>
+QError SparseImplQPU<data_t>::unitarySingleQubitGate(size_t qn, QStat& matrix,
+    bool is_dagger, GateType type)
+{
+    if (m_dense)
+    {
+        return m_dense->unitarySingleQubitGate(qn, matrix, is_dagger, type);
+    }
+
+    Qnum qubits = { qn };
+    Qnum controls;
+    QStat gate_matrix;
+    gate_target_operator(type, false, matrix, is_dagger, qubits, controls, gate_matrix);
+    _apply_gate(qubits, controls, gate_matrix);
+    _check_fill();
+    return qErrorNone;
+}
+
+template <typename data_t>
+QError SparseImplQPU<data_t>::controlunitarySingleQubitGate(size_t qn, Qnum& control_qubits,
+    QStat& matrix, bool is_dagger, GateType type)
+{
+    if (m_dense)
+    {
+        return m_dense->controlunitarySingleQubitGate(qn, control_qubits, matrix, is_dagger, type);
+    }
+
+    Qnum qubits = { qn };
+    Qnum controls = control_qubits;
+    QStat gate_matrix;
+    gate_target_operator(type, true, matrix, is_dagger, qubits, controls, gate_matrix);
+    _apply_gate(qubits, controls, gate_matrix);
+    _check_fill();
+    return qErrorNone;
+}
+
+template <typename data_t>
+QError SparseImplQPU<data_t>::unitaryDoubleQubitGate(size_t qn_0, size_t qn_1,
+    QStat& matrix, bool is_dagger, GateType type)
+{
+    if (m_dense)
+    {
+        return m_dense->unitaryDoubleQubitGate(qn_0, qn_1, matrix, is_dagger, type);
+    }
+
+    Qnum qubits = { qn_0, qn_1 };
+    Qnum controls;
+    QStat gate_matrix;
+    gate_target_operator(type, false, matrix, is_dagger, qubits, controls, gate_matrix);
+    _apply_gate(qubits, controls, gate_matrix);
+    _check_fill();
+    return qErrorNone;
+}
+
+template <typename data_t>
+QError SparseImplQPU<data_t>::controlunitaryDoubleQubitGate(size_t qn_0, size_t qn_1,
+    Qnum& control_qubits, QStat& matrix, bool is_dagger, GateType type)
+{
+    if (m_dense)
+    {
+        return m_dense->controlunitaryDoubleQubitGate(qn_0, qn_1, control_qubits, matrix, is_dagger, type);
+    }
+
+    Qnum qubits = { qn_0, qn_1 };
+    Qnum controls = control_qubits;
+    QStat gate_matrix;
+    gate_target_operator(type, true, matrix, is_dagger, qubits, controls, gate_matrix);
+    _apply_gate(qubits, controls, gate_matrix);
+    _check_fill();
+    return qErrorNone;
+}
+
+template <typename data_t>
+QError SparseImplQPU<data_t>::OracleGate(Qnum& qubits, QStat &matrix, bool is_dagger)
+{
+    return controlOracleGate(qubits, {}, matrix, is_dagger);
+}
+
+template <typename data_t>
+QError SparseImplQPU<data_t>::controlOracleGate(Qnum& qubits, const Qnum& controls,
+    QStat &matrix, bool is_dagger)
+{
+    if (m_dense)
+    {
+        return m_dense->controlOracleGate(qubits, controls, matrix, is_dagger);
+    }
+
+    size_t dim = 1ull << qubits.size();
+    QPANDA_ASSERT(matrix.size() != dim * dim, "Error: oracle matrix size.");
+    QStat gate_matrix = matrix;
+    if (is_dagger)
+    {
+        for (size_t row = 0; row < dim; row++)
+        {
+            for (size_t col = 0; col < dim; col++)
+            {
+                gate_matrix[row * dim + col] = std::conj(matrix[col * dim + row]);
+            }
+        }
+    }
+
+    _apply_gate(qubits, controls, gate_matrix);
+    _check_fill();
+    return qErrorNone;
+}
+
+template <typename data_t>
+QError SparseImplQPU<data_t>::process_noise(Qnum& qnum, QStat& matrix)
+{
+    if (m_dense)
+    {
+        return m_dense->process_noise(qnum, matrix);
+    }
+
+    if (qnum.size() > 2)
+    {
+        QCERR_AND_THROW(std::invalid_argument, "Qnum for noise above 2");
+    }
+
+    _apply_gate(qnum, {}, matrix);
+    _check_fill();
+    return qErrorNone;
+}
+
+template <typename data_t>
+bool SparseImplQPU<data_t>::qubitMeasure(size_t qn)
+{
+    if (m_dense)
+    {
+        return m_dense->qubitMeasure(qn);
+    }
+
+    size_t mask = 1ull << qn;
+    double dprob = 0;
+    for (const auto& amplitude : m_state)
+    {
+        if (0 == (amplitude.first & mask))
+        {
+            dprob += std::norm(amplitude.second);
+        }
+    }
+
+    bool measure_out = get_random_double() > dprob;
+    data_t scale = 1 / sqrt(measure_out ? 1 - dprob : dprob);
+    for (auto iter = m_state.begin(); iter != m_state.end();)
+    {
+        if (bool(iter->first & mask) != measure_out)
+        {
+            iter = m_state.erase(iter);
+        }
+        else
+        {
+            iter->second *= scale;
+            ++iter;
+        }
+    }
+    return measure_out;
+}
+
+template <typename data_t>
+QError SparseImplQPU<data_t>::pMeasure(Qnum& qnum, prob_vec &probs)
+{
+    if (m_dense)
+    {
+        return m_dense->pMeasure(qnum, probs);
+    }
+
+    probs.assign(1ull << qnum.size(), 0);
+    for (const auto& amplitude : m_state)
+    {
+        size_t index = 0;
+        for (size_t j = 0; j < qnum.size(); j++)
+        {
+            index |= ((amplitude.first >> qnum[j]) & 1ull) << j;
+        }
+        probs[index] += std::norm(amplitude.second);
+    }
+    return qErrorNone;
+}
+
+template <typename data_t>
+QStat SparseImplQPU<data_t>::getQState()
+{
+    if (m_dense)
+    {
+        return m_dense->getQState();
+    }
+
+    QStat state(1ull << m_qubit_num, 0);
+    for (const auto& amplitude : m_state)
+    {
+        state[amplitude.first] = amplitude.second;
+    }
+    return state;
+}
+
+template <typename data_t>
+QError SparseImplQPU<data_t>::Reset(size_t qn)
+{
+    if (m_dense)
+    {
+        return m_dense->Reset(qn);
+    }
+
+    if (qubitMeasure(qn))
+    {
+        _apply_gate({ qn }, {}, { 0, 1, 1, 0 });
+    }
+    return qErrorNone;
+}
+
+template <typename data_t>
+QError SparseImplQPU<data_t>::debug(std::shared_ptr<QPanda::AbstractQDebugNode> debugger)
+{
+    if (m_dense)
+    {
+        return m_dense->debug(debugger);
+    }
+
+    /* the debugger keeps a reference, so it gets a copy of the state */
+    m_debug_state = getQState();
+    debugger->save_qstate(m_debug_state);
+    return QError::qErrorNone;
+}
+
+template <typename data_t>
+void SparseImplQPU<data_t>::set_parallel_threads_size(size_t size)
+{
+    m_max_threads_size = size;
+    if (m_dense)
+    {
+        m_dense->set_parallel_threads_size(size);
+    }
+}
+
+template class QPanda::SparseImplQPU<double>;
+template class QPanda::SparseImplQPU<float>;
@@ -0,0 +1,125 @@
+/*
+Copyright (c) 2017-2020 Origin Quantum Computing. All Right Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "QPandaConfig.h"
+#include "Core/VirtualQuantumProcessor/UnitaryImplQPU.h"
+#include "Core/Utilities/Tools/QPandaException.h"
+#include <algorithm>
+#include <cmath>
+
+USING_QPANDA
+using namespace std;
+
+template <typename data_t>
+QError UnitaryImplQPU<data_t>::init_operator(const Qnum& qubits)
+{
+    Qnum prog_qubits = qubits;
+    std::sort(prog_qubits.begin(), prog_qubits.end());
+    prog_qubits.erase(std::unique(prog_qubits.begin(), prog_qubits.end()), prog_qubits.end());
+    QPANDA_ASSERT(prog_qubits.empty(), "Error: unitary of no qubit.");
+
+    /* the reference qubits follow the prog qubits, the register keeps this order */
+    m_operator_qubit_num = prog_qubits.size();
+    size_t reference_begin = prog_qubits.back() + 1;
+    Qnum register_qubits = prog_qubits;
+    for (size_t i = 0; i < m_operator_qubit_num; i++)
+    {
+        register_qubits.push_back(reference_begin + i);
+    }
+
+    this->set_used_qubits(register_qubits);
+    CPUImplQPU<data_t>::initState(0, 1, reference_begin + m_operator_qubit_num);
+
+    /* sum_c |c>|c> / 2^(n/2), the columns of the identity */
+    QStat hadamard = { SQ2, SQ2, SQ2, -SQ2 };
+    QStat pauli_x = { 0, 1, 1, 0 };
+    for (size_t i = 0; i < m_operator_qubit_num; i++)
+    {
+        Qnum reference = { reference_begin + i };
+        Qnum target = { prog_qubits[i] };
+        this->OracleGate(reference, hadamard, false);
+        this->controlOracleGate(target, reference, pauli_x, false);
+    }
+
+    return qErrorNone;
+}
+
+template <typename data_t>
+QStat UnitaryImplQPU<data_t>::get_operator()
+{
+    /* index c * 2^n + r of the state is row r and column c */
+    QStat matrix = this->_register_state();
+    int64_t dim = 1ll << m_operator_qubit_num;
+    const double scale = std::sqrt((double)dim);
+
+#pragma omp parallel for num_threads(this->_omp_thread_num(matrix.size()))
+    for (int64_t row = 0; row < dim; row++)
+    {
+        matrix[row * dim + row] *= scale;
+        for (int64_t col = row + 1; col < dim; col++)
+        {
+            qcomplex_t value = matrix[row * dim + col];
+            matrix[row * dim + col] = matrix[col * dim + row] * scale;
+            matrix[col * dim + row] = value * scale;
+        }
+    }
+
+    return matrix;
+}
+
+template <typename data_t>
+QError UnitaryImplQPU<data_t>::initState(size_t head_rank, size_t rank_size, size_t qubit_num)
+{
+    Qnum qubits(qubit_num);
+    for (size_t i = 0; i < qubit_num; i++)
+    {
+        qubits[i] = i;
+    }
+
+    return init_operator(qubits);
+}
+
+template <typename data_t>
+QStat UnitaryImplQPU<data_t>::getQState()
+{
+    return get_operator();
+}
+
+template <typename data_t>
+bool UnitaryImplQPU<data_t>::qubitMeasure(size_t qn)
+{
+    QCERR_AND_THROW(run_fail, "Error: measure is not unitary.");
+}
+
+template <typename data_t>
+QError UnitaryImplQPU<data_t>::pMeasure(Qnum& qnum, prob_vec &probs)
+{
+    QCERR_AND_THROW(run_fail, "Error: pmeasure is not unitary.");
+}
+
+template <typename data_t>
+QError UnitaryImplQPU<data_t>::Reset(size_t qn)
+{
+    QCERR_AND_THROW(run_fail, "Error: reset is not unitary.");
+}
+
+template <typename data_t>
+QError UnitaryImplQPU<data_t>::process_noise(Qnum& qnum, QStat& matrix)
+{
+    QCERR_AND_THROW(run_fail, "Error: noise is not unitary.");
+}
+
+template class QPanda::UnitaryImplQPU<double>;
+template class QPanda::UnitaryImplQPU<float>;
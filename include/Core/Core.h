@@ -78,6 +78,9 @@ limitations under the License.
 #include "Core/Utilities/Tools/GetQubitTopology.h"
 #include "Core/Utilities/Tools/RemapQProg.h"
 #include "Core/Utilities/Tools/QCircuitFusion.h"
+#include "Core/Utilities/Tools/QProgLightCone.h"
+#include "Core/Utilities/Tools/ShotSampler.h"
+#include "Core/Utilities/Tools/PauliGrouping.h"
 
 #include "Core/Variational/var.h"
 #include "Core/Variational/Optimizer.h"  
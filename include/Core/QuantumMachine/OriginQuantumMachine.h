@@ -20,11 +20,14 @@ limitations under the License.
 #include "Core/QuantumMachine/QuantumMachineInterface.h"
 #include "Core/VirtualQuantumProcessor/QPUImpl.h"
 #include "Core/VirtualQuantumProcessor/QuantumGateParameter.h"
+#include "Core/VirtualQuantumProcessor/StateAllocator.h"
 #include "Core/Utilities/Tools/QPandaException.h"
 #include "Core/Utilities/Tools/RandomEngine/RandomEngine.h"
 #include "Core/VirtualQuantumProcessor/NoiseQPU/NoiseModel.h"  
 #include "Core/QuantumMachine/QProgCheck.h"
 #include "Core/QuantumMachine/QProgExecution.h"
+#include "Core/QuantumMachine/QProgBranchExecution.h"
+#include "Core/QuantumMachine/QProgBatchExecution.h"
 #include "Core/Utilities/Tools/AsyncTask.h"
 #include "Core/Utilities/QProgInfo/QProgProgress.h"
 #include "Core/QuantumNoise/NoiseModelV2.h"
@@ -83,6 +86,7 @@ private:
 	OriginQubitPool();
 
 public:
+	/* process-wide pool behind the qubit address helpers, a QVM allocates from a pool of its own */
 	static OriginQubitPool* get_instance()
 	{
 		static OriginQubitPool instance;
@@ -226,6 +230,7 @@ class OriginCMem : public CMem
 	std::vector<CBit*> vecBit;
 	OriginCMem();
 public:
+	/* process-wide cbits behind the cbit address helpers, a QVM allocates from cbits of its own */
 	static OriginCMem* get_instance()
 	{
 		static OriginCMem instance;
@@ -319,7 +324,7 @@ public:
 class QVM : public QuantumMachine
 {
 protected:
-	RandomEngine* random_engine;
+	RandomEngine* random_engine = nullptr;
 	QubitPool* _Qubit_Pool = nullptr;
 	CMem* _CMem = nullptr;
 	QResult* _QResult = nullptr;
@@ -329,6 +334,24 @@ protected:
 	uint64_t _ExecId{0};
 	virtual void run(QProg&, const NoiseModel& = NoiseModel());
 	std::string _ResultToBinaryString(std::vector<ClassicalCondition>& vCBit);
+	std::string _ResultToBinaryString(std::vector<ClassicalCondition>& vCBit, std::map<std::string, bool> resmap);
+
+	/**
+	* @brief  count the shots of the branches of a prog by the result string of the cbits
+	* @param[in]  const std::vector<ShotBranch>&  branches of QProgBranchExecution
+	* @param[in]  std::vector<ClassicalCondition>&  cbits of the result string
+	* @return     std::map<std::string, size_t>  result string -> shots
+	*/
+	std::map<std::string, size_t> _branch_result(const std::vector<ShotBranch>& branches, std::vector<ClassicalCondition>& cbits);
+
+	/**
+	* @brief  qubits and cbits the machine allocated at addresses
+	* @note   an address the machine didn't allocate throws; only a machine that
+	*         allocated none resolves them on the process-wide OriginQubitPool
+	*         and OriginCMem, which progs built by address are measured into
+	*/
+	QVec _get_qubits_by_addr(const std::vector<int>& qubits_addr);
+	std::vector<ClassicalCondition> _get_cbits_by_addr(const std::vector<int>& cbits_addr);
 	virtual void _start();
 	QVM()
 		:_AsyncTask(new AsyncTask<decltype(&QVM::run), \
@@ -364,7 +387,26 @@ protected:
 	virtual std::map<std::string, size_t> run_with_optimizing(QProg& prog, std::vector<ClassicalCondition>& cbits,
 		int shots, TraversalConfig& traver_param);
 	virtual std::map<std::string, size_t> run_with_normal(QProg& prog, std::vector<ClassicalCondition>& cbits, int shots, const NoiseModel& = NoiseModel());
+
+	/**
+	* @brief  get the prog to simulate when only the measures and the observed qubits are read out
+	* @param[in]  QProg&  source prog
+	* @param[in]  const QVec&  observed qubits
+	* @return     QProg  the light cone of the measures and the observed qubits
+	*/
+	QProg _light_cone_prog(QProg& prog, const QVec& observed_qubits = {});
+
+	bool m_is_light_cone_pruning{ false };
 public:
+	/**
+	* @brief  set whether gates that can't reach a measure or a pmeasured qubit are
+	*         skipped by probRun* and runWithConfiguration
+	* @param[in]  bool  prune the prog, off by default
+	* @note   the state left after a pruned run only holds the observed qubits right,
+	*         so turn it on only when getQState() isn't read after these calls
+	*/
+	virtual void set_light_cone_pruning(bool enable);
+
     virtual void initState(const QStat& state = {}, const QVec& qlist = {});
 	virtual Qubit* allocateQubitThroughPhyAddress(size_t qubit_num);
 	virtual Qubit* allocateQubitThroughVirAddress(size_t qubit_num); // allocate and return a qubit
@@ -462,8 +504,140 @@ public:
 	CPUQVM() {}
 	void init();
 
+	/**
+	* @brief  init the quantum machine with the precision of the state vector
+	* @param[in]  bool  true for complex<double> amplitudes, false for complex<float>
+	*                   amplitudes that take half the memory with ~1e-7 error
+	*/
+	void init(bool is_double_precision);
+
+	/**
+	* @brief  init the quantum machine with the state vector in memory mapped chunk files
+	* @param[in]  const std::string&  directory of the chunk and initial state files, $TMPDIR or /tmp if empty
+	* @param[in]  size_t  bytes of the state mapped in RAM at a time
+	* @param[in]  bool  true for complex<double> amplitudes, false for complex<float>
+	* @note   for states larger than RAM, the cache blocking and the page
+	*         mode do not apply to it
+	*/
+	void init_out_of_core(const std::string& directory, size_t memory_budget,
+		bool is_double_precision = true);
+
+	/**
+	* @brief  init the quantum machine with a state of the non-zero amplitudes only
+	* @param[in]  bool  true for complex<double> amplitudes, false for complex<float>
+	* @note   for arithmetic, oracle and basis state preparation progs, the state
+	*         turns dense past 1/16 of the amplitudes. It turns the gate fusion
+	*         off, set_max_fusion_qubits turns it back on
+	*/
+	void init_sparse(bool is_double_precision = true);
+
+	/**
+	* @brief  init the quantum machine with the state vector partitioned over MPI ranks
+	* @param[in]  bool  whether the ranks on one node share the state memory
+	* @note   every rank runs the same progs, with 2^r ranks a prog needs more
+	*         than r qubits. Built without USE_MPI, it runs as a single rank
+	*/
+	void init_distributed(bool use_shared_memory = true);
+
+	/**
+	* @brief  set the max qubits of the gate blocks fused before running a prog
+	* @param[in]  size_t  max fusion qubits, 1 ~ 5, 0 turns the gate fusion off
+	*/
+	void set_max_fusion_qubits(size_t qubit_num);
+
+	/**
+	* @brief  set the qubits of the cache blocks that runs of gates are executed in
+	* @param[in]  size_t  block qubits, 0 turns the cache blocking off
+	* @note   call it after init(), the default blocks take 256 KB
+	*/
+	void set_cache_block_qubits(size_t qubit_num);
+
+	/**
+	* @brief  set the pages backing the state vector
+	* @param[in]  StatePageMode  page mode, transparent huge pages by default
+	* @note   call it after init(), explicit huge pages fall back to
+	*         transparent ones when hugetlbfs has no page reserved
+	*/
+	void set_state_page_mode(StatePageMode mode);
+
+	/**
+	* @brief  set the directory of the files that large custom initial states are kept in
+	* @param[in]  const std::string&  directory, $TMPDIR or /tmp if empty
+	* @note   call it after init(), /tmp is often a tmpfs in memory
+	*/
+	void set_init_state_directory(const std::string& directory);
+
+	/**
+	* @brief  set whether a prog is simulated on the qubits it uses only
+	* @param[in]  bool  compact the qubit addresses, on by default
+	* @note   the state and the pmeasure results keep the prog addresses,
+	*         qubits the prog does not use read as |0>
+	*/
+	void set_qubit_compaction(bool enable);
+
+	/**
+	* @brief  get the reduced density matrix of qubits in the current state
+	* @param[in]  const QVec&  the qubits, the others are traced out
+	* @return QStat  row major matrix, qubits[0] is the lowest bit of the index
+	* @note   computed on the state in place, without copying it out
+	*/
+	QStat get_reduced_density_matrix(const QVec& qubits);
+
+	/**
+	* @brief  get the Schmidt spectrum of the current state across the cut around qubits
+	* @param[in]  const QVec&  the qubits on one side of the cut
+	* @return prob_vec  squared Schmidt coefficients in descending order
+	*/
+	prob_vec get_schmidt_spectrum(const QVec& qubits);
+
+	/**
+	* @brief  get the entanglement entropy in bits of the current state across the cut around qubits
+	* @param[in]  const QVec&  the qubits on one side of the cut
+	* @param[in]  double  order of the Renyi entropy, 1 for the von Neumann entropy
+	*/
+	double get_entanglement_entropy(const QVec& qubits, double alpha = 1);
+
+	/**
+	* @brief  get the expectations of hamiltonians at every point of a parameter sweep
+	* @param[in]  const ParametricProg&  builds the prog of a point on the allocated qubits
+	* @param[in]  const std::vector<std::vector<double>>&  one row of parameters per point
+	* @param[in]  const std::vector<QHamiltonian>&  hamiltonians, a term index is an index in qv
+	* @param[in]  const QVec&  qubits of the hamiltonians
+	* @return std::vector<std::vector<double>>  one row of expectations per point
+	* @note   the points run concurrently on their own states, see QProgBatchExecution,
+	*         the state of the machine is left as it is
+	*/
+	std::vector<std::vector<double>> batch_expectation(const ParametricProg& builder,
+		const std::vector<std::vector<double>>& params,
+		const std::vector<QHamiltonian>& hamiltonians, const QVec& qv);
+
+	/**
+	* @brief  get the probabilities of qubits at every point of a parameter sweep
+	* @param[in]  const ParametricProg&  builds the prog of a point on the allocated qubits
+	* @param[in]  const std::vector<std::vector<double>>&  one row of parameters per point
+	* @param[in]  const QVec&  measured qubits, qubits[0] is the lowest bit of the outcome
+	* @return std::vector<prob_vec>  one probability list per point
+	*/
+	std::vector<prob_vec> batch_prob_list(const ParametricProg& builder,
+		const std::vector<std::vector<double>>& params, const QVec& qubits);
+
 protected:
     void run(QProg&, const NoiseModel& = NoiseModel()) override ;
+    std::map<std::string, size_t> run_with_optimizing(QProg& prog, std::vector<ClassicalCondition>& cbits,
+        int shots, TraversalConfig& traver_param) override;
+
+    /* progs with mid-circuit measures or control flow run their shots as branches of one run */
+    std::map<std::string, size_t> run_with_normal(QProg& prog, std::vector<ClassicalCondition>& cbits,
+        int shots, const NoiseModel& = NoiseModel()) override;
+    void _compact_qubits(QProg& prog);
+
+private:
+    /* smaller states stay in cache, fusing their gates costs more than it saves */
+    static const size_t kFusionMinQubits = 14;
+    /* smaller registers are cheaper to simulate than to search for unused qubits */
+    static const size_t kCompactionMinQubits = 16;
+    size_t m_max_fusion_qubits{ 5 };
+    bool m_is_qubit_compaction{ true };
 };
 
 class GPUQVM : public IdealQVM
@@ -6,6 +6,7 @@
 #include "Core/Utilities/Tools/Traversal.h"
 #include "Core/QuantumMachine/OriginQuantumMachine.h"
 #include "Core/VirtualQuantumProcessor/MPSQVM/MPSImplQPU.h"
+#include "Core/VirtualQuantumProcessor/SparseImplQPU.h"
 #include "Core/VirtualQuantumProcessor/PartialAmplitude/PartialAmplitudeGraph.h"
 #include "Core/Utilities/QProgTransform/TransformDecomposition.h"
 #include "Core/Utilities/QProgInfo/Visualization/QVisualization.h"
@@ -26,7 +27,8 @@ enum class BackendType
     GPU,
     CPU_SINGLE_THREAD,
     NOISE,
-    MPS
+    MPS,
+    SPARSE
 };
 
 class PartialAmplitudeQVM : public QVM, public TraversalInterface<>
@@ -0,0 +1,97 @@
+/*
+Copyright (c) 2017-2020 Origin Quantum Computing. All Right Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+/*! \file QProgBatchExecution.h */
+#ifndef QPROG_BATCH_EXECUTION_H
+#define QPROG_BATCH_EXECUTION_H
+
+#include <vector>
+#include <functional>
+#include "Core/QuantumCircuit/QProgram.h"
+#include "Core/Module/DataStruct.h"
+#include "Core/VirtualQuantumProcessor/QPUImpl.h"
+
+QPANDA_BEGIN
+
+/**
+* @brief  builds the prog of one point of a parameter sweep
+*/
+using ParametricProg = std::function<QProg(const std::vector<double>&)>;
+
+/**
+* @brief  runs one parametric prog at many parameter points at once
+* @ingroup QuantumMachine
+* @note   the progs are built one after another, then simulated concurrently,
+*         every worker on its own state vector. The workers are bounded by
+*         the threads and by the memory limit, the threads left over by the
+*         workers run the gates of each state
+*/
+class QProgBatchExecution
+{
+public:
+	/**
+	* @brief  reads the state of a point once its prog has run
+	*/
+	using PointHandler = std::function<void(size_t, QPUImpl*)>;
+
+	/**
+	* @param[in]  ParametricProg  builds the prog of a point, called on the calling thread only
+	* @param[in]  size_t  qubits of the states, the progs use addresses below it
+	*/
+	QProgBatchExecution(ParametricProg builder, size_t qubit_num);
+
+	/**
+	* @brief  set the bytes all the state vectors may take together, 4 GB by default
+	*/
+	void set_memory_limit(size_t bytes) { m_memory_limit = bytes; }
+
+	/**
+	* @brief  workers that run a batch of points
+	*/
+	size_t worker_num(size_t point_num) const;
+
+	/**
+	* @brief  run the prog of every parameter point
+	* @param[in]  const std::vector<std::vector<double>>&  one row of parameters per point
+	* @param[in]  PointHandler  called on the worker thread of every point, with the point index
+	* @note   the progs hold gates and circuits only, measures and control flow need the QVM
+	*/
+	void run(const std::vector<std::vector<double>>& params, const PointHandler& handler);
+
+	/**
+	* @brief  expectations of hamiltonians at every parameter point
+	* @param[in]  const std::vector<std::vector<double>>&  one row of parameters per point
+	* @param[in]  const std::vector<QHamiltonian>&  hamiltonians on qubit addresses
+	* @return     std::vector<std::vector<double>>  one row of expectations per point
+	*/
+	std::vector<std::vector<double>> expectation(const std::vector<std::vector<double>>& params,
+		const std::vector<QHamiltonian>& hamiltonians);
+
+	/**
+	* @brief  probabilities of the qubits at every parameter point
+	* @param[in]  const std::vector<std::vector<double>>&  one row of parameters per point
+	* @param[in]  const Qnum&  qubit addresses, qubits[0] is the lowest bit of the outcome
+	* @return     std::vector<prob_vec>  one probability list per point
+	*/
+	std::vector<prob_vec> prob_list(const std::vector<std::vector<double>>& params, const Qnum& qubits);
+
+private:
+	ParametricProg m_builder;
+	size_t m_qubit_num;
+	size_t m_memory_limit{ 1ull << 32 };
+};
+
+QPANDA_END
+#endif // !QPROG_BATCH_EXECUTION_H
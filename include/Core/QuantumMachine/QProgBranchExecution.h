@@ -0,0 +1,111 @@
+/*
+Copyright (c) 2017-2020 Origin Quantum Computing. All Right Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+/*! \file QProgBranchExecution.h */
+#ifndef QPROG_BRANCH_EXECUTION_H
+#define QPROG_BRANCH_EXECUTION_H
+
+#include <map>
+#include <memory>
+#include <vector>
+#include <functional>
+#include "Core/QuantumCircuit/QProgram.h"
+#include "Core/QuantumCircuit/ControlFlow.h"
+#include "Core/QuantumMachine/CBitFactory.h"
+#include "Core/VirtualQuantumProcessor/QPUImpl.h"
+
+QPANDA_BEGIN
+
+/**
+* @brief  the shots that end in the same branch of a prog
+* @ingroup QuantumMachine
+*/
+struct ShotBranch
+{
+	std::map<std::string, bool> m_result; /**< measure results of the branch */
+	size_t m_shots;                       /**< shots that took the branch */
+};
+
+/**
+* @brief  runs all the shots of a prog with mid-circuit measures and control flow at once
+* @ingroup QuantumMachine
+* @note   the prog is run once up to a measure or a reset, where the state is split
+*         into the two outcomes and the shots are shared between them by a binomial
+*         draw. A state is only copied when both outcomes keep shots, so the cost
+*         grows with the distinct branches instead of with the shots
+*/
+class QProgBranchExecution
+{
+public:
+	/**
+	* @brief  runs a gate or a circuit node on a processor
+	*/
+	using NodeRunner = std::function<void(std::shared_ptr<QNode>, const std::shared_ptr<QPUImpl>&)>;
+
+	/**
+	* @brief  flatten the prog into instructions and jumps
+	* @param[in]  QProg  the prog, it keeps the nodes alive
+	*/
+	QProgBranchExecution(QProg prog);
+
+	/**
+	* @brief  whether every node of the prog can run on shared shots
+	* @note   noise and debug nodes act on one shot only
+	*/
+	bool is_supported() const { return m_is_supported; }
+
+	/**
+	* @brief  run the shots
+	* @param[in]  std::shared_ptr<QPUImpl>  processor with the initial state, it holds
+	*                                      the state of one of the branches on return
+	* @param[in]  size_t  shots
+	* @param[in]  const std::vector<CBit*>&  cbits whose values a branch keeps
+	* @param[in]  NodeRunner  runs gates and circuits, QProgExecution by default
+	* @return     std::vector<ShotBranch>  every finished branch with its shots
+	* @note   the processor must support clone() and qubitCollapse()
+	*/
+	std::vector<ShotBranch> execute(std::shared_ptr<QPUImpl> qpu, size_t shots,
+		const std::vector<CBit*>& cbits, NodeRunner runner = nullptr);
+
+private:
+	enum class OpType
+	{
+		QUANTUM,
+		MEASURE,
+		RESET,
+		CLASSICAL,
+		JUMP,
+		JUMP_IF_FALSE
+	};
+
+	struct Instruction
+	{
+		OpType m_type;
+		std::shared_ptr<QNode> m_node;
+		size_t m_qubit;
+		CBit* m_cbit;
+		size_t m_target;
+	};
+
+	void _compile(std::shared_ptr<QNode> node);
+	size_t _append(OpType type, std::shared_ptr<QNode> node = nullptr, size_t qubit = 0, CBit* cbit = nullptr);
+
+	QProg m_prog;
+	std::vector<Instruction> m_instructions;
+	bool m_is_supported{ true };
+};
+
+QPANDA_END
+#endif // !QPROG_BRANCH_EXECUTION_H
@@ -27,6 +27,7 @@ limitations under the License.
 #include "Core/QuantumNoise/AbstractNoiseNode.h"
 #include "Core/Utilities/Tools/Traversal.h"
 #include <map>
+#include <atomic>
 #include <type_traits>
 
 
@@ -187,6 +188,10 @@ private:
 
 	std::map<std::string, bool> m_result;
     std::mt19937_64 m_rng;
+
+    /* looked up at the first gate, so that a gate does not lock the progress of all the machines */
+    bool m_is_progress_checked{ false };
+    std::atomic<size_t>* m_processed_gates{ nullptr };
 };
 
 /* new interface */
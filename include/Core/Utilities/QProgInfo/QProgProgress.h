@@ -22,6 +22,9 @@ private:
     ~QProgProgress() = default;
     std::unordered_map<uint64_t, std::atomic<size_t>> m_prog_exec_gates;
 
+    /* machines in different threads start and end their progs concurrently */
+    SharedMutex m_sm;
+
 public:
 
     static QProgProgress &getInstance()
@@ -53,6 +56,14 @@ public:
      *         else return 0
      */
     size_t update_processed_gate_num(uint64_t exec_id, size_t count = 1);
+
+    /**
+     * @brief get the processed gate counter of a QProgExecution
+     * 
+     * @return std::atomic<size_t>* nullptr if QProgExecution not be record,
+     *         the counter stays valid until prog_end
+     */
+    std::atomic<size_t>* get_processed_gate_counter(uint64_t exec_id);
 };
 
 QPANDA_END
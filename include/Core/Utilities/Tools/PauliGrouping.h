@@ -0,0 +1,57 @@
+/*
+Copyright (c) 2017-2020 Origin Quantum Computing. All Right Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+/*! \file PauliGrouping.h */
+#ifndef PAULI_GROUPING_H
+#define PAULI_GROUPING_H
+
+#include <map>
+#include <string>
+#include <vector>
+#include "Core/Module/DataStruct.h"
+
+QPANDA_BEGIN
+
+/**
+* @brief  hamiltonian terms measured in one basis
+* @ingroup Utilities
+*/
+struct PauliMeasureGroup
+{
+	QTerm m_basis;               /**< pauli measured on every qubit of the group */
+	std::vector<size_t> m_terms; /**< indices of the terms in the hamiltonian */
+};
+
+/**
+* @brief  partition the terms of a hamiltonian into qubit-wise commuting groups
+* @param[in]  const QHamiltonian&  hamiltonian
+* @return     std::vector<PauliMeasureGroup>  groups, the terms without a pauli are in none
+* @note   terms are placed by descending |coefficient| into the first group
+*         whose basis agrees with them on every shared qubit
+*/
+std::vector<PauliMeasureGroup> group_qubit_wise_commuting(const QHamiltonian& hamiltonian);
+
+/**
+* @brief  estimate of a term from the bit strings measured in the basis of its group
+* @param[in]  const QTerm&  term
+* @param[in]  const QTerm&  basis of the group, the order of its qubits is the order of the bits
+* @param[in]  const std::map<std::string, size_t>&  bit string -> count, the last char is the first qubit
+* @return     double  mean of the parity of the term bits
+*/
+double term_expectation(const QTerm& term, const QTerm& basis,
+	const std::map<std::string, size_t>& counts);
+
+QPANDA_END
+#endif // !PAULI_GROUPING_H
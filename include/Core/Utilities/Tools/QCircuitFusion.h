@@ -46,6 +46,33 @@ public:
 	*/
 	void aggregate_operations(QProg& prog, QuantumMachine* qvm);
 
+	/**
+	* @brief  fuse the gates of the prog into dense blocks for state vector simulation,
+	          gates acting on disjoint qubits may be gathered into the same block, and
+	          the width of every block is chosen by fusion_cost()
+	* @param[in]  QProg& prog target optimize prog, it is flattened and rewritten
+	* @param[in]  size_t max_fusion_qubits  max qubits of a fused block, 1 ~ 5
+	* @return     void
+	* @ingroup QuantumProg
+	*/
+	void aggregate_blocks(QProg& prog, size_t max_fusion_qubits = 5);
+
+	/**
+	* @brief  set the cost of applying a gate on qubit_num qubits,
+	          in passes over the state vector
+	* @param[in]  size_t qubit_num
+	* @param[in]  double cost
+	* @return     void
+	*/
+	void set_fusion_cost(size_t qubit_num, double cost);
+
+	/**
+	* @brief  get the cost of applying a gate on qubit_num qubits
+	* @param[in]  size_t qubit_num
+	* @return     double cost in passes over the state vector
+	*/
+	double fusion_cost(size_t qubit_num) const;
+
 protected:
     double distance_cost(const std::vector<QGate>& ops,
         const int from,
@@ -78,6 +105,14 @@ protected:
     void _allocate_new_gate(std::vector<QGate>& prog, int index,
         std::vector<int>& fusing_op_itrs, QuantumMachine* qvm);
 
+    void _aggregate_gate_run(std::vector<QGate>& gates, size_t max_fusion_qubits, QProg& prog);
+
+    std::vector<size_t> _collect_block(const std::vector<std::vector<size_t>>& gate_qubits,
+        const std::vector<bool>& fusible, const std::vector<bool>& done,
+        size_t first, size_t width, std::vector<size_t>& block_qubits) const;
+
+    QGate _generate_block_gate(const std::vector<QGate>& gates, const std::vector<size_t>& block_qubits);
+
 private:
     double distance_factor = 1.8;
     double distances_[64];
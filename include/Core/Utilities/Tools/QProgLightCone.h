@@ -0,0 +1,41 @@
+/*
+Copyright (c) 2017-2020 Origin Quantum Computing. All Right Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+/*! \file QProgLightCone.h */
+#ifndef QPROG_LIGHT_CONE_H
+#define QPROG_LIGHT_CONE_H
+
+#include "Core/Utilities/QPandaNamespace.h"
+#include "Core/QuantumCircuit/QProgram.h"
+#include "Core/QuantumMachine/QVec.h"
+
+QPANDA_BEGIN
+
+/**
+* @brief  remove the nodes of a prog that can't affect what is read out of it
+* @ingroup Utilities
+* @param[in]  QProg  source prog of gates, measures and resets
+* @param[in]  const QVec&  qubits whose state is read out after the prog
+* @return     QProg  a flat prog of the nodes in the backward light cone of the
+*                    observed qubits and of the measures, the source prog itself
+*                    if no node is removed or it has control flow or classical nodes
+* @note   the marginal distribution of the observed qubits and of the measure
+*         results is kept, the rest of the state is not. Observed qubits left
+*         without any node get a barrier, so the prog still spans them
+*/
+QProg light_cone_prune(QProg prog, const QVec& observed_qubits = {});
+
+QPANDA_END
+#endif // !QPROG_LIGHT_CONE_H
@@ -157,5 +157,22 @@ bool is_unitary_matrix(const QStat &circuit_matrix, const double precision = MAX
 bool is_unitary_matrix_by_eigen(const QStat& circuit_matrix, const double precision = MAX_COMPARE_PRECISION);
 bool is_unitary_matrix_by_eigen(const EigenMatrixXc& circuit_matrix, const double precision = MAX_COMPARE_PRECISION);
 
+/**
+* @brief eigenvalues of a density matrix
+* @ingroup Utilities
+* @param[in] const QStat& the density matrix, row major
+* @return prob_vec the eigenvalues in descending order, the rounding errors below 0 are cut to 0
+*/
+prob_vec density_matrix_spectrum(const QStat& density_matrix);
+
+/**
+* @brief Renyi entropy of a probability spectrum, in bits
+* @ingroup Utilities
+* @param[in] const prob_vec& the spectrum, e.g. the eigenvalues of a density matrix
+* @param[in] double the order alpha of the Renyi entropy, 1 for the von Neumann entropy
+* @return double the entropy
+*/
+double spectrum_entropy(const prob_vec& spectrum, double alpha = 1);
+
 QPANDA_END
 #endif // QSTATMATRIX_H
@@ -16,9 +16,13 @@ limitations under the License.
 
 #ifndef RANDOM_ENGINE_H
 #define RANDOM_ENGINE_H
+#include <array>
 #include <random>
 #include <chrono>
+#include <thread>
 #include <vector>
+#include <cstdint>
+#include <functional>
 
 
 /**
@@ -92,10 +96,123 @@ public:
 };
 
 inline double _default_random_generator() {
-	static XC_RandomEngine16807 engine;
+	thread_local XC_RandomEngine16807 engine(
+		std::chrono::system_clock::now().time_since_epoch().count()
+		^ std::hash<std::thread::id>()(std::this_thread::get_id()));
 	return engine();
 }
 
+/**
+* @brief  Philox4x32-10 counter based generator
+* @ingroup VirtualQuantumProcessor
+* @note   the n-th number of a stream is a function of (seed, stream, n) only,
+*         so streams drawn from one seed in any thread and in any order give
+*         the same numbers. It meets UniformRandomBitGenerator for the std
+*         distributions
+*/
+class Philox4x32
+{
+public:
+	using result_type = uint32_t;
+
+	Philox4x32(uint64_t seed = 0, uint64_t stream = 0)
+		: m_seed(seed), m_stream(stream)
+	{ }
+
+	static constexpr result_type min() { return 0; }
+	static constexpr result_type max() { return UINT32_MAX; }
+
+	/**
+	* @brief  the 4 numbers of a block of a stream
+	* @param[in]  uint64_t  seed, the key of the cipher
+	* @param[in]  uint64_t  stream
+	* @param[in]  uint64_t  block index in the stream
+	*/
+	static std::array<uint32_t, 4> block(uint64_t seed, uint64_t stream, uint64_t index)
+	{
+		std::array<uint32_t, 4> ctr = { (uint32_t)index, (uint32_t)(index >> 32),
+			(uint32_t)stream, (uint32_t)(stream >> 32) };
+		uint32_t key[2] = { (uint32_t)seed, (uint32_t)(seed >> 32) };
+		for (int round = 0; round < 10; ++round)
+		{
+			uint64_t product_0 = (uint64_t)0xD2511F53 * ctr[0];
+			uint64_t product_1 = (uint64_t)0xCD9E8D57 * ctr[2];
+			ctr = { (uint32_t)(product_1 >> 32) ^ ctr[1] ^ key[0], (uint32_t)product_1,
+				(uint32_t)(product_0 >> 32) ^ ctr[3] ^ key[1], (uint32_t)product_0 };
+			key[0] += 0x9E3779B9;
+			key[1] += 0xBB67AE85;
+		}
+		return ctr;
+	}
+
+	inline result_type operator()()
+	{
+		if (4 == m_position)
+		{
+			m_block = block(m_seed, m_stream, m_index++);
+			m_position = 0;
+		}
+		return m_block[m_position++];
+	}
+
+	/**
+	* @brief  uniform double in [0, 1) of 53 random bits
+	*/
+	inline double random_double()
+	{
+		uint64_t high = (*this)() >> 5;
+		uint64_t low = (*this)() >> 6;
+		return (high * 67108864. + low) / 9007199254740992.;
+	}
+
+	inline uint64_t random_uint64()
+	{
+		uint64_t high = (*this)();
+		return (high << 32) | (*this)();
+	}
+
+	uint64_t seed() const { return m_seed; }
+	uint64_t stream() const { return m_stream; }
+
+private:
+	uint64_t m_seed;
+	uint64_t m_stream;
+	uint64_t m_index{ 0 };
+	std::array<uint32_t, 4> m_block{};
+	size_t m_position{ 4 };
+};
+
+/**
+* @brief  Philox Random Engine
+* @ingroup VirtualQuantumProcessor
+* @note   set on a quantum machine, it draws the measures and the seeds of the
+*         shot sampling, which then give the same results for the same seed
+*         whatever the threads. stream() hands out generators independent of
+*         the engine and of each other, one per thread, shot or trajectory
+*/
+class PhiloxRandomEngine : public RandomEngine {
+private:
+	Philox4x32 engine;
+public:
+	PhiloxRandomEngine()
+		:engine(std::chrono::system_clock::now().time_since_epoch().count())
+	{ }
+
+	PhiloxRandomEngine(uint64_t seed)
+		:engine(seed) { }
+
+	inline double operator()() {
+		return engine.random_double();
+	}
+
+	/**
+	* @brief  generator of a stream of the seed, stream 0 is the one of the engine itself
+	*/
+	inline Philox4x32 stream(uint64_t stream_id) const {
+		return Philox4x32(engine.seed(), stream_id + 1);
+	}
+};
+
 class RandomEngine19937
 {
 public:
@@ -106,7 +223,11 @@ public:
 
     void set_random_seed()
     {
-        m_mt.seed(std::chrono::system_clock::now().time_since_epoch().count());
+        /* threads that start in the same clock tick still get their own sequence */
+        uint64_t time = std::chrono::system_clock::now().time_since_epoch().count();
+        uint64_t thread = std::hash<std::thread::id>()(std::this_thread::get_id());
+        std::seed_seq seq{ (uint32_t)time, (uint32_t)(time >> 32), (uint32_t)thread, (uint32_t)(thread >> 32) };
+        m_mt.seed(seq);
     }
 
     void set_random_seed(size_t seed)
@@ -128,10 +249,23 @@ private:
     std::mt19937_64 m_mt;
 };
 
+/* one generator per thread, so that machines in different threads don't share it */
 inline double random_generator19937(double begine = 0, double end = 1)
 {
-    static RandomEngine19937 rng;
+    thread_local RandomEngine19937 rng;
     return rng.random_double(begine, end);
 }
 
+/**
+* @brief  a 64 bit seed of two draws of an engine, of random_generator19937 without one
+*/
+inline uint64_t random_seed64(RandomEngine* engine = nullptr)
+{
+    auto draw = [engine]() {
+        return (uint64_t)((nullptr == engine ? random_generator19937() : (*engine)()) * 4294967296.);
+    };
+    uint64_t high = draw();
+    return (high << 32) | draw();
+}
+
 #endif // RANDOM_ENGINE_H
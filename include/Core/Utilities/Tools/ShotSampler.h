@@ -0,0 +1,73 @@
+/*
+Copyright (c) 2017-2020 Origin Quantum Computing. All Right Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+/*! \file ShotSampler.h */
+#ifndef SHOT_SAMPLER_H
+#define SHOT_SAMPLER_H
+
+#include <map>
+#include <vector>
+#include <cstdint>
+#include "Core/Utilities/QPandaNamespace.h"
+
+QPANDA_BEGIN
+
+/**
+* @brief  draws shots from a discrete distribution through an alias table
+* @ingroup Utilities
+* @note   the table is built once in O(N), each shot then costs O(1).
+*         Shots are counted by outcome index, so the caller converts an
+*         outcome to its string form once, not once per shot
+*/
+class ShotSampler
+{
+public:
+	/**
+	* @brief  build the alias table of a distribution
+	* @param[in]  const prob_vec&  probability of each outcome, normalized here
+	*/
+	ShotSampler(const prob_vec& probs);
+
+	/**
+	* @brief  map a uniform random number to an outcome
+	* @param[in]  double  random number in [0, 1)
+	* @return     size_t  outcome index
+	*/
+	size_t sample(double random) const;
+
+	/**
+	* @brief  draw shots and count them by outcome
+	* @param[in]  size_t  shots
+	* @param[in]  uint64_t  seed of the random streams
+	* @return     std::map<size_t, size_t>  outcome index -> count, outcomes never drawn are absent
+	* @note   shots are split into streams of a fixed size, each a Philox stream
+	*         of the seed, so the counts only depend on the seed, not on the threads
+	*/
+	std::map<size_t, size_t> sample_counts(size_t shots, uint64_t seed) const;
+
+	/**
+	* @brief  draw shots and count them by outcome, seeded from the global generator
+	*/
+	std::map<size_t, size_t> sample_counts(size_t shots) const;
+
+	size_t size() const { return m_alias.size(); }
+
+private:
+	std::vector<double> m_threshold;
+	std::vector<size_t> m_alias;
+};
+
+QPANDA_END
+#endif // !SHOT_SAMPLER_H
@@ -19,6 +19,8 @@ Classes for get the shortes path of graph
 #include "Core/QuantumMachine/OriginQuantumMachine.h"
 #include <iostream>
 #include <map>
+#include <memory>
+#include <cstdio>
 #include <stddef.h>
 
 #pragma warning( disable : 4996)
@@ -50,6 +52,15 @@ QProg Reset_All(std::vector<Qubit*> qubit_vector, bool setVal,QuantumMachine * q
 */
 QCircuit parityCheckCircuit(std::vector<Qubit*> qubit_vec);
 
+/**
+* @brief  create a temporary file that has no name left in a directory
+* @param[in]  const std::string&  directory of the file, $TMPDIR or /tmp if empty
+* @param[in]  const std::string&  start of the temporary name
+* @return     std::shared_ptr<FILE>  the file, its blocks are freed when it is closed,
+*                                    nullptr if it can't be created
+*/
+std::shared_ptr<FILE> create_unnamed_file(const std::string& directory, const std::string& prefix);
+
 /**
 * @brief  Apply Quantum Gate on a series of Qubit
 * @ingroup Utilities
@@ -17,6 +17,8 @@ QPANDA_BEGIN
 class AbstractDistributedFullAmplitudeEngine
 {
 public:
+    virtual ~AbstractDistributedFullAmplitudeEngine() {}
+
     virtual void initState(int head_rank, int rank_size, int qubit_num) = 0;
     virtual void initState(size_t qubit_num, const QStat &state = {}) = 0;
 
@@ -26,6 +28,7 @@ public:
 
     virtual void doubleQubitOperation(const int &iQn1, const int &iQn2, QStat U, bool isConjugate) = 0;
     virtual void controldoubleQubitOperation(const int &iQn1, const int &iQn2, Qnum& qnum, QStat U, bool isConjugate) = 0;
+    virtual void controlOracleOperation(const Qnum& qubits, const Qnum& controls, QStat U, bool isConjugate) = 0;
 
     virtual int  measureQubitOperation(const int &qn) = 0;
     virtual void PMeasureQubitOperation(Qnum& qnum, prob_vec &mResult) = 0;
@@ -51,6 +54,13 @@ private:
 class DistributedFullAmplitudeEngine :public QPUImpl
 {
 public:
+    /**
+    * @brief  constructor
+    * @param[in]  bool  whether MPI ranks on one node share the state memory
+    */
+    DistributedFullAmplitudeEngine(bool use_shared_memory = true);
+    ~DistributedFullAmplitudeEngine();
+
     bool qubitMeasure(size_t qn);
 
     void set_parallel_threads_size(size_t size);
@@ -58,6 +68,7 @@ public:
     QError pMeasure(Qnum& qnum, prob_vec &mResult);
 
     QError initState(size_t head_rank, size_t rank_size, size_t qubit_num);
+    QError initState(size_t qubit_num, const QStat &state = {});
 
     QError unitarySingleQubitGate(size_t qn, QStat& matrix,
         bool isConjugate,
@@ -79,17 +90,29 @@ public:
         QStat& matrix,
         bool isConjugate,
         GateType);
+
+    QError OracleGate(Qnum& qubits, QStat &matrix,
+        bool isConjugate);
+    QError controlOracleGate(Qnum& qubits, const Qnum& controls,
+        QStat &matrix, bool isConjugate);
     
     virtual QError process_noise(Qnum& qnum, QStat& matrix){
         QCERR_AND_THROW(std::runtime_error, "Not implemented yet");
     }
 
+    QError debug(std::shared_ptr<QPanda::AbstractQDebugNode> debugger);
+
     QStat getQState();
 
 	QError Reset(size_t qn);
 
 private:
+    /* apply a gate by its matrix on its targets */
+    QError _apply_gate(Qnum qubits, Qnum controls, const QStat& matrix,
+        bool isConjugate, GateType type, bool is_controlled);
+
     AbstractDistributedFullAmplitudeEngine * _PQGates = nullptr;
+    QStat m_debug_state;
 };
 
 QPANDA_END
@@ -18,21 +18,105 @@ limitations under the License.
 #define CPU_QUANTUM_GATE_H
 
 #include <vector>
+#include <bitset>
+#include <memory>
+#include <algorithm>
 #include <stdio.h>
 #include <iostream>
 #include "Core/Utilities/Tools/Utils.h"
 #include "Core/VirtualQuantumProcessor/QPUImpl.h"
+#include "Core/VirtualQuantumProcessor/StateAllocator.h"
 
 
 QPANDA_BEGIN
 
+/**
+* @brief Index map of the controlled gate kernels
+* @ingroup VirtualQuantumProcessor
+* @note  the i-th index is the i-th amplitude whose control qubits are 1 and
+*        whose target qubits are 0, a gate with k controls and targets
+*        visits 2^(n-k) amplitudes instead of testing all of them
+*/
+class ControlSubspace
+{
+public:
+    /**
+    * @brief  constructor
+    * @param[in]  const Qnum&  control qubits, the targets in it are ignored
+    * @param[in]  const Qnum&  target qubits
+    */
+    ControlSubspace(const Qnum& controls, const Qnum& targets)
+        : m_qubits(controls)
+    {
+        for (auto qubit : controls)
+        {
+            if (std::find(targets.begin(), targets.end(), qubit) == targets.end())
+            {
+                m_mask |= 1ll << qubit;
+            }
+        }
+
+        m_qubits.insert(m_qubits.end(), targets.begin(), targets.end());
+        std::sort(m_qubits.begin(), m_qubits.end());
+        m_qubits.erase(std::unique(m_qubits.begin(), m_qubits.end()), m_qubits.end());
+    }
+
+    /**
+    * @brief  number of indices in a state of qubit_num qubits
+    */
+    int64_t size(size_t qubit_num) const
+    {
+        return 1ll << (qubit_num - m_qubits.size());
+    }
+
+    /**
+    * @brief  deposit the bits of value around the fixed qubits, from the lowest one
+    */
+    inline int64_t operator()(int64_t value) const
+    {
+        for (auto qubit : m_qubits)
+        {
+            int64_t low = value & ((1ll << qubit) - 1);
+            value = ((value ^ low) << 1) | low;
+        }
+        return value | m_mask;
+    }
+
+private:
+    Qnum m_qubits;
+    int64_t m_mask{ 0 };
+};
+
+/**
+* @brief  the matrix a gate applies on its targets where its controls are all 1
+* @ingroup VirtualQuantumProcessor
+* @param[in]  GateType  gate type
+* @param[in]  bool  whether the gate is controlled
+* @param[in]  const QStat&  matrix of the gate
+* @param[in]  bool  whether the gate is daggered
+* @param[in,out]  Qnum&  qubits of the gate, the targets on return,
+*                        targets[0] is the lowest bit of the matrix index
+* @param[in,out]  Qnum&  controls of the gate, with the control qubits
+*                        of gates like CNOT appended on return
+* @param[out]  QStat&  matrix on the targets with the dagger taken,
+*                      empty targets for gates doing nothing
+* @note   a backend applying this matrix gets the states of the CPU kernels
+*/
+void gate_target_operator(GateType type, bool is_controlled, const QStat& matrix,
+    bool is_dagger, Qnum& qubits, Qnum& controls, QStat& target_matrix);
+
 /**
 * @brief QPU implementation by  CPU model
 * @ingroup VirtualQuantumProcessor
+* @note  data_t is the precision of the state amplitudes (double or float),
+*        gate matrices and the QPUImpl interface stay in double precision
 */
+template <typename data_t = double>
 class CPUImplQPU : public QPUImpl
 {
 public:
+    using cstate_t = std::vector<std::complex<data_t>, StateAllocator<std::complex<data_t>>>;
+
     CPUImplQPU();
     CPUImplQPU(size_t qubit_num);
     ~CPUImplQPU();
@@ -40,6 +124,7 @@ public:
     template<const qcomplex_t& U00, const qcomplex_t& U01, const qcomplex_t& U10, const qcomplex_t& U11>
     QError single_gate(size_t qn, bool is_dagger, double error_rate)
     {
+        _flush_gates();
         QStat matrix = { U00, U01, U10, U11 };
         _single_qubit_normal_unitary(qn, matrix, is_dagger);
 
@@ -49,6 +134,7 @@ public:
 
     QError U1_GATE(size_t qn, double theta, bool is_dagger, double error_rate)
     {
+        _flush_gates();
         QStat matrix = { 1, 0, 0, qcomplex_t(cos(theta),sin(theta)) };
         _U1(qn, matrix, is_dagger);
         return qErrorNone;
@@ -56,6 +142,7 @@ public:
 
 	QError P_GATE(size_t qn, double theta, bool is_dagger, double error_rate)
 	{
+		_flush_gates();
 		QStat matrix = { 1, 0, 0, qcomplex_t(cos(theta),sin(theta)) };
 		_U1(qn, matrix, is_dagger);
 		return qErrorNone;
@@ -65,6 +152,7 @@ public:
     template<const double& Nx, const double& Ny, const double& Nz>
     QError single_angle_gate(size_t qn, double theta, bool is_dagger, double error_rate)
     {
+        _flush_gates();
         qcomplex_t U00(cos(theta / 2), -sin(theta / 2)*Nz);
         qcomplex_t U01(-sin(theta / 2)*Ny, -sin(theta / 2)*Nx);
         qcomplex_t U10(sin(theta / 2)*Ny, -sin(theta / 2)*Nx);
@@ -83,6 +171,7 @@ public:
         bool is_dagger,
         double error_rate)
     {
+        _flush_gates();
         qcomplex_t U00(cos(theta / 2), -sin(theta / 2)*Nz);
         qcomplex_t U01(-sin(theta / 2)*Ny, -sin(theta / 2)*Nx);
         qcomplex_t U10(sin(theta / 2)*Ny, -sin(theta / 2)*Nx);
@@ -103,6 +192,7 @@ public:
             bool is_dagger,
             double error_rate)
     {
+        _flush_gates();
         QStat matrix = { U00, U01, U10, U11 };
         _single_qubit_normal_unitary(qn, vControlBit, matrix, is_dagger);
         return qErrorNone;
@@ -140,23 +230,177 @@ public:
     QStat getQState();
     QError Reset(size_t qn);
     bool qubitMeasure(size_t qn);
+    QError qubitCollapse(size_t qn, bool outcome, double prob);
+    QPUImpl* clone();
     QError pMeasure(Qnum& qnum, prob_tuple &probs,
         int select_max = -1);
     QError pMeasure(Qnum& qnum, prob_vec &probs);
     QError initState(size_t head_rank, size_t rank_size, size_t qubit_num);
     QError initState(size_t qubit_num, const QStat &state = {});
+
+    /**
+    * @brief  set the initial state of some qubits, the other qubits start from |0>
+    * @param[in]  size_t  qubit num
+    * @param[in]  const QStat&  state of 2^qubits.size() amplitudes, bit j of the index is qubits[j]
+    * @param[in]  const Qnum&  qubits of the state
+    * @note   the state of all the qubits is written straight to where it is kept,
+    *         it is never held as a whole besides
+    */
+    QError initState(size_t qubit_num, const QStat& state, const Qnum& qubits);
 	QError initMatrixState(size_t qubit_num, const QStat& state = {});
 
+    /**
+    * @brief  set the working state, without keeping it as the initial state
+    * @param[in]  size_t  qubit num
+    * @param[in]  const QStat&  state of 2^qubit_num amplitudes
+    * @note   the next initState(head_rank, rank_size, qubit_num) starts from |0...0> again
+    */
+    QError loadState(size_t qubit_num, const QStat& state);
+
+    /**
+    * @brief  set the qubits from which a custom initial state is kept in a file
+    * @param[in]  size_t  qubit num, 16 by default, 0 keeps every initial state in memory
+    * @note   a kept state is reloaded at every initState(head_rank, rank_size, qubit_num).
+    *         A state in a file doesn't hold a second state in memory, but costs a file
+    *         write and a read per run; below 16 qubits the copy in memory is at most 1 MB
+    *         and cheaper than the file. A state no file can be written for stays in memory.
+    */
+    void set_init_state_spill_qubits(size_t qubit_num) { m_init_state_spill_qubits = qubit_num; }
+
+    /**
+    * @brief  set the directory of the initial state files
+    * @param[in]  const std::string&  directory, $TMPDIR or /tmp if empty
+    * @note   /tmp is often a tmpfs in memory, large states want a directory on disk
+    */
+    void set_init_state_directory(const std::string& directory) { m_init_state_directory = directory; }
+
+    /**
+    * @brief  set the qubits of the cache blocks that gate runs are executed in
+    * @param[in]  size_t  block qubits, 0 turns the cache blocking off
+    * @note   gates are queued, runs of diagonal gates are applied in one
+    *         pass, and runs of gates acting on at most block qubits are
+    *         applied block by block of 2^qubits amplitudes,
+    *         runs on high qubits are swapped onto free low qubits first.
+    *         With fewer blocks than threads, the other gates run in one
+    *         parallel region synchronized only around gates on high qubits.
+    *         The queue is flushed before the state is read or measured.
+    */
+    void set_cache_block_qubits(size_t qubit_num);
+
+    /**
+    * @brief  set the pages backing the state vector
+    * @param[in]  StatePageMode  page mode
+    * @note   takes effect at the next initState, the state is first touched
+    *         in parallel with the schedule of the gate loops
+    */
+    void set_state_page_mode(StatePageMode mode);
+
+    /**
+    * @brief  set the qubit addresses the next prog uses
+    * @param[in]  const Qnum&  used qubit addresses
+    * @note   the next initState(head_rank, rank_size, qubit_num) allocates
+    *         a register of the used qubits only, the state, measurements
+    *         and pmeasure results still use the prog addresses where the
+    *         unused qubits read as |0>. Ignored with a custom initial state.
+    */
+    void set_used_qubits(const Qnum& qubits);
+
+    /**
+    * @brief  reduced density matrix of the qubits, the other qubits traced out
+    * @param[in]  const Qnum&  prog addresses of the qubits
+    * @return QStat  row major matrix, bit j of the index is qubits[j]
+    * @note   computed on the state in place as a Gram matrix, block by block
+    */
+    QStat reduced_density_matrix(const Qnum& qubits);
+
+    /**
+    * @brief  Schmidt spectrum of the state across the cut between the qubits and the others
+    * @param[in]  const Qnum&  prog addresses of the qubits on one side of the cut
+    * @return prob_vec  squared Schmidt coefficients in descending order, one for
+    *                   every basis state of the smaller side
+    */
+    prob_vec schmidt_spectrum(const Qnum& qubits);
+
+    /**
+    * @brief  entanglement entropy in bits between the qubits and the others
+    * @param[in]  const Qnum&  prog addresses of the qubits on one side of the cut
+    * @param[in]  double  order of the Renyi entropy, 1 for the von Neumann entropy
+    */
+    double entanglement_entropy(const Qnum& qubits, double alpha = 1);
+
+    /**
+    * @brief  expectation of a hamiltonian on the state in place
+    * @param[in]  const QHamiltonian&  pauli terms on prog addresses
+    * @param[out]  double&  expectation
+    * @note   terms that flip the same qubits form a family, <psi|P|psi> of
+    *         all the terms of a family is summed in one sweep over the
+    *         amplitude pairs the flip connects, diagonal terms need |psi|^2 only
+    */
+    QError pauliExpectation(const QHamiltonian& hamiltonian, double& expectation);
+
 protected:
+    enum class GateCallType
+    {
+        SINGLE,
+        DOUBLE,
+        ORACLE
+    };
+
+    /* a queued gate, controls of single and double qubit gates contain the targets */
+    struct GateCall
+    {
+        GateCallType call_type;
+        bool is_controlled;
+        Qnum qubits;
+        Qnum controls;
+        QStat matrix;
+        bool is_dagger;
+        GateType gate_type;
+    };
+
+    /* diagonal of a gate, bit j of the index is qubits[j] */
+    struct DiagonalTerm
+    {
+        Qnum qubits;
+        QStat diagonal;
+    };
+
+    /* a queued gate compiled for a gate sequence, bit j of the matrix index is qubits[j] */
+    struct SequenceGate
+    {
+        Qnum qubits;
+        QStat matrix;
+        ControlSubspace subspace;
+        bool is_local;
+    };
+
+    inline bool _can_defer_gate() const
+    {
+        return !m_is_flushing && m_cache_block_qubits > 0
+            && m_qubit_num > m_cache_block_qubits;
+    }
+
+    QError _defer_gate(GateCall&& call);
+    void _flush_gates();
+    void _run_gate_block(size_t begin, size_t end, const std::bitset<64>& used);
+    void _swap_qubits(const Qnum& qubits_0, const Qnum& qubits_1);
+    void _apply_diagonal_terms(const std::vector<DiagonalTerm>& terms);
+    static bool _diagonal_term(const GateCall& call, DiagonalTerm& term);
+    static void _apply_gate(CPUImplQPU<data_t>& qpu, const GateCall& call, const Qnum& relabel);
+    static std::bitset<64> _gate_qubits(const GateCall& call);
+    void _run_gate_sequence(size_t begin, size_t end, const Qnum& identity);
+    static bool _sequence_gate(const GateCall& call, Qnum& qubits, Qnum& controls, QStat& matrix);
+    template <size_t K>
+    void _sequence_kernel(const SequenceGate& gate, int64_t part_num);
 	
     QError _single_qubit_normal_unitary(size_t qn, QStat& matrix, bool is_dagger);
     QError _single_qubit_normal_unitary(size_t qn, Qnum& controls, QStat& matrix, bool is_dagger);
 
     QError _double_qubit_normal_unitary(size_t qn_0, size_t qn_1, QStat& matrix, bool is_dagger);
     QError _double_qubit_normal_unitary(size_t qn_0, size_t qn_1, Qnum& controls, QStat& matrix, bool is_dagger);
-	QError _three_qubit_gate(Qnum &qubits, QStat& matrix, bool is_dagger, const Qnum& controls = {});
-	QError _four_qubit_gate(Qnum &qubits, QStat& matrix, bool is_dagger, const Qnum& controls = {});
-	QError _five_qubit_gate(Qnum &qubits, QStat& matrix, bool is_dagger, const Qnum& controls = {});
+    QError _oracle_gate(const Qnum &qubits, const QStat& matrix, bool is_dagger, const Qnum& controls);
+    template <size_t K>
+    QError _k_qubit_gate(const Qnum &qubits, const QStat& matrix, bool is_dagger, const Qnum& controls);
 	QError _X(size_t qn);
     QError _Y(size_t qn);
     QError _Z(size_t qn);
@@ -266,34 +510,37 @@ protected:
         return ((y << 1) | x);
     }
 
-	int64_t _insert(int64_t value, Qnum &qns)
-	{
-		std::sort(qns.begin(), qns.end());
-		std::vector<int> MASK(qns.size());
-		for (int i = 0; i < qns.size(); i++)
-		{
-			MASK[i] = (1 << (qns[i] - i)) - 1;
-		}
-		std::vector<int> tmp(MASK.size() + 1);
-		tmp[0] = MASK[0] & value;
+    void _verify_state(const QStat &state);
+    int _omp_thread_num(size_t size);
 
-		for (int i = 1; i < tmp.size() - 1; i++)
-		{
-			tmp[i] = ~MASK[i - 1] & value & MASK[i];
-		}
-		tmp[tmp.size() - 1] = ~MASK[MASK.size() - 1] & value;
+    /*
+      reallocates state with size elements left uninitialized unless it
+      already fits, true if it did
+    */
+    bool _alloc_state(cstate_t& state, size_t size);
 
-		int offset = tmp[0];
-		for (int i = 1; i < tmp.size(); i++)
-		{
-			offset += tmp[i] << i;
-		}
+    /* keep the initial state of size amplitudes given by amplitude(index), in a file if it is large */
+    template <typename Func>
+    void _keep_init_state(size_t size, const Func& amplitude);
 
-		return offset;
-	}
+    /* write the initial state to a file in m_init_state_directory, false if it can't be written */
+    template <typename Func>
+    bool _spill_init_state(size_t size, const Func& amplitude);
+    void _load_init_state();
 
-    void _verify_state(const QStat &state);
-    inline int _omp_thread_num(size_t size);
+    /* keep the half of the state where register qubit qn is outcome, renormalized by its probability */
+    void _qubit_collapse(size_t qn, bool outcome, double prob);
+
+    /* the amplitudes of the register with the queued gates applied, bit j of the index is register qubit j */
+    QStat _register_state();
+
+    /* sum over the other qubits of |psi_a><psi_b| on the register qubits, row major */
+    QStat _gram_matrix(const Qnum& qubits);
+
+    /* register qubit of a prog address when the register is compacted */
+    size_t _register_qubit(size_t qn) const;
+    Qnum _register_qubits(const Qnum& qubits) const;
+    bool _is_used_qubit(size_t qn) const;
 private:
     bool m_is_init_state{false};
     /* 
@@ -308,14 +555,35 @@ private:
       qubits state vetor of tensor product is arraged as sequence:
       m_state = [an...a1a0, an...a1b0, an...b1a0, an...b1b0, ..., bn...b1b0]
     */
-    QStat m_state;
-    QStat m_init_state;
+    cstate_t m_state;
+
+    /*
+      the initial state is reloaded at every initState, large ones from a
+      file so that they don't hold a second state in memory, m_init_state
+      keeps the small ones and the ones no file can be written for
+    */
+    size_t m_init_state_spill_qubits{ 16 };
+    std::string m_init_state_directory;
+    std::shared_ptr<FILE> m_init_state_file;
+    cstate_t m_init_state;
+    QStat m_debug_state;
     size_t m_qubit_num;
-    const int64_t m_threshold = 1ll << 9;
+
+    /* prog addresses used by the next initState */
+    Qnum m_used_qubits;
+    /* prog address of every register qubit, and register qubit of every prog address */
+    Qnum m_register_qubits;
+    Qnum m_qubit_map;
+    int64_t m_threshold = 1ll << 9;
     int64_t m_max_threads_size = 0;
+
+    size_t m_cache_block_qubits;
+    StatePageMode m_page_mode{ StatePageMode::TRANSPARENT_HUGE };
+    bool m_is_flushing{ false };
+    std::vector<GateCall> m_pending_gates;
 };
 
-class CPUImplQPUWithOracle : public CPUImplQPU {
+class CPUImplQPUWithOracle : public CPUImplQPU<double> {
 public:
     QError controlOracularGate(std::vector<size_t> bits,
         std::vector<size_t> controlbits,
@@ -0,0 +1,144 @@
+/*
+Copyright (c) 2017-2020 Origin Quantum Computing. All Right Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+/*! \file MPIFullAmplitudeEngine.h */
+#ifndef MPI_FULL_AMPLITUDE_ENGINE_H
+#define MPI_FULL_AMPLITUDE_ENGINE_H
+
+#include "QPandaConfig.h"
+#include "Core/VirtualQuantumProcessor/AbstractFullAmplitudeEngine.h"
+#ifdef USE_MPI
+#include "mpi.h"
+#endif
+
+QPANDA_BEGIN
+
+/**
+* @brief Full amplitude engine with the state vector partitioned over MPI ranks
+* @ingroup VirtualQuantumProcessor
+* @note  With 2^r ranks, rank k holds the 2^(n-r) amplitudes whose r highest
+*        qubits are the bits of k. Gates on the other qubits are local, a gate
+*        on high qubits exchanges the amplitudes of the ranks that differ in
+*        its high targets, chunk by chunk. When all the ranks are on one node,
+*        the state is in an MPI shared memory window and the ranks read the
+*        amplitudes of each other in place instead of sending them.
+*        Measure results are drawn on rank 0 and broadcast, so every rank
+*        runs the same prog with the same results.
+*        Without USE_MPI it runs as a single rank.
+*        The targets of the matrix of a gate are in the order of the qubits,
+*        the first one is the lowest bit of the matrix index.
+*/
+class MPIFullAmplitudeEngine : public AbstractDistributedFullAmplitudeEngine
+{
+public:
+    /**
+    * @brief  constructor, it initializes MPI if it is not yet
+    * @param[in]  bool  whether ranks on one node share the state memory
+    */
+    MPIFullAmplitudeEngine(bool use_shared_memory = true);
+    ~MPIFullAmplitudeEngine();
+
+    int get_rank() const
+    {
+        return m_rank;
+    }
+
+    int get_rank_size() const
+    {
+        return m_rank_size;
+    }
+
+    /**
+    * @brief  whether the state is in shared memory
+    */
+    bool is_shared_memory() const
+    {
+        return m_is_shared_memory;
+    }
+
+    void initState(int head_rank, int rank_size, int qubit_num);
+    void initState(size_t qubit_num, const QStat &state = {});
+
+    /**
+    * @brief  get the state
+    * @param[in]  bool  the whole state on every rank, or the amplitudes of this rank only
+    */
+    QStat getQState(bool is_all_state = true);
+
+    void singleQubitOperation(const int &iQn, QStat U, bool isConjugate);
+    void controlsingleQubitOperation(const int &iQn, Qnum& qnum, QStat U, bool isConjugate);
+
+    void doubleQubitOperation(const int &iQn1, const int &iQn2, QStat U, bool isConjugate);
+    void controldoubleQubitOperation(const int &iQn1, const int &iQn2, Qnum& qnum, QStat U, bool isConjugate);
+
+    void controlOracleOperation(const Qnum& qubits, const Qnum& controls, QStat U, bool isConjugate);
+
+    int  measureQubitOperation(const int &qn);
+    void PMeasureQubitOperation(Qnum& qnum, prob_vec &mResult);
+
+    void reset_qubit_operation(const int &qn);
+
+private:
+    void distributeOneRank_doubleQubitOperation(const int &iQn1, const int &iQn2, QStat U, bool isConjugate);
+    void distributeTwoRank_doubleQubitOperation(const int &iQn1, const int &iQn2, QStat U, bool isConjugate);
+    void distributeFourRank_doubleQubitOperation(const int &iQn1, const int &iQn2, QStat U, bool isConjugate);
+
+    qstate_type distributeAllRank_measureQubitOperation(const int &qn);
+    qstate_type distributeHalfRank_measureQubitOperation(const int &qn);
+
+    void distributeAllRank_handleMeasureState(const int &qn, int &result, const qstate_type &prob);
+    void distributeHalfRank_handleMeasureState(const int &qn, int &result, const qstate_type &prob);
+
+    /* apply U on the qubits where the controls are all 1 */
+    void _apply_gate(const Qnum& qubits, const Qnum& controls, const QStat& U);
+    void _local_gate(const Qnum& qubits, const Qnum& controls, const QStat& U);
+    void _global_gate(const Qnum& qubits, const Qnum& controls, const QStat& U, bool is_selected);
+
+    /* amplitudes of rank at indices, this rank sends the same ones in return */
+    void _fetch(int rank, const std::vector<int64_t>& indices, QStat& buffer);
+    void _synchronize();
+    double _reduce_sum(double value);
+
+    void _allocate_state(size_t qubit_num);
+    void _free_state();
+
+    int _omp_thread_num(size_t size) const;
+
+    int m_rank{ 0 };
+    int m_rank_size{ 1 };
+    size_t m_rank_qubits{ 0 };
+    size_t m_qubit_num{ 0 };
+    size_t m_local_qubits{ 0 };
+    int64_t m_local_size{ 0 };
+    qcomplex_t* m_state{ nullptr };
+    QStat m_local_state;
+
+    bool m_use_shared_memory;
+    bool m_is_shared_memory{ false };
+#ifdef USE_MPI
+    MPI_Comm m_comm{ MPI_COMM_NULL };
+    MPI_Win m_window{ MPI_WIN_NULL };
+    std::vector<qcomplex_t*> m_rank_states;
+#endif
+    QStat m_send_buffer;
+
+    bool m_is_init_state{ false };
+    QStat m_init_state;
+
+    int64_t m_threshold = 1ll << 9;
+};
+
+QPANDA_END
+#endif // !MPI_FULL_AMPLITUDE_ENGINE_H
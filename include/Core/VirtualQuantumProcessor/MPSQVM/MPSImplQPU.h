@@ -41,6 +41,10 @@ public:
 
 	bool qubitMeasure(size_t qn);
 
+	QError qubitCollapse(size_t qn, bool outcome, double prob);
+
+	QPUImpl* clone();
+
 	QError pMeasure(Qnum& qnum, prob_vec &mResult);
 
 	QError initState(size_t head_rank, size_t rank_size, size_t qubit_num);
@@ -241,10 +245,34 @@ public:
 
 	bool apply_measure(size_t qubit);
 
+	/**
+	* @brief project a qubit onto an outcome and propagate it along the chain
+	* @param[in]  size_t  the qubit, the chain is in sorted ordering
+	* @param[in]  bool  the outcome
+	* @param[in]  double  the probability of the outcome
+	*/
+	void apply_collapse(size_t qubit, bool outcome, double prob);
+
 	Qnum apply_measure(Qnum qubits);
 
     cmatrix_t density_matrix(const Qnum &qubits);
 
+	/**
+	* @brief Schmidt spectrum of the state across the cut between the qubits and the others
+	* @param[in]  const Qnum&  the qubits on one side of the cut
+	* @return prob_vec  squared Schmidt coefficients in descending order
+	* @note  when the qubits are at one end of the chain, it is the squared lambdas
+	*        of the bond, otherwise the spectrum of the density matrix of the smaller side
+	*/
+	prob_vec schmidt_spectrum(const Qnum &qubits);
+
+	/**
+	* @brief entanglement entropy in bits between the qubits and the others
+	* @param[in]  const Qnum&  the qubits on one side of the cut
+	* @param[in]  double  order of the Renyi entropy, 1 for the von Neumann entropy
+	*/
+	double entanglement_entropy(const Qnum &qubits, double alpha = 1);
+
     double expectation_value(const Qnum &qubits, const cmatrix_t &matrix);
 
     double single_expectation_value(const Qnum &qubits, const cmatrix_t &matrix);
@@ -31,6 +31,20 @@ public:
     prob_vec PMeasure_no_index(QVec qubits);
     prob_vec pMeasureNoIndex(QVec qubit_vector);
 
+    /**
+    * @brief  get the Schmidt spectrum of the current state across the cut around qubits
+    * @param[in]  QVec  the qubits on one side of the cut
+    * @return prob_vec  squared Schmidt coefficients in descending order
+    */
+    prob_vec get_schmidt_spectrum(QVec qubits);
+
+    /**
+    * @brief  get the entanglement entropy in bits of the current state across the cut around qubits
+    * @param[in]  QVec  the qubits on one side of the cut
+    * @param[in]  double  order of the Renyi entropy, 1 for the von Neumann entropy
+    */
+    double get_entanglement_entropy(QVec qubits, double alpha = 1);
+
 
     qcomplex_t pmeasure_bin_index(QProg prog, std::string str);
     qcomplex_t pmeasure_dec_index(QProg prog, std::string str);
@@ -116,6 +130,10 @@ protected:
     void run_cannot_optimize_measure(QProg &prog);
 
     std::map<std::string, size_t> run_configuration_with_noise(QProg &prog, std::vector<ClassicalCondition> &cbits, int shots);
+
+    /* runs the shots of a prog with mid-circuit measures or control flow as branches of one run */
+    std::map<std::string, size_t> run_with_branching(QProgBranchExecution &branch_exec,
+        std::vector<ClassicalCondition> &cbits, int shots);
     
     //The all next functions are only for noise simulator
     std::map<std::string, size_t> run_configuration_without_noise(QProg &prog, std::vector<ClassicalCondition> &cbits, int shots);
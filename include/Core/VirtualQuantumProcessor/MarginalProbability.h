@@ -0,0 +1,343 @@
+/*
+Copyright (c) 2017-2020 Origin Quantum Computing. All Right Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+/*! \file MarginalProbability.h */
+#ifndef MARGINAL_PROBABILITY_H
+#define MARGINAL_PROBABILITY_H
+
+#include <vector>
+#include <complex>
+#include <algorithm>
+#include <stdexcept>
+#include "QPandaConfig.h"
+#include "Core/Utilities/QPandaNamespace.h"
+#ifdef USE_OPENMP
+#include <omp.h>
+#endif
+
+QPANDA_BEGIN
+
+/**
+* @brief Marginal probability engine of a full state vector
+* @ingroup VirtualQuantumProcessor
+* @note Amplitudes are accumulated without any lock: small outcome spaces use
+*       one histogram per thread that are merged at the end, large outcome
+*       spaces are split by outcome so that every thread owns its bins.
+*       Contiguous qubits and qubits lying in a narrow span are read as
+*       contiguous segments of the state.
+*/
+template<typename T>
+class MarginalProbability
+{
+public:
+    /**
+    * @brief  constructor
+    * @param[in]  const std::complex<T>*  state vector of 2^qubit_num amplitudes
+    * @param[in]  size_t  qubit number of the state
+    * @param[in]  int  max threads number
+    */
+    MarginalProbability(const std::complex<T>* state, size_t qubit_num, int threads = 1)
+        : m_state(state), m_qubit_num(qubit_num), m_threads(threads > 0 ? threads : 1)
+    {}
+
+    /**
+    * @brief  calculate marginal probabilities of qubits
+    * @param[in]  const Qnum&  qubits, bit j of the outcome index is qubits[j]
+    * @param[out]  prob_vec&  probabilities of the 2^qubits.size() outcomes
+    */
+    void calculate(const Qnum& qubits, prob_vec& probs)
+    {
+        for (auto qubit : qubits)
+        {
+            QPANDA_ASSERT(qubit >= m_qubit_num, "Error: pmeasure qubit out of range.");
+        }
+
+        probs.assign(1ull << qubits.size(), 0);
+        if (qubits.empty())
+        {
+            _contiguous(0, 0, probs);
+            return;
+        }
+
+        bool contiguous = true;
+        for (size_t i = 1; i < qubits.size(); i++)
+        {
+            if (qubits[i] != qubits[0] + i)
+            {
+                contiguous = false;
+                break;
+            }
+        }
+
+        if (contiguous)
+        {
+            _contiguous(qubits[0], qubits.size(), probs);
+            return;
+        }
+
+        auto min_qubit = *std::min_element(qubits.begin(), qubits.end());
+        auto max_qubit = *std::max_element(qubits.begin(), qubits.end());
+        size_t span = max_qubit - min_qubit + 1;
+        if (span <= kMaxSpan)
+        {
+            /* low-order or narrow subsets: stream the span, then fold it */
+            prob_vec span_probs(1ull << span, 0);
+            _contiguous(min_qubit, span, span_probs);
+            for (size_t i = 0; i < span_probs.size(); i++)
+            {
+                size_t idx = 0;
+                for (size_t j = 0; j < qubits.size(); j++)
+                {
+                    idx |= ((i >> (qubits[j] - min_qubit)) & 1ull) << j;
+                }
+                probs[idx] += span_probs[i];
+            }
+            return;
+        }
+
+        if (_use_local_histogram(qubits.size()))
+        {
+            _gather(qubits, probs);
+        }
+        else
+        {
+            _scatter(qubits, probs);
+        }
+    }
+
+private:
+    static const size_t kMaxSpan = 16;
+
+    /* one histogram per thread only pays when it is small beside the state */
+    bool _use_local_histogram(size_t measure_num) const
+    {
+        return (m_threads == 1) ||
+            ((1ull << measure_num) * m_threads <= (1ull << m_qubit_num) / 8);
+    }
+
+    static inline T _norm(const std::complex<T>& value)
+    {
+        return value.real() * value.real() + value.imag() * value.imag();
+    }
+
+    /* merge the per-thread histograms, each bin is owned by one thread */
+    void _merge(std::vector<prob_vec>& locals, prob_vec& probs) const
+    {
+        int64_t bins = probs.size();
+#pragma omp parallel for num_threads(_threads_for(bins))
+        for (int64_t i = 0; i < bins; i++)
+        {
+            double sum = 0;
+            for (auto& local : locals)
+            {
+                sum += local[i];
+            }
+            probs[i] += sum;
+        }
+    }
+
+    int _threads_for(int64_t work) const
+    {
+        return work > kParallelThreshold ? m_threads : 1;
+    }
+
+    /*
+      qubits [low, low + measure_num) are measured, the state is laid out as
+      index = high << (low + measure_num) | outcome << low | rest,
+      so every outcome owns contiguous segments of 2^low amplitudes
+    */
+    void _contiguous(size_t low, size_t measure_num, prob_vec& probs) const
+    {
+        int64_t segment_len = 1ll << low;
+        int64_t outcome_mask = (1ll << measure_num) - 1;
+        int64_t segments = 1ll << (m_qubit_num - low);
+        int threads = _threads_for(1ll << m_qubit_num);
+
+        if (1 == threads)
+        {
+            for (int64_t seg = 0; seg < segments; seg++)
+            {
+                probs[seg & outcome_mask] += _segment_sum(seg * segment_len, segment_len);
+            }
+            return;
+        }
+
+        if (_use_local_histogram(measure_num))
+        {
+            std::vector<prob_vec> locals(threads, prob_vec(probs.size(), 0));
+#pragma omp parallel for num_threads(threads)
+            for (int64_t seg = 0; seg < segments; seg++)
+            {
+                _local(locals)[seg & outcome_mask] += _segment_sum(seg * segment_len, segment_len);
+            }
+            _merge(locals, probs);
+        }
+        else
+        {
+            int64_t outcomes = outcome_mask + 1;
+            int64_t high_num = segments / outcomes;
+#pragma omp parallel for num_threads(threads)
+            for (int64_t outcome = 0; outcome < outcomes; outcome++)
+            {
+                double sum = 0;
+                for (int64_t high = 0; high < high_num; high++)
+                {
+                    sum += _segment_sum((high * outcomes + outcome) * segment_len, segment_len);
+                }
+                probs[outcome] = sum;
+            }
+        }
+    }
+
+    inline double _segment_sum(int64_t begin, int64_t len) const
+    {
+        double sum = 0;
+        for (int64_t i = begin; i < begin + len; i++)
+        {
+            sum += _norm(m_state[i]);
+        }
+        return sum;
+    }
+
+    inline prob_vec& _local(std::vector<prob_vec>& locals) const
+    {
+#ifdef USE_OPENMP
+        return locals[omp_get_thread_num()];
+#else
+        return locals[0];
+#endif
+    }
+
+    /*
+      bit lookup split in two halves of the index:
+      f(i) = low_table[i & low_mask] | high_table[i >> low_bits]
+    */
+    struct SplitTable
+    {
+        size_t low_bits;
+        int64_t low_mask;
+        std::vector<int64_t> low_table;
+        std::vector<int64_t> high_table;
+
+        inline int64_t operator()(int64_t i) const
+        {
+            return low_table[i & low_mask] | high_table[i >> low_bits];
+        }
+    };
+
+    /* table of the map: bit src[j] of the input -> bit dst[j] of the output */
+    static SplitTable _make_table(size_t bits_num, const Qnum& src, const Qnum& dst)
+    {
+        SplitTable table;
+        table.low_bits = bits_num / 2;
+        table.low_mask = (1ll << table.low_bits) - 1;
+        table.low_table.assign(1ull << table.low_bits, 0);
+        table.high_table.assign(1ull << (bits_num - table.low_bits), 0);
+
+        for (size_t j = 0; j < src.size(); j++)
+        {
+            if (src[j] < table.low_bits)
+            {
+                for (int64_t i = 0; i < (int64_t)table.low_table.size(); i++)
+                {
+                    table.low_table[i] |= ((i >> src[j]) & 1ll) << dst[j];
+                }
+            }
+            else
+            {
+                for (int64_t i = 0; i < (int64_t)table.high_table.size(); i++)
+                {
+                    table.high_table[i] |= ((i >> (src[j] - table.low_bits)) & 1ll) << dst[j];
+                }
+            }
+        }
+        return table;
+    }
+
+    /* every amplitude looks up its outcome and adds to a per-thread histogram */
+    void _gather(const Qnum& qubits, prob_vec& probs) const
+    {
+        Qnum outcome_bits(qubits.size());
+        for (size_t j = 0; j < qubits.size(); j++)
+        {
+            outcome_bits[j] = j;
+        }
+        auto table = _make_table(m_qubit_num, qubits, outcome_bits);
+
+        int64_t size = 1ll << m_qubit_num;
+        int threads = _threads_for(size);
+        if (1 == threads)
+        {
+            for (int64_t i = 0; i < size; i++)
+            {
+                probs[table(i)] += _norm(m_state[i]);
+            }
+            return;
+        }
+
+        std::vector<prob_vec> locals(threads, prob_vec(probs.size(), 0));
+#pragma omp parallel for num_threads(threads)
+        for (int64_t i = 0; i < size; i++)
+        {
+            _local(locals)[table(i)] += _norm(m_state[i]);
+        }
+        _merge(locals, probs);
+    }
+
+    /* every outcome enumerates its own amplitudes, bins are never shared */
+    void _scatter(const Qnum& qubits, prob_vec& probs) const
+    {
+        Qnum outcome_bits(qubits.size());
+        for (size_t j = 0; j < qubits.size(); j++)
+        {
+            outcome_bits[j] = j;
+        }
+        auto outcome_table = _make_table(qubits.size(), outcome_bits, qubits);
+
+        Qnum rest_qubits, rest_bits;
+        for (size_t q = 0; q < m_qubit_num; q++)
+        {
+            if (std::find(qubits.begin(), qubits.end(), q) == qubits.end())
+            {
+                rest_bits.push_back(rest_qubits.size());
+                rest_qubits.push_back(q);
+            }
+        }
+        auto rest_table = _make_table(rest_qubits.size(), rest_bits, rest_qubits);
+
+        int64_t outcomes = probs.size();
+        int64_t rest_num = 1ll << rest_qubits.size();
+#pragma omp parallel for num_threads(_threads_for(1ll << m_qubit_num))
+        for (int64_t outcome = 0; outcome < outcomes; outcome++)
+        {
+            int64_t base = outcome_table(outcome);
+            double sum = 0;
+            for (int64_t rest = 0; rest < rest_num; rest++)
+            {
+                sum += _norm(m_state[base | rest_table(rest)]);
+            }
+            probs[outcome] = sum;
+        }
+    }
+
+    static const int64_t kParallelThreshold = 1ll << 9;
+
+    const std::complex<T>* m_state;
+    size_t m_qubit_num;
+    int m_threads;
+};
+
+QPANDA_END
+#endif // !MARGINAL_PROBABILITY_H
@@ -0,0 +1,153 @@
+/*
+Copyright (c) 2017-2020 Origin Quantum Computing. All Right Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+/*! \file OutOfCoreImplQPU.h */
+#ifndef OUT_OF_CORE_IMPL_QPU_H
+#define OUT_OF_CORE_IMPL_QPU_H
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <complex>
+#include <stdio.h>
+#include "Core/VirtualQuantumProcessor/QPUImpl.h"
+#include "Core/VirtualQuantumProcessor/CPUImplQPU.h"
+
+QPANDA_BEGIN
+
+/**
+* @brief QPU implementation with the state vector kept out of RAM, in chunk files
+* @ingroup VirtualQuantumProcessor
+* @note  The state of n qubits is split into 2^(n-c) chunks of 2^c amplitudes,
+*        each one in a file that is memory mapped while it is worked on, c is
+*        the largest chunk two of which fit the memory budget.
+*        Gates are queued and applied chunk by chunk in one pass over the files.
+*        A gate on a qubit above the chunk first swaps it with the least recently
+*        used qubit inside the chunk, streaming pairs of chunks, so the qubits of
+*        the following gates are mostly inside the chunk; controls above the
+*        chunk only select the chunks the gate visits.
+*/
+template <typename data_t = double>
+class OutOfCoreImplQPU : public QPUImpl
+{
+public:
+    using amplitude_t = std::complex<data_t>;
+
+    /* 1 GB of mapped chunks */
+    static const size_t kDefaultMemoryBudget = 1ull << 30;
+
+    /**
+    * @brief  constructor
+    * @param[in]  const std::string&  directory of the chunk and initial state files, $TMPDIR or /tmp if empty
+    * @param[in]  size_t  bytes of the chunks mapped at a time
+    */
+    OutOfCoreImplQPU(const std::string& directory = "", size_t memory_budget = kDefaultMemoryBudget);
+    ~OutOfCoreImplQPU();
+
+    /**
+    * @brief  qubits of a chunk of the current state
+    */
+    size_t get_chunk_qubits() const
+    {
+        return m_chunk_qubits;
+    }
+
+    bool qubitMeasure(size_t qn);
+    QError pMeasure(Qnum& qnum, prob_vec &probs);
+
+    QError initState(size_t head_rank, size_t rank_size, size_t qubit_num);
+    QError initState(size_t qubit_num, const QStat &state = {});
+
+    QError unitarySingleQubitGate(size_t qn, QStat& matrix,
+        bool is_dagger, GateType type);
+    QError controlunitarySingleQubitGate(size_t qn, Qnum& controls,
+        QStat& matrix, bool is_dagger, GateType type);
+    QError unitaryDoubleQubitGate(size_t qn_0, size_t qn_1,
+        QStat& matrix, bool is_dagger, GateType type);
+    QError controlunitaryDoubleQubitGate(size_t qn_0, size_t qn_1,
+        Qnum& controls, QStat& matrix, bool is_dagger, GateType type);
+    QError OracleGate(Qnum& qubits, QStat &matrix, bool is_dagger);
+    QError controlOracleGate(Qnum& qubits, const Qnum& controls,
+        QStat &matrix, bool is_dagger);
+
+    QError process_noise(Qnum& qnum, QStat& matrix);
+    QError debug(std::shared_ptr<QPanda::AbstractQDebugNode> debugger);
+
+    /**
+    * @brief  get the whole state, it has to fit in RAM
+    */
+    QStat getQState();
+    QError Reset(size_t qn);
+    void set_parallel_threads_size(size_t size);
+
+protected:
+    /* a queued gate in the qubits of the chunks */
+    struct ChunkGate
+    {
+        Qnum qubits;                /* targets, all inside the chunk */
+        QStat matrix;               /* with the dagger taken */
+        ControlSubspace subspace;   /* controls inside the chunk */
+        int64_t chunk_mask;         /* controls above the chunk, on the chunk index */
+    };
+
+    /* queue a gate of matrix on the prog qubits where controls are all 1 */
+    void _apply_gate(const Qnum& qubits, const Qnum& controls, QStat matrix);
+    void _flush_gates();
+
+    template <size_t K>
+    void _chunk_kernel(amplitude_t* chunk, const ChunkGate& gate);
+    void _chunk_gate(amplitude_t* chunk, const ChunkGate& gate);
+
+    /* qubit inside the chunk not in qubits that was used the longest time ago */
+    size_t _victim_qubit(const Qnum& qubits) const;
+    void _swap_qubits(size_t low_qubit, size_t high_qubit);
+
+    double _zero_probability(size_t qubit);
+    void _create_chunks(size_t qubit_num);
+    void _clear_chunk(size_t chunk);
+    amplitude_t* _map_chunk(size_t chunk);
+    void _unmap_chunk(size_t chunk, amplitude_t* data);
+    void _load_init_state();
+
+    int _omp_thread_num(size_t size) const;
+
+private:
+    std::string m_directory;
+    size_t m_memory_budget;
+    size_t m_qubit_num{ 0 };
+    size_t m_chunk_qubits{ 0 };
+    std::vector<std::shared_ptr<FILE>> m_chunk_files;
+
+    /* chunk qubit of every prog qubit, and the other way round */
+    Qnum m_qubit_map;
+    Qnum m_chunk_qubit_owner;
+    std::vector<size_t> m_last_use;
+    size_t m_use_count{ 0 };
+
+    std::vector<ChunkGate> m_pending_gates;
+
+    bool m_is_init_state{ false };
+    std::shared_ptr<FILE> m_init_state_file;
+
+    QStat m_debug_state;
+    int64_t m_threshold = 1ll << 9;
+    int64_t m_max_threads_size = 0;
+};
+
+template <typename data_t>
+const size_t OutOfCoreImplQPU<data_t>::kDefaultMemoryBudget;
+
+QPANDA_END
+#endif // !OUT_OF_CORE_IMPL_QPU_H
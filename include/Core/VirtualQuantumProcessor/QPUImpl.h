@@ -26,6 +26,7 @@ limitations under the License.
 #include "Core/Utilities/Tools/RandomEngine/RandomEngine.h"
 #include "Core/QuantumCircuit/QGlobalVariable.h"
 #include "Core/Debugger/AbstractQDebugNode.h"
+#include "Core/Module/DataStruct.h"
 
 QPANDA_BEGIN
 
@@ -129,11 +130,19 @@ public:
 	}
 	virtual inline double get_random_double() {
 		if (!random_engine)
-			return _default_random_generator();
+			return random_generator19937();
 		else
 			return (*random_engine)();
 	}
 
+	/**
+	* @brief  seed for the streams of a parallel sampling, drawn from the random engine
+	* @note   with a seeded engine the seeds, and so the samples, repeat run after run
+	*/
+	inline uint64_t get_random_seed() {
+		return random_seed64(random_engine);
+	}
+
 	/**
 	* @brief reset qubit
 	* @param[in]  size_t  qubit address
@@ -142,6 +151,38 @@ public:
 
     virtual void set_parallel_threads_size(size_t size) = 0;
 
+	/**
+	* @brief  project a qubit onto a given measure outcome instead of drawing it
+	* @param[in]  size_t  qubit address
+	* @param[in]  bool  outcome
+	* @param[in]  double  probability of the outcome, the state is renormalized by it
+	* @return    QError  undefineError if the processor can't collapse a qubit
+	*/
+	virtual QError qubitCollapse(size_t qn, bool outcome, double prob)
+	{
+		return undefineError;
+	}
+
+	/**
+	* @brief  copy of the processor with its current state
+	* @return    QPUImpl*  owned by the caller, nullptr if the processor can't be copied
+	*/
+	virtual QPUImpl* clone()
+	{
+		return nullptr;
+	}
+
+	/**
+	* @brief  expectation of a hamiltonian on the current state, without changing it
+	* @param[in]  const QHamiltonian&  pauli terms on qubit addresses
+	* @param[out]  double&  expectation
+	* @return    QError  undefineError if the processor can't evaluate the terms in place
+	*/
+	virtual QError pauliExpectation(const QHamiltonian& hamiltonian, double& expectation)
+	{
+		return undefineError;
+	}
+
 };
 
 /**
@@ -0,0 +1,94 @@
+/*
+Copyright (c) 2017-2020 Origin Quantum Computing. All Right Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+/*! \file SIMDGates.h */
+#ifndef SIMD_GATES_H
+#define SIMD_GATES_H
+
+#include "Core/Utilities/QPandaNamespace.h"
+
+QPANDA_BEGIN
+
+/**
+* @brief SIMD instruction set used by the CPU gate kernels
+* @ingroup VirtualQuantumProcessor
+*/
+enum class SIMDLevel
+{
+    SCALAR = 0,
+    AVX2,
+    AVX512
+};
+
+/**
+* @brief  get the best instruction set supported by the running CPU and OS
+* @return SIMDLevel
+*/
+SIMDLevel detected_simd_level();
+
+/**
+* @brief  get the instruction set used by the gate kernels
+* @return SIMDLevel
+*/
+SIMDLevel get_simd_level();
+
+/**
+* @brief  set the instruction set used by the gate kernels,
+          the level is clamped to detected_simd_level()
+* @param[in]  SIMDLevel  instruction set
+*/
+void set_simd_level(SIMDLevel level);
+
+/*
+  Hand vectorized state vector kernels. They compute exactly the same
+  floating point operations in the same order as the scalar kernels of
+  CPUImplQPU, so both give bit-identical states.
+  Every kernel returns false when it does not handle the case (no SIMD
+  support, or a qubit layout without a vectorized path), and the caller
+  falls back to the scalar kernel.
+*/
+
+/**
+* @brief  apply matrix {m0, m1, m2, m3} on qubit qn
+*/
+bool simd_single_qubit_unitary(qcomplex_t* state, size_t qubit_num,
+    size_t qn, const qcomplex_t* matrix, int threads);
+
+/**
+* @brief  apply matrix {m0, m1, m2, m3} on target qubit where control qubit is 1
+*/
+bool simd_control_single_qubit_unitary(qcomplex_t* state, size_t qubit_num,
+    size_t control, size_t target, const qcomplex_t* matrix, int threads);
+
+/**
+* @brief  apply the 4*4 matrix on qubits (qn_0, qn_1), qn_0 is the low bit of the matrix index
+*/
+bool simd_double_qubit_unitary(qcomplex_t* state, size_t qubit_num,
+    size_t qn_0, size_t qn_1, const qcomplex_t* matrix, int threads);
+
+bool simd_pauli_x(qcomplex_t* state, size_t qubit_num, size_t qn, int threads);
+bool simd_hadamard(qcomplex_t* state, size_t qubit_num, size_t qn, int threads);
+bool simd_cnot(qcomplex_t* state, size_t qubit_num, size_t control, size_t target, int threads);
+
+/* single precision states always use the scalar kernels */
+inline bool simd_single_qubit_unitary(std::complex<float>*, size_t, size_t, const qcomplex_t*, int) { return false; }
+inline bool simd_control_single_qubit_unitary(std::complex<float>*, size_t, size_t, size_t, const qcomplex_t*, int) { return false; }
+inline bool simd_double_qubit_unitary(std::complex<float>*, size_t, size_t, size_t, const qcomplex_t*, int) { return false; }
+inline bool simd_pauli_x(std::complex<float>*, size_t, size_t, int) { return false; }
+inline bool simd_hadamard(std::complex<float>*, size_t, size_t, int) { return false; }
+inline bool simd_cnot(std::complex<float>*, size_t, size_t, size_t, int) { return false; }
+
+QPANDA_END
+#endif // !SIMD_GATES_H
@@ -0,0 +1,109 @@
+/*
+Copyright (c) 2017-2020 Origin Quantum Computing. All Right Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+/*! \file SparseImplQPU.h */
+#ifndef SPARSE_IMPL_QPU_H
+#define SPARSE_IMPL_QPU_H
+
+#include <memory>
+#include <complex>
+#include <unordered_map>
+#include "Core/VirtualQuantumProcessor/QPUImpl.h"
+
+QPANDA_BEGIN
+
+/**
+* @brief QPU implementation keeping the non-zero amplitudes only
+* @ingroup VirtualQuantumProcessor
+* @note  The amplitudes are in a hash map by basis index, a gate costs time
+*        proportional to the non-zero amplitudes instead of 2^n, which suits
+*        arithmetic, oracle and basis state preparation circuits.
+*        Once the non-zero amplitudes pass the dense fill ratio of the state,
+*        it is moved to a CPUImplQPU that runs the rest of the prog.
+*/
+template <typename data_t = double>
+class SparseImplQPU : public QPUImpl
+{
+public:
+    using amplitude_t = std::complex<data_t>;
+    using amplitude_map = std::unordered_map<size_t, amplitude_t>;
+
+    /**
+    * @brief  constructor
+    * @param[in]  double  fill ratio of the state over which it turns dense
+    */
+    SparseImplQPU(double dense_fill_ratio = 1. / 16);
+    ~SparseImplQPU();
+
+    /**
+    * @brief  whether the state has turned dense
+    */
+    bool is_dense() const
+    {
+        return nullptr != m_dense;
+    }
+
+    /**
+    * @brief  number of the amplitudes kept
+    */
+    size_t get_amplitude_num() const;
+
+    bool qubitMeasure(size_t qn);
+    QError pMeasure(Qnum& qnum, prob_vec &probs);
+
+    QError initState(size_t head_rank, size_t rank_size, size_t qubit_num);
+    QError initState(size_t qubit_num, const QStat &state = {});
+
+    QError unitarySingleQubitGate(size_t qn, QStat& matrix,
+        bool is_dagger, GateType type);
+    QError controlunitarySingleQubitGate(size_t qn, Qnum& controls,
+        QStat& matrix, bool is_dagger, GateType type);
+    QError unitaryDoubleQubitGate(size_t qn_0, size_t qn_1,
+        QStat& matrix, bool is_dagger, GateType type);
+    QError controlunitaryDoubleQubitGate(size_t qn_0, size_t qn_1,
+        Qnum& controls, QStat& matrix, bool is_dagger, GateType type);
+    QError OracleGate(Qnum& qubits, QStat &matrix, bool is_dagger);
+    QError controlOracleGate(Qnum& qubits, const Qnum& controls,
+        QStat &matrix, bool is_dagger);
+
+    QError process_noise(Qnum& qnum, QStat& matrix);
+    QError debug(std::shared_ptr<QPanda::AbstractQDebugNode> debugger);
+
+    QStat getQState();
+    QError Reset(size_t qn);
+    void set_parallel_threads_size(size_t size);
+
+protected:
+    /* apply matrix on the qubits where controls are all 1 */
+    void _apply_gate(const Qnum& qubits, const Qnum& controls, const QStat& matrix);
+    void _apply_diagonal(const Qnum& qubits, size_t control_mask, const QStat& matrix);
+    void _check_fill();
+    void _to_dense();
+
+private:
+    double m_dense_fill_ratio;
+    size_t m_qubit_num{ 0 };
+    amplitude_map m_state;
+    std::unique_ptr<QPUImpl> m_dense;
+
+    bool m_is_init_state{ false };
+    amplitude_map m_init_state;
+
+    QStat m_debug_state;
+    size_t m_max_threads_size{ 0 };
+};
+
+QPANDA_END
+#endif // !SPARSE_IMPL_QPU_H
@@ -0,0 +1,166 @@
+/*
+Copyright (c) 2017-2020 Origin Quantum Computing. All Right Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+/*! \file StateAllocator.h */
+#ifndef STATE_ALLOCATOR_H
+#define STATE_ALLOCATOR_H
+
+#include <new>
+#include <cstddef>
+#include <utility>
+#include <type_traits>
+#include "Core/Utilities/QPandaNamespace.h"
+#if defined(__linux__)
+#include <sys/mman.h>
+#endif
+
+QPANDA_BEGIN
+
+/**
+* @brief Pages backing the state vector of the CPU simulator
+* @ingroup VirtualQuantumProcessor
+*/
+enum class StatePageMode
+{
+    NORMAL = 0,         /**< pages of the default allocator */
+    TRANSPARENT_HUGE,   /**< anonymous mapping advised for transparent huge pages */
+    EXPLICIT_HUGE       /**< hugetlbfs pages, transparent huge pages if none is reserved */
+};
+
+/**
+* @brief Allocator of the state vector of the CPU simulator
+* @ingroup VirtualQuantumProcessor
+* @note  Elements are not initialized on allocation, so that the owner first
+*        touches them in parallel with the schedule of its gate loops and
+*        every page lands on the NUMA node of the thread using it.
+*        Huge pages are only requested on Linux for states of 2 MB or more.
+*/
+template <typename T>
+class StateAllocator
+{
+public:
+    using value_type = T;
+    using propagate_on_container_move_assignment = std::true_type;
+    using propagate_on_container_swap = std::true_type;
+
+    template <typename U>
+    struct rebind
+    {
+        using other = StateAllocator<U>;
+    };
+
+    StateAllocator(StatePageMode mode = StatePageMode::TRANSPARENT_HUGE) noexcept
+        : m_mode(mode)
+    {}
+
+    template <typename U>
+    StateAllocator(const StateAllocator<U>& other) noexcept
+        : m_mode(other.mode())
+    {}
+
+    StatePageMode mode() const noexcept
+    {
+        return m_mode;
+    }
+
+    T* allocate(size_t n)
+    {
+        size_t bytes = n * sizeof(T);
+#if defined(__linux__)
+        if (_is_mapped(bytes))
+        {
+            size_t length = _mapped_length(bytes);
+            void* ptr = MAP_FAILED;
+#ifdef MAP_HUGETLB
+            if (StatePageMode::EXPLICIT_HUGE == m_mode)
+            {
+                ptr = mmap(nullptr, length, PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+            }
+#endif
+            if (MAP_FAILED == ptr)
+            {
+                ptr = mmap(nullptr, length, PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+                if (MAP_FAILED == ptr)
+                {
+                    throw std::bad_alloc();
+                }
+#ifdef MADV_HUGEPAGE
+                madvise(ptr, length, MADV_HUGEPAGE);
+#endif
+            }
+            return static_cast<T*>(ptr);
+        }
+#endif
+        return static_cast<T*>(::operator new(bytes));
+    }
+
+    void deallocate(T* ptr, size_t n) noexcept
+    {
+#if defined(__linux__)
+        size_t bytes = n * sizeof(T);
+        if (_is_mapped(bytes))
+        {
+            munmap(ptr, _mapped_length(bytes));
+            return;
+        }
+#endif
+        ::operator delete(ptr);
+    }
+
+    /* value initialization is left to the owner of the state */
+    template <typename U>
+    void construct(U*) noexcept
+    {
+        static_assert(std::is_trivially_destructible<U>::value, "Error: state element type.");
+    }
+
+    template <typename U, typename... Args>
+    void construct(U* ptr, Args&&... args)
+    {
+        ::new (static_cast<void*>(ptr)) U(std::forward<Args>(args)...);
+    }
+
+    template <typename U>
+    bool operator==(const StateAllocator<U>& other) const noexcept
+    {
+        return m_mode == other.mode();
+    }
+
+    template <typename U>
+    bool operator!=(const StateAllocator<U>& other) const noexcept
+    {
+        return m_mode != other.mode();
+    }
+
+private:
+    static const size_t kHugePageSize = 1ull << 21;
+
+    bool _is_mapped(size_t bytes) const noexcept
+    {
+        return StatePageMode::NORMAL != m_mode && bytes >= kHugePageSize;
+    }
+
+    static size_t _mapped_length(size_t bytes) noexcept
+    {
+        return (bytes + kHugePageSize - 1) / kHugePageSize * kHugePageSize;
+    }
+
+    StatePageMode m_mode;
+};
+
+QPANDA_END
+#endif // !STATE_ALLOCATOR_H
@@ -0,0 +1,74 @@
+/*
+Copyright (c) 2017-2020 Origin Quantum Computing. All Right Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+/*! \file SparseImplQPU.h */
+/*! \file UnitaryImplQPU.h */
+#ifndef UNITARY_IMPL_QPU_H
+#define UNITARY_IMPL_QPU_H
+
+#include "Core/VirtualQuantumProcessor/CPUImplQPU.h"
+
+QPANDA_BEGIN
+
+/**
+* @brief QPU implementation evolving the unitary operator of a prog
+* @ingroup VirtualQuantumProcessor
+* @note  The operator of n qubits is kept as a state of 2n qubits, the prog
+*        qubits and n reference qubits prepared in maximally entangled pairs
+*        with them, so that column c of the operator is the state of the prog
+*        qubits where the reference qubits are c. Every gate is applied once
+*        to all the columns by the kernels and the cache blocking of CPUImplQPU,
+*        instead of multiplying 2^n x 2^n matrices.
+*        Measure, reset and noise are not unitary and throw.
+*/
+template <typename data_t = double>
+class UnitaryImplQPU : public CPUImplQPU<data_t>
+{
+public:
+    /**
+    * @brief  init the operator to the identity on the qubits
+    * @param[in]  const Qnum&  prog addresses of the qubits of the operator
+    * @note   gates act on these addresses only, the j-th address in
+    *         ascending order is bit j of the operator index
+    */
+    QError init_operator(const Qnum& qubits);
+
+    /**
+    * @brief  get the operator
+    * @return QStat  row major 2^n x 2^n matrix
+    */
+    QStat get_operator();
+
+    /**
+    * @brief  init the operator to the identity on the qubits 0 ~ qubit_num - 1
+    */
+    QError initState(size_t head_rank, size_t rank_size, size_t qubit_num);
+
+    /**
+    * @brief  the operator as get_operator()
+    */
+    QStat getQState();
+
+    bool qubitMeasure(size_t qn);
+    QError pMeasure(Qnum& qnum, prob_vec &probs);
+    QError Reset(size_t qn);
+    QError process_noise(Qnum& qnum, QStat& matrix);
+
+private:
+    size_t m_operator_qubit_num{ 0 };
+};
+
+QPANDA_END
+#endif // !UNITARY_IMPL_QPU_H
@@ -0,0 +1,12 @@
+#ifndef _QPANDA_CONFIG_H_
+#define _QPANDA_CONFIG_H_
+
+/* #undef USE_CUDA */
+/* #undef USE_PYQPANDA */
+#define USE_OPENMP
+#define USE_CURL
+/* #undef USE_MPI */
+/* #undef USE_EXTENSION */
+
+
+#endif
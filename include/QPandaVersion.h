@@ -0,0 +1,3 @@
+#define QPANDA_MAJOR_VERSION 2
+#define QPANDA_MINOR_VERSION 1
+#define QPANDA_PATCH_VERSION 12
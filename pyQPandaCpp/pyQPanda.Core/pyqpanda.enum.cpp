@@ -139,8 +139,14 @@ void export_enum(py::module &m)
         .value("CPU_SINGLE_THREAD", BackendType::CPU_SINGLE_THREAD)
         .value("NOISE", BackendType::NOISE)
         .value("MPS", BackendType::MPS)
+        .value("SPARSE", BackendType::SPARSE)
         .export_values();
 
+    py::enum_<StatePageMode>(m, "StatePageMode")
+        .value("NORMAL", StatePageMode::NORMAL)
+        .value("TRANSPARENT_HUGE", StatePageMode::TRANSPARENT_HUGE)
+        .value("EXPLICIT_HUGE", StatePageMode::EXPLICIT_HUGE);
+
     py::enum_<DAGNodeType>(m, "DAGNodeType")
         .value("NUKNOW_SEQ_NODE_TYPE", DAGNodeType::NUKNOW_SEQ_NODE_TYPE)
         .value("MAX_GATE_TYPE", DAGNodeType::MAX_GATE_TYPE)
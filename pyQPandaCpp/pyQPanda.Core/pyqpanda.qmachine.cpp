@@ -9,6 +9,7 @@
 #include "Core/QuantumMachine/PartialAmplitudeQVM.h"
 #include "Core/QuantumMachine/QCloudMachine.h"
 #include "Core/VirtualQuantumProcessor/NoiseQPU/NoiseModel.h"
+#include "Core/VirtualQuantumProcessor/OutOfCoreImplQPU.h"
 #include "template_generator.h"
 USING_QPANDA
 namespace py = pybind11;
@@ -192,6 +193,53 @@ void export_quantum_machine(py::module &m)
        but as we won't want to export IdealQVM to user, this may the only way
      */
      export_idealqvm_func<CPUQVM>::export_func(cpu_qvm);
+     cpu_qvm.def("init_qvm",
+                 py::overload_cast<bool>(&CPUQVM::init),
+                 py::arg("is_double_precision") = true,
+                 "init quantum virtual machine, the state vector is complex<float> if is_double_precision is false");
+     cpu_qvm.def("init_out_of_core",
+                 &CPUQVM::init_out_of_core,
+                 py::arg("directory") = "",
+                 py::arg("memory_budget") = OutOfCoreImplQPU<double>::kDefaultMemoryBudget,
+                 py::arg("is_double_precision") = true,
+                 "init quantum virtual machine with the state vector in memory mapped chunk files under directory");
+     cpu_qvm.def("init_sparse",
+                 &CPUQVM::init_sparse,
+                 py::arg("is_double_precision") = true,
+                 "init quantum virtual machine with a state of the non-zero amplitudes only, it turns dense when filled");
+     cpu_qvm.def("init_distributed",
+                 &CPUQVM::init_distributed,
+                 py::arg("use_shared_memory") = true,
+                 "init quantum virtual machine with the state vector partitioned over MPI ranks");
+     cpu_qvm.def("set_max_fusion_qubits",
+                 &CPUQVM::set_max_fusion_qubits,
+                 py::arg("qubit_num"),
+                 "set the max qubits of the fused gate blocks, 0 turns the gate fusion off");
+     cpu_qvm.def("set_cache_block_qubits",
+                 &CPUQVM::set_cache_block_qubits,
+                 py::arg("qubit_num"),
+                 "set the qubits of the cache blocks gate runs are executed in, 0 turns the cache blocking off");
+     cpu_qvm.def("set_state_page_mode",
+                 &CPUQVM::set_state_page_mode,
+                 py::arg("mode"),
+                 "set the pages backing the state vector, takes effect at the next run");
+     cpu_qvm.def("set_qubit_compaction",
+                 &CPUQVM::set_qubit_compaction,
+                 py::arg("enable"),
+                 "set whether a prog is simulated on the qubits it uses only");
+     cpu_qvm.def("get_reduced_density_matrix",
+                 &CPUQVM::get_reduced_density_matrix,
+                 py::arg("qubit_list"),
+                 "get the reduced density matrix of the qubits in the current state");
+     cpu_qvm.def("get_schmidt_spectrum",
+                 &CPUQVM::get_schmidt_spectrum,
+                 py::arg("qubit_list"),
+                 "get the squared Schmidt coefficients of the current state across the cut around the qubits");
+     cpu_qvm.def("get_entanglement_entropy",
+                 &CPUQVM::get_entanglement_entropy,
+                 py::arg("qubit_list"),
+                 py::arg("alpha") = 1,
+                 "get the Renyi entropy of order alpha in bits across the cut around the qubits, von Neumann for alpha 1");
      py::class_<CPUSingleThreadQVM, QuantumMachine> cpu_single_thread_qvm(m, "CPUSingleThreadQVM");
      export_idealqvm_func<CPUSingleThreadQVM>::export_func(cpu_single_thread_qvm);
 
@@ -399,6 +447,8 @@ void export_quantum_machine(py::module &m)
          .def("prob_run_list", &MPSQVM::probRunList, "program"_a, "qubit_list"_a, "select_max"_a = -1, py::return_value_policy::reference)
          .def("prob_run_dict", &MPSQVM::probRunDict, "program"_a, "qubit_list"_a, "select_max"_a = -1, py::return_value_policy::reference)
          .def("quick_measure", &MPSQVM::quickMeasure, "qubit_list"_a, "shots"_a, py::return_value_policy::reference)
+         .def("get_schmidt_spectrum", &MPSQVM::get_schmidt_spectrum, "qubit_list"_a, py::return_value_policy::automatic)
+         .def("get_entanglement_entropy", &MPSQVM::get_entanglement_entropy, "qubit_list"_a, "alpha"_a = 1, py::return_value_policy::automatic)
 
          .def("pmeasure_bin_index", &MPSQVM::pmeasure_bin_index, "program"_a, "string"_a, py::return_value_policy::reference)
          .def("pmeasure_dec_index", &MPSQVM::pmeasure_dec_index, "program"_a, "string"_a, py::return_value_policy::reference)
@@ -196,6 +196,10 @@ public:
                      py::arg("qubit_addr_list"),
                      py::arg("select_max") = -1,
                      py::return_value_policy::automatic)
+                .def("set_light_cone_pruning",
+                     &Cls_t::set_light_cone_pruning,
+                     py::arg("enable"),
+                     "set whether gates that can't reach a measure or a pmeasured qubit are skipped")
                 .def("quick_measure",
                      &Cls_t::quickMeasure,
                      py::arg("qubit_list"),
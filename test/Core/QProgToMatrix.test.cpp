@@ -620,4 +620,70 @@ TEST(QProgToMatrix, test1)
 
 	//ASSERT_TRUE(test_val);
 	//cout << "QProgToMatrix tests over." << endl;
-}
\ No newline at end of file
+}
+TEST(QProgToMatrix, unitaryEvolution)
+{
+	CPUQVM qvm;
+	qvm.init();
+	auto q = qvm.qAllocMany(10);
+
+	/* q[0] is left out, the matrix is on the qubits in use */
+	QVec used_qv = { q[1], q[2], q[3], q[5], q[6], q[7], q[8], q[9] };
+	QCircuit sub_cir;
+	sub_cir << RY(used_qv[2], 0.3) << CU(1, 2, 3, 4, used_qv[2], used_qv[5]) << S(used_qv[7]);
+
+	QCircuit cir;
+	for (size_t i = 0; i < used_qv.size(); ++i)
+	{
+		cir << H(used_qv[i]) << RZ(used_qv[i], 0.1 * (i + 1));
+	}
+	cir << CNOT(used_qv[0], used_qv[3]) << iSWAP(used_qv[1], used_qv[6], 0.7)
+		<< RX(used_qv[4], 1.1).control({ used_qv[0], used_qv[7] })
+		<< sub_cir.dagger() << CZ(used_qv[6], used_qv[2])
+		<< U3(used_qv[5], 0.4, 0.5, 0.6) << SWAP(used_qv[3], used_qv[4]).control({ used_qv[1] });
+
+	const size_t dim = 1ull << used_qv.size();
+	const auto matrix = getCircuitMatrix(cir);
+	const auto positive_matrix = getCircuitMatrix(cir, true);
+	ASSERT_EQ(matrix.size(), dim * dim);
+	ASSERT_EQ(positive_matrix.size(), dim * dim);
+
+	auto reverse_bits = [&](size_t index) {
+		size_t reversed = 0;
+		for (size_t i = 0; i < used_qv.size(); ++i)
+		{
+			reversed |= ((index >> i) & 1) << (used_qv.size() - 1 - i);
+		}
+		return reversed;
+	};
+
+	/* column c is the state the circuit takes |c> to */
+	for (size_t col = 0; col < dim; col += 37)
+	{
+		QProg prog;
+		for (size_t i = 0; i < used_qv.size(); ++i)
+		{
+			if ((col >> i) & 1)
+			{
+				prog << X(used_qv[i]);
+			}
+		}
+		prog << cir;
+		qvm.directlyRun(prog);
+		auto state = qvm.getQState();
+
+		for (size_t row = 0; row < dim; ++row)
+		{
+			size_t index = 0;
+			for (size_t i = 0; i < used_qv.size(); ++i)
+			{
+				index |= ((row >> i) & 1) << used_qv[i]->get_phy_addr();
+			}
+			EXPECT_NEAR(std::abs(matrix[row * dim + col] - state[index]), 0, 1e-10);
+			EXPECT_NEAR(std::abs(positive_matrix[reverse_bits(row) * dim + reverse_bits(col)]
+				- state[index]), 0, 1e-10);
+		}
+	}
+
+	qvm.finalize();
+}
@@ -1,10 +1,14 @@
 #include <time.h>
 #include <iostream>
 #include <numeric>
+#include <thread>
 #include "QPanda.h"
 #include <functional>
 #include "gtest/gtest.h"
 #include "Core/Utilities/Tools/OriginCollection.h"
+#include "Core/VirtualQuantumProcessor/CPUImplQPU.h"
+#include "Core/VirtualQuantumProcessor/MarginalProbability.h"
+#include "Core/VirtualQuantumProcessor/OutOfCoreImplQPU.h"
 USING_QPANDA
 using namespace std;
 using namespace Base64;
@@ -521,3 +525,1249 @@ static prob_vec state_to_probs(QStat& state)
 }
 
 
+
+TEST(CPUQVMTest, PMeasureMarginal)
+{
+	CPUQVM qvm;
+	qvm.init();
+	auto q = qvm.qAllocMany(12);
+
+	QProg prog;
+	for (auto i = 0; i < q.size(); ++i)
+	{
+		prog << RY(q[i], 0.3 * (i + 1)) << RZ(q[i], 0.1 * i);
+	}
+	for (auto i = 0; i < q.size() - 1; ++i)
+	{
+		prog << CNOT(q[i], q[i + 1]);
+	}
+	qvm.directlyRun(prog);
+	auto state = qvm.getQState();
+
+	std::vector<QVec> cases = { { q[0] }, { q[2], q[3], q[4] }, { q[3], q[0] },
+		{ q[11], q[1], q[5] }, { q[7], q[2], q[9], q[0], q[11] } };
+	for (auto& qubits : cases)
+	{
+		prob_vec expect(1ull << qubits.size(), 0);
+		for (size_t i = 0; i < state.size(); ++i)
+		{
+			size_t idx = 0;
+			for (size_t j = 0; j < qubits.size(); ++j)
+			{
+				idx |= ((i >> qubits[j]->get_phy_addr()) & 1ull) << j;
+			}
+			expect[idx] += std::norm(state[i]);
+		}
+
+		auto probs = qvm.PMeasure_no_index(qubits);
+		ASSERT_EQ(probs.size(), expect.size());
+		for (size_t i = 0; i < probs.size(); ++i)
+		{
+			EXPECT_NEAR(probs[i], expect[i], 1e-12);
+		}
+
+		auto prob_list = qvm.PMeasure(qubits, 2);
+		ASSERT_EQ(prob_list.size(), 2);
+		EXPECT_NEAR(prob_list[0].second, *std::max_element(expect.begin(), expect.end()), 1e-12);
+	}
+}
+
+TEST(CPUQVMTest, PMeasureMarginalWide)
+{
+	/* spans over 16 qubits go through the per-thread histograms or the scattered bins */
+	CPUQVM qvm;
+	qvm.init();
+	auto q = qvm.qAllocMany(20);
+
+	QProg prog;
+	for (auto i = 0; i < q.size(); ++i)
+	{
+		prog << RY(q[i], 0.2 * (i + 1)) << RZ(q[i], 0.1 * i);
+	}
+	for (auto i = 0; i < q.size() - 1; ++i)
+	{
+		prog << CNOT(q[i], q[i + 1]);
+	}
+	qvm.directlyRun(prog);
+	auto state = qvm.getQState();
+
+	auto expect_probs = [&](const Qnum& qubits) {
+		prob_vec expect(1ull << qubits.size(), 0);
+		for (size_t i = 0; i < state.size(); ++i)
+		{
+			size_t idx = 0;
+			for (size_t j = 0; j < qubits.size(); ++j)
+			{
+				idx |= ((i >> qubits[j]) & 1ull) << j;
+			}
+			expect[idx] += std::norm(state[i]);
+		}
+		return expect;
+	};
+
+	std::vector<QVec> cases = { { q[0], q[17] }, { q[19], q[3], q[1] } };
+	for (auto& qubits : cases)
+	{
+		Qnum addrs;
+		for (auto qubit : qubits)
+		{
+			addrs.push_back(qubit->get_phy_addr());
+		}
+		auto expect = expect_probs(addrs);
+		auto probs = qvm.PMeasure_no_index(qubits);
+		ASSERT_EQ(probs.size(), expect.size());
+		for (size_t i = 0; i < probs.size(); ++i)
+		{
+			EXPECT_NEAR(probs[i], expect[i], 1e-12);
+		}
+	}
+
+	/* 16 of the 20 qubits with 8 threads scatter into the shared bins */
+	std::vector<std::complex<double>> amplitudes(state.begin(), state.end());
+	Qnum wide = { 19, 3, 1, 0, 2, 4, 5, 6, 8, 9, 11, 12, 13, 14, 15, 17 };
+	for (auto qubits : { Qnum{ 0, 17 }, Qnum{ 19, 3, 1 }, wide })
+	{
+		auto expect = expect_probs(qubits);
+		for (int threads : { 1, 8 })
+		{
+			prob_vec probs;
+			MarginalProbability<double>(amplitudes.data(), q.size(), threads).calculate(qubits, probs);
+			ASSERT_EQ(probs.size(), expect.size());
+			for (size_t i = 0; i < probs.size(); ++i)
+			{
+				EXPECT_NEAR(probs[i], expect[i], 1e-12);
+			}
+		}
+	}
+}
+
+/*
+  runs the prog on a CPUQVM set up by init and on a default CPUQVM, the states
+  and the probabilities of prob_qubits must agree, and every shot measuring
+  the first two of them must be counted
+*/
+static void expect_cpu_state(const std::function<void(CPUQVM&)>& init, size_t qubit_num,
+	const std::function<QProg(QVec&)>& build_prog, const std::vector<size_t>& prob_qubits, double precision)
+{
+	auto select = [&](QVec& q) {
+		QVec selected;
+		for (auto i : prob_qubits)
+		{
+			selected.push_back(q[i]);
+		}
+		return selected;
+	};
+
+	CPUQVM expect_qvm;
+	expect_qvm.init();
+	auto expect_q = expect_qvm.qAllocMany(qubit_num);
+	auto expect_prog = build_prog(expect_q);
+	auto expect = expect_qvm.probRunDict(expect_prog, select(expect_q));
+	expect_qvm.directlyRun(expect_prog);
+	auto expect_state = expect_qvm.getQState();
+
+	CPUQVM qvm;
+	init(qvm);
+	auto q = qvm.qAllocMany(qubit_num);
+	auto prog = build_prog(q);
+	auto result = qvm.probRunDict(prog, select(q));
+	ASSERT_EQ(result.size(), expect.size());
+	for (auto& val : expect)
+	{
+		EXPECT_NEAR(result[val.first], val.second, precision);
+	}
+
+	qvm.directlyRun(prog);
+	auto state = qvm.getQState();
+	ASSERT_EQ(state.size(), expect_state.size());
+	for (size_t i = 0; i < state.size(); i++)
+	{
+		EXPECT_NEAR(std::abs(state[i] - expect_state[i]), 0, precision);
+	}
+
+	auto c = qvm.cAllocMany(2);
+	prog << Measure(q[prob_qubits[0]], c[0]) << Measure(q[prob_qubits[1]], c[1]);
+	auto shots_result = qvm.runWithConfiguration(prog, c, 100);
+	size_t shots = 0;
+	for (auto& val : shots_result)
+	{
+		shots += val.second;
+	}
+	EXPECT_EQ(shots, 100);
+}
+
+TEST(CPUQVMTest, SinglePrecision)
+{
+	auto build_prog = [](QVec& q) {
+		QProg prog;
+		for (auto i = 0; i < q.size(); ++i)
+		{
+			prog << H(q[i]) << RY(q[i], 0.2 * (i + 1)) << T(q[i]);
+		}
+		for (auto i = 0; i < q.size() - 1; ++i)
+		{
+			prog << CNOT(q[i], q[i + 1]) << CR(q[i + 1], q[i], 0.7) << SWAP(q[i], q[i + 1]);
+		}
+		prog << Toffoli(q[0], q[3], q[6]) << U4(1.0, 2.0, 3.0, 4.0, q[5]).control({ q[1], q[2] });
+		return prog;
+	};
+
+	expect_cpu_state([](CPUQVM& qvm) { qvm.init(false); }, 10, build_prog, { 1, 4, 8 }, 1e-6);
+}
+
+TEST(CPUQVMTest, GateFusion)
+{
+	auto run_state = [](size_t max_fusion_qubits) {
+		CPUQVM qvm;
+		qvm.init();
+		qvm.set_max_fusion_qubits(max_fusion_qubits);
+		auto q = qvm.qAllocMany(14);
+
+		QCircuit layer;
+		for (auto i = 0; i < q.size(); ++i)
+		{
+			layer << RZ(q[i], 0.1 * i) << RX(q[i], 0.3 + 0.2 * i) << RZ(q[i], -0.4 * i);
+		}
+		for (auto i = 0; i < q.size() - 1; ++i)
+		{
+			layer << CNOT(q[i], q[i + 1]);
+		}
+
+		QProg prog;
+		prog << H(q) << layer << layer.dagger()
+			<< CR(q[7], q[2], 0.6) << SWAP(q[13], q[4])
+			<< Toffoli(q[0], q[5], q[9]) << RY(q[3], 0.9).control({ q[1], q[12] })
+			<< iSWAP(q[6], q[11]) << layer;
+		qvm.directlyRun(prog);
+		return qvm.getQState();
+	};
+
+	auto expect = run_state(0);
+	for (size_t max_fusion_qubits = 1; max_fusion_qubits <= 5; ++max_fusion_qubits)
+	{
+		auto state = run_state(max_fusion_qubits);
+		ASSERT_EQ(state.size(), expect.size());
+		for (size_t i = 0; i < state.size(); ++i)
+		{
+			EXPECT_NEAR(std::abs(state[i] - expect[i]), 0, 1e-10);
+		}
+	}
+}
+
+TEST(CPUQVMTest, CacheBlocking)
+{
+	auto run_state = [](size_t block_qubits) {
+		CPUQVM qvm;
+		qvm.init();
+		qvm.set_max_fusion_qubits(0);
+		qvm.set_cache_block_qubits(block_qubits);
+		auto q = qvm.qAllocMany(14);
+		auto ancilla = qvm.allocateQubit();
+		auto c = qvm.cAllocMany(1);
+
+		QProg prog;
+		prog << H(q);
+		for (auto i = 0; i < q.size(); ++i)
+		{
+			prog << RZ(q[i], 0.1 * i) << RX(q[i], 0.3 + 0.2 * i) << T(q[i]);
+		}
+		for (auto i = 0; i < q.size() - 1; ++i)
+		{
+			prog << CNOT(q[i], q[i + 1]) << RY(q[i + 1], 0.2 * i);
+		}
+		prog << Toffoli(q[0], q[12], q[13]) << CR(q[11], q[2], 0.6).dagger()
+			<< RY(q[3], 0.9).control({ q[1], q[10] }) << SWAP(q[13], q[4])
+			<< iSWAP(q[6], q[11]) << U3(q[12], 0.1, 0.2, 0.3)
+			<< Measure(ancilla, c[0]) << CZ(q[12], q[13]) << H(q[12]) << H(q[13]);
+		qvm.directlyRun(prog);
+		return qvm.getQState();
+	};
+
+	auto expect = run_state(0);
+	for (size_t block_qubits : { 2, 3, 5, 10 })
+	{
+		auto state = run_state(block_qubits);
+		ASSERT_EQ(state.size(), expect.size());
+		for (size_t i = 0; i < state.size(); ++i)
+		{
+			EXPECT_NEAR(std::abs(state[i] - expect[i]), 0, 1e-10);
+		}
+	}
+}
+
+TEST(CPUQVMTest, MultiControlGates)
+{
+	CPUQVM qvm;
+	qvm.init();
+	auto q = qvm.qAllocMany(12);
+
+	auto run_index = [&](QProg prog) {
+		qvm.directlyRun(prog);
+		auto state = qvm.getQState();
+		size_t index = 0;
+		for (size_t i = 0; i < state.size(); ++i)
+		{
+			if (std::abs(state[i]) > 0.5)
+			{
+				index = i;
+			}
+		}
+		return index;
+	};
+
+	QProg prog;
+	prog << X(q[3]) << X(q[7]) << X(q[11]) << X(q[0]).control({ q[3], q[7], q[11] });
+	EXPECT_EQ(run_index(prog), (1u << 0) | (1u << 3) | (1u << 7) | (1u << 11));
+
+	prog = QProg();
+	prog << X(q[3]) << X(q[11]) << X(q[0]).control({ q[3], q[7], q[11] });
+	EXPECT_EQ(run_index(prog), (1u << 3) | (1u << 11));
+
+	prog = QProg();
+	prog << X(q[1]) << X(q[5]) << X(q[9]) << SWAP(q[1], q[2]).control({ q[5], q[9] })
+		<< CNOT(q[2], q[10]).control({ q[5] }) << Toffoli(q[2], q[10], q[4]).control({ q[6] });
+	EXPECT_EQ(run_index(prog), (1u << 2) | (1u << 5) | (1u << 9) | (1u << 10));
+}
+
+TEST(CPUQVMTest, OracleQubitOrder)
+{
+	CPUQVM qvm;
+	qvm.init();
+	auto q = qvm.qAllocMany(12);
+	QVec oracle_qubits = { q[7], q[2], q[9], q[0], q[4], q[11], q[5] };
+
+	for (size_t qubit_num = 1; qubit_num <= oracle_qubits.size(); ++qubit_num)
+	{
+		/* phased permutation matrix, bit j of the matrix index is qubits[j] */
+		QVec qubits(oracle_qubits.begin(), oracle_qubits.begin() + qubit_num);
+		size_t dim = 1ull << qubit_num;
+		QStat matrix(dim * dim, 0);
+		for (size_t col = 0; col < dim; ++col)
+		{
+			matrix[((col * 5 + 3) % dim) * dim + col] = qcomplex_t(cos(0.1 * col), sin(0.1 * col));
+		}
+
+		size_t input = dim - 2;
+		QProg prog;
+		for (size_t j = 0; j < qubit_num; ++j)
+		{
+			if ((input >> j) & 1)
+			{
+				prog << X(qubits[j]);
+			}
+		}
+		prog << QOracle(qubits, matrix);
+		qvm.directlyRun(prog);
+		auto state = qvm.getQState();
+
+		size_t output = (input * 5 + 3) % dim;
+		size_t index = 0;
+		for (size_t j = 0; j < qubit_num; ++j)
+		{
+			index |= ((output >> j) & 1ull) << qubits[j]->get_phy_addr();
+		}
+		EXPECT_NEAR(std::abs(state[index] - qcomplex_t(cos(0.1 * input), sin(0.1 * input))), 0, 1e-10);
+	}
+}
+
+TEST(CPUQVMTest, DiagonalBatching)
+{
+	auto run_state = [](size_t block_qubits) {
+		CPUQVM qvm;
+		qvm.init();
+		qvm.set_max_fusion_qubits(0);
+		qvm.set_cache_block_qubits(block_qubits);
+		auto q = qvm.qAllocMany(14);
+
+		QProg prog;
+		prog << H(q);
+		for (auto layer = 0; layer < 2; ++layer)
+		{
+			for (auto i = 0; i < q.size(); ++i)
+			{
+				prog << RZZ(q[i], q[(i * 5 + 3) % q.size()], 0.2 * i + layer)
+					<< CR(q[i], q[(i + 7) % q.size()], 0.1 * i);
+			}
+			prog << Z(q[0]) << S(q[13]).dagger() << T(q[5]) << U1(q[9], 0.7) << RZ(q[11], 0.3)
+				<< CZ(q[2], q[12]) << CP(q[8], q[1], 0.4) << RZ(q[6], 0.5).control({ q[3], q[10] });
+			for (auto i = 0; i < q.size(); ++i)
+			{
+				prog << RX(q[i], 0.3 * layer + 0.1 * i);
+			}
+		}
+		qvm.directlyRun(prog);
+		return qvm.getQState();
+	};
+
+	auto expect = run_state(0);
+	for (size_t block_qubits : { 3, 8 })
+	{
+		auto state = run_state(block_qubits);
+		ASSERT_EQ(state.size(), expect.size());
+		for (size_t i = 0; i < state.size(); ++i)
+		{
+			EXPECT_NEAR(std::abs(state[i] - expect[i]), 0, 1e-10);
+		}
+	}
+
+	/* a controlled RZZ is rejected the same next to diagonal gates as on its own */
+	QStat rz = { std::polar(1., -0.15), 0, 0, std::polar(1., 0.15) };
+	QStat rzz(16, 0);
+	rzz[0] = rzz[15] = std::polar(1., -0.1);
+	rzz[5] = rzz[10] = std::polar(1., 0.1);
+	for (size_t block_qubits : { 0, 8 })
+	{
+		for (bool is_batched : { false, true })
+		{
+			CPUImplQPU<double> qpu;
+			qpu.set_cache_block_qubits(block_qubits);
+			qpu.initState(0, 1, 6);
+			if (is_batched)
+			{
+				qpu.unitarySingleQubitGate(0, rz, false, GateType::RZ_GATE);
+			}
+			Qnum controls = { 3 };
+			EXPECT_ANY_THROW({
+				qpu.controlunitaryDoubleQubitGate(1, 2, controls, rzz, false, GateType::RZZ_GATE);
+				qpu.getQState();
+			});
+		}
+	}
+}
+
+TEST(CPUQVMTest, GateSequenceRegion)
+{
+	auto run_state = [](size_t threads, size_t block_qubits) {
+		CPUQVM qvm;
+		qvm.init();
+		qvm.set_parallel_threads(threads);
+		qvm.set_max_fusion_qubits(0);
+		qvm.set_cache_block_qubits(block_qubits);
+		auto q = qvm.qAllocMany(12);
+
+		QProg prog;
+		prog << H(q);
+		for (auto layer = 0; layer < 2; ++layer)
+		{
+			for (auto i = 0; i < q.size(); ++i)
+			{
+				prog << RX(q[i], 0.3 + 0.2 * i) << CNOT(q[i], q[(i + 5) % q.size()])
+					<< U3(q[(i * 7) % q.size()], 0.1 * i, 0.2, 0.3 * layer).dagger()
+					<< CU(q[i], q[(i + 11) % q.size()], 0.1, 0.2, 0.3, 0.4 * i)
+					<< SWAP(q[i], q[(i + 3) % q.size()]) << RY(q[i], 0.1).control({ q[(i + 1) % q.size()] });
+			}
+			prog << iSWAP(q[2], q[9]) << Toffoli(q[11], q[0], q[6]) << S(q[10]).dagger() << Y(q[4]);
+		}
+		qvm.directlyRun(prog);
+		return qvm.getQState();
+	};
+
+	/* fewer cache blocks than threads run the gates in one parallel region */
+	auto expect = run_state(1, 0);
+	for (size_t threads : { 3, 8 })
+	{
+		auto state = run_state(threads, 10);
+		ASSERT_EQ(state.size(), expect.size());
+		for (size_t i = 0; i < state.size(); ++i)
+		{
+			EXPECT_NEAR(std::abs(state[i] - expect[i]), 0, 1e-10);
+		}
+	}
+}
+
+TEST(CPUQVMTest, StatePageMode)
+{
+	/* 17 qubits take 2 MB, the smallest state backed by huge pages */
+	const size_t qubit_num = 17;
+	QStat init_state(1ull << qubit_num);
+	for (size_t i = 0; i < init_state.size(); ++i)
+	{
+		init_state[i] = qcomplex_t(1.0 + i % 7, 0.5 * (i % 3)) / 512.0;
+	}
+	double norm = 0;
+	for (auto& amplitude : init_state)
+	{
+		norm += std::norm(amplitude);
+	}
+	for (auto& amplitude : init_state)
+	{
+		amplitude /= std::sqrt(norm);
+	}
+
+	auto run_state = [&](StatePageMode mode) {
+		CPUQVM qvm;
+		qvm.init();
+		qvm.set_state_page_mode(mode);
+		auto q = qvm.qAllocMany(qubit_num);
+
+		QProg prog;
+		for (auto i = 0; i < q.size(); ++i)
+		{
+			prog << H(q[i]) << RY(q[i], 0.1 * i) << CNOT(q[i], q[(i + 5) % q.size()]);
+		}
+		qvm.initState(init_state);
+		qvm.directlyRun(prog);
+		auto state = qvm.getQState();
+
+		/* the second run reuses the pages of the first one */
+		qvm.directlyRun(prog);
+		EXPECT_EQ(state, qvm.getQState());
+		return state;
+	};
+
+	auto expect = run_state(StatePageMode::NORMAL);
+	for (auto mode : { StatePageMode::TRANSPARENT_HUGE, StatePageMode::EXPLICIT_HUGE })
+	{
+		auto state = run_state(mode);
+		ASSERT_EQ(state.size(), expect.size());
+		for (size_t i = 0; i < state.size(); ++i)
+		{
+			EXPECT_NEAR(std::abs(state[i] - expect[i]), 0, 1e-10);
+		}
+	}
+}
+
+template <typename data_t>
+static void check_init_state_reload(const QStat& init_state, size_t qubit_num, size_t spill_qubits,
+	const std::string& directory = "")
+{
+	CPUImplQPU<data_t> qpu;
+	qpu.set_init_state_spill_qubits(spill_qubits);
+	qpu.set_init_state_directory(directory);
+	qpu.initState(qubit_num, init_state);
+
+	QStat hadamard = { 1 / std::sqrt(2.), 1 / std::sqrt(2.), 1 / std::sqrt(2.), -1 / std::sqrt(2.) };
+	QStat expect_state;
+	for (int run = 0; run < 3; ++run)
+	{
+		/* every run starts from the initial state in the engine precision */
+		PhiloxRandomEngine rng(2021);
+		qpu.set_random_engine(&rng);
+		qpu.initState(0, 1, qubit_num);
+		auto state = qpu.getQState();
+		ASSERT_EQ(state.size(), init_state.size());
+		for (size_t i = 0; i < state.size(); ++i)
+		{
+			EXPECT_EQ(static_cast<data_t>(state[i].real()), static_cast<data_t>(init_state[i].real()));
+			EXPECT_EQ(static_cast<data_t>(state[i].imag()), static_cast<data_t>(init_state[i].imag()));
+		}
+
+		qpu.unitarySingleQubitGate(2, hadamard, false, GateType::HADAMARD_GATE);
+		qpu.Reset(4);
+		if (0 == run)
+		{
+			expect_state = qpu.getQState();
+		}
+		else
+		{
+			EXPECT_EQ(expect_state, qpu.getQState());
+		}
+	}
+
+	/* a loaded state is not kept, the next run starts from |0...0> */
+	qpu.set_random_engine(nullptr);
+	qpu.loadState(qubit_num, init_state);
+	qpu.initState(0, 1, qubit_num);
+	auto state = qpu.getQState();
+	EXPECT_EQ(state[0], qcomplex_t(1, 0));
+}
+
+TEST(CPUQVMTest, InitialStateReload)
+{
+	const size_t qubit_num = 6;
+	QStat init_state(1ull << qubit_num);
+	double norm = 0;
+	for (size_t i = 0; i < init_state.size(); ++i)
+	{
+		init_state[i] = qcomplex_t(std::cos(0.7 * i), std::sin(0.3 * i + 1));
+		norm += std::norm(init_state[i]);
+	}
+	for (auto& amplitude : init_state)
+	{
+		amplitude /= std::sqrt(norm);
+	}
+
+	/* kept in memory, in a file of the default and of a given directory, and in memory when no file can be made */
+	check_init_state_reload<double>(init_state, qubit_num, 0);
+	check_init_state_reload<float>(init_state, qubit_num, 0);
+	check_init_state_reload<double>(init_state, qubit_num, 1);
+	check_init_state_reload<float>(init_state, qubit_num, 1);
+	check_init_state_reload<double>(init_state, qubit_num, 1, ".");
+	check_init_state_reload<float>(init_state, qubit_num, 1, ".");
+	check_init_state_reload<double>(init_state, qubit_num, 1, "./qpanda_missing_dir");
+	check_init_state_reload<float>(init_state, qubit_num, 1, "./qpanda_missing_dir");
+
+	/* the state of a few qubits is spread over the register as it is kept */
+	{
+		CPUQVM qvm;
+		qvm.init();
+		auto q = qvm.qAllocMany(qubit_num);
+		QStat sub_state = { 0.5, qcomplex_t(0, 0.5), -0.5, qcomplex_t(0.3, 0.4) };
+		qvm.initState(sub_state, { q[4], q[1] });
+		QProg prog;
+		qvm.directlyRun(prog);
+		auto state = qvm.getQState();
+		for (size_t i = 0; i < state.size(); ++i)
+		{
+			size_t index = ((i >> 4) & 1) | (((i >> 1) & 1) << 1);
+			EXPECT_EQ(state[i], (i & ~0x12ull) ? qcomplex_t(0) : sub_state[index]);
+		}
+		qvm.finalize();
+	}
+
+	for (bool is_double : { true, false })
+	{
+		CPUQVM qvm;
+		qvm.init(is_double);
+		auto q = qvm.qAllocMany(qubit_num);
+		QProg prog;
+		prog << H(q[2]) << Reset(q[4]) << CNOT(q[0], q[5]) << RY(q[1], 0.4);
+
+		/* the same seed for every run keeps the reset outcome */
+		PhiloxRandomEngine rng(2021);
+		qvm.set_random_engine(&rng);
+		qvm.initState(init_state);
+		qvm.directlyRun(prog);
+		auto state = qvm.getQState();
+		for (int run = 0; run < 2; ++run)
+		{
+			PhiloxRandomEngine rerun_rng(2021);
+			qvm.set_random_engine(&rerun_rng);
+			qvm.directlyRun(prog);
+			EXPECT_EQ(state, qvm.getQState());
+		}
+		qvm.set_random_engine(nullptr);
+		qvm.finalize();
+	}
+}
+
+TEST(CPUQVMTest, QubitCompaction)
+{
+	/* a few qubits at both ends of a wide register */
+	const size_t qubit_num = 20;
+	auto run_prog = [&](bool is_compaction, prob_dict& result) {
+		CPUQVM qvm;
+		qvm.init();
+		qvm.set_qubit_compaction(is_compaction);
+		auto q = qvm.qAllocMany(qubit_num);
+
+		QProg prog;
+		prog << H(q[0]) << RY(q[19], 0.7) << CNOT(q[0], q[17])
+			<< Toffoli(q[0], q[17], q[2]) << CR(q[19], q[2], 0.3) << X(q[5]);
+		qvm.directlyRun(prog);
+		auto state = qvm.getQState();
+		result = qvm.probRunDict(prog, { q[0], q[3], q[5], q[19] });
+		return state;
+	};
+
+	prob_dict compact_result, expect_result;
+	auto compact_state = run_prog(true, compact_result);
+	auto expect_state = run_prog(false, expect_result);
+
+	ASSERT_EQ(compact_state.size(), 1ull << qubit_num);
+	ASSERT_EQ(compact_state.size(), expect_state.size());
+	for (size_t i = 0; i < compact_state.size(); ++i)
+	{
+		EXPECT_NEAR(std::abs(compact_state[i] - expect_state[i]), 0, 1e-10);
+	}
+
+	ASSERT_EQ(compact_result.size(), expect_result.size());
+	for (auto& val : expect_result)
+	{
+		EXPECT_NEAR(compact_result[val.first], val.second, 1e-10);
+	}
+}
+
+TEST(CPUQVMTest, LightConePruning)
+{
+	CPUQVM qvm;
+	qvm.init();
+	auto q = qvm.qAllocMany(20);
+	auto c = qvm.cAllocMany(2);
+
+	QCircuit cir;
+	cir << H(q[1]) << CNOT(q[1], q[2]) << RY(q[3], 0.4).control({ q[2] });
+	QProg prog;
+	prog << H(q[0]) << H(q[2]) << cir.dagger() << RX(q[7], 0.3) << CNOT(q[0], q[7])
+		<< BARRIER(q) << RZ(q[5], 0.2) << H(q[19]) << CNOT(q[18], q[19])
+		<< T(q[3]) << RX(q[12], 1.0) << CZ(q[12], q[3]);
+	for (auto i = 0; i < q.size(); i += 2)
+	{
+		prog << RY(q[i], 0.1 * i);
+	}
+
+	/* only the gates reaching q[3] and q[1] are left, q[9] is kept by a barrier */
+	auto pruned_prog = light_cone_prune(prog, { q[3], q[9], q[1] });
+	EXPECT_LT(getQGateNum(pruned_prog), getQGateNum(prog));
+	EXPECT_EQ(pruned_prog.get_max_qubit_addr(), 12);
+
+	/* off by default, the state left by probRunDict is the one of the whole prog */
+	auto expect = qvm.probRunDict(prog, { q[3], q[9], q[1] });
+	auto state = qvm.getQState();
+	qvm.directlyRun(prog);
+	auto expect_state = qvm.getQState();
+	ASSERT_EQ(state.size(), expect_state.size());
+	for (size_t i = 0; i < state.size(); i++)
+	{
+		EXPECT_NEAR(std::abs(state[i] - expect_state[i]), 0, 1e-12);
+	}
+	qvm.set_light_cone_pruning(true);
+	auto result = qvm.probRunDict(prog, { q[3], q[9], q[1] });
+	ASSERT_EQ(result.size(), expect.size());
+	for (auto& val : expect)
+	{
+		EXPECT_NEAR(result[val.first], val.second, 1e-10);
+	}
+
+	/* the measures are observed as well, no barrier is needed for them */
+	prog << Measure(q[3], c[0]) << Measure(q[1], c[1]);
+	auto pruned_measure_prog = light_cone_prune(prog);
+	EXPECT_EQ(getQGateNum(pruned_measure_prog) + 1, getQGateNum(pruned_prog));
+	auto shots_result = qvm.runWithConfiguration(prog, c, 1000);
+	size_t shots = 0;
+	for (auto& val : shots_result)
+	{
+		shots += val.second;
+	}
+	EXPECT_EQ(shots, 1000);
+}
+
+TEST(CPUQVMTest, OutOfCore)
+{
+	auto build_prog = [](QVec& q) {
+		QProg prog;
+		prog << HadamardQCircuit(q) << CNOT(q[13], q[2]) << RY(q[12], 0.7).control({ q[0], q[11] })
+			<< iSWAP(q[1], q[13]) << CR(q[10], q[3], 0.4) << U3(q[11], 0.1, 0.2, 0.3).dagger()
+			<< SWAP(q[4], q[12]) << CZ(q[13], q[12]) << RX(q[9], 1.1) << Toffoli(q[13], q[12], q[5]);
+		return prog;
+	};
+
+	/* 32 chunks of 2^9 amplitudes, the gates on the top qubits reorder them */
+	expect_cpu_state([](CPUQVM& qvm) { qvm.init_out_of_core("", 1ull << 14); }, 14, build_prog, { 13, 2, 12 }, 1e-10);
+
+	/* a custom initial state is kept in the given directory like the chunks */
+	QStat init_state(1ull << 8);
+	for (size_t i = 0; i < init_state.size(); i++)
+	{
+		init_state[i] = qcomplex_t(std::cos(0.3 * i), std::sin(0.5 * i)) / std::sqrt(256.);
+	}
+	OutOfCoreImplQPU<double> qpu(".", 1ull << 12);
+	qpu.initState(8, init_state);
+	for (int run = 0; run < 2; ++run)
+	{
+		qpu.initState(0, 1, 8);
+		auto state = qpu.getQState();
+		ASSERT_EQ(state.size(), init_state.size());
+		for (size_t i = 0; i < state.size(); i++)
+		{
+			EXPECT_EQ(state[i], init_state[i]);
+		}
+	}
+
+	OutOfCoreImplQPU<double> missing_dir_qpu("./qpanda_missing_dir", 1ull << 12);
+	EXPECT_ANY_THROW(missing_dir_qpu.initState(8, init_state));
+}
+
+TEST(CPUQVMTest, SparseState)
+{
+	auto build_prog = [](QVec& q) {
+		QProg prog;
+		prog << X(q[1]) << X(q[3]) << H(q[0]) << RY(q[2], 0.3);
+		for (size_t i = 0; i + 2 < q.size(); i++)
+		{
+			prog << Toffoli(q[i], q[i + 1], q[i + 2]) << CNOT(q[i + 2], q[i]);
+		}
+		prog << iSWAP(q[4], q[12]) << CR(q[12], q[0], 0.4) << S(q[13]).dagger()
+			<< SWAP(q[5], q[13]) << H(q[0]);
+		return prog;
+	};
+
+	expect_cpu_state([](CPUQVM& qvm) { qvm.init_sparse(); }, 14, build_prog, { 0, 12, 13 }, 1e-10);
+
+	/* a 40 qubit GHZ state is two amplitudes */
+	CPUQVM ghz_qvm;
+	ghz_qvm.setConfigure({ 40, 40 });
+	ghz_qvm.init_sparse();
+	auto ghz_q = ghz_qvm.qAllocMany(40);
+	QProg ghz_prog;
+	ghz_prog << H(ghz_q[0]);
+	for (size_t i = 0; i + 1 < ghz_q.size(); i++)
+	{
+		ghz_prog << CNOT(ghz_q[i], ghz_q[i + 1]);
+	}
+
+	auto result = ghz_qvm.probRunDict(ghz_prog, { ghz_q[0], ghz_q[20], ghz_q[39] });
+	EXPECT_NEAR(result["000"], 0.5, 1e-10);
+	EXPECT_NEAR(result["111"], 0.5, 1e-10);
+}
+
+TEST(CPUQVMTest, DistributedState)
+{
+	/* runs on any power of 2 ranks, e.g. mpirun -np 4 Core.test --gtest_filter=CPUQVMTest.DistributedState */
+	auto build_prog = [](QVec& q) {
+		QProg prog;
+		prog << HadamardQCircuit(q) << CNOT(q[11], q[2]) << RY(q[10], 0.7).control({ q[0], q[11] })
+			<< iSWAP(q[1], q[11]) << CR(q[10], q[11], 0.4) << U3(q[11], 0.1, 0.2, 0.3).dagger()
+			<< SWAP(q[4], q[10]) << Toffoli(q[11], q[10], q[5]) << RZZ(q[3], q[11], 0.6);
+		return prog;
+	};
+
+	expect_cpu_state([](CPUQVM& qvm) { qvm.init_distributed(); }, 12, build_prog, { 11, 2, 10 }, 1e-10);
+}
+
+TEST(CPUQVMTest, EntanglementEntropy)
+{
+	CPUQVM qvm;
+	qvm.init();
+	auto q = qvm.qAllocMany(17);
+
+	/* GHZ on q[0], q[1], q[16], q[2] apart, the others unused and compacted away */
+	QProg prog;
+	prog << H(q[0]) << CNOT(q[0], q[1]) << CNOT(q[1], q[16])
+		<< RY(q[2], 0.8) << RX(q[3], 0.3) << CNOT(q[3], q[2]);
+	qvm.directlyRun(prog);
+	auto state = qvm.getQState();
+
+	/* trace out the other qubits of the copied state */
+	QVec rho_qubits = { q[16], q[5], q[2] };
+	const size_t dim = 1ull << rho_qubits.size();
+	QStat expect_rho(dim * dim, 0);
+	size_t mask = 0;
+	for (auto qubit : rho_qubits)
+	{
+		mask |= 1ull << qubit->get_phy_addr();
+	}
+	auto sub_index = [&](size_t index) {
+		size_t sub = 0;
+		for (size_t j = 0; j < rho_qubits.size(); ++j)
+		{
+			sub |= ((index >> rho_qubits[j]->get_phy_addr()) & 1) << j;
+		}
+		return sub;
+	};
+	for (size_t i = 0; i < state.size(); ++i)
+	{
+		/* j runs over the indices that differ from i in the bits of the qubits only */
+		for (size_t bits = mask; ; bits = (bits - 1) & mask)
+		{
+			size_t j = (i & ~mask) | bits;
+			expect_rho[sub_index(i) * dim + sub_index(j)] += state[i] * std::conj(state[j]);
+			if (0 == bits)
+			{
+				break;
+			}
+		}
+	}
+
+	auto rho = qvm.get_reduced_density_matrix(rho_qubits);
+	ASSERT_EQ(rho.size(), expect_rho.size());
+	for (size_t i = 0; i < rho.size(); ++i)
+	{
+		EXPECT_NEAR(std::abs(rho[i] - expect_rho[i]), 0, 1e-10);
+	}
+
+	/* one bit across any cut of the GHZ state, whatever the order */
+	EXPECT_NEAR(qvm.get_entanglement_entropy({ q[1] }), 1, 1e-10);
+	EXPECT_NEAR(qvm.get_entanglement_entropy({ q[0], q[16] }, 2), 1, 1e-10);
+	EXPECT_NEAR(qvm.get_entanglement_entropy({ q[0], q[1], q[16] }), 0, 1e-10);
+	EXPECT_NEAR(qvm.get_entanglement_entropy({ q[5] }), 0, 1e-10);
+
+	auto spectrum = qvm.get_schmidt_spectrum({ q[0], q[1], q[16], q[2] });
+	auto rho_3 = qvm.get_reduced_density_matrix({ q[3] });
+	auto expect_spectrum = density_matrix_spectrum(rho_3);
+	ASSERT_GE(spectrum.size(), expect_spectrum.size());
+	for (size_t i = 0; i < spectrum.size(); ++i)
+	{
+		EXPECT_NEAR(spectrum[i], i < expect_spectrum.size() ? expect_spectrum[i] : 0, 1e-10);
+	}
+	EXPECT_NEAR(qvm.get_entanglement_entropy({ q[3] }), spectrum_entropy(expect_spectrum), 1e-10);
+
+	qvm.finalize();
+}
+
+TEST(CPUQVMTest, ShotSampler)
+{
+	prob_vec probs = { 0.1, 0, 0.25, 0.05, 0, 0.6 };
+	ShotSampler sampler(probs);
+	const size_t shots = 200000;
+
+	/* the counts only depend on the seed */
+	auto counts = sampler.sample_counts(shots, 2021);
+	EXPECT_EQ(counts, sampler.sample_counts(shots, 2021));
+
+	size_t total = 0;
+	for (const auto& item : counts)
+	{
+		ASSERT_LT(item.first, probs.size());
+		EXPECT_GT(probs[item.first], 0);
+		EXPECT_NEAR((double)item.second / shots, probs[item.first], 0.01);
+		total += item.second;
+	}
+	EXPECT_EQ(total, shots);
+
+	CPUQVM qvm;
+	qvm.init();
+	auto q = qvm.qAllocMany(3);
+	auto c = qvm.cAllocMany(3);
+
+	/* c[0] reads q[2], which is always 1, c[2] is never measured */
+	QProg prog;
+	prog << X(q[2]) << H(q[0]) << RY(q[1], 1.2)
+		<< Measure(q[2], c[0]) << Measure(q[0], c[1]);
+	auto result = qvm.runWithConfiguration(prog, c, 10000);
+
+	total = 0;
+	for (const auto& item : result)
+	{
+		EXPECT_EQ('1', item.first.back());
+		EXPECT_EQ('0', item.first.front());
+		EXPECT_NEAR(item.second / 10000., 0.5, 0.05);
+		total += item.second;
+	}
+	EXPECT_EQ(result.size(), 2);
+	EXPECT_EQ(total, 10000);
+
+	qvm.directlyRun(QProg() << RY(q[1], 1.2));
+	auto quick_result = qvm.quickMeasure({ q[1] }, 10000);
+	EXPECT_NEAR(quick_result["1"] / 10000., std::pow(std::sin(0.6), 2), 0.03);
+	EXPECT_EQ(quick_result["0"] + quick_result["1"], 10000);
+
+	qvm.finalize();
+}
+
+TEST(CPUQVMTest, ShotBranching)
+{
+	auto check_branches = [](QuantumMachine& qvm, bool has_reset) {
+		auto q = qvm.qAllocMany(4);
+		auto c = qvm.cAllocMany(5);
+
+		/* c[1] copies c[0] through a qif, the qwhile repeats until c[4] is 1 */
+		QProg prog;
+		prog << H(q[0]) << Measure(q[0], c[0])
+			<< CreateIfProg(c[0] == 1, QProg() << X(q[1])) << Measure(q[1], c[1])
+			<< RY(q[2], 1.0) << Measure(q[2], c[2]);
+		if (has_reset)
+		{
+			prog << Reset(q[2]);
+		}
+		prog << Measure(q[2], c[3])
+			<< H(q[3]) << Measure(q[3], c[4])
+			<< CreateWhileProg(c[4] == 0, QProg() << H(q[3]) << Measure(q[3], c[4]));
+
+		const size_t shots = 4000;
+		auto result = qvm.runWithConfiguration(prog, c, shots);
+		size_t total = 0, ones_0 = 0, ones_2 = 0;
+		for (const auto& item : result)
+		{
+			/* the string is c[4] ... c[0] */
+			EXPECT_EQ(item.first[4], item.first[3]);
+			EXPECT_EQ('1', item.first[0]);
+			EXPECT_EQ(has_reset ? '0' : item.first[2], item.first[1]);
+			total += item.second;
+			ones_0 += '1' == item.first[4] ? item.second : 0;
+			ones_2 += '1' == item.first[2] ? item.second : 0;
+		}
+		EXPECT_EQ(total, shots);
+		EXPECT_NEAR((double)ones_0 / shots, 0.5, 0.05);
+		EXPECT_NEAR((double)ones_2 / shots, std::pow(std::sin(0.5), 2), 0.05);
+	};
+
+	CPUQVM qvm;
+	qvm.init();
+	check_branches(qvm, true);
+	qvm.finalize();
+
+	MPSQVM mps_qvm;
+	mps_qvm.init();
+	check_branches(mps_qvm, false);
+	mps_qvm.finalize();
+}
+
+TEST(CPUQVMTest, PauliExpectation)
+{
+	CPUQVM qvm;
+	qvm.init();
+	auto q = qvm.qAllocMany(17);
+
+	/* q[3] ... q[15] stay unused and are compacted away */
+	QProg prog;
+	prog << H(q[0]) << CNOT(q[0], q[1]) << RY(q[2], 0.7) << RX(q[16], 0.4)
+		<< CNOT(q[2], q[16]) << RZ(q[1], 0.3) << H(q[2]);
+
+	QHamiltonian hamiltonian = {
+		{ {}, 0.5 },
+		{ { { 0, 'Z' }, { 1, 'Z' } }, 1.5 },
+		{ { { 0, 'X' }, { 1, 'X' } }, -0.8 },
+		{ { { 0, 'Y' }, { 1, 'Y' } }, 0.6 },
+		{ { { 0, 'X' }, { 1, 'Y' } }, 0.9 },
+		{ { { 2, 'Y' }, { 16, 'X' } }, -1.1 },
+		{ { { 2, 'Z' }, { 16, 'Y' }, { 1, 'X' } }, 0.7 },
+		{ { { 16, 'Z' } }, 0.4 },
+		{ { { 5, 'Z' }, { 2, 'X' } }, 0.3 },
+		{ { { 5, 'X' }, { 0, 'Z' } }, 2.0 }
+	};
+
+	/* <psi|P|psi> of every term on the copied state */
+	qvm.directlyRun(prog);
+	auto state = qvm.getQState();
+	double expect = 0;
+	for (const auto& term : hamiltonian)
+	{
+		qcomplex_t sum = 0;
+		for (size_t i = 0; i < state.size(); ++i)
+		{
+			size_t j = i;
+			qcomplex_t phase = 1;
+			for (const auto& pauli : term.first)
+			{
+				bool bit = (i >> q[pauli.first]->get_phy_addr()) & 1;
+				if ('Z' == pauli.second)
+				{
+					phase *= bit ? -1 : 1;
+					continue;
+				}
+				j ^= 1ull << q[pauli.first]->get_phy_addr();
+				if ('Y' == pauli.second)
+				{
+					phase *= bit ? qcomplex_t(0, -1) : qcomplex_t(0, 1);
+				}
+			}
+			sum += std::conj(state[j]) * phase * state[i];
+		}
+		expect += term.second * sum.real();
+	}
+
+	EXPECT_NEAR(qvm.get_expectation(prog, hamiltonian, q), expect, 1e-10);
+	qvm.finalize();
+}
+
+TEST(CPUQVMTest, GroupedExpectation)
+{
+	QHamiltonian hamiltonian = {
+		{ {}, -0.3 },
+		{ { { 0, 'Z' } }, 0.5 },
+		{ { { 0, 'Z' }, { 1, 'Z' } }, 1.2 },
+		{ { { 1, 'Z' }, { 2, 'Z' } }, -0.7 },
+		{ { { 0, 'X' }, { 1, 'X' } }, 0.9 },
+		{ { { 2, 'X' } }, 0.4 },
+		{ { { 1, 'Y' }, { 2, 'Y' } }, -0.6 },
+		{ { { 0, 'X' }, { 2, 'X' } }, 0.2 }
+	};
+
+	/* {ZZ, Z, ZZ}, {XX, X, XX} and {YY} */
+	auto groups = group_qubit_wise_commuting(hamiltonian);
+	ASSERT_EQ(groups.size(), 3);
+	std::vector<size_t> grouped;
+	for (const auto& group : groups)
+	{
+		for (auto index : group.m_terms)
+		{
+			for (const auto& pauli : hamiltonian[index].first)
+			{
+				EXPECT_EQ(group.m_basis.at(pauli.first), pauli.second);
+			}
+			grouped.push_back(index);
+		}
+	}
+	std::sort(grouped.begin(), grouped.end());
+	EXPECT_EQ(grouped, std::vector<size_t>({ 1, 2, 3, 4, 5, 6, 7 }));
+
+	/* the bits of qubits 0, 1, 2 are the last, middle and first chars */
+	QTerm basis = { { 0, 'Z' }, { 1, 'Z' }, { 2, 'Z' } };
+	std::map<std::string, size_t> counts = { { "001", 30 }, { "110", 10 } };
+	EXPECT_NEAR(term_expectation({ { 0, 'Z' } }, basis, counts), -0.5, 1e-12);
+	EXPECT_NEAR(term_expectation({ { 1, 'Z' }, { 2, 'Z' } }, basis, counts), 1, 1e-12);
+
+	CPUQVM qvm;
+	qvm.init();
+	auto q = qvm.qAllocMany(3);
+	QProg prog;
+	prog << RY(q[0], 0.9) << H(q[1]) << CNOT(q[1], q[2]) << RX(q[2], 0.5) << CNOT(q[0], q[1]);
+
+	auto exact = qvm.get_expectation(prog, hamiltonian, q);
+	EXPECT_NEAR(qvm.get_expectation(prog, hamiltonian, q, 20000), exact, 0.1);
+	qvm.finalize();
+}
+
+TEST(CPUQVMTest, BatchExecution)
+{
+	CPUQVM qvm;
+	qvm.init();
+	auto q = qvm.qAllocMany(3);
+	auto builder = [&](const std::vector<double>& para) {
+		QProg prog;
+		prog << RY(q[0], para[0]) << CNOT(q[0], q[1]) << RX(q[2], para[1]) << CZ(q[1], q[2]);
+		return prog;
+	};
+
+	std::vector<std::vector<double>> params;
+	for (size_t i = 0; i < 12; ++i)
+	{
+		params.push_back({ 0.3 * i, 1.7 - 0.2 * i });
+	}
+	std::vector<QHamiltonian> hamiltonians = {
+		{ { { { 0, 'Z' }, { 1, 'Z' } }, 0.8 }, { { { 2, 'X' } }, -0.5 } },
+		{ { { { 1, 'Y' }, { 2, 'Y' } }, 1.1 }, { {}, 0.2 } }
+	};
+
+	auto expectations = qvm.batch_expectation(builder, params, hamiltonians, q);
+	auto probs = qvm.batch_prob_list(builder, params, { q[2], q[0] });
+	ASSERT_EQ(expectations.size(), params.size());
+	ASSERT_EQ(probs.size(), params.size());
+	for (size_t i = 0; i < params.size(); ++i)
+	{
+		for (size_t j = 0; j < hamiltonians.size(); ++j)
+		{
+			EXPECT_NEAR(expectations[i][j], qvm.get_expectation(builder(params[i]), hamiltonians[j], q), 1e-10);
+		}
+
+		auto prog = builder(params[i]);
+		qvm.directlyRun(prog);
+		auto expect_probs = qvm.getProbList({ q[2], q[0] });
+		ASSERT_EQ(probs[i].size(), expect_probs.size());
+		for (size_t k = 0; k < expect_probs.size(); ++k)
+		{
+			EXPECT_NEAR(probs[i][k], expect_probs[k], 1e-10);
+		}
+	}
+
+	/* one state fits the memory limit, the points then run one after another */
+	QProgBatchExecution batch_exec(builder, 3);
+	batch_exec.set_memory_limit(sizeof(qcomplex_t) << 3);
+	EXPECT_EQ(batch_exec.worker_num(params.size()), 1);
+	qvm.finalize();
+}
+
+TEST(CPUQVMTest, ConcurrentMachines)
+{
+	/* every thread runs its own machine, addresses resolve to the cbits and qubits of that machine */
+	auto simulate = [](size_t target, size_t& errors) {
+		for (size_t i = 0; i < 20; ++i)
+		{
+			CPUQVM qvm;
+			qvm.init();
+			auto q = qvm.qAllocMany(4);
+			auto c = qvm.cAllocMany(4);
+
+			QProg prog;
+			prog << X(q[target]) << H(q[(target + 1) % 4])
+				<< Measure(q[target], c[0]) << Measure(q[(target + 1) % 4], c[1])
+				<< CreateIfProg(c[0] == 1, QProg() << X(q[(target + 2) % 4]))
+				<< Measure(q[(target + 2) % 4], c[2]);
+
+			std::vector<int> cbits_addr = { 0, 2 };
+			for (const auto& item : qvm.runWithConfiguration(prog, cbits_addr, 100))
+			{
+				errors += "11" != item.first;
+			}
+
+			QProg prob_prog;
+			prob_prog << X(q[target]);
+			auto probs = qvm.probRunList(prob_prog, std::vector<int>{ (int)target });
+			errors += std::abs(probs[1] - 1) > 1e-10;
+			qvm.finalize();
+		}
+	};
+
+	std::vector<size_t> errors(4, 0);
+	std::vector<std::thread> threads;
+	for (size_t i = 0; i < errors.size(); ++i)
+	{
+		threads.emplace_back(simulate, i, std::ref(errors[i]));
+	}
+	for (auto& thread : threads)
+	{
+		thread.join();
+	}
+	for (auto error : errors)
+	{
+		EXPECT_EQ(error, 0);
+	}
+
+	/* an address the machine didn't allocate is not taken from the process-wide pools */
+	CPUQVM other_qvm;
+	other_qvm.init();
+	auto other_q = other_qvm.qAllocMany(6);
+	auto other_c = other_qvm.cAllocMany(6);
+	CPUQVM qvm;
+	qvm.init();
+	auto q = qvm.qAllocMany(2);
+	auto c = qvm.cAllocMany(2);
+	QProg prog;
+	prog << X(q[0]) << Measure(q[0], c[0]);
+	std::vector<int> unallocated_cbits = { 0, 5 };
+	EXPECT_THROW(qvm.runWithConfiguration(prog, unallocated_cbits, 10), std::invalid_argument);
+	EXPECT_THROW(qvm.probRunList(prog, std::vector<int>{ 0, 5 }), std::invalid_argument);
+	std::vector<int> allocated_cbits = { 0 };
+	EXPECT_EQ(qvm.runWithConfiguration(prog, allocated_cbits, 10).at("1"), 10);
+	qvm.finalize();
+	other_qvm.finalize();
+}
+
+TEST(CPUQVMTest, PhiloxRandomEngine)
+{
+	/* known answer of Philox4x32-10 for a zero counter and key */
+	auto block = Philox4x32::block(0, 0, 0);
+	EXPECT_EQ(block[0], 0x6627e8d5u);
+	EXPECT_EQ(block[1], 0xe169c58du);
+	EXPECT_EQ(block[2], 0xbc57ac4cu);
+	EXPECT_EQ(block[3], 0x9b00dbd8u);
+
+	/* the streams of a seed don't depend on the order they are drawn in */
+	PhiloxRandomEngine engine(2021);
+	auto stream_3 = engine.stream(3);
+	auto stream_1 = engine.stream(1);
+	std::vector<uint32_t> values_3, values_1;
+	for (int i = 0; i < 9; ++i)
+	{
+		values_3.push_back(stream_3());
+		values_1.push_back(stream_1());
+	}
+	auto stream_1_again = engine.stream(1);
+	for (int i = 0; i < 9; ++i)
+	{
+		EXPECT_EQ(values_1[i], stream_1_again());
+	}
+	EXPECT_NE(values_1, values_3);
+
+	/* a seeded engine on the machine repeats the shots, measures and branches */
+	auto run = [](uint64_t seed) {
+		PhiloxRandomEngine rng(seed);
+		CPUQVM qvm;
+		qvm.init();
+		qvm.set_random_engine(&rng);
+		auto q = qvm.qAllocMany(4);
+		auto c = qvm.cAllocMany(4);
+
+		QProg terminal_prog;
+		terminal_prog << H(q[0]) << RY(q[1], 0.7) << CNOT(q[1], q[2]) << MeasureAll(q, c);
+		auto result = qvm.runWithConfiguration(terminal_prog, c, 5000);
+
+		QProg branch_prog;
+		branch_prog << H(q[0]) << Measure(q[0], c[0])
+			<< CreateIfProg(c[0] == 1, QProg() << RX(q[1], 1.1)) << Measure(q[1], c[1]);
+		for (const auto& item : qvm.runWithConfiguration(branch_prog, c, 5000))
+		{
+			result["branch " + item.first] = item.second;
+		}
+
+		QProg direct_prog;
+		direct_prog << H(q[0]) << H(q[1]) << H(q[2]) << MeasureAll(q, c);
+		for (int i = 0; i < 8; ++i)
+		{
+			qvm.directlyRun(direct_prog);
+			std::string bits;
+			for (auto cbit : c)
+			{
+				bits += std::to_string(cbit.get_val());
+			}
+			++result["direct " + bits];
+		}
+		qvm.finalize();
+		return result;
+	};
+
+	auto result = run(7);
+	EXPECT_EQ(result, run(7));
+	EXPECT_NE(result, run(8));
+}
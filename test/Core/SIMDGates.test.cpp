@@ -0,0 +1,54 @@
+#include <cstring>
+#include "QPanda.h"
+#include "gtest/gtest.h"
+#include "Core/VirtualQuantumProcessor/SIMDGates.h"
+USING_QPANDA
+using namespace std;
+
+static QStat run_simd_test_circuit(SIMDLevel level)
+{
+    set_simd_level(level);
+
+    CPUQVM qvm;
+    qvm.init();
+    auto q = qvm.qAllocMany(11);
+
+    /* not symmetric in the two qubits, so the qubit order matters */
+    QStat matrix(16);
+    for (auto i = 0; i < 16; ++i)
+    {
+        matrix[i] = qcomplex_t(0.1 * i, 0.05 * (15 - i));
+    }
+
+    QProg prog;
+    for (auto i = 0; i < q.size(); ++i)
+    {
+        prog << H(q[i]) << RX(q[i], 0.2 + i) << U3(q[i], 0.1 * i, 0.7, -0.3 * i);
+    }
+    for (auto i = 0; i < q.size(); ++i)
+    {
+        auto j = (i + 3) % q.size();
+        prog << CNOT(q[i], q[j]) << X(q[j])
+            << CU(0.1, 0.2 * i, 0.3, 0.4, q[j], q[i])
+            << RXX(q[i], q[j], 0.5 + i)
+            << RYY(q[j], q[i], 0.25 * i).dagger()
+            << QDouble(q[j], q[i], matrix);
+    }
+
+    qvm.directlyRun(prog);
+    auto state = qvm.getQState();
+    set_simd_level(detected_simd_level());
+    return state;
+}
+
+TEST(SIMDGates, BitIdenticalToScalar)
+{
+    auto scalar_state = run_simd_test_circuit(SIMDLevel::SCALAR);
+    auto avx2_state = run_simd_test_circuit(SIMDLevel::AVX2);
+    auto best_state = run_simd_test_circuit(detected_simd_level());
+
+    ASSERT_EQ(scalar_state.size(), avx2_state.size());
+    ASSERT_EQ(scalar_state.size(), best_state.size());
+    EXPECT_EQ(0, memcmp(scalar_state.data(), avx2_state.data(), scalar_state.size() * sizeof(qcomplex_t)));
+    EXPECT_EQ(0, memcmp(scalar_state.data(), best_state.data(), scalar_state.size() * sizeof(qcomplex_t)));
+}